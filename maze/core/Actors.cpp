@@ -51,25 +51,35 @@ void PlayingActor::Reset()
     _advancePos = 0;
 }
 
+void PlayingActor::SaveSnapshot(ActorSnapshot& snapshot) const
+{
+    snapshot = ActorSnapshot{};
+    snapshot._pixel = _pixel;
+    snapshot._dir = _dir;
+    snapshot._pressDir = _pressDir;
+    snapshot._advance = _advance;
+    snapshot._advancePos = _advancePos;
+    snapshot._speed = (uint32_t)_speed;
+    snapshot._active = _active;
+}
+
+void PlayingActor::LoadSnapshot(const ActorSnapshot& snapshot)
+{
+    _pixel = snapshot._pixel;
+    _dir = snapshot._dir;
+    _pressDir = snapshot._pressDir;
+    _advance = snapshot._advance;
+    _advancePos = snapshot._advancePos;
+    _speed = snapshot._speed;
+    _active = snapshot._active != 0;
+}
+
 // STATIC_DATA(pod)
 static const int s_nFixedPoint = 0x10000;
 
 size_t PlayingActor::GetAdvanceCount()
 {
-    size_t nAdvanceCount = 0;
-
-    if (_active)
-    {
-        _advancePos += _advance;
-
-        while (_advancePos >= s_nFixedPoint)
-        {
-            nAdvanceCount++;
-            _advancePos -= s_nFixedPoint;
-        }
-    }
-
-    return nAdvanceCount;
+    return _active ? GetAdvanceCount(_advancePos, _advance) : 0;
 }
 
 void PlayingActor::SetSpeed(size_t speed)
@@ -77,11 +87,32 @@ void PlayingActor::SetSpeed(size_t speed)
     if (_speed != speed && _active)
     {
         _speed = speed;
+        _advance = GetAdvanceForSpeed(speed);
+    }
+}
+
+// static
+size_t PlayingActor::GetAdvanceCount(int& advancePos, int advance)
+{
+    size_t nAdvanceCount = 0;
 
-        double renderMultiply = (_speed * PacsPerSecondF()) / (100.0 * IdealFramesPerSecondF());
+    advancePos += advance;
 
-        _advance = (int)(renderMultiply * s_nFixedPoint);
+    while (advancePos >= s_nFixedPoint)
+    {
+        nAdvanceCount++;
+        advancePos -= s_nFixedPoint;
     }
+
+    return nAdvanceCount;
+}
+
+// static
+int PlayingActor::GetAdvanceForSpeed(size_t speed)
+{
+    double renderMultiply = (speed * PacsPerSecondF()) / (100.0 * IdealFramesPerSecondF());
+
+    return (int)(renderMultiply * s_nFixedPoint);
 }
 
 void PlayingActor::AddDelay(size_t delay)
@@ -206,6 +237,22 @@ void PacActor::Reset()
     _stuck = false;
 }
 
+void PacActor::SaveSnapshot(ActorSnapshot& snapshot) const
+{
+    __super::SaveSnapshot(snapshot);
+
+    snapshot._canTurn = _canTurn;
+    snapshot._stuck = _stuck;
+}
+
+void PacActor::LoadSnapshot(const ActorSnapshot& snapshot)
+{
+    __super::LoadSnapshot(snapshot);
+
+    _canTurn = snapshot._canTurn != 0;
+    _stuck = snapshot._stuck != 0;
+}
+
 bool PacActor::CanTurn() const
 {
     return _canTurn;
@@ -241,96 +288,259 @@ void PacActor::OnPressDirChanged()
     _canTurn = true;
 }
 
-GhostActor::GhostActor()
-    : _move(MOVE_NORMAL)
-    , _house(HOUSE_OUTSIDE)
-    , _dotCount(0)
+size_t GetGhostPersonality(size_t nGhost)
 {
+    return nGhost % GHOST_PERSONALITY_COUNT;
 }
 
-GhostActor::GhostActor(const GhostActor& rhs)
+GhostStates::GhostStates()
 {
-    *this = rhs;
 }
 
-GhostActor::~GhostActor()
+GhostStates::~GhostStates()
 {
 }
 
-GhostActor& GhostActor::operator=(const GhostActor& rhs)
+size_t GhostStates::GetCount() const
 {
-    if (this != &rhs)
-    {
-        __super::operator=(rhs);
+    return _active.size();
+}
 
-        _move = rhs._move;
-        _house = rhs._house;
-        _dotCount = rhs._dotCount;
-        _brains = rhs._brains;
+void GhostStates::SetCount(size_t nCount)
+{
+    _active.resize(nCount, true);
+    _pixel.resize(nCount, ff::point_int(0, 0));
+    _dir.resize(nCount, ff::point_int(0, 0));
+    _pressDir.resize(nCount, ff::point_int(0, 0));
+    _move.resize(nCount, MOVE_NORMAL);
+    _house.resize(nCount, HOUSE_OUTSIDE);
+    _speed.resize(nCount, 0);
+    _advance.resize(nCount, 0);
+    _advancePos.resize(nCount, 0);
+    _dotCount.resize(nCount, 0);
+    _brains.resize(nCount);
+}
+
+void GhostStates::Reset(size_t nGhost)
+{
+    _active[nGhost] = true;
+    _pixel[nGhost] = ff::point_int(0, 0);
+    _dir[nGhost] = ff::point_int(0, 0);
+    _pressDir[nGhost] = ff::point_int(0, 0);
+    _move[nGhost] = MOVE_NORMAL;
+    _house[nGhost] = HOUSE_OUTSIDE;
+    _speed[nGhost] = 0;
+    _advance[nGhost] = 0;
+    _advancePos[nGhost] = 0;
+
+    // Leave the brains and dot counter alone
+}
+
+size_t GhostStates::GetAdvanceCount(size_t nGhost)
+{
+    return _active[nGhost] ? PlayingActor::GetAdvanceCount(_advancePos[nGhost], _advance[nGhost]) : 0;
+}
+
+void GhostStates::SetSpeed(size_t nGhost, size_t speed)
+{
+    if (_speed[nGhost] != speed && _active[nGhost])
+    {
+        _speed[nGhost] = speed;
+        _advance[nGhost] = PlayingActor::GetAdvanceForSpeed(speed);
     }
+}
 
-    return *this;
+bool GhostStates::IsActive(size_t nGhost) const
+{
+    return _active[nGhost] != 0;
 }
 
-void GhostActor::Reset()
+void GhostStates::SetActive(size_t nGhost, bool bActive)
 {
-    __super::Reset();
+    _active[nGhost] = bActive;
+}
+
+ff::point_int GhostStates::GetTile(size_t nGhost) const
+{
+    return PixelAndDirToTile(_pixel[nGhost], _dir[nGhost]);
+}
+
+ff::point_int GhostStates::GetPixel(size_t nGhost) const
+{
+    return _pixel[nGhost];
+}
+
+void GhostStates::SetPixel(size_t nGhost, ff::point_int pixel)
+{
+    if (_active[nGhost])
+    {
+        _pixel[nGhost] = pixel;
+    }
+}
 
-    _move = MOVE_NORMAL;
-    _house = HOUSE_OUTSIDE;
+ff::point_int GhostStates::GetDir(size_t nGhost) const
+{
+    return _dir[nGhost];
+}
 
-    // Leave _pBrains the _nDots alone
+void GhostStates::SetDir(size_t nGhost, ff::point_int dir)
+{
+    if (_active[nGhost])
+    {
+        assert(abs(dir.x) <= 1 && abs(dir.y) <= 1);
+
+        _dir[nGhost] = dir;
+    }
 }
 
-IGhostBrains* GhostActor::GetBrains()
+ff::point_int GhostStates::GetPressDir(size_t nGhost) const
 {
-    return _brains.get();
+    return _pressDir[nGhost];
 }
 
-void GhostActor::SetBrains(std::shared_ptr<IGhostBrains> brains)
+void GhostStates::SetPressDir(size_t nGhost, ff::point_int dir)
 {
-    _brains = brains;
+    if (_active[nGhost])
+    {
+        assert(abs(dir.x) <= 1 && abs(dir.y) <= 1);
+
+        _pressDir[nGhost] = dir;
+    }
 }
 
-MoveState GhostActor::GetMoveState() const
+MoveState GhostStates::GetMoveState(size_t nGhost) const
 {
-    return _move;
+    return _move[nGhost];
 }
 
-void GhostActor::SetMoveState(MoveState state)
+void GhostStates::SetMoveState(size_t nGhost, MoveState state)
 {
-    if (_active)
+    if (_active[nGhost])
     {
-        _move = state;
+        _move[nGhost] = state;
     }
 }
 
-HouseState GhostActor::GetHouseState() const
+HouseState GhostStates::GetHouseState(size_t nGhost) const
 {
-    return _house;
+    return _house[nGhost];
 }
 
-void GhostActor::SetHouseState(HouseState state)
+void GhostStates::SetHouseState(size_t nGhost, HouseState state)
 {
-    if (_active)
+    if (_active[nGhost])
     {
-        _house = state;
+        _house[nGhost] = state;
     }
 }
 
-size_t GhostActor::GetDotCounter() const
+size_t GhostStates::GetDotCounter(size_t nGhost) const
 {
-    return _dotCount;
+    return _dotCount[nGhost];
 }
 
-void GhostActor::SetDotCounter(size_t dotCount)
+void GhostStates::SetDotCounter(size_t nGhost, size_t dotCount)
 {
-    if (_active)
+    if (_active[nGhost])
     {
-        _dotCount = dotCount;
+        _dotCount[nGhost] = dotCount;
     }
 }
 
+void GhostStates::SaveSnapshot(size_t nGhost, ActorSnapshot& snapshot) const
+{
+    snapshot = ActorSnapshot{};
+    snapshot._pixel = _pixel[nGhost];
+    snapshot._dir = _dir[nGhost];
+    snapshot._pressDir = _pressDir[nGhost];
+    snapshot._advance = _advance[nGhost];
+    snapshot._advancePos = _advancePos[nGhost];
+    snapshot._speed = (uint32_t)_speed[nGhost];
+    snapshot._dotCount = (uint32_t)_dotCount[nGhost];
+    snapshot._active = _active[nGhost];
+    snapshot._move = (uint8_t)_move[nGhost];
+    snapshot._house = (uint8_t)_house[nGhost];
+}
+
+void GhostStates::LoadSnapshot(size_t nGhost, const ActorSnapshot& snapshot)
+{
+    _pixel[nGhost] = snapshot._pixel;
+    _dir[nGhost] = snapshot._dir;
+    _pressDir[nGhost] = snapshot._pressDir;
+    _advance[nGhost] = snapshot._advance;
+    _advancePos[nGhost] = snapshot._advancePos;
+    _speed[nGhost] = snapshot._speed;
+    _dotCount[nGhost] = snapshot._dotCount;
+    _active[nGhost] = snapshot._active != 0;
+    _move[nGhost] = (MoveState)snapshot._move;
+    _house[nGhost] = (HouseState)snapshot._house;
+}
+
+IGhostBrains* GhostStates::GetBrains(size_t nGhost)
+{
+    return _brains[nGhost].get();
+}
+
+void GhostStates::SetBrains(size_t nGhost, std::shared_ptr<IGhostBrains> brains)
+{
+    _brains[nGhost] = brains;
+}
+
+GhostActor::GhostActor(std::shared_ptr<GhostStates> states, size_t nGhost)
+    : _states(states)
+    , _ghost(nGhost)
+{
+}
+
+GhostActor::~GhostActor()
+{
+}
+
+ff::point_int GhostActor::GetTile() const
+{
+    return _states->GetTile(_ghost);
+}
+
+ff::point_int GhostActor::GetPixel() const
+{
+    return _states->GetPixel(_ghost);
+}
+
+void GhostActor::SetPixel(ff::point_int pixel)
+{
+    _states->SetPixel(_ghost, pixel);
+}
+
+ff::point_int GhostActor::GetDir() const
+{
+    return _states->GetDir(_ghost);
+}
+
+void GhostActor::SetDir(ff::point_int dir)
+{
+    _states->SetDir(_ghost, dir);
+}
+
+ff::point_int GhostActor::GetPressDir() const
+{
+    return _states->GetPressDir(_ghost);
+}
+
+void GhostActor::SetPressDir(ff::point_int dir)
+{
+    _states->SetPressDir(_ghost, dir);
+}
+
+bool GhostActor::IsActive() const
+{
+    return _states->IsActive(_ghost);
+}
+
+void GhostActor::SetActive(bool bActive)
+{
+    _states->SetActive(_ghost, bActive);
+}
+
 FruitActor::FruitActor()
     : _type(FRUIT_0)
     , _exitTile(0, 0)
@@ -353,7 +563,6 @@ FruitActor& FruitActor::operator=(const FruitActor& rhs)
     {
         _type = rhs._type;
         _exitTile = rhs._exitTile;
-        _brains = rhs._brains;
 
         __super::operator=(rhs);
     }
@@ -368,17 +577,22 @@ void FruitActor::Reset()
     _active = false;
     _type = FRUIT_0;
     _exitTile = ff::point_int(0, 0);
-    _brains = nullptr;
 }
 
-IGhostBrains* FruitActor::GetBrains()
+void FruitActor::SaveSnapshot(ActorSnapshot& snapshot) const
 {
-    return _brains.get();
+    __super::SaveSnapshot(snapshot);
+
+    snapshot._fruitType = (int32_t)_type;
+    snapshot._exitTile = _exitTile;
 }
 
-void FruitActor::SetBrains(std::shared_ptr<IGhostBrains> brains)
+void FruitActor::LoadSnapshot(const ActorSnapshot& snapshot)
 {
-    _brains = brains;
+    __super::LoadSnapshot(snapshot);
+
+    _type = (FruitType)snapshot._fruitType;
+    _exitTile = snapshot._exitTile;
 }
 
 FruitType FruitActor::GetType() const
@@ -19,6 +19,26 @@ enum HouseState
     HOUSE_LEAVING,
 };
 
+// Everything about an actor that changes while playing, with fixed size fields so that it can be saved to disk
+struct ActorSnapshot
+{
+    ff::point_int _pixel;
+    ff::point_int _dir;
+    ff::point_int _pressDir;
+    ff::point_int _exitTile; // fruit
+    int32_t _advance;
+    int32_t _advancePos;
+    uint32_t _speed;
+    uint32_t _dotCount; // ghosts
+    int32_t _fruitType; // fruit
+    uint8_t _active;
+    uint8_t _canTurn; // Pac
+    uint8_t _stuck; // Pac
+    uint8_t _move; // ghosts
+    uint8_t _house; // ghosts
+    uint8_t _padding[3];
+};
+
 class IPlayingActor
 {
 public:
@@ -50,10 +70,18 @@ public:
 
     virtual void Reset(); // between lives
 
+    // Loading doesn't call OnTileChanged or OnPressDirChanged, the snapshot already has their results
+    virtual void SaveSnapshot(ActorSnapshot& snapshot) const;
+    virtual void LoadSnapshot(const ActorSnapshot& snapshot);
+
     size_t GetAdvanceCount();
     void SetSpeed(size_t speed); // 0 - 100
     void AddDelay(size_t delay);
 
+    // Fixed point movement, shared with GhostStates
+    static size_t GetAdvanceCount(int& advancePos, int advance);
+    static int GetAdvanceForSpeed(size_t speed);
+
     // IPlayingActor
 
     virtual ff::point_int GetTile() const override;
@@ -93,6 +121,8 @@ public:
     PacActor& operator=(const PacActor& rhs);
 
     virtual void Reset() override;
+    virtual void SaveSnapshot(ActorSnapshot& snapshot) const override;
+    virtual void LoadSnapshot(const ActorSnapshot& snapshot) override;
 
     bool CanTurn() const;
     void SetCanTurn(bool canTurn);
@@ -108,34 +138,94 @@ protected:
     bool _stuck;
 };
 
-class GhostActor : public PlayingActor
+const size_t GHOST_PERSONALITY_COUNT = 4; // red, pink, blue, orange
+const size_t MAX_GHOST_COUNT = 1024;
+
+// Brains, colors, and stats repeat every GHOST_PERSONALITY_COUNT ghosts
+size_t GetGhostPersonality(size_t nGhost);
+
+// Every ghost in a maze, with one array per field so that updating a big swarm of ghosts stays cheap.
+// Like PlayingActor, changes to an inactive ghost are ignored.
+class GhostStates
 {
 public:
-    GhostActor();
-    GhostActor(const GhostActor& rhs);
-    ~GhostActor();
+    GhostStates();
+    ~GhostStates();
 
-    GhostActor& operator=(const GhostActor& rhs);
+    size_t GetCount() const;
+    void SetCount(size_t nCount);
+    void Reset(size_t nGhost); // between lives
 
-    virtual void Reset() override;
+    void SaveSnapshot(size_t nGhost, ActorSnapshot& snapshot) const;
+    void LoadSnapshot(size_t nGhost, const ActorSnapshot& snapshot);
 
-    IGhostBrains* GetBrains();
-    void SetBrains(std::shared_ptr<IGhostBrains> brains);
+    size_t GetAdvanceCount(size_t nGhost);
+    void SetSpeed(size_t nGhost, size_t speed); // 0 - 100
 
-    MoveState GetMoveState() const;
-    void SetMoveState(MoveState state);
+    bool IsActive(size_t nGhost) const;
+    void SetActive(size_t nGhost, bool bActive);
 
-    HouseState GetHouseState() const;
-    void SetHouseState(HouseState state);
+    ff::point_int GetTile(size_t nGhost) const;
+    ff::point_int GetPixel(size_t nGhost) const;
+    void SetPixel(size_t nGhost, ff::point_int pixel);
 
-    size_t GetDotCounter() const;
-    void SetDotCounter(size_t dotCount);
+    ff::point_int GetDir(size_t nGhost) const;
+    void SetDir(size_t nGhost, ff::point_int dir);
 
-protected:
-    size_t _dotCount;
-    MoveState _move;
-    HouseState _house;
-    std::shared_ptr<IGhostBrains> _brains;
+    ff::point_int GetPressDir(size_t nGhost) const;
+    void SetPressDir(size_t nGhost, ff::point_int dir);
+
+    MoveState GetMoveState(size_t nGhost) const;
+    void SetMoveState(size_t nGhost, MoveState state);
+
+    HouseState GetHouseState(size_t nGhost) const;
+    void SetHouseState(size_t nGhost, HouseState state);
+
+    size_t GetDotCounter(size_t nGhost) const;
+    void SetDotCounter(size_t nGhost, size_t dotCount);
+
+    IGhostBrains* GetBrains(size_t nGhost);
+    void SetBrains(size_t nGhost, std::shared_ptr<IGhostBrains> brains);
+
+private:
+    std::vector<BYTE> _active;
+    std::vector<ff::point_int> _pixel;
+    std::vector<ff::point_int> _dir;
+    std::vector<ff::point_int> _pressDir;
+    std::vector<MoveState> _move;
+    std::vector<HouseState> _house;
+    std::vector<size_t> _speed;
+    std::vector<int> _advance;
+    std::vector<int> _advancePos;
+    std::vector<size_t> _dotCount;
+    std::vector<std::shared_ptr<IGhostBrains>> _brains;
+};
+
+// One ghost from GhostStates, for code that works with any kind of actor
+class GhostActor : public IPlayingActor
+{
+public:
+    GhostActor(std::shared_ptr<GhostStates> states, size_t nGhost);
+    ~GhostActor();
+
+    // IPlayingActor
+
+    virtual ff::point_int GetTile() const override;
+    virtual ff::point_int GetPixel() const override;
+    virtual void SetPixel(ff::point_int pixel) override;
+
+    virtual ff::point_int GetDir() const override;
+    virtual void SetDir(ff::point_int dir) override;
+
+    virtual ff::point_int GetPressDir() const override;
+    virtual void SetPressDir(ff::point_int dir) override;
+
+    virtual bool IsActive() const override;
+    virtual void SetActive(bool bActive) override;
+
+private:
+    std::shared_ptr<GhostStates> _states;
+    size_t _ghost;
 };
 
 class FruitActor : public PlayingActor
@@ -148,9 +238,8 @@ public:
     FruitActor& operator=(const FruitActor& rhs);
 
     virtual void Reset() override;
-
-    IGhostBrains* GetBrains();
-    void SetBrains(std::shared_ptr<IGhostBrains> brains);
+    virtual void SaveSnapshot(ActorSnapshot& snapshot) const override;
+    virtual void LoadSnapshot(const ActorSnapshot& snapshot) override;
 
     FruitType GetType() const;
     void SetType(FruitType type);
@@ -161,7 +250,6 @@ public:
 protected:
     FruitType _type;
     ff::point_int _exitTile;
-    std::shared_ptr<IGhostBrains> _brains;
 };
 
 class PointActor : public PlayingActor
@@ -1,7 +1,10 @@
 #include "pch.h"
 #include "Core/Audio.h"
 #include "Core/GlobalResources.h"
-#include "States/PacApplication.h"
+#include "Core/Helpers.h"
+
+static bool s_bSoundOn = true;
+static bool s_bVibrateOn = true;
 
 class SoundEffects : public ISoundEffects
 {
@@ -28,12 +31,36 @@ private:
     AudioEffect _curBG;
 };
 
+// Doesn't load or play anything
+class SilentSoundEffects : public ISoundEffects
+{
+public:
+    virtual void Play(AudioEffect effect) override {}
+    virtual void Stop(AudioEffect effect) override {}
+    virtual void StopAll() override {}
+
+    virtual AudioEffect GetBG() override { return EFFECT_INVALID; }
+    virtual void StopBG() override {}
+};
+
 // static
 std::shared_ptr<ISoundEffects> ISoundEffects::Create(CharType type)
 {
+    if (IsHeadless())
+    {
+        return std::make_shared<SilentSoundEffects>();
+    }
+
     return std::make_shared<SoundEffects>(type);
 }
 
+// static
+void ISoundEffects::SetEnabled(bool bSound, bool bVibrate)
+{
+    s_bSoundOn = bSound;
+    s_bVibrateOn = bVibrate;
+}
+
 SoundEffects::SoundEffects(CharType type)
     : _curBG(EFFECT_INVALID)
 {
@@ -162,14 +189,10 @@ bool SoundEffects::IsBG(AudioEffect effect) const
 
 bool SoundEffects::IsEnabled() const
 {
-    const ff::dict& options = PacApplication::Get()->GetOptions();
-    bool soundOn = options.get<bool>(PacApplication::OPTION_SOUND_ON, PacApplication::DEFAULT_SOUND_ON);
-    return soundOn;
+    return s_bSoundOn;
 }
 
 bool SoundEffects::IsVibrateEnabled() const
 {
-    const ff::dict& options = PacApplication::Get()->GetOptions();
-    bool vibrateOn = options.get<bool>(PacApplication::OPTION_VIBRATE_ON, PacApplication::DEFAULT_VIBRATE_ON);
-    return vibrateOn;
+    return s_bVibrateOn;
 }
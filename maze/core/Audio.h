@@ -34,7 +34,8 @@ class ISoundEffects
 public:
     virtual ~ISoundEffects() = default;
 
-    static std::shared_ptr<ISoundEffects> Create(CharType type);
+    static std::shared_ptr<ISoundEffects> Create(CharType type); // silent when headless
+    static void SetEnabled(bool bSound, bool bVibrate); // from the app's options
 
     virtual void Play(AudioEffect effect) = 0;
     virtual void Stop(AudioEffect effect) = 0;
@@ -1,23 +1,32 @@
 #include "pch.h"
 #include "Core/Actors.h"
 #include "Core/Difficulty.h"
+#include "Core/Random.h"
 
-static const Difficulty s_emptyDifficulty
+static Difficulty CreateEmptyDifficulty()
 {
-    4, // _ghostCount
-    80, // _pacSpeed
-    0, // _pacSubtract
-    0, // _pacAdd
-    20, // _elroyDots
-    6, // _scaredSeconds
-    { 7, 20, 7, 20, 5, 20, 5, 0 }, // _ghostModeSeconds
-    { 0, 0, 30, 60 }, // _ghostDotCounter
-    4, // _lastDotSeconds
-    FRUIT_0 // _fruit
-};
+    Difficulty diff
+    {
+        4, // _ghostCount
+        80, // _pacSpeed
+        0, // _pacSubtract
+        0, // _pacAdd
+        20, // _elroyDots
+        6, // _scaredSeconds
+        { 7, 20, 7, 20, 5, 20, 5, 0 }, // _ghostModeSeconds
+        { 0, 0, 30, 60 }, // _ghostDotCounter
+        4, // _lastDotSeconds
+        FRUIT_0, // _fruit
+        false, // _pathTargeting
+    };
+
+    std::copy_n(GetClassicGhostPersonalities(), _countof(diff._personalities), diff._personalities);
+    return diff;
+}
 
 const Difficulty& GetEmptyDifficulty()
 {
+    static const Difficulty s_emptyDifficulty = CreateEmptyDifficulty();
     return s_emptyDifficulty;
 }
 
@@ -31,6 +40,10 @@ static std::string_view PROP_LAST_DOT("lastDotSecondsUntilGhost");
 static std::string_view PROP_FRUIT("fruit");
 static std::string_view PROP_GHOST_MODE("ghostModeSeconds");
 static std::string_view PROP_GHOST_DOTS("ghostDots");
+static std::string_view PROP_PATH_TARGETING("pathTargeting");
+static std::string_view PROP_PERSONALITIES("ghostPersonalities");
+static std::string_view PROP_CHASE("chase");
+static std::string_view PROP_SCATTER("scatter");
 
 static bool GetDifficultyBasics(const ff::dict& dict, std::vector<Difficulty>& diffs)
 {
@@ -132,6 +145,40 @@ bool CreateDifficultiesFromDict(const ff::dict& dict, std::vector<Difficulty>& d
         }
     }
 
+    bool bPathTargeting = dict.get<bool>(PROP_PATH_TARGETING, false);
+    for (Difficulty& diff : diffs)
+    {
+        diff._pathTargeting = bPathTargeting;
+    }
+
+    // Compiled now so that ghosts never look at the strings while playing
+
+    ff::value_ptr personalitiesValue = dict.get(PROP_PERSONALITIES);
+    if (personalitiesValue)
+    {
+        assert_ret_val(personalitiesValue->is_type<std::vector<ff::value_ptr>>(), false);
+        std::vector<ff::value_ptr> values = personalitiesValue->get<std::vector<ff::value_ptr>>();
+
+        for (size_t i = 0; i < _countof(Difficulty::_personalities) && i < values.size(); i++)
+        {
+            ff::value_ptr personalityValue = values[i]->try_convert<ff::dict>();
+            assert_ret_val(personalityValue, false);
+
+            const ff::dict& personalityDict = personalityValue->get<ff::dict>();
+            GhostPersonality personality;
+
+            assert_ret_val(CompileGhostPersonality(
+                personalityDict.get<std::string>(PROP_CHASE),
+                personalityDict.get<std::string>(PROP_SCATTER),
+                personality), false);
+
+            for (Difficulty& diff : diffs)
+            {
+                diff._personalities[i] = personality;
+            }
+        }
+    }
+
     return !diffs.empty();
 }
 
@@ -206,11 +253,11 @@ size_t Difficulty::GetEatenFrames() const
     return ff::constants::updates_per_second<size_t>() * 9 / 10;
 }
 
-size_t Difficulty::GetGhostDotCounter(size_t nGhost) const
+size_t Difficulty::GetGhostDotCounter(size_t nPersonality) const
 {
-    assert_ret_val(nGhost >= 0 && nGhost < _countof(_ghostDotCounter), 0);
+    assert_ret_val(nPersonality >= 0 && nPersonality < _countof(_ghostDotCounter), 0);
 
-    return _ghostDotCounter[nGhost];
+    return _ghostDotCounter[nPersonality];
 }
 
 size_t Difficulty::GetGlobalDotCounter(size_t nIndex) const
@@ -230,10 +277,10 @@ size_t Difficulty::GetLastDotFrames() const
     return _lastDotSeconds * ff::constants::updates_per_second<size_t>();
 }
 
-size_t Difficulty::GetFruitFrames(CharType type) const
+size_t Difficulty::GetFruitFrames(CharType type, Random& random) const
 {
     int seconds = IsFruitMoving(type) ? 14 : 9;
-    return seconds * ff::constants::updates_per_second<size_t>() + (rand() % ff::constants::updates_per_second<size_t>());
+    return seconds * ff::constants::updates_per_second<size_t>() + random.Next(ff::constants::updates_per_second<size_t>());
 }
 
 FruitType Difficulty::GetFruit() const
@@ -251,6 +298,11 @@ bool Difficulty::HasRandomGhostMovement(CharType type) const
     return type == CHAR_MS;
 }
 
+bool Difficulty::UsesPathTargeting() const
+{
+    return _pathTargeting;
+}
+
 void Difficulty::GetGhostModeFrames(size_t nIndex, size_t& nScatter, size_t& nChase) const
 {
     size_t nMinScatter = 1 * ff::constants::updates_per_second<size_t>();
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "Core/Actors.h"
+#include "Core/GhostPersonality.h"
+
 enum MoveState;
 enum HouseState;
+class Random;
 
 enum CharType
 {
@@ -40,9 +44,11 @@ struct Difficulty
     size_t _elroyDots;
     size_t _scaredSeconds;
     size_t _ghostModeSeconds[8]; // scatter, chase, scatter, ...
-    size_t _ghostDotCounter[4]; // initial dots eaten before leaving house
+    size_t _ghostDotCounter[GHOST_PERSONALITY_COUNT]; // initial dots eaten before leaving house
     size_t _lastDotSeconds; // seconds after eating last dot before a ghost is released
     FruitType _fruit;
+    bool _pathTargeting; // ghosts measure distance to their target by walking the maze
+    GhostPersonality _personalities[GHOST_PERSONALITY_COUNT]; // compiled chase and scatter targets
 
     // Helper functions
 
@@ -53,13 +59,14 @@ struct Difficulty
     size_t GetGhostSpeed(MoveState move, HouseState house, bool bTunnel, bool bElroy, size_t nDotsLeft) const;
     size_t GetScaredFrames() const;
     size_t GetEatenFrames() const;
-    size_t GetGhostDotCounter(size_t nGhost) const;
+    size_t GetGhostDotCounter(size_t nPersonality) const;
     size_t GetGlobalDotCounter(size_t nIndex) const;
     size_t GetLastDotFrames() const;
-    size_t GetFruitFrames(CharType type) const;
+    size_t GetFruitFrames(CharType type, Random& random) const;
     FruitType GetFruit() const;
     bool IsFruitMoving(CharType type) const;
     bool HasRandomGhostMovement(CharType type) const;
+    bool UsesPathTargeting() const;
 
     void GetGhostModeFrames(size_t nIndex, size_t& nScatter, size_t& nChase) const;
     void GetFruitDotCount(size_t nTotalDots, size_t& nFruit1, size_t& nFruit2) const;
@@ -1,14 +1,34 @@
 #include "pch.h"
 #include "Core/Actors.h"
 #include "Core/GhostBrains.h"
+#include "Core/GhostPersonality.h"
 #include "Core/Helpers.h"
 #include "Core/Maze.h"
+#include "Core/MazeDistances.h"
+#include "Core/MazeFlowField.h"
 #include "Core/PlayingMaze.h"
+#include "Core/Random.h"
+
+static ff::point_int GetGhostTargetPixel(GhostState state, const GhostTargetInputs& inputs, Random& random)
+{
+    switch (state)
+    {
+        default:
+        case GHOST_CHASE:
+            return EvaluateGhostTarget(true, inputs, random);
+
+        case GHOST_SCATTER:
+            return EvaluateGhostTarget(false, inputs, random);
+
+        case GHOST_EYES:
+            return inputs._ghostStartPixel;
+    }
+}
 
 class DefaultGhostBrains : public IGhostBrains
 {
 public:
-    DefaultGhostBrains(size_t nGhost);
+    DefaultGhostBrains(size_t nGhost, size_t nPersonality);
 
     // IGhostBrains
     virtual ff::point_int Decide(
@@ -19,22 +39,21 @@ public:
     virtual ff::point_int GetTargetPixel(IPlayingMaze* pPlay) override;
 
 private:
-    ff::point_int GetScatterPixel(IPlayingMaze* pPlay);
-    ff::point_int GetChasePixel(IPlayingMaze* pPlay);
-
     size_t _nGhost{};
+    size_t _nPersonality{};
 };
 
 // static
-std::shared_ptr<IGhostBrains> IGhostBrains::Create(size_t nGhost)
+std::shared_ptr<IGhostBrains> IGhostBrains::Create(size_t nGhost, size_t nPersonality)
 {
-    return std::make_shared<DefaultGhostBrains>(nGhost);
+    return std::make_shared<DefaultGhostBrains>(nGhost, nPersonality);
 }
 
-DefaultGhostBrains::DefaultGhostBrains(size_t nGhost)
+DefaultGhostBrains::DefaultGhostBrains(size_t nGhost, size_t nPersonality)
     : _nGhost(nGhost)
+    , _nPersonality(nPersonality)
 {
-    assert(nGhost >= 0 && nGhost < 4);
+    assert(nPersonality < GHOST_PERSONALITY_COUNT);
 }
 
 ff::point_int DefaultGhostBrains::Decide(
@@ -51,12 +70,16 @@ ff::point_int DefaultGhostBrains::Decide(
         default:
         case GHOST_CHASE:
         case GHOST_SCATTER:
+            return pPlay->GetDifficulty().UsesPathTargeting()
+                ? DecideForPathTarget(pPlay->GetMaze()->GetDistances(), GetTargetPixel(pPlay), pTiles, nTiles)
+                : DecideForTarget(GetTargetPixel(pPlay), pTiles, nTiles);
+
         case GHOST_EYES:
-            return DecideForTarget(GetTargetPixel(pPlay), pTiles, nTiles);
+            return DecideForFlowField(pPlay->GetMaze()->GetHouseFlowField(), GetTargetPixel(pPlay), pTiles, nTiles);
 
         case GHOST_SCARED:
         case GHOST_SCARED_FLASH:
-            return pTiles[rand() % nTiles];
+            return pTiles[pPlay->GetRandom().Next(nTiles)];
     }
 }
 
@@ -64,97 +87,92 @@ ff::point_int DefaultGhostBrains::GetTargetPixel(IPlayingMaze* pPlay)
 {
     assert_ret_val(pPlay && pPlay->GetMaze(), ff::point_int(0, 0));
 
-    switch (pPlay->GetGhostState(_nGhost))
-    {
-        default:
-        case GHOST_CHASE:
-            return GetChasePixel(pPlay);
-
-        case GHOST_SCATTER:
-            return GetScatterPixel(pPlay);
-
-        case GHOST_EYES:
-            return pPlay->GetGhostStartPixel();
-    }
+    GhostTargetInputs inputs;
+    inputs._pacPixel = pPlay->GetPac()->GetPixel();
+    inputs._pacDir = pPlay->GetPac()->GetDir();
+    inputs._mazeSize = pPlay->GetMaze()->GetSizeInTiles();
+    inputs._leaderPixel = pPlay->GetGhost(_nGhost - _nPersonality)->GetPixel();
+    inputs._ghostPixel = pPlay->GetGhost(_nGhost)->GetPixel();
+    inputs._ghostStartPixel = pPlay->GetGhostStartPixel();
+    inputs._personalities = pPlay->GetDifficulty()._personalities;
+    inputs._personality = _nPersonality;
+    inputs._randomScatter = pPlay->GetDifficulty().HasRandomGhostMovement(pPlay->GetCharType());
+
+    return GetGhostTargetPixel(pPlay->GetGhostState(_nGhost), inputs, pPlay->GetRandom());
 }
 
-ff::point_int DefaultGhostBrains::GetScatterPixel(IPlayingMaze* pPlay)
+ff::point_int DecideForTarget(ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles)
 {
-    ff::point_int size = pPlay->GetMaze()->GetSizeInTiles();
-    size_t nGhost = pPlay->GetDifficulty().HasRandomGhostMovement(pPlay->GetCharType())
-        ? (rand() % 4)
-        : _nGhost;
+    assert_ret_val(pTiles && nTiles, ff::point_int(0, 0));
 
-    switch (nGhost)
-    {
-        default:
-        case 0:
-            return TileCenterToPixel(ff::point_int(size.x - 3, -3));
+    // Find the shortest distance to the target pixel
 
-        case 1:
-            return TileCenterToPixel(ff::point_int(2, -3));
+    size_t nBestChoice = 0;
+    uint64_t nBestDist = std::numeric_limits<uint64_t>::max();
 
-        case 2:
-            return TileCenterToPixel(ff::point_int(size.x - 1, size.y + 1));
+    for (size_t i = 0; i < nTiles; i++)
+    {
+        ff::point_int dist = TileCenterToPixel(pTiles[i]) - targetPixel;
+        uint64_t nDist = (uint64_t)((int64_t)dist.x * dist.x + (int64_t)dist.y * dist.y);
 
-        case 3:
-            return TileCenterToPixel(ff::point_int(0, size.y + 1));
+        if (nDist < nBestDist)
+        {
+            nBestChoice = i;
+            nBestDist = nDist;
+        }
     }
-}
 
-static const size_t s_nMaxOrangeDist =
-(8 * PixelsPerTile().x) * (8 * PixelsPerTile().x) +
-(8 * PixelsPerTile().y) * (8 * PixelsPerTile().y);
+    return pTiles[nBestChoice];
+}
 
-ff::point_int DefaultGhostBrains::GetChasePixel(IPlayingMaze* pPlay)
+ff::point_int DecideForPathTarget(const MazeDistances& distances, ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles)
 {
-    ff::point_int pac = pPlay->GetPac()->GetPixel();
+    size_t dists[4];
+    assert_ret_val(pTiles && nTiles && nTiles <= _countof(dists), ff::point_int(0, 0));
 
-    switch (_nGhost)
-    {
-        default:
-        case 0:
-            return pac;
+    // Targets off the edge or inside walls (like scatter corners) can't be walked to from any choice
 
-        case 1:
-            {
-                ff::point_int offset = pPlay->GetPac()->GetDir();
-                offset.x *= PixelsPerTile().x * 4;
-                offset.y *= PixelsPerTile().y * 4;
+    if (!distances.GetDistances(pTiles, nTiles, PixelToTile(targetPixel), dists))
+    {
+        return DecideForTarget(targetPixel, pTiles, nTiles);
+    }
 
-                return pac + offset;
-            }
+    size_t nBestChoice = 0;
+    float bestDist = std::numeric_limits<float>::max();
 
-        case 2:
-            {
-                ff::point_int offset = pac - pPlay->GetGhost(0)->GetPixel();
+    for (size_t i = 0; i < nTiles; i++)
+    {
+        float dist = (float)dists[i];
 
-                return pac + offset;
-            }
+        if (dists[i] == ff::constants::invalid_unsigned<size_t>())
+        {
+            // Only this choice can't walk there, so guess with the straight line in tiles, which is never longer.
+            // Uses floats to pick the same as PickForPathTarget.
 
-        case 3:
-            {
-                ff::point_int dist = (pac - pPlay->GetGhost(3)->GetPixel());
-                size_t nDist = dist.x * dist.x + dist.y * dist.y;
+            ff::point_int offset = TileCenterToPixel(pTiles[i]) - targetPixel;
+            dist = std::sqrt((float)((int64_t)offset.x * offset.x + (int64_t)offset.y * offset.y)) / (float)PixelsPerTile().x;
+        }
 
-                return nDist >= s_nMaxOrangeDist ? pac : GetScatterPixel(pPlay);
-            }
+        if (dist < bestDist)
+        {
+            nBestChoice = i;
+            bestDist = dist;
+        }
     }
+
+    return pTiles[nBestChoice];
 }
 
-ff::point_int DecideForTarget(ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles)
+ff::point_int DecideForFlowField(const MazeFlowField& field, ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles)
 {
     assert_ret_val(pTiles && nTiles, ff::point_int(0, 0));
 
-    // Find the shortest distance to the target pixel
-
     size_t nBestChoice = 0;
     size_t nBestDist = ff::constants::invalid_unsigned<size_t>();
 
     for (size_t i = 0; i < nTiles; i++)
     {
-        ff::point_int dist = TileCenterToPixel(pTiles[i]) - targetPixel;
-        size_t nDist = dist.x * dist.x + dist.y * dist.y;
+        size_t nDist = field.GetDistance(pTiles[i]);
 
         if (nDist < nBestDist)
         {
@@ -163,5 +181,194 @@ ff::point_int DecideForTarget(ff::point_int targetPixel, const ff::point_int* pT
         }
     }
 
-    return pTiles[nBestChoice];
+    return (nBestDist != ff::constants::invalid_unsigned<size_t>())
+        ? pTiles[nBestChoice]
+        : DecideForTarget(targetPixel, pTiles, nTiles);
+}
+
+// Returns the first of the lowest costs, so ties go to the choice with the highest priority like the scalar loops
+static size_t PickLowestCost(__m128 costs)
+{
+    __m128 low = _mm_min_ps(costs, _mm_shuffle_ps(costs, costs, _MM_SHUFFLE(2, 3, 0, 1)));
+    low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    int mask = _mm_movemask_ps(_mm_cmpeq_ps(costs, low));
+    size_t nIndex = 0;
+
+    for (; !(mask & 1); mask >>= 1, nIndex++);
+    return nIndex;
+}
+
+// Unused lanes repeat the first choice, which can never win a tie against it
+static ff::point_int GetChoice(const GhostDecision& decision, size_t nLane)
+{
+    return decision._choices[(nLane < decision._choiceCount) ? nLane : 0];
+}
+
+// Same as PickLowestCost for costs that don't fit in floats
+static size_t PickLowestCost(const uint64_t costs[4])
+{
+    size_t nIndex = 0;
+
+    for (size_t i = 1; i < 4; i++)
+    {
+        if (costs[i] < costs[nIndex])
+        {
+            nIndex = i;
+        }
+    }
+
+    return nIndex;
+}
+
+// Squares the absolute values of 32-bit lanes 0 and 2 into two 64-bit lanes
+static __m128i SquareEvenLanes(__m128i values)
+{
+    __m128i sign = _mm_srai_epi32(values, 31);
+    __m128i abs = _mm_sub_epi32(_mm_xor_si128(values, sign), sign);
+
+    return _mm_mul_epu32(abs, abs);
+}
+
+// Squared pixel distances to the target for all four lanes, the same as DecideForTarget. The offsets are
+// 32-bit lanes and their squares are added in 64-bit lanes, so they stay exact however big the maze is.
+static void GetTargetCosts(const GhostDecision& decision, ff::point_int targetPixel, uint64_t costs[4])
+{
+    ff::point_int dists[4];
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        dists[i] = TileCenterToPixel(GetChoice(decision, i)) - targetPixel;
+    }
+
+    __m128i dx = _mm_setr_epi32(dists[0].x, dists[1].x, dists[2].x, dists[3].x);
+    __m128i dy = _mm_setr_epi32(dists[0].y, dists[1].y, dists[2].y, dists[3].y);
+    __m128i even = _mm_add_epi64(SquareEvenLanes(dx), SquareEvenLanes(dy));
+    __m128i odd = _mm_add_epi64(SquareEvenLanes(_mm_srli_epi64(dx, 32)), SquareEvenLanes(_mm_srli_epi64(dy, 32)));
+
+    _mm_storeu_si128((__m128i*)costs, _mm_unpacklo_epi64(even, odd));
+    _mm_storeu_si128((__m128i*)(costs + 2), _mm_unpackhi_epi64(even, odd));
+}
+
+static size_t PickForTarget(const GhostDecision& decision, ff::point_int targetPixel)
+{
+    uint64_t costs[4];
+    GetTargetCosts(decision, targetPixel, costs);
+
+    return PickLowestCost(costs);
+}
+
+static size_t PickForPathTarget(const MazeDistances& distances, const GhostDecision& decision, ff::point_int targetPixel)
+{
+    size_t dists[4];
+    size_t nReachable = distances.GetDistances(decision._choices, decision._choiceCount, PixelToTile(targetPixel), dists);
+
+    if (!nReachable)
+    {
+        return PickForTarget(decision, targetPixel);
+    }
+
+    float costs[4];
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        size_t nDist = dists[(i < decision._choiceCount) ? i : 0];
+        costs[i] = (nDist != ff::constants::invalid_unsigned<size_t>()) ? (float)nDist : -1.0f;
+    }
+
+    __m128 paths = _mm_loadu_ps(costs);
+
+    if (nReachable == decision._choiceCount)
+    {
+        return PickLowestCost(paths);
+    }
+
+    // Same as DecideForPathTarget, only the lanes that can't walk there use the straight line in tiles
+
+    uint64_t lineCosts[4];
+    float lines[4];
+    GetTargetCosts(decision, targetPixel, lineCosts);
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        lines[i] = std::sqrt((float)lineCosts[i]) / (float)PixelsPerTile().x;
+    }
+
+    __m128 unreachable = _mm_cmplt_ps(paths, _mm_setzero_ps());
+
+    return PickLowestCost(_mm_or_ps(_mm_and_ps(unreachable, _mm_loadu_ps(lines)), _mm_andnot_ps(unreachable, paths)));
+}
+
+static size_t PickForFlowField(const MazeFlowField& field, const GhostDecision& decision, ff::point_int targetPixel)
+{
+    float costs[4];
+    bool bReachable = false;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        size_t nDist = field.GetDistance(GetChoice(decision, i));
+        bReachable |= (nDist != ff::constants::invalid_unsigned<size_t>());
+        costs[i] = (nDist != ff::constants::invalid_unsigned<size_t>()) ? (float)nDist : std::numeric_limits<float>::max();
+    }
+
+    return bReachable
+        ? PickLowestCost(_mm_loadu_ps(costs))
+        : PickForTarget(decision, targetPixel);
+}
+
+ff::point_int GetGhostTargetPixel(const GhostSnapshot& snapshot, size_t nGhost, Random& random)
+{
+    size_t nPersonality = GetGhostPersonality(nGhost);
+
+    GhostTargetInputs inputs;
+    inputs._pacPixel = snapshot._pacPixel;
+    inputs._pacDir = snapshot._pacDir;
+    inputs._mazeSize = snapshot._mazeSize;
+    inputs._leaderPixel = snapshot._ghostPixels[nGhost - nPersonality];
+    inputs._ghostPixel = snapshot._ghostPixels[nGhost];
+    inputs._ghostStartPixel = snapshot._ghostStartPixel;
+    inputs._personalities = snapshot._personalities;
+    inputs._personality = nPersonality;
+    inputs._randomScatter = snapshot._randomScatter;
+
+    return GetGhostTargetPixel(snapshot._ghostStates[nGhost], inputs, random);
+}
+
+void DecideGhosts(const GhostSnapshot& snapshot, GhostDecision* pDecisions, size_t nCount, Random& random)
+{
+    for (size_t i = 0; i < nCount; i++)
+    {
+        GhostDecision& decision = pDecisions[i];
+        assert(decision._choiceCount > 0 && decision._choiceCount <= _countof(decision._choices));
+
+        size_t nGhost = decision._ghost;
+        GhostState state = snapshot._ghostStates[nGhost];
+        size_t nChoice = 0;
+
+        switch (state)
+        {
+            default:
+            case GHOST_CHASE:
+            case GHOST_SCATTER:
+                {
+                    ff::point_int target = GetGhostTargetPixel(snapshot, nGhost, random);
+
+                    nChoice = snapshot._distances
+                        ? PickForPathTarget(*snapshot._distances, decision, target)
+                        : PickForTarget(decision, target);
+                }
+                break;
+
+            case GHOST_EYES:
+                nChoice = PickForFlowField(*snapshot._houseFlowField, decision, snapshot._ghostStartPixel);
+                break;
+
+            case GHOST_SCARED:
+            case GHOST_SCARED_FLASH:
+                nChoice = random.Next(decision._choiceCount);
+                break;
+        }
+
+        decision._result = decision._choices[nChoice];
+    }
 }
@@ -1,14 +1,57 @@
 #pragma once
 
 class IPlayingMaze;
+class MazeDistances;
+struct GhostPersonality;
+class MazeFlowField;
+class Random;
+enum GhostState;
 
 class IGhostBrains
 {
 public:
-    static std::shared_ptr<IGhostBrains> Create(size_t nGhost);
+    // Personalities repeat every GHOST_PERSONALITY_COUNT ghosts, so a swarm has many of each
+    static std::shared_ptr<IGhostBrains> Create(size_t nGhost, size_t nPersonality);
 
     virtual ff::point_int Decide(IPlayingMaze* pPlay, const ff::point_int* pTiles, size_t nTiles) = 0;
     virtual ff::point_int GetTargetPixel(IPlayingMaze* pPlay) = 0;
 };
 
 ff::point_int DecideForTarget(ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles);
+
+// Picks the choice with the shortest walk to the target tile, or uses DecideForTarget when any walk is unknown
+ff::point_int DecideForPathTarget(const MazeDistances& distances, ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles);
+
+// Picks the choice closest to the flow field's goal, or uses DecideForTarget when no choice can reach it
+ff::point_int DecideForFlowField(const MazeFlowField& field, ff::point_int targetPixel, const ff::point_int* pTiles, size_t nTiles);
+
+// Everything the default ghost brains look at, packed once per step so that deciding for a big swarm
+// doesn't keep calling back into the game for each ghost
+struct GhostSnapshot
+{
+    ff::point_int _pacPixel;
+    ff::point_int _pacDir;
+    ff::point_int _mazeSize; // in tiles
+    ff::point_int _ghostStartPixel;
+    bool _randomScatter;
+    const GhostPersonality* _personalities; // from the difficulty
+    const MazeDistances* _distances; // null unless the difficulty uses path targeting
+    const MazeFlowField* _houseFlowField;
+    std::vector<ff::point_int> _ghostPixels; // for every ghost
+    std::vector<GhostState> _ghostStates; // for every ghost
+};
+
+// A ghost in the middle of a tile with more than one way to go
+struct GhostDecision
+{
+    size_t _ghost;
+    ff::point_int _tile;
+    ff::point_int _choices[4]; // in priority order
+    size_t _choiceCount;
+    ff::point_int _result; // set to one of the choices
+};
+
+ff::point_int GetGhostTargetPixel(const GhostSnapshot& snapshot, size_t nGhost, Random& random);
+
+// Does what DefaultGhostBrains::Decide does for each decision, comparing all the choices of a ghost at once
+void DecideGhosts(const GhostSnapshot& snapshot, GhostDecision* pDecisions, size_t nCount, Random& random);
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "Core/GhostPaths.h"
+
+GhostPaths::GhostPaths()
+    : _cost{}
+{
+}
+
+void GhostPaths::SetCount(size_t nCount)
+{
+    _paths.resize(nCount);
+    Clear();
+}
+
+void GhostPaths::Clear()
+{
+    for (Path& path : _paths)
+    {
+        path._count = 0;
+    }
+}
+
+void GhostPaths::BeginUpdate()
+{
+    _cost = GhostPathCost{};
+    _updateStart = std::chrono::high_resolution_clock::now();
+}
+
+void GhostPaths::EndUpdate()
+{
+    _cost._microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - _updateStart).count();
+}
+
+void GhostPaths::Invalidate(size_t nGhost)
+{
+    assert_ret(nGhost < _paths.size());
+
+    _paths[nGhost]._count = 0;
+}
+
+// Drops the tiles the ghost already walked past and returns how many are left. Returns one, for the ghost's own
+// tile, when nothing can be kept.
+size_t GhostPaths::KeepFrom(Path& path, ff::point_int tile, ff::point_int leaveDir, ff::point_int targetTile)
+{
+    if (path._targetTile == targetTile)
+    {
+        for (size_t i = 0; i < path._count; i++)
+        {
+            if (path._tiles[i] == tile && path._dirs[i] == leaveDir)
+            {
+                size_t nKeep = path._count - i;
+
+                if (i)
+                {
+                    std::copy(path._tiles + i, path._tiles + path._count, path._tiles);
+                    std::copy(path._dirs + i, path._dirs + path._count, path._dirs);
+                }
+
+                _cost._tilesReused += nKeep;
+                return nKeep;
+            }
+        }
+    }
+
+    path._targetTile = targetTile;
+    path._tiles[0] = tile;
+    path._dirs[0] = leaveDir;
+
+    _cost._rebuilds++;
+    return 1;
+}
+
+size_t GhostPaths::GetCount() const
+{
+    return _paths.size();
+}
+
+size_t GhostPaths::GetTileCount(size_t nGhost) const
+{
+    assert_ret_val(nGhost < _paths.size(), 0);
+
+    return _paths[nGhost]._count;
+}
+
+const ff::point_int* GhostPaths::GetTiles(size_t nGhost) const
+{
+    assert_ret_val(nGhost < _paths.size(), nullptr);
+
+    return _paths[nGhost]._tiles;
+}
+
+const ff::point_int* GhostPaths::GetDirs(size_t nGhost) const
+{
+    assert_ret_val(nGhost < _paths.size(), nullptr);
+
+    return _paths[nGhost]._dirs;
+}
+
+ff::point_int GhostPaths::GetTargetTile(size_t nGhost) const
+{
+    assert_ret_val(nGhost < _paths.size(), ff::point_int(0, 0));
+
+    return _paths[nGhost]._targetTile;
+}
+
+const GhostPathCost& GhostPaths::GetCost() const
+{
+    return _cost;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// What updating the paths cost during the last frame
+struct GhostPathCost
+{
+    size_t _ghosts; // with a path
+    size_t _tilesReused;
+    size_t _tilesPredicted;
+    size_t _rebuilds;
+    int64_t _microseconds;
+};
+
+// The tiles each ghost is expected to walk through next, starting with the tile it's in. Paths are kept from frame
+// to frame, so only the tiles after a ghost stopped following its old path (or after its target moved) are
+// predicted again.
+class GhostPaths
+{
+public:
+    static constexpr size_t MAX_TILES = 35;
+
+    GhostPaths();
+
+    void SetCount(size_t nCount);
+    void Clear();
+
+    void BeginUpdate();
+    void EndUpdate();
+
+    // Step(tile, dir) returns the direction to leave a tile when arriving in dir.
+    // leaveDir is the way the ghost will leave the tile it's in now.
+    template<typename StepFunc>
+    void Update(size_t nGhost, ff::point_int tile, ff::point_int leaveDir, ff::point_int targetTile, StepFunc&& step);
+    void Invalidate(size_t nGhost); // not following a target right now
+
+    size_t GetCount() const;
+    size_t GetTileCount(size_t nGhost) const;
+    const ff::point_int* GetTiles(size_t nGhost) const;
+    const ff::point_int* GetDirs(size_t nGhost) const; // leaving each tile
+    ff::point_int GetTargetTile(size_t nGhost) const;
+    const GhostPathCost& GetCost() const;
+
+private:
+    struct Path
+    {
+        ff::point_int _targetTile;
+        ff::point_int _tiles[MAX_TILES];
+        ff::point_int _dirs[MAX_TILES]; // leaving each tile
+        size_t _count;
+    };
+
+    size_t KeepFrom(Path& path, ff::point_int tile, ff::point_int leaveDir, ff::point_int targetTile);
+
+    std::vector<Path> _paths;
+    GhostPathCost _cost;
+    std::chrono::high_resolution_clock::time_point _updateStart;
+};
+
+template<typename StepFunc>
+void GhostPaths::Update(size_t nGhost, ff::point_int tile, ff::point_int leaveDir, ff::point_int targetTile, StepFunc&& step)
+{
+    assert_ret(nGhost < _paths.size());
+
+    Path& path = _paths[nGhost];
+    size_t nCount = KeepFrom(path, tile, leaveDir, targetTile);
+
+    for (; nCount < MAX_TILES; nCount++)
+    {
+        ff::point_int nextTile = path._tiles[nCount - 1] + path._dirs[nCount - 1];
+
+        path._tiles[nCount] = nextTile;
+        path._dirs[nCount] = step(nextTile, path._dirs[nCount - 1]);
+        _cost._tilesPredicted++;
+    }
+
+    path._count = nCount;
+    _cost._ghosts++;
+}
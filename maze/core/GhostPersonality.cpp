@@ -0,0 +1,607 @@
+#include "pch.h"
+#include "Core/Actors.h"
+#include "Core/GhostPersonality.h"
+#include "Core/Helpers.h"
+#include "Core/Random.h"
+
+enum ValueType
+{
+    VALUE_NUMBER,
+    VALUE_POINT,
+    VALUE_BOOL,
+};
+
+struct GhostName
+{
+    std::string_view _name;
+    GhostOp _op;
+    ValueType _type;
+};
+
+static const GhostName s_names[] =
+{
+    { "pac", GHOST_OP_PAC, VALUE_POINT },
+    { "pacDir", GHOST_OP_PAC_DIR, VALUE_POINT },
+    { "self", GHOST_OP_SELF, VALUE_POINT },
+    { "leader", GHOST_OP_LEADER, VALUE_POINT },
+    { "home", GHOST_OP_HOME, VALUE_POINT },
+    { "scatter", GHOST_OP_SCATTER, VALUE_POINT },
+    { "width", GHOST_OP_WIDTH, VALUE_NUMBER },
+    { "height", GHOST_OP_HEIGHT, VALUE_NUMBER },
+};
+
+// Recursive descent, writing instructions as it goes. All the string work happens here, at load time.
+class GhostCompiler
+{
+public:
+    GhostCompiler(std::string_view text, bool bScatter, GhostProgram& program);
+
+    bool Compile();
+
+private:
+    bool ParseCondition(ValueType& type);
+    bool ParseSum(ValueType& type);
+    bool ParseProduct(ValueType& type);
+    bool ParseUnary(ValueType& type);
+    bool ParsePrimary(ValueType& type);
+    bool ParseArgs(const ValueType* pTypes, size_t nCount);
+
+    bool Emit(GhostOp op, int nArg, int nStackChange);
+    void SkipSpaces();
+    bool Accept(char ch);
+    std::string_view ParseName();
+    bool Fail(std::string_view reason);
+
+    std::string_view _text;
+    size_t _pos;
+    bool _scatter;
+    GhostProgram& _program;
+    size_t _stack;
+};
+
+GhostCompiler::GhostCompiler(std::string_view text, bool bScatter, GhostProgram& program)
+    : _text(text)
+    , _pos(0)
+    , _scatter(bScatter)
+    , _program(program)
+    , _stack(0)
+{
+}
+
+bool GhostCompiler::Compile()
+{
+    _program = GhostProgram{};
+
+    ValueType type;
+    check_ret_val(ParseCondition(type), false);
+
+    SkipSpaces();
+
+    if (_pos < _text.size())
+    {
+        return Fail("unexpected text at the end");
+    }
+
+    if (type != VALUE_POINT)
+    {
+        return Fail("the target must be a point");
+    }
+
+    return true;
+}
+
+// condition: sum, or sum ? condition : condition
+bool GhostCompiler::ParseCondition(ValueType& type)
+{
+    check_ret_val(ParseSum(type), false);
+
+    if (!Accept('?'))
+    {
+        return true;
+    }
+
+    if (type != VALUE_BOOL)
+    {
+        return Fail("only near() can come before '?'");
+    }
+
+    size_t nJumpIfFalse = _program._count;
+    check_ret_val(Emit(GHOST_OP_JUMP_IF_FALSE, 0, -1), false);
+
+    ValueType trueType;
+    check_ret_val(ParseCondition(trueType), false);
+
+    size_t nJump = _program._count;
+    check_ret_val(Emit(GHOST_OP_JUMP, 0, 0), false);
+
+    if (!Accept(':'))
+    {
+        return Fail("expected ':'");
+    }
+
+    // Only one side runs, so the second starts with the same stack as the first
+
+    _program._code[nJumpIfFalse]._arg = (int16_t)_program._count;
+    _stack--;
+
+    ValueType falseType;
+    check_ret_val(ParseCondition(falseType), false);
+
+    if (trueType != falseType || trueType == VALUE_BOOL)
+    {
+        return Fail("both sides of '?' must be points or numbers");
+    }
+
+    _program._code[nJump]._arg = (int16_t)_program._count;
+    type = trueType;
+
+    return true;
+}
+
+// sum: product, with + or - product
+bool GhostCompiler::ParseSum(ValueType& type)
+{
+    check_ret_val(ParseProduct(type), false);
+
+    for (;;)
+    {
+        bool bAdd = Accept('+');
+        if (!bAdd && !Accept('-'))
+        {
+            return true;
+        }
+
+        ValueType rightType;
+        check_ret_val(ParseProduct(rightType), false);
+
+        if (type != rightType || type == VALUE_BOOL)
+        {
+            return Fail("can only add or subtract two points or two numbers");
+        }
+
+        check_ret_val(Emit(bAdd ? GHOST_OP_ADD : GHOST_OP_SUBTRACT, 0, -1), false);
+    }
+}
+
+// product: unary, with * unary
+bool GhostCompiler::ParseProduct(ValueType& type)
+{
+    check_ret_val(ParseUnary(type), false);
+
+    while (Accept('*'))
+    {
+        ValueType rightType;
+        check_ret_val(ParseUnary(rightType), false);
+
+        if (type == VALUE_BOOL || rightType == VALUE_BOOL || (type == VALUE_POINT && rightType == VALUE_POINT))
+        {
+            return Fail("can only multiply by a number");
+        }
+
+        // Numbers are stored in both x and y, so every kind of multiply is the same instruction
+        check_ret_val(Emit(GHOST_OP_MULTIPLY, 0, -1), false);
+        type = (type == VALUE_POINT || rightType == VALUE_POINT) ? VALUE_POINT : VALUE_NUMBER;
+    }
+
+    return true;
+}
+
+// unary: -unary, or primary
+bool GhostCompiler::ParseUnary(ValueType& type)
+{
+    if (!Accept('-'))
+    {
+        return ParsePrimary(type);
+    }
+
+    check_ret_val(ParseUnary(type), false);
+
+    if (type == VALUE_BOOL)
+    {
+        return Fail("can't negate near()");
+    }
+
+    return Emit(GHOST_OP_NEGATE, 0, 0);
+}
+
+// primary: number, name, tile(x, y), near(a, b, tiles), or (condition)
+bool GhostCompiler::ParsePrimary(ValueType& type)
+{
+    if (Accept('('))
+    {
+        check_ret_val(ParseCondition(type), false);
+        return Accept(')') || Fail("expected ')'");
+    }
+
+    SkipSpaces();
+
+    if (_pos < _text.size() && std::isdigit((unsigned char)_text[_pos]))
+    {
+        int nValue = 0;
+        for (; _pos < _text.size() && std::isdigit((unsigned char)_text[_pos]) && nValue <= SHRT_MAX; _pos++)
+        {
+            nValue = nValue * 10 + (_text[_pos] - '0');
+        }
+
+        if (nValue > SHRT_MAX)
+        {
+            return Fail("number is too big");
+        }
+
+        type = VALUE_NUMBER;
+        return Emit(GHOST_OP_NUMBER, nValue, 1);
+    }
+
+    std::string_view name = ParseName();
+
+    if (name == "tile")
+    {
+        static const ValueType s_types[] = { VALUE_NUMBER, VALUE_NUMBER };
+        check_ret_val(ParseArgs(s_types, _countof(s_types)), false);
+
+        type = VALUE_POINT;
+        return Emit(GHOST_OP_TILE, 0, -1);
+    }
+
+    if (name == "near")
+    {
+        static const ValueType s_types[] = { VALUE_POINT, VALUE_POINT, VALUE_NUMBER };
+        check_ret_val(ParseArgs(s_types, _countof(s_types)), false);
+
+        type = VALUE_BOOL;
+        return Emit(GHOST_OP_NEAR, 0, -2);
+    }
+
+    for (const GhostName& entry : s_names)
+    {
+        if (entry._name == name)
+        {
+            if (entry._op == GHOST_OP_SCATTER && _scatter)
+            {
+                return Fail("scatter targets can't use \"scatter\"");
+            }
+
+            type = entry._type;
+            return Emit(entry._op, 0, 1);
+        }
+    }
+
+    return Fail(name.empty() ? "expected a value" : "unknown name");
+}
+
+bool GhostCompiler::ParseArgs(const ValueType* pTypes, size_t nCount)
+{
+    if (!Accept('('))
+    {
+        return Fail("expected '('");
+    }
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        if (i && !Accept(','))
+        {
+            return Fail("expected ','");
+        }
+
+        ValueType type;
+        check_ret_val(ParseCondition(type), false);
+
+        if (type != pTypes[i])
+        {
+            return Fail("wrong kind of argument");
+        }
+    }
+
+    return Accept(')') || Fail("expected ')'");
+}
+
+bool GhostCompiler::Emit(GhostOp op, int nArg, int nStackChange)
+{
+    if (_program._count >= GhostProgram::MAX_INSTRUCTIONS)
+    {
+        return Fail("expression is too long");
+    }
+
+    _stack += nStackChange;
+
+    if (_stack > GhostProgram::MAX_STACK)
+    {
+        return Fail("expression is nested too deeply");
+    }
+
+    _program._code[_program._count++] = GhostInstruction{ op, (int16_t)nArg };
+    return true;
+}
+
+void GhostCompiler::SkipSpaces()
+{
+    for (; _pos < _text.size() && std::isspace((unsigned char)_text[_pos]); _pos++);
+}
+
+bool GhostCompiler::Accept(char ch)
+{
+    SkipSpaces();
+
+    if (_pos < _text.size() && _text[_pos] == ch)
+    {
+        _pos++;
+        return true;
+    }
+
+    return false;
+}
+
+std::string_view GhostCompiler::ParseName()
+{
+    SkipSpaces();
+
+    size_t nStart = _pos;
+    for (; _pos < _text.size() && std::isalpha((unsigned char)_text[_pos]); _pos++);
+
+    return _text.substr(nStart, _pos - nStart);
+}
+
+bool GhostCompiler::Fail(std::string_view reason)
+{
+    debug_fail_msg(ff::string::concat("Bad ghost target \"", _text, "\": ", reason).c_str());
+    return false;
+}
+
+bool CompileGhostProgram(std::string_view text, bool bScatter, GhostProgram& program)
+{
+    GhostCompiler compiler(text, bScatter, program);
+    return compiler.Compile();
+}
+
+bool CompileGhostPersonality(std::string_view chase, std::string_view scatter, GhostPersonality& personality)
+{
+    return CompileGhostProgram(chase, false, personality._chase) &&
+        CompileGhostProgram(scatter, true, personality._scatter);
+}
+
+// Every way into an instruction must leave the same number of values on the stack
+static bool FlowTo(int* depths, size_t nCount, size_t nFrom, size_t nTo, int nDepth)
+{
+    check_ret_val(nTo > nFrom && nTo <= nCount, false);
+    check_ret_val(depths[nTo] < 0 || depths[nTo] == nDepth, false);
+
+    depths[nTo] = nDepth;
+    return true;
+}
+
+bool ValidateGhostProgram(const GhostProgram& program, bool bScatter)
+{
+    check_ret_val(program._count && program._count <= GhostProgram::MAX_INSTRUCTIONS, false);
+
+    // Stack depth before each instruction, jumps only go forward so one pass finds them all
+
+    int depths[GhostProgram::MAX_INSTRUCTIONS + 1];
+    std::fill(std::begin(depths), std::end(depths), -1);
+    depths[0] = 0;
+
+    for (size_t i = 0; i < program._count; i++)
+    {
+        const GhostInstruction& instruction = program._code[i];
+        int nDepth = depths[i];
+        int nPops = 0;
+        int nPushes = 1;
+        bool bJump = false;
+        bool bFallThrough = true;
+
+        if (nDepth < 0)
+        {
+            // Never reached
+            continue;
+        }
+
+        switch (instruction._op)
+        {
+            case GHOST_OP_NUMBER:
+            case GHOST_OP_PAC:
+            case GHOST_OP_PAC_DIR:
+            case GHOST_OP_SELF:
+            case GHOST_OP_LEADER:
+            case GHOST_OP_HOME:
+            case GHOST_OP_WIDTH:
+            case GHOST_OP_HEIGHT:
+                break;
+
+            case GHOST_OP_SCATTER:
+                check_ret_val(!bScatter, false);
+                break;
+
+            case GHOST_OP_TILE:
+            case GHOST_OP_ADD:
+            case GHOST_OP_SUBTRACT:
+            case GHOST_OP_MULTIPLY:
+                nPops = 2;
+                break;
+
+            case GHOST_OP_NEAR:
+                nPops = 3;
+                break;
+
+            case GHOST_OP_NEGATE:
+                nPops = 1;
+                break;
+
+            case GHOST_OP_JUMP:
+                nPushes = 0;
+                bJump = true;
+                bFallThrough = false;
+                break;
+
+            case GHOST_OP_JUMP_IF_FALSE:
+                nPops = 1;
+                nPushes = 0;
+                bJump = true;
+                break;
+
+            default:
+                return false;
+        }
+
+        check_ret_val(nDepth >= nPops, false);
+        nDepth += nPushes - nPops;
+        check_ret_val(nDepth <= (int)GhostProgram::MAX_STACK, false);
+
+        check_ret_val(!bFallThrough || FlowTo(depths, program._count, i, i + 1, nDepth), false);
+        check_ret_val(!bJump || FlowTo(depths, program._count, i, (size_t)instruction._arg, nDepth), false);
+    }
+
+    return depths[program._count] == 1;
+}
+
+bool ValidateGhostPersonality(const GhostPersonality& personality)
+{
+    return ValidateGhostProgram(personality._chase, false) &&
+        ValidateGhostProgram(personality._scatter, true);
+}
+
+const GhostPersonality* GetClassicGhostPersonalities()
+{
+    static const std::array<GhostPersonality, GHOST_PERSONALITY_COUNT> s_personalities = []()
+        {
+            std::array<GhostPersonality, GHOST_PERSONALITY_COUNT> personalities{};
+
+            verify(CompileGhostPersonality("pac", "tile(width - 3, -3)", personalities[0]));
+            verify(CompileGhostPersonality("pac + pacDir * 4", "tile(2, -3)", personalities[1]));
+            verify(CompileGhostPersonality("pac + (pac - leader)", "tile(width - 1, height + 1)", personalities[2]));
+            verify(CompileGhostPersonality("near(self, pac, 8) ? scatter : pac", "tile(0, height + 1)", personalities[3]));
+
+            if constexpr (ff::constants::debug_build)
+            {
+                for (const GhostPersonality& personality : personalities)
+                {
+                    assert(ValidateGhostPersonality(personality));
+                }
+            }
+
+            return personalities;
+        }();
+
+    return s_personalities.data();
+}
+
+static ff::point_int Evaluate(const GhostProgram& program, const GhostTargetInputs& inputs, Random& random);
+
+static ff::point_int EvaluateScatter(const GhostTargetInputs& inputs, Random& random)
+{
+    size_t nPersonality = inputs._randomScatter
+        ? random.Next(GHOST_PERSONALITY_COUNT)
+        : inputs._personality;
+
+    return Evaluate(inputs._personalities[nPersonality]._scatter, inputs, random);
+}
+
+static ff::point_int Evaluate(const GhostProgram& program, const GhostTargetInputs& inputs, Random& random)
+{
+    assert_ret_val(program._count && program._count <= GhostProgram::MAX_INSTRUCTIONS, inputs._pacPixel);
+
+    // Numbers and bools are stored in both x and y
+
+    ff::point_int stack[GhostProgram::MAX_STACK];
+    size_t nStack = 0;
+
+    for (size_t i = 0; i < program._count; i++)
+    {
+        const GhostInstruction& instruction = program._code[i];
+
+        switch (instruction._op)
+        {
+            case GHOST_OP_NUMBER:
+                stack[nStack++] = ff::point_int(instruction._arg, instruction._arg);
+                break;
+
+            case GHOST_OP_PAC:
+                stack[nStack++] = inputs._pacPixel;
+                break;
+
+            case GHOST_OP_PAC_DIR:
+                stack[nStack++] = ff::point_int(inputs._pacDir.x * PixelsPerTile().x, inputs._pacDir.y * PixelsPerTile().y);
+                break;
+
+            case GHOST_OP_SELF:
+                stack[nStack++] = inputs._ghostPixel;
+                break;
+
+            case GHOST_OP_LEADER:
+                stack[nStack++] = inputs._leaderPixel;
+                break;
+
+            case GHOST_OP_HOME:
+                stack[nStack++] = inputs._ghostStartPixel;
+                break;
+
+            case GHOST_OP_SCATTER:
+                stack[nStack++] = EvaluateScatter(inputs, random);
+                break;
+
+            case GHOST_OP_WIDTH:
+                stack[nStack++] = ff::point_int(inputs._mazeSize.x, inputs._mazeSize.x);
+                break;
+
+            case GHOST_OP_HEIGHT:
+                stack[nStack++] = ff::point_int(inputs._mazeSize.y, inputs._mazeSize.y);
+                break;
+
+            case GHOST_OP_TILE:
+                nStack--;
+                stack[nStack - 1] = TileCenterToPixel(ff::point_int(stack[nStack - 1].x, stack[nStack].x));
+                break;
+
+            case GHOST_OP_NEAR:
+                {
+                    nStack -= 2;
+
+                    ff::point_int dist = stack[nStack] - stack[nStack - 1];
+                    ff::point_int range(stack[nStack + 1].x * PixelsPerTile().x, stack[nStack + 1].x * PixelsPerTile().y);
+                    int nNear = (dist.x * dist.x + dist.y * dist.y < range.x * range.x + range.y * range.y);
+
+                    stack[nStack - 1] = ff::point_int(nNear, nNear);
+                }
+                break;
+
+            case GHOST_OP_ADD:
+                nStack--;
+                stack[nStack - 1] = stack[nStack - 1] + stack[nStack];
+                break;
+
+            case GHOST_OP_SUBTRACT:
+                nStack--;
+                stack[nStack - 1] = stack[nStack - 1] - stack[nStack];
+                break;
+
+            case GHOST_OP_MULTIPLY:
+                nStack--;
+                stack[nStack - 1] = ff::point_int(stack[nStack - 1].x * stack[nStack].x, stack[nStack - 1].y * stack[nStack].y);
+                break;
+
+            case GHOST_OP_NEGATE:
+                stack[nStack - 1] = -stack[nStack - 1];
+                break;
+
+            case GHOST_OP_JUMP:
+                i = (size_t)instruction._arg - 1;
+                break;
+
+            case GHOST_OP_JUMP_IF_FALSE:
+                if (!stack[--nStack].x)
+                {
+                    i = (size_t)instruction._arg - 1;
+                }
+                break;
+        }
+    }
+
+    return nStack ? stack[nStack - 1] : inputs._pacPixel;
+}
+
+ff::point_int EvaluateGhostTarget(bool bChase, const GhostTargetInputs& inputs, Random& random)
+{
+    assert_ret_val(inputs._personalities && inputs._personality < GHOST_PERSONALITY_COUNT, inputs._pacPixel);
+
+    return bChase
+        ? Evaluate(inputs._personalities[inputs._personality]._chase, inputs, random)
+        : EvaluateScatter(inputs, random);
+}
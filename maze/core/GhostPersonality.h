@@ -0,0 +1,78 @@
+#pragma once
+
+class Random;
+
+// Target expressions from the maze resources are compiled into these for a tiny stack machine.
+// Numbers are tiles, points are pixels.
+enum GhostOp : uint8_t
+{
+    GHOST_OP_NUMBER, // pushes _arg
+    GHOST_OP_PAC,
+    GHOST_OP_PAC_DIR, // one tile in the direction Pac is moving
+    GHOST_OP_SELF,
+    GHOST_OP_LEADER, // red ghost from the same group of four
+    GHOST_OP_HOME, // above the ghost door
+    GHOST_OP_SCATTER,
+    GHOST_OP_WIDTH,
+    GHOST_OP_HEIGHT,
+    GHOST_OP_TILE, // tile(x, y), the middle of a tile
+    GHOST_OP_NEAR, // near(a, b, tiles)
+    GHOST_OP_ADD,
+    GHOST_OP_SUBTRACT,
+    GHOST_OP_MULTIPLY,
+    GHOST_OP_NEGATE,
+    GHOST_OP_JUMP, // to _arg
+    GHOST_OP_JUMP_IF_FALSE, // to _arg
+};
+
+struct GhostInstruction
+{
+    GhostOp _op;
+    int16_t _arg;
+};
+
+// Plain data, so that it can be copied around with Difficulty and saved in maze packs
+struct GhostProgram
+{
+    static constexpr size_t MAX_INSTRUCTIONS = 32;
+    static constexpr size_t MAX_STACK = 8;
+
+    GhostInstruction _code[MAX_INSTRUCTIONS];
+    uint8_t _count;
+};
+
+struct GhostPersonality
+{
+    GhostProgram _chase;
+    GhostProgram _scatter;
+};
+
+// Everything a target expression can look at
+struct GhostTargetInputs
+{
+    ff::point_int _pacPixel;
+    ff::point_int _pacDir;
+    ff::point_int _mazeSize; // in tiles
+    ff::point_int _leaderPixel;
+    ff::point_int _ghostPixel;
+    ff::point_int _ghostStartPixel;
+    const GhostPersonality* _personalities; // GHOST_PERSONALITY_COUNT of them
+    size_t _personality;
+    bool _randomScatter; // "scatter" picks any personality's corner
+};
+
+// The expression can use +, -, *, parentheses, "near(a, b, tiles) ? x : y", "tile(x, y)", numbers,
+// and the names pac, pacDir, self, leader, home, scatter, width, and height. Scatter can't use "scatter".
+bool CompileGhostProgram(std::string_view text, bool bScatter, GhostProgram& program);
+bool CompileGhostPersonality(std::string_view chase, std::string_view scatter, GhostPersonality& personality);
+
+// Checks programs that weren't compiled here, like ones loaded from a maze pack: known ops, forward jumps,
+// a stack that never underflows or overflows, and no "scatter" inside a scatter program.
+bool ValidateGhostProgram(const GhostProgram& program, bool bScatter);
+bool ValidateGhostPersonality(const GhostPersonality& personality);
+
+// The original four: red chases Pac, pink aims ahead of Pac, blue flanks with red, and orange backs off when close
+const GhostPersonality* GetClassicGhostPersonalities();
+
+// Never allocates, so it's fine to call for every ghost decision
+ff::point_int EvaluateGhostTarget(bool bChase, const GhostTargetInputs& inputs, Random& random);
@@ -78,6 +78,8 @@ static size_t s_eventPause = ff::stable_hash_func("pause"sv);
 static size_t s_eventStart = ff::stable_hash_func("start"sv);
 static size_t s_eventPauseAdvance = ff::stable_hash_func("pauseAdvance"sv);
 static size_t s_eventClick = ff::stable_hash_func("click"sv);
+static size_t s_eventRewind = ff::stable_hash_func("rewind"sv);
+static size_t s_eventFastForward = ff::stable_hash_func("fastForward"sv);
 
 std::string_view GetAssetPrefix(CharType type)
 {
@@ -139,6 +141,16 @@ size_t GetEventClick()
     return s_eventClick;
 }
 
+size_t GetEventRewind()
+{
+    return s_eventRewind;
+}
+
+size_t GetEventFastForward()
+{
+    return s_eventFastForward;
+}
+
 std::shared_ptr<ff::input_event_provider> GetGlobalInputMapping()
 {
     static std::shared_ptr<ff::input_mapping> input_mapping;
@@ -23,4 +23,6 @@ size_t GetEventPause();
 size_t GetEventStart();
 size_t GetEventPauseAdvance();
 size_t GetEventClick();
+size_t GetEventRewind(); // held, not an event
+size_t GetEventFastForward(); // held, not an event
 std::shared_ptr<ff::input_event_provider> GetGlobalInputMapping();
@@ -0,0 +1,423 @@
+#include "pch.h"
+#include "Core/Actors.h"
+#include "Core/HeadlessRunner.h"
+#include "Core/Helpers.h"
+#include "Core/Mazes.h"
+#include "Core/PacController.h"
+#include "Core/PlayingMaze.h"
+#include "Core/Random.h"
+#include "Core/Replay.h"
+#include "Core/SelfTest.h"
+
+static const size_t DEFAULT_FRAMES = 36000;
+static const size_t ROLLOUT_COUNT = 32;
+static const size_t ROLLOUT_FRAMES = 120;
+
+static const std::string_view USAGE =
+    "Usage: -headless [-mazes <id>] [-frames <count>] [-controller autopilot|rollouts|none] [-script <path>]\n"
+    "                 [-report <path>] [-seed <number>] [-replay <path>] [-record <path>] [-selftest <name>|all]\n";
+
+HeadlessRunner::HeadlessRunner(Output output)
+    : _output(std::move(output))
+    , _mazesId("mr-mazes-normal")
+    , _controllerName("autopilot")
+    , _frames(DEFAULT_FRAMES)
+    , _seed(Random::NewSeed())
+    , _scriptPos(0)
+    , _games(0)
+    , _gamesOver(0)
+    , _bestLevel(0)
+    , _bestScore(0)
+    , _totalScore(0)
+    , _bestReplayScore(0)
+    , _replayDivergedFrame(ff::constants::invalid_unsigned<size_t>())
+{
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+}
+
+int HeadlessRunner::RunArgs(const std::vector<std::string>& args, Output output)
+{
+    HeadlessRunner runner(std::move(output));
+    return (runner.ParseArgs(args) && runner.Run()) ? 0 : 1;
+}
+
+bool HeadlessRunner::ParseArgs(const std::vector<std::string>& args)
+{
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        std::string_view name = args[i];
+
+        if (name != "-mazes" && name != "-frames" && name != "-controller" && name != "-script" &&
+            name != "-report" && name != "-seed" && name != "-replay" && name != "-record" && name != "-selftest")
+        {
+            return Fail(ff::string::concat("unknown option ", name));
+        }
+
+        if (i + 1 == args.size())
+        {
+            return Fail(ff::string::concat("missing value for ", name));
+        }
+
+        std::string_view value = args[++i];
+
+        if (name == "-mazes")
+        {
+            _mazesId = value;
+        }
+        else if (name == "-frames")
+        {
+            size_t nFrames = 0;
+            if (std::from_chars(value.data(), value.data() + value.size(), nFrames).ec != std::errc() || !nFrames)
+            {
+                return Fail(ff::string::concat("bad frame count ", value));
+            }
+
+            _frames = nFrames;
+        }
+        else if (name == "-controller")
+        {
+            if (value != "autopilot" && value != "rollouts" && value != "none")
+            {
+                return Fail(ff::string::concat("unknown controller ", value, ", expected autopilot, rollouts, or none"));
+            }
+
+            _controllerName = value;
+        }
+        else if (name == "-script")
+        {
+            if (!LoadScript(std::filesystem::path(value)))
+            {
+                return Fail(ff::string::concat("can't read script ", value));
+            }
+        }
+        else if (name == "-report")
+        {
+            _reportPath = std::filesystem::path(value);
+        }
+        else if (name == "-seed")
+        {
+            if (std::from_chars(value.data(), value.data() + value.size(), _seed).ec != std::errc())
+            {
+                return Fail(ff::string::concat("bad seed ", value));
+            }
+        }
+        else if (name == "-replay")
+        {
+            _playback = Replay::Load(std::filesystem::path(value));
+            if (!_playback)
+            {
+                return Fail(ff::string::concat("can't read replay ", value));
+            }
+        }
+        else if (name == "-record")
+        {
+            _recordPath = std::filesystem::path(value);
+        }
+        else if (name == "-selftest")
+        {
+            if (!SelfTest::IsTestName(value))
+            {
+                return Fail(ff::string::concat("unknown self test ", value));
+            }
+
+            _selfTestName = value;
+        }
+    }
+
+    return true;
+}
+
+bool HeadlessRunner::Run()
+{
+    SetHeadless(true);
+
+    if (!_selfTestName.empty())
+    {
+        SelfTest test;
+        bool bPassed = test.Run(_selfTestName);
+        _report = test.GetReport();
+
+        return WriteReport() && bPassed;
+    }
+
+    std::shared_ptr<IMazes> pMazes = CreateMazesFromId(_playback ? _playback->GetMazesID() : _mazesId);
+    if (!pMazes || !pMazes->GetMazeCount())
+    {
+        return Fail(ff::string::concat("can't load mazes ", _playback ? _playback->GetMazesID() : _mazesId));
+    }
+
+    std::shared_ptr<IPacController> pController;
+    if (_playback)
+    {
+        // The replay has all the input
+        _mazesId = _playback->GetMazesID();
+        _controllerName = "replay";
+        _frames = _playback->GetFrameCount();
+    }
+    else if (_controllerName == "autopilot")
+    {
+        pController = IPacController::CreateAutopilot();
+    }
+    else if (_controllerName == "rollouts")
+    {
+        pController = IPacController::CreateRollouts(ROLLOUT_COUNT, ROLLOUT_FRAMES);
+    }
+
+    std::vector<double> frameMicroseconds;
+    frameMicroseconds.reserve(_frames);
+
+    std::shared_ptr<IPlayingGame> pGame;
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (size_t nFrame = 0; nFrame < _frames; nFrame++)
+    {
+        if (!pGame || pGame->IsGameOver())
+        {
+            if (pGame)
+            {
+                AddGameResults(pGame.get());
+                _gamesOver++;
+            }
+
+            pGame = _playback
+                ? IPlayingGame::Create(_playback, this)
+                : IPlayingGame::Create(pMazes, 1, this, _seed + _games);
+            assert_ret_val(pGame, false);
+            _games++;
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // Same as the app: input goes to Pac before the game advances
+        std::shared_ptr<IPlayer> pPlayer = pGame->GetPlayer(pGame->GetCurrentPlayer());
+        std::shared_ptr<IPlayingMaze> pPlay = pPlayer ? pPlayer->GetPlayingMaze() : nullptr;
+        std::shared_ptr<IPlayingActor> pac = pPlay ? pPlay->GetPac() : nullptr;
+
+        if (pac && !_playback)
+        {
+            ff::point_int pressDir = GetScriptDir(nFrame);
+
+            if (!pressDir && pController)
+            {
+                pressDir = pController->GetPressDir(pPlay.get());
+            }
+
+            pac->SetPressDir(pressDir);
+        }
+
+        pGame->Advance();
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        frameMicroseconds.push_back(std::chrono::duration<double, std::micro>(frameEnd - frameStart).count());
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    if (pGame)
+    {
+        AddGameResults(pGame.get());
+        _replayDivergedFrame = pGame->GetReplayDivergedFrame();
+    }
+
+    BuildReport(frameMicroseconds, totalSeconds);
+
+    if (!WriteReport())
+    {
+        return false;
+    }
+
+    if (!_recordPath.empty() && _bestReplay && !_bestReplay->Save(_recordPath))
+    {
+        return Fail(ff::string::concat("can't write replay ", _recordPath.string()));
+    }
+
+    return _replayDivergedFrame == ff::constants::invalid_unsigned<size_t>();
+}
+
+const std::string& HeadlessRunner::GetReport() const
+{
+    return _report;
+}
+
+bool HeadlessRunner::IsShowingScoreBar(IPlayingGame* pGame) const
+{
+    return false;
+}
+
+bool HeadlessRunner::IsShowingStatusBar(IPlayingGame* pGame) const
+{
+    return false;
+}
+
+bool HeadlessRunner::IsShowingGhostTrails(IPlayingGame* pGame) const
+{
+    return false;
+}
+
+void HeadlessRunner::OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlayer> pPlayer)
+{
+}
+
+void HeadlessRunner::OnFastForwardStep(IPlayingGame* pGame)
+{
+}
+
+// The error goes where the report would have gone, so scripts that run this can tell what happened
+bool HeadlessRunner::Fail(std::string_view error)
+{
+    _report = ff::string::concat("Headless: ", error, "\n", USAGE);
+
+    if (_output)
+    {
+        _output(_report);
+    }
+
+    return false;
+}
+
+bool HeadlessRunner::WriteReport()
+{
+    if (_output)
+    {
+        _output(_report);
+    }
+
+    if (!_reportPath.empty())
+    {
+        std::ofstream file(_reportPath);
+        file << _report;
+
+        if (!file.good())
+        {
+            return Fail(ff::string::concat("can't write report ", _reportPath.string()));
+        }
+    }
+
+    return true;
+}
+
+bool HeadlessRunner::LoadScript(const std::filesystem::path& path)
+{
+    std::ifstream file(path);
+    check_ret_val(file.is_open(), false);
+
+    _script.clear();
+    _scriptPos = 0;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream lineStream(line);
+        std::string frameText;
+        std::string dirText;
+
+        if (!(lineStream >> frameText) || frameText[0] == '#')
+        {
+            continue;
+        }
+
+        size_t nFrame = 0;
+        check_ret_val(std::from_chars(frameText.data(), frameText.data() + frameText.size(), nFrame).ec == std::errc(), false);
+        check_ret_val(lineStream >> dirText, false);
+
+        ff::point_int dir{};
+        if (dirText == "up")
+        {
+            dir.y = -1;
+        }
+        else if (dirText == "down")
+        {
+            dir.y = 1;
+        }
+        else if (dirText == "left")
+        {
+            dir.x = -1;
+        }
+        else if (dirText == "right")
+        {
+            dir.x = 1;
+        }
+        else
+        {
+            check_ret_val(dirText == "none", false);
+        }
+
+        _script.emplace_back(nFrame, dir);
+    }
+
+    std::stable_sort(_script.begin(), _script.end(), [](const auto& lhs, const auto& rhs)
+        {
+            return lhs.first < rhs.first;
+        });
+
+    return true;
+}
+
+// Frames only go forward, so this just walks the sorted script
+ff::point_int HeadlessRunner::GetScriptDir(size_t nFrame)
+{
+    while (_scriptPos < _script.size() && _script[_scriptPos].first <= nFrame)
+    {
+        _scriptPos++;
+    }
+
+    return _scriptPos ? _script[_scriptPos - 1].second : ff::point_int{};
+}
+
+void HeadlessRunner::AddGameResults(IPlayingGame* pGame)
+{
+    size_t nGameScore = 0;
+
+    for (size_t i = 0; i < pGame->GetPlayers(); i++)
+    {
+        std::shared_ptr<IPlayer> pPlayer = pGame->GetPlayer(i);
+        if (pPlayer)
+        {
+            _bestLevel = std::max(_bestLevel, pPlayer->GetLevel() + 1);
+            _bestScore = std::max(_bestScore, pPlayer->GetScore());
+            _totalScore += pPlayer->GetScore();
+            nGameScore = std::max(nGameScore, pPlayer->GetScore());
+        }
+    }
+
+    // Games are done once they get here, so their replays won't change
+    if (!_bestReplay || nGameScore > _bestReplayScore)
+    {
+        _bestReplay = pGame->GetReplay();
+        _bestReplayScore = nGameScore;
+    }
+}
+
+void HeadlessRunner::BuildReport(std::vector<double>& frameMicroseconds, double totalSeconds)
+{
+    std::sort(frameMicroseconds.begin(), frameMicroseconds.end());
+
+    auto percentile = [&frameMicroseconds](size_t nPercent)
+        {
+            return frameMicroseconds.empty() ? 0.0 : frameMicroseconds[(frameMicroseconds.size() - 1) * nPercent / 100];
+        };
+
+    double framesPerSecond = totalSeconds > 0 ? frameMicroseconds.size() / totalSeconds : 0.0;
+    double realTime = framesPerSecond / IdealFramesPerSecondF();
+
+    std::string replayText;
+    if (_playback)
+    {
+        replayText = (_replayDivergedFrame == ff::constants::invalid_unsigned<size_t>())
+            ? ff::string::concat("  Replay: ", _playback->GetCheckpointCount(), " checkpoints matched\n")
+            : ff::string::concat("  Replay: DIVERGED by frame ", _replayDivergedFrame, "\n");
+    }
+
+    _report = ff::string::concat(
+        "Headless: mazes=", _mazesId, ", controller=", _controllerName, ", script lines=", _script.size(),
+        ", seed=", _playback ? _playback->GetSeed() : _seed, "\n",
+        "  Frames: ", frameMicroseconds.size(), " in ", totalSeconds, " s, ",
+        (size_t)framesPerSecond, " frames/s, ", (size_t)realTime, "x real time\n",
+        "  Frame cost (us): p50=", percentile(50), ", p90=", percentile(90), ", p99=", percentile(99), ", max=", percentile(100), "\n",
+        "  Games: ", _games, " started, ", _gamesOver, " over, best level ", _bestLevel,
+        ", best score ", _bestScore, ", total score ", _totalScore, "\n",
+        replayText);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Core/PlayingGame.h"
+
+class Replay;
+
+// Plays whole games with no rendering or audio, as fast as possible, and measures how long each frame takes.
+// Doesn't use any platform APIs, the host decides where the report and any errors are written. It's run by
+// "maze.exe -headless ..." and by the console app in maze/headless, given the arguments after "-headless":
+//   -mazes <id>          which mazes to play, default mr-mazes-normal
+//   -frames <count>      how many frames to simulate, default 36000 (ten minutes of play)
+//   -controller <name>   autopilot, rollouts, or none
+//   -script <path>       lines of "<frame> <up|down|left|right|none>", each press lasts until the next line.
+//                        Pressing none gives Pac back to the controller. Lines starting with # are ignored.
+//   -report <path>       also write the report to this file
+//   -seed <number>       seed for the first game, the next games add one to it
+//   -replay <path>       play back a replay file instead, for as many frames as it has, and check that it matches
+//   -record <path>       save the replay of the highest scoring game
+//   -selftest <name>     run checks and benchmarks instead of playing, see SelfTest
+class HeadlessRunner : public IPlayingGameHost
+{
+public:
+    using Output = std::function<void(std::string_view text)>;
+
+    HeadlessRunner(Output output);
+    ~HeadlessRunner();
+
+    // Parses args and runs, returning the exit code for the process
+    static int RunArgs(const std::vector<std::string>& args, Output output);
+
+    // Both return false after writing an error, or when a replay didn't match
+    bool ParseArgs(const std::vector<std::string>& args);
+    bool Run();
+    const std::string& GetReport() const;
+
+    // IPlayingGameHost
+    virtual bool IsShowingScoreBar(IPlayingGame* pGame) const override;
+    virtual bool IsShowingStatusBar(IPlayingGame* pGame) const override;
+    virtual bool IsShowingGhostTrails(IPlayingGame* pGame) const override;
+    virtual void OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlayer> pPlayer) override;
+    virtual void OnFastForwardStep(IPlayingGame* pGame) override;
+
+private:
+    bool Fail(std::string_view error);
+    bool WriteReport();
+    bool LoadScript(const std::filesystem::path& path);
+    ff::point_int GetScriptDir(size_t nFrame);
+    void AddGameResults(IPlayingGame* pGame);
+    void BuildReport(std::vector<double>& frameMicroseconds, double totalSeconds);
+
+    Output _output;
+    std::string _mazesId;
+    std::string _controllerName;
+    std::filesystem::path _reportPath;
+    std::filesystem::path _recordPath;
+    std::string _selfTestName;
+    size_t _frames;
+    uint64_t _seed;
+    std::shared_ptr<Replay> _playback;
+
+    // Script
+    std::vector<std::pair<size_t, ff::point_int>> _script; // sorted by frame
+    size_t _scriptPos;
+
+    // Results
+    size_t _games;
+    size_t _gamesOver;
+    size_t _bestLevel;
+    size_t _bestScore;
+    size_t _totalScore;
+    size_t _bestReplayScore;
+    std::shared_ptr<Replay> _bestReplay;
+    size_t _replayDivergedFrame;
+    std::string _report;
+};
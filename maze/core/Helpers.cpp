@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Core/Helpers.h"
+#include "Core/Tiles.h"
 
 // These are the arcade pac speeds
 
@@ -9,6 +10,8 @@ static double s_fPps = 75.5;
 static size_t s_nFps = 60;
 static size_t s_nPps = 75;
 
+static bool s_bHeadless = false;
+
 size_t IdealFramesPerSecond()
 {
     return s_nFps;
@@ -29,6 +32,16 @@ double PacsPerSecondF()
     return s_fPps;
 }
 
+bool IsHeadless()
+{
+    return s_bHeadless;
+}
+
+void SetHeadless(bool bHeadless)
+{
+    s_bHeadless = bHeadless;
+}
+
 int Sign(int num)
 {
     if (num < 0)
@@ -44,6 +57,71 @@ int Sign(int num)
     return 0;
 }
 
+TileExit DirToExit(ff::point_int dir)
+{
+    if (dir.y < 0)
+    {
+        return EXIT_UP;
+    }
+    else if (dir.x < 0)
+    {
+        return EXIT_LEFT;
+    }
+    else if (dir.y > 0)
+    {
+        return EXIT_DOWN;
+    }
+    else if (dir.x > 0)
+    {
+        return EXIT_RIGHT;
+    }
+
+    return EXIT_NONE;
+}
+
+ff::point_int ExitToDir(TileExit exit)
+{
+    switch (exit)
+    {
+        case EXIT_UP: return ff::point_int(0, -1);
+        case EXIT_LEFT: return ff::point_int(-1, 0);
+        case EXIT_DOWN: return ff::point_int(0, 1);
+        case EXIT_RIGHT: return ff::point_int(1, 0);
+        default: return ff::point_int(0, 0);
+    }
+}
+
+size_t CountExits(BYTE exits)
+{
+    return ((exits & EXIT_UP) ? 1 : 0) +
+        ((exits & EXIT_LEFT) ? 1 : 0) +
+        ((exits & EXIT_DOWN) ? 1 : 0) +
+        ((exits & EXIT_RIGHT) ? 1 : 0);
+}
+
+BYTE PressDirToByte(ff::point_int dir)
+{
+    return (BYTE)((dir.x < 0 ? 0x01 : 0) | (dir.x > 0 ? 0x02 : 0) | (dir.y < 0 ? 0x04 : 0) | (dir.y > 0 ? 0x08 : 0));
+}
+
+ff::point_int ByteToPressDir(BYTE value)
+{
+    return ff::point_int(
+        (value & 0x01) ? -1 : ((value & 0x02) ? 1 : 0),
+        (value & 0x04) ? -1 : ((value & 0x08) ? 1 : 0));
+}
+
+ff::point_int WrapTile(ff::point_int tile, ff::point_int size)
+{
+    if (size.x > 0 && size.y > 0)
+    {
+        tile.x = (tile.x % size.x + size.x) % size.x;
+        tile.y = (tile.y % size.y + size.y) % size.y;
+    }
+
+    return tile;
+}
+
 ff::point_int PixelsPerTile()
 {
     return ff::point_int(8, 8);
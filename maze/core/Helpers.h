@@ -1,13 +1,26 @@
 #pragma once
 
+enum TileExit : BYTE;
+
 size_t IdealFramesPerSecond();
 double IdealFramesPerSecondF();
 
 size_t PacsPerSecond();
 double PacsPerSecondF();
 
+// Games still play when headless, but nothing is rendered, no sounds play, and debug keys are ignored
+bool IsHeadless();
+void SetHeadless(bool bHeadless);
+
 int Sign(int num);
 
+TileExit DirToExit(ff::point_int dir);
+ff::point_int ExitToDir(TileExit exit);
+size_t CountExits(BYTE exits);
+BYTE PressDirToByte(ff::point_int dir); // keeps diagonals, for recording what was pressed
+ff::point_int ByteToPressDir(BYTE value);
+ff::point_int WrapTile(ff::point_int tile, ff::point_int size); // leaving one edge of the maze comes back in on the other
+
 ff::point_int PixelsPerTile();
 ff::point_int PixelToTile(ff::point_int pixel);
 ff::point_int PixelAndDirToTile(ff::point_int pixel, ff::point_int dir);
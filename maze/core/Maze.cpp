@@ -1,9 +1,23 @@
 #include "pch.h"
 #include "Core/Difficulty.h"
 #include "Core/Maze.h"
+#include "Core/MazeCache.h"
+#include "Core/MazeDistances.h"
+#include "Core/MazeFlowField.h"
+#include "Core/MazeGraph.h"
 #include "Core/Tiles.h"
 
-class Maze : public IMaze
+// Measurements only depend on walls, zones, and the ghost door, so copies of a maze share them until one of
+// those changes. Nothing stored in a holder is ever replaced, a changed maze moves to a new holder instead.
+struct MazeMeasurements
+{
+    std::mutex _mutex;
+    std::shared_ptr<MazeGraph> _graph; // created on demand
+    std::shared_ptr<MazeDistances> _distances; // created on demand
+    std::shared_ptr<MazeFlowField> _houseFlowField; // created on demand
+};
+
+class Maze : public IMaze, public IMazeListener
 {
 public:
     Maze(
@@ -12,6 +26,7 @@ public:
         DirectX::XMFLOAT4 colorBorder,
         DirectX::XMFLOAT4 colorFill,
         DirectX::XMFLOAT4 colorBackground);
+    virtual ~Maze();
 
     // IMaze
 
@@ -26,12 +41,18 @@ public:
 
     virtual ff::point_int GetSizeInTiles() const override;
     virtual void SetSizeInTiles(ff::point_int tileSize) override;
-    virtual void ShiftTiles(ff::point_int tileShift) override;
+    virtual void ShiftTiles(ff::point_int tileShift, bool bWrap) override;
+    virtual void BeginChanges() override;
+    virtual void CommitChanges() override;
 
     virtual TileContent GetTileContent(ff::point_int tile) const override;
     virtual void SetTileContent(ff::point_int tile, TileContent content) override;
     virtual TileZone GetTileZone(ff::point_int tile) const override;
     virtual void SetTileZone(ff::point_int tile, TileZone zone) override;
+    virtual const Tiles& GetTiles() const override;
+    virtual const MazeGraph& GetGraph() override;
+    virtual const MazeDistances& GetDistances() override;
+    virtual const MazeFlowField& GetHouseFlowField() override;
 
     virtual const DirectX::XMFLOAT4& GetFillColor() const override;
     virtual const DirectX::XMFLOAT4& GetBorderColor() const override;
@@ -40,12 +61,25 @@ public:
     virtual void SetBorderColor(const DirectX::XMFLOAT4& color) override;
     virtual void SetBackgroundColor(const DirectX::XMFLOAT4& color) override;
 
+    // IMazeListener
+
+    virtual void OnTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent) override;
+    virtual void OnAllTilesChanged() override;
+    virtual void OnTilesChanged(const ff::rect_int* pRects, size_t nRects) override;
+
 private:
-    GUID _id;
+    void UpdateMeasurements(const ff::point_int* pTiles, size_t nTiles, bool bWallChanged, bool bDoorChanged);
+
+    mutable GUID _id; // created on demand
+    mutable bool _hasID;
     DirectX::XMFLOAT4 _fillColor;
     DirectX::XMFLOAT4 _borderColor;
     DirectX::XMFLOAT4 _backgroundColor;
     std::shared_ptr<Tiles> _tiles;
+    std::shared_ptr<MazeMeasurements> _measurements;
+    const MazeGraph* _graph; // cached from _measurements
+    const MazeDistances* _distances; // cached from _measurements
+    const MazeFlowField* _houseFlowField; // cached from _measurements
     CharType _charType;
 };
 
@@ -56,11 +90,13 @@ static DirectX::XMFLOAT4 VectorFromRect(const ff::rect_float& rect)
 
 std::shared_ptr<IMaze> CreateMazeFromResource(std::string_view name)
 {
-    static std::shared_ptr<ff::resource_values> values_maze;
-    if (!values_maze)
-    {
-        values_maze = ff::auto_resource<ff::resource_values>("values_maze").object();
-    }
+    return MazeCache::Get().GetMaze(name);
+}
+
+std::shared_ptr<IMaze> CreateMazeFromValues(std::string_view name)
+{
+    // Mazes can be loaded from any thread
+    static std::shared_ptr<ff::resource_values> values_maze = ff::auto_resource<ff::resource_values>("values_maze").object();
 
     ff::value_ptr rawValue = values_maze->get_resource_value(name);
     assert_ret_val(rawValue, nullptr);
@@ -103,19 +139,38 @@ Maze::Maze(
     , _borderColor(colorBorder)
     , _backgroundColor(colorBackground)
     , _charType(type)
+    , _hasID(false)
+    , _measurements(std::make_shared<MazeMeasurements>())
+    , _graph(nullptr)
+    , _distances(nullptr)
+    , _houseFlowField(nullptr)
 {
-    CoCreateGuid(&_id);
+    // Listen first, so measurements are current before anyone else hears about a change
+    AddListener(this);
+}
+
+Maze::~Maze()
+{
+    RemoveListener(this);
 }
 
 REFGUID Maze::GetID() const
 {
+    if (!_hasID)
+    {
+        ::CoCreateGuid(&_id);
+        _hasID = true;
+    }
+
     return _id;
 }
 
 std::shared_ptr<IMaze> Maze::Clone(bool bShareTiles)
 {
     std::shared_ptr<Tiles> tiles = bShareTiles ? _tiles : _tiles->Clone();
-    return std::make_shared<Maze>(_charType, tiles, _borderColor, _fillColor, _backgroundColor);
+    std::shared_ptr<Maze> maze = std::make_shared<Maze>(_charType, tiles, _borderColor, _fillColor, _backgroundColor);
+    maze->_measurements = _measurements;
+    return maze;
 }
 
 void Maze::AddListener(IMazeListener* pListener)
@@ -154,9 +209,19 @@ void Maze::SetSizeInTiles(ff::point_int tileSize)
     _tiles->SetSize(tileSize);
 }
 
-void Maze::ShiftTiles(ff::point_int tileShift)
+void Maze::ShiftTiles(ff::point_int tileShift, bool bWrap)
+{
+    _tiles->Shift(tileShift, bWrap);
+}
+
+void Maze::BeginChanges()
+{
+    _tiles->BeginChanges();
+}
+
+void Maze::CommitChanges()
 {
-    _tiles->Shift(tileShift);
+    _tiles->CommitChanges();
 }
 
 TileContent Maze::GetTileContent(ff::point_int tile) const
@@ -179,6 +244,63 @@ void Maze::SetTileZone(ff::point_int tile, TileZone zone)
     _tiles->SetZone(tile, zone);
 }
 
+const Tiles& Maze::GetTiles() const
+{
+    return *_tiles;
+}
+
+const MazeGraph& Maze::GetGraph()
+{
+    if (!_graph)
+    {
+        std::lock_guard<std::mutex> lock(_measurements->_mutex);
+
+        if (!_measurements->_graph)
+        {
+            _measurements->_graph = std::make_shared<MazeGraph>(*_tiles);
+        }
+
+        _graph = _measurements->_graph.get();
+    }
+
+    return *_graph;
+}
+
+const MazeDistances& Maze::GetDistances()
+{
+    if (!_distances)
+    {
+        // Other copies wait for the search instead of repeating it
+        std::lock_guard<std::mutex> lock(_measurements->_mutex);
+
+        if (!_measurements->_distances)
+        {
+            _measurements->_distances = std::make_shared<MazeDistances>(*_tiles);
+        }
+
+        _distances = _measurements->_distances.get();
+    }
+
+    return *_distances;
+}
+
+const MazeFlowField& Maze::GetHouseFlowField()
+{
+    if (!_houseFlowField)
+    {
+        std::lock_guard<std::mutex> lock(_measurements->_mutex);
+
+        if (!_measurements->_houseFlowField)
+        {
+            _measurements->_houseFlowField = std::make_shared<MazeFlowField>(*_tiles);
+        }
+
+        _houseFlowField = _measurements->_houseFlowField.get();
+    }
+
+    return *_houseFlowField;
+}
+
 const DirectX::XMFLOAT4& Maze::GetFillColor() const
 {
     return _fillColor;
@@ -208,3 +330,116 @@ void Maze::SetBackgroundColor(const DirectX::XMFLOAT4& color)
 {
     _backgroundColor = color;
 }
+
+void Maze::OnTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent)
+{
+    // Zone changes are reported with the same old and new content, the graph checks if the zone really changed.
+    // Eating dots never changes a measurement.
+
+    bool bWallChanged = Tiles::IsWallContent(oldContent) != Tiles::IsWallContent(newContent);
+    bool bDoorChanged = oldContent != newContent && (oldContent == CONTENT_GHOST_DOOR || newContent == CONTENT_GHOST_DOOR);
+
+    if (bWallChanged || bDoorChanged || oldContent == newContent)
+    {
+        UpdateMeasurements(&tile, 1, bWallChanged, bDoorChanged);
+    }
+}
+
+void Maze::OnAllTilesChanged()
+{
+    _measurements = std::make_shared<MazeMeasurements>();
+    _graph = nullptr;
+    _distances = nullptr;
+    _houseFlowField = nullptr;
+}
+
+// A batch doesn't say what each tile used to be. The graph still knows which tiles really changed shape,
+// and a ghost door could only have changed where there's a wall now or where the shape changed.
+void Maze::OnTilesChanged(const ff::rect_int* pRects, size_t nRects)
+{
+    std::shared_ptr<MazeGraph> graph;
+    {
+        std::lock_guard<std::mutex> lock(_measurements->_mutex);
+        graph = _measurements->_graph;
+    }
+
+    std::vector<ff::point_int> tiles;
+    bool bShapeChanged = !graph;
+    bool bWallNow = false;
+
+    for (size_t i = 0; i < nRects; i++)
+    {
+        const ff::rect_int& rect = pRects[i];
+
+        for (ff::point_int tile(rect.left, rect.top); tile.y < rect.bottom; tile.x = rect.left, tile.y++)
+        {
+            for (; tile.x < rect.right; tile.x++)
+            {
+                tiles.push_back(tile);
+                bWallNow |= Tiles::IsWallContent(_tiles->GetContent(tile));
+                bShapeChanged |= graph && graph->NeedsUpdate(*_tiles, tile);
+            }
+        }
+    }
+
+    UpdateMeasurements(tiles.data(), tiles.size(), bShapeChanged, bShapeChanged || bWallNow);
+}
+
+// Other copies may still be using the old holder, so this copy moves to a new one that keeps what's still valid
+void Maze::UpdateMeasurements(const ff::point_int* pTiles, size_t nTiles, bool bWallChanged, bool bDoorChanged)
+{
+    std::shared_ptr<MazeMeasurements> measurements = std::make_shared<MazeMeasurements>();
+    {
+        std::lock_guard<std::mutex> lock(_measurements->_mutex);
+        measurements->_graph = _measurements->_graph;
+        measurements->_distances = _measurements->_distances;
+        measurements->_houseFlowField = _measurements->_houseFlowField;
+    }
+
+    bool bGraphChanged = false;
+    for (size_t i = 0; i < nTiles && measurements->_graph && !bGraphChanged; i++)
+    {
+        bGraphChanged = measurements->_graph->NeedsUpdate(*_tiles, pTiles[i]);
+    }
+
+    bool bDistancesChanged = measurements->_distances && bWallChanged;
+    bool bHouseFlowFieldChanged = measurements->_houseFlowField && (bWallChanged || bDoorChanged);
+
+    if (!bGraphChanged && !bDistancesChanged && !bHouseFlowFieldChanged)
+    {
+        return;
+    }
+
+    if (bGraphChanged)
+    {
+        // Only update the graph in place when no other copy can see it, through this holder or an older one
+
+        if (_measurements.use_count() > 1 || measurements->_graph.use_count() > 2)
+        {
+            measurements->_graph = std::make_shared<MazeGraph>(*measurements->_graph);
+        }
+
+        for (size_t i = 0; i < nTiles; i++)
+        {
+            if (measurements->_graph->NeedsUpdate(*_tiles, pTiles[i]))
+            {
+                measurements->_graph->Update(*_tiles, pTiles[i]);
+            }
+        }
+    }
+
+    if (bDistancesChanged)
+    {
+        measurements->_distances = nullptr;
+    }
+
+    if (bHouseFlowFieldChanged)
+    {
+        measurements->_houseFlowField = nullptr;
+    }
+
+    _measurements = measurements;
+    _graph = measurements->_graph.get();
+    _distances = measurements->_distances.get();
+    _houseFlowField = measurements->_houseFlowField.get();
+}
@@ -2,6 +2,9 @@
 
 class Tiles;
 class IMazeListener;
+class MazeDistances;
+class MazeFlowField;
+class MazeGraph;
 enum CharType;
 enum TileContent : BYTE;
 enum TileZone : BYTE;
@@ -19,6 +22,7 @@ public:
         const DirectX::XMFLOAT4& colorBackground);
 
     virtual REFGUID GetID() const = 0;
+    // Copies share the graph, distances, and flow field until one of them changes a wall, zone, or ghost door
     virtual std::shared_ptr<IMaze> Clone(bool bShareTiles) = 0;
 
     virtual void AddListener(IMazeListener* pListener) = 0;
@@ -29,12 +33,18 @@ public:
 
     virtual ff::point_int GetSizeInTiles() const = 0;
     virtual void SetSizeInTiles(ff::point_int tileSize) = 0;
-    virtual void ShiftTiles(ff::point_int tileShift) = 0;
+    virtual void ShiftTiles(ff::point_int tileShift, bool bWrap) = 0;
+    virtual void BeginChanges() = 0;
+    virtual void CommitChanges() = 0;
 
     virtual TileContent GetTileContent(ff::point_int tile) const = 0;
     virtual void SetTileContent(ff::point_int tile, TileContent content) = 0;
     virtual TileZone GetTileZone(ff::point_int tile) const = 0;
     virtual void SetTileZone(ff::point_int tile, TileZone zone) = 0;
+    virtual const Tiles& GetTiles() const = 0;
+    virtual const MazeGraph& GetGraph() = 0;
+    virtual const MazeDistances& GetDistances() = 0;
+    virtual const MazeFlowField& GetHouseFlowField() = 0;
 
     virtual const DirectX::XMFLOAT4& GetFillColor() const = 0;
     virtual const DirectX::XMFLOAT4& GetBorderColor() const = 0;
@@ -51,6 +61,13 @@ public:
 
     virtual void OnTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent) = 0;
     virtual void OnAllTilesChanged() = 0;
+
+    // Batched changes from IMaze::CommitChanges, override to only update the tiles within the rects
+    virtual void OnTilesChanged(const ff::rect_int* pRects, size_t nRects)
+    {
+        OnAllTilesChanged();
+    }
 };
 
 std::shared_ptr<IMaze> CreateMazeFromResource(std::string_view name);
+std::shared_ptr<IMaze> CreateMazeFromValues(std::string_view name);
@@ -0,0 +1,251 @@
+#include "pch.h"
+#include "Core/Difficulty.h"
+#include "Core/Maze.h"
+#include "Core/MazeCache.h"
+#include "Core/MazeDistances.h"
+#include "Core/MazeFlowField.h"
+#include "Core/MazeGraph.h"
+#include "Core/MazePack.h"
+#include "Core/Mazes.h"
+#include "Core/StaticTiles.h"
+#include "Core/Tiles.h"
+
+static std::shared_ptr<IMazes> CloneMazes(const IMazes& source)
+{
+    std::shared_ptr<IMazes> mazes = IMazes::Create();
+    mazes->SetID(source.GetID());
+    mazes->SetStartingLives(source.GetStartingLives());
+    mazes->SetFreeLifeScore(source.GetFreeLifeScore(), source.GetFreeLifeRepeat(), source.GetMaxFreeLives());
+    mazes->SetStats(source.GetStats());
+
+    for (size_t i = 0; i < source.GetMazeCount(); i++)
+    {
+        mazes->AddMaze(i, source.GetMaze(i)->Clone(false));
+    }
+
+    for (size_t i = 0; i < source.GetDifficultyCount(); i++)
+    {
+        mazes->AddDifficulty(i, source.GetDifficulty(i));
+    }
+
+    return mazes;
+}
+
+// Measures a cached maze once, every copy handed out shares the results until it changes a wall
+static void MeasureMaze(IMaze& maze, bool bDistances)
+{
+    maze.GetGraph();
+    maze.GetHouseFlowField();
+
+    if (bDistances)
+    {
+        maze.GetDistances();
+    }
+}
+
+static void MeasureMazes(IMazes& mazes)
+{
+    bool bDistances = false;
+
+    for (size_t i = 0; i < mazes.GetDifficultyCount(); i++)
+    {
+        bDistances |= mazes.GetDifficulty(i).UsesPathTargeting();
+    }
+
+    for (size_t i = 0; i < mazes.GetMazeCount(); i++)
+    {
+        MeasureMaze(*mazes.GetMaze(i), bDistances);
+    }
+}
+
+MazeCache::MazeCache()
+    : _stats{}
+    , _stopPrewarm(false)
+{
+}
+
+MazeCache::~MazeCache()
+{
+    StopPrewarm();
+}
+
+// static
+MazeCache& MazeCache::Get()
+{
+    static MazeCache s_cache;
+    return s_cache;
+}
+
+// static
+const std::vector<std::string_view>& MazeCache::GetBuiltInMazesIds()
+{
+    static const std::vector<std::string_view> s_ids =
+    {
+        "mr-mazes-easy",
+        "mr-mazes-normal",
+        "mr-mazes-hard",
+        "ms-mazes-easy",
+        "ms-mazes-normal",
+        "ms-mazes-hard",
+    };
+
+    return s_ids;
+}
+
+// static
+const std::vector<std::string_view>& MazeCache::GetBuiltInMazeNames()
+{
+    static const std::vector<std::string_view> s_names =
+    {
+        "title-maze-front",
+        "title-maze-back",
+        "high-score-maze",
+    };
+
+    return s_names;
+}
+
+std::shared_ptr<Tiles> MazeCache::GetTiles(std::string_view name)
+{
+    std::shared_ptr<Tiles> tiles = Find<Tiles>(_tiles, name, [name]()
+        {
+            std::shared_ptr<Tiles> tiles = CreateBuiltInTiles(name);
+            if (!tiles)
+            {
+                std::shared_ptr<MazePack> pack = MazePack::Get();
+                tiles = pack ? pack->CreateTiles(name) : nullptr;
+            }
+
+            return tiles ? tiles : CreateTilesFromValues(name);
+        });
+
+    return tiles ? tiles->Clone() : nullptr;
+}
+
+std::shared_ptr<IMaze> MazeCache::GetMaze(std::string_view name)
+{
+    std::shared_ptr<IMaze> maze = Find<IMaze>(_mazes, name, [name]()
+        {
+            std::shared_ptr<MazePack> pack = MazePack::Get();
+            std::shared_ptr<IMaze> maze = pack ? pack->CreateMaze(name) : nullptr;
+            maze = maze ? maze : CreateMazeFromValues(name);
+
+            if (maze)
+            {
+                MeasureMaze(*maze, false);
+            }
+
+            return maze;
+        });
+
+    return maze ? maze->Clone(false) : nullptr;
+}
+
+std::shared_ptr<IMazes> MazeCache::GetMazes(std::string_view id)
+{
+    std::shared_ptr<IMazes> mazes = Find<IMazes>(_mazeSets, id, [id]()
+        {
+            std::shared_ptr<MazePack> pack = MazePack::Get();
+            std::shared_ptr<IMazes> mazes = pack ? pack->CreateMazes(id) : nullptr;
+            mazes = mazes ? mazes : CreateMazesFromValues(id);
+
+            if (mazes)
+            {
+                MeasureMazes(*mazes);
+            }
+
+            return mazes;
+        });
+
+    return mazes ? CloneMazes(*mazes) : nullptr;
+}
+
+void MazeCache::Prewarm(std::string_view firstMazesId)
+{
+    StopPrewarm();
+
+    // The set that's about to be played comes first, then the single mazes, then the other sets.
+    // Ones already loaded are only found again in the cache.
+
+    _stopPrewarm = false;
+    _prewarm = std::async(std::launch::async, [this, firstId = std::string(firstMazesId)]()
+        {
+            if (firstId.size())
+            {
+                GetMazes(firstId);
+            }
+
+            for (std::string_view name : GetBuiltInMazeNames())
+            {
+                if (_stopPrewarm)
+                {
+                    return;
+                }
+
+                GetMaze(name);
+            }
+
+            for (std::string_view id : GetBuiltInMazesIds())
+            {
+                if (_stopPrewarm)
+                {
+                    return;
+                }
+
+                GetMazes(id);
+            }
+
+            if constexpr (ff::constants::debug_build)
+            {
+                MazeCacheStats stats = GetStats();
+                std::string text = "MazeCache prewarmed: " +
+                    std::to_string(stats._misses) + " built in " +
+                    std::to_string((int)(stats._buildSeconds * 1000.0)) + "ms\n";
+                ::OutputDebugStringA(text.c_str());
+            }
+        });
+}
+
+void MazeCache::StopPrewarm()
+{
+    if (_prewarm.valid())
+    {
+        _stopPrewarm = true;
+        _prewarm.wait();
+        _prewarm = std::future<void>();
+    }
+}
+
+MazeCacheStats MazeCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+template<typename T>
+std::shared_ptr<T> MazeCache::Find(std::unordered_map<std::string, std::shared_ptr<T>>& map, std::string_view name, const std::function<std::shared_ptr<T>()>& build)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto i = map.find(std::string(name));
+        if (i != map.end())
+        {
+            _stats._hits++;
+            return i->second;
+        }
+
+        _stats._misses++;
+    }
+
+    // Building can load other cached objects, so don't hold the lock. If two threads build the same thing, the first one wins.
+    auto startTime = std::chrono::steady_clock::now();
+    std::shared_ptr<T> value = build();
+    std::chrono::duration<double> buildTime = std::chrono::steady_clock::now() - startTime;
+    assert_ret_val(value, nullptr);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats._buildSeconds += buildTime.count();
+
+    return map.try_emplace(std::string(name), value).first->second;
+}
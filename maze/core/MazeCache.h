@@ -0,0 +1,48 @@
+#pragma once
+
+class IMaze;
+class IMazes;
+class Tiles;
+
+struct MazeCacheStats
+{
+    size_t _hits;
+    size_t _misses;
+    double _buildSeconds; // total time spent building cache misses
+};
+
+// Process-wide cache of built-in mazes, keyed by resource name. The cached objects are never changed or
+// handed out directly, callers always get clones that share the cached tile data until they change it.
+class MazeCache
+{
+public:
+    MazeCache();
+    ~MazeCache();
+
+    static MazeCache& Get();
+    static const std::vector<std::string_view>& GetBuiltInMazesIds();
+    static const std::vector<std::string_view>& GetBuiltInMazeNames();
+
+    std::shared_ptr<Tiles> GetTiles(std::string_view name);
+    std::shared_ptr<IMaze> GetMaze(std::string_view name);
+    std::shared_ptr<IMazes> GetMazes(std::string_view id);
+
+    // Loads every built-in maze on a background thread, starting with firstMazesId
+    void Prewarm(std::string_view firstMazesId);
+    void StopPrewarm();
+
+    MazeCacheStats GetStats() const;
+
+private:
+    template<typename T>
+    std::shared_ptr<T> Find(std::unordered_map<std::string, std::shared_ptr<T>>& map, std::string_view name, const std::function<std::shared_ptr<T>()>& build);
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, std::shared_ptr<Tiles>> _tiles;
+    std::unordered_map<std::string, std::shared_ptr<IMaze>> _mazes;
+    std::unordered_map<std::string, std::shared_ptr<IMazes>> _mazeSets;
+    MazeCacheStats _stats;
+
+    std::future<void> _prewarm;
+    std::atomic<bool> _stopPrewarm;
+};
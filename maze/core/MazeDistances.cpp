@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "Core/Helpers.h"
+#include "Core/MazeDistances.h"
+#include "Core/Tiles.h"
+
+MazeDistances::MazeDistances(const Tiles& tiles)
+    : _size(tiles.GetSize())
+{
+    _tileOpen.assign(_size.x * _size.y, ff::constants::invalid_unsigned<size_t>());
+
+    for (ff::point_int tile(0, 0); tile.y < _size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < _size.x; tile.x++)
+        {
+            if (!tiles.IsWall(tile))
+            {
+                _tileOpen[tile.y * _size.x + tile.x] = _openTiles.size();
+                _openTiles.push_back(tile);
+            }
+        }
+    }
+
+    if (_openTiles.empty() || _openTiles.size() > MAX_OPEN_TILES)
+    {
+        return;
+    }
+
+    _distances.assign(_openTiles.size() * _openTiles.size(), NO_DISTANCE);
+
+    // Each search only writes its own row, so they can all run at once
+
+    std::vector<size_t> sources(_openTiles.size());
+    std::iota(sources.begin(), sources.end(), 0);
+
+    std::for_each(std::execution::par, sources.begin(), sources.end(), [this, &tiles](size_t nSource)
+        {
+            std::vector<size_t> queue;
+            Search(tiles, nSource, queue);
+        });
+}
+
+bool MazeDistances::IsValid() const
+{
+    return !_distances.empty();
+}
+
+size_t MazeDistances::GetOpenTileCount() const
+{
+    return _openTiles.size();
+}
+
+size_t MazeDistances::GetDistance(ff::point_int fromTile, ff::point_int toTile) const
+{
+    size_t nFrom = GetOpenIndex(fromTile);
+    size_t nTo = GetOpenIndex(toTile);
+
+    if (nFrom == ff::constants::invalid_unsigned<size_t>() ||
+        nTo == ff::constants::invalid_unsigned<size_t>() ||
+        _distances.empty())
+    {
+        return ff::constants::invalid_unsigned<size_t>();
+    }
+
+    uint16_t nDist = _distances[nFrom * _openTiles.size() + nTo];
+    return (nDist != NO_DISTANCE) ? nDist : ff::constants::invalid_unsigned<size_t>();
+}
+
+// Walks are the same length both ways, so the target's row has the distance from every tile
+size_t MazeDistances::GetDistances(const ff::point_int* pFromTiles, size_t nCount, ff::point_int toTile, size_t* pDistances) const
+{
+    size_t nTo = GetOpenIndex(toTile);
+    const uint16_t* pRow = (nTo != ff::constants::invalid_unsigned<size_t>() && !_distances.empty())
+        ? &_distances[nTo * _openTiles.size()]
+        : nullptr;
+
+    size_t nReachable = 0;
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        size_t nFrom = pRow ? GetOpenIndex(pFromTiles[i]) : ff::constants::invalid_unsigned<size_t>();
+        uint16_t nDist = (nFrom != ff::constants::invalid_unsigned<size_t>()) ? pRow[nFrom] : NO_DISTANCE;
+
+        pDistances[i] = (nDist != NO_DISTANCE) ? nDist : ff::constants::invalid_unsigned<size_t>();
+        nReachable += (nDist != NO_DISTANCE);
+    }
+
+    return nReachable;
+}
+
+void MazeDistances::Search(const Tiles& tiles, size_t nSource, std::vector<size_t>& queue)
+{
+    uint16_t* pRow = &_distances[nSource * _openTiles.size()];
+    pRow[nSource] = 0;
+
+    queue.reserve(_openTiles.size());
+    queue.push_back(nSource);
+
+    for (size_t nQueue = 0; nQueue < queue.size(); nQueue++)
+    {
+        size_t nOpen = queue[nQueue];
+        ff::point_int tile = _openTiles[nOpen];
+        uint16_t nNextDist = pRow[nOpen] + 1;
+        BYTE exits = tiles.GetExits(tile);
+
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            if (exits & exit)
+            {
+                size_t nNext = GetOpenIndex(WrapTile(tile + ExitToDir((TileExit)exit), _size));
+                if (nNext != ff::constants::invalid_unsigned<size_t>() && pRow[nNext] == NO_DISTANCE)
+                {
+                    pRow[nNext] = nNextDist;
+                    queue.push_back(nNext);
+                }
+            }
+        }
+    }
+}
+
+size_t MazeDistances::GetOpenIndex(ff::point_int tile) const
+{
+    if (!_tileOpen.empty() &&
+        tile.x >= -1 && tile.x <= _size.x &&
+        tile.y >= -1 && tile.y <= _size.y)
+    {
+        // Only one tile off the edge, so this wraps without dividing
+        tile.x = (tile.x < 0) ? _size.x - 1 : ((tile.x == _size.x) ? 0 : tile.x);
+        tile.y = (tile.y < 0) ? _size.y - 1 : ((tile.y == _size.y) ? 0 : tile.y);
+        return _tileOpen[tile.y * _size.x + tile.x];
+    }
+
+    return ff::constants::invalid_unsigned<size_t>();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+class Tiles;
+
+// Walking distance in tiles between every pair of open tiles, found with one breadth first search per tile.
+// Only depends on the walls, so the owning IMaze shares it between copies until a wall changes.
+// Very large mazes aren't measured, every distance is invalid for them.
+class MazeDistances
+{
+public:
+    MazeDistances(const Tiles& tiles);
+
+    static constexpr size_t MAX_OPEN_TILES = 2048;
+
+    bool IsValid() const;
+    size_t GetOpenTileCount() const;
+
+    // Tiles just off the edge of the maze count as the tile on the other side. Returns invalid when either tile
+    // isn't open, or when there is no way from one to the other.
+    size_t GetDistance(ff::point_int fromTile, ff::point_int toTile) const;
+
+    // Same as GetDistance for each of the from tiles, but only looks up the target once.
+    // Returns how many of them can walk there.
+    size_t GetDistances(const ff::point_int* pFromTiles, size_t nCount, ff::point_int toTile, size_t* pDistances) const;
+
+private:
+    void Search(const Tiles& tiles, size_t nSource, std::vector<size_t>& queue);
+    size_t GetOpenIndex(ff::point_int tile) const;
+
+    static constexpr uint16_t NO_DISTANCE = 0xFFFF;
+
+    ff::point_int _size;
+    std::vector<ff::point_int> _openTiles;
+    std::vector<size_t> _tileOpen; // index into _openTiles for each tile, or invalid
+    std::vector<uint16_t> _distances; // _openTiles.size() squared, by source row
+};
@@ -0,0 +1,76 @@
+#include "pch.h"
+#include "Core/Helpers.h"
+#include "Core/MazeFlowField.h"
+#include "Core/Tiles.h"
+
+MazeFlowField::MazeFlowField(const Tiles& tiles)
+    : _size(tiles.GetSize())
+    , _goalTile(tiles.GetCensus()._ghostDoor + ff::point_int(0, -1))
+{
+    if (!tiles.GetCensus()._contentCounts[CONTENT_GHOST_DOOR])
+    {
+        return;
+    }
+
+    _distances.assign(_size.x * _size.y, ff::constants::invalid_unsigned<size_t>());
+
+    // Eyes aim for the right edge of the goal tile, so the tile to its right is also there.
+    // Moving between open tiles works the same both ways, so searching out from the goal finds every way back.
+
+    std::vector<ff::point_int> queue;
+    queue.reserve(_distances.size());
+
+    for (ff::point_int tile : { _goalTile, _goalTile + ff::point_int(1, 0) })
+    {
+        if (tile.x >= 0 && tile.x < _size.x && tile.y >= 0 && tile.y < _size.y && !tiles.IsWall(tile))
+        {
+            _distances[tile.y * _size.x + tile.x] = 0;
+            queue.push_back(tile);
+        }
+    }
+
+    for (size_t nQueue = 0; nQueue < queue.size(); nQueue++)
+    {
+        ff::point_int tile = queue[nQueue];
+        size_t nNextDist = _distances[tile.y * _size.x + tile.x] + 1;
+        BYTE exits = tiles.GetExits(tile);
+
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            if (exits & exit)
+            {
+                ff::point_int nextTile = WrapTile(tile + ExitToDir((TileExit)exit), _size);
+                size_t& nDist = _distances[nextTile.y * _size.x + nextTile.x];
+
+                if (nDist == ff::constants::invalid_unsigned<size_t>() && !tiles.IsWall(nextTile))
+                {
+                    nDist = nNextDist;
+                    queue.push_back(nextTile);
+                }
+            }
+        }
+    }
+}
+
+bool MazeFlowField::IsValid() const
+{
+    return !_distances.empty();
+}
+
+ff::point_int MazeFlowField::GetGoalTile() const
+{
+    return _goalTile;
+}
+
+size_t MazeFlowField::GetDistance(ff::point_int tile) const
+{
+    if (_distances.empty() ||
+        tile.x < -1 || tile.x > _size.x ||
+        tile.y < -1 || tile.y > _size.y)
+    {
+        return ff::constants::invalid_unsigned<size_t>();
+    }
+
+    tile = WrapTile(tile, _size);
+    return _distances[tile.y * _size.x + tile.x];
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+class Tiles;
+
+// Walking distance from every open tile to the tile above the ghost door, where eyes go back into the house.
+// The owning IMaze shares it between copies until a wall or the ghost door changes.
+class MazeFlowField
+{
+public:
+    MazeFlowField(const Tiles& tiles);
+
+    bool IsValid() const;
+    ff::point_int GetGoalTile() const;
+
+    // Tiles just off the edge of the maze count as the tile on the other side. Returns invalid for walls and
+    // tiles that can't reach the goal.
+    size_t GetDistance(ff::point_int tile) const;
+
+private:
+    ff::point_int _size;
+    ff::point_int _goalTile;
+    std::vector<size_t> _distances; // for each tile, empty when there is no ghost door
+};
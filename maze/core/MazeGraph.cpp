@@ -0,0 +1,372 @@
+#include "pch.h"
+#include "Core/Helpers.h"
+#include "Core/MazeGraph.h"
+#include "Core/Tiles.h"
+
+static size_t ExitIndex(TileExit exit)
+{
+    switch (exit)
+    {
+        case EXIT_UP: return 0;
+        case EXIT_LEFT: return 1;
+        case EXIT_DOWN: return 2;
+        case EXIT_RIGHT: return 3;
+        default: return ff::constants::invalid_unsigned<size_t>();
+    }
+}
+
+// Bits from GetTileShape
+static const BYTE SHAPE_WALL = 0x01;
+static const BYTE SHAPE_OUT_OF_BOUNDS = 0x02;
+
+MazeGraph::MazeGraph(const Tiles& tiles)
+    : _size(tiles.GetSize())
+{
+    size_t nTiles = (size_t)(_size.x * _size.y);
+    std::array<size_t, 4> noEdges;
+    noEdges.fill(ff::constants::invalid_unsigned<size_t>());
+
+    _tileShapes.resize(nTiles);
+    _tileNodes.assign(nTiles, ff::constants::invalid_unsigned<size_t>());
+    _tileEdges.assign(nTiles, noEdges);
+
+    // Any open tile that isn't a simple corridor is a node
+
+    for (ff::point_int tile(0, 0); tile.y < _size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < _size.x; tile.x++)
+        {
+            _tileShapes[GetTileIndex(tile)] = GetTileShape(tiles, tile);
+
+            if (IsNodeTile(tiles, tile))
+            {
+                AddNode(tiles, tile);
+            }
+        }
+    }
+
+    // Follow every exit of every node to the next node
+
+    for (size_t i = 0; i < _nodes.size(); i++)
+    {
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            if (_nodes[i]._exits & exit)
+            {
+                TraceEdge(tiles, i, ExitToDir((TileExit)exit));
+            }
+        }
+    }
+}
+
+size_t MazeGraph::GetNodeCount() const
+{
+    return _nodes.size();
+}
+
+const MazeGraphNode& MazeGraph::GetNode(size_t nNode) const
+{
+    return _nodes[nNode];
+}
+
+size_t MazeGraph::GetEdgeCount() const
+{
+    return _edges.size();
+}
+
+const MazeGraphEdge& MazeGraph::GetEdge(size_t nEdge) const
+{
+    return _edges[nEdge];
+}
+
+size_t MazeGraph::GetNodeIndex(ff::point_int tile) const
+{
+    size_t nTile = GetTileIndex(tile);
+    return (nTile != ff::constants::invalid_unsigned<size_t>()) ? _tileNodes[nTile] : ff::constants::invalid_unsigned<size_t>();
+}
+
+bool MazeGraph::IsNode(ff::point_int tile) const
+{
+    return GetNodeIndex(tile) != ff::constants::invalid_unsigned<size_t>();
+}
+
+bool MazeGraph::NeedsUpdate(const Tiles& tiles, ff::point_int tile) const
+{
+    size_t nTile = GetTileIndex(tile);
+
+    return tiles.GetSize() != _size ||
+        (nTile != ff::constants::invalid_unsigned<size_t>() && _tileShapes[nTile] != GetTileShape(tiles, tile));
+}
+
+void MazeGraph::Update(const Tiles& tiles, ff::point_int tile)
+{
+    size_t nTile = GetTileIndex(tile);
+
+    // Tunnels wrap around the edges, so a change there can reach corridors anywhere
+
+    if (tiles.GetSize() != _size || nTile == ff::constants::invalid_unsigned<size_t>() ||
+        !tile.x || !tile.y || tile.x == _size.x - 1 || tile.y == _size.y - 1)
+    {
+        *this = MazeGraph(tiles);
+        return;
+    }
+
+    _tileShapes[nTile] = GetTileShape(tiles, tile);
+
+    // A wall changes the exits of its neighbors too, so any of them can start or stop being a node.
+    // Every edge that leaves or enters one of those tiles needs to be traced again from where it started.
+
+    const ff::point_int nearTiles[5] =
+    {
+        tile,
+        tile + ff::point_int(0, -1),
+        tile + ff::point_int(-1, 0),
+        tile + ff::point_int(0, 1),
+        tile + ff::point_int(1, 0),
+    };
+
+    std::vector<size_t> retraceNodes;
+
+    for (ff::point_int nearTile : nearTiles)
+    {
+        size_t nNear = GetTileIndex(nearTile);
+        size_t nNode = _tileNodes[nNear];
+
+        for (size_t nEdge : std::array<size_t, 4>(_tileEdges[nNear]))
+        {
+            if (nEdge != ff::constants::invalid_unsigned<size_t>())
+            {
+                retraceNodes.push_back(_edges[nEdge]._from);
+                RemoveEdge(nEdge);
+            }
+        }
+
+        if (nNode != ff::constants::invalid_unsigned<size_t>())
+        {
+            for (size_t nEdge : _nodes[nNode]._edges)
+            {
+                if (nEdge != ff::constants::invalid_unsigned<size_t>())
+                {
+                    RemoveEdge(nEdge);
+                }
+            }
+        }
+    }
+
+    for (ff::point_int nearTile : nearTiles)
+    {
+        size_t nNode = _tileNodes[GetTileIndex(nearTile)];
+
+        if (!IsNodeTile(tiles, nearTile))
+        {
+            if (nNode != ff::constants::invalid_unsigned<size_t>())
+            {
+                RemoveNode(nNode);
+            }
+        }
+        else if (nNode == ff::constants::invalid_unsigned<size_t>())
+        {
+            retraceNodes.push_back(AddNode(tiles, nearTile));
+        }
+        else
+        {
+            _nodes[nNode]._exits = tiles.GetExits(nearTile);
+            retraceNodes.push_back(nNode);
+        }
+    }
+
+    for (size_t nNode : retraceNodes)
+    {
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            if ((_nodes[nNode]._exits & exit) &&
+                _nodes[nNode]._edges[ExitIndex((TileExit)exit)] == ff::constants::invalid_unsigned<size_t>())
+            {
+                TraceEdge(tiles, nNode, ExitToDir((TileExit)exit));
+            }
+        }
+    }
+}
+
+// static
+BYTE MazeGraph::GetTileShape(const Tiles& tiles, ff::point_int tile)
+{
+    return (tiles.IsWall(tile) ? SHAPE_WALL : 0) | (tiles.GetZone(tile) == ZONE_OUT_OF_BOUNDS ? SHAPE_OUT_OF_BOUNDS : 0);
+}
+
+// static
+bool MazeGraph::IsNodeTile(const Tiles& tiles, ff::point_int tile)
+{
+    return !tiles.IsWall(tile) && tiles.GetZone(tile) != ZONE_OUT_OF_BOUNDS && CountExits(tiles.GetExits(tile)) != 2;
+}
+
+size_t MazeGraph::AddNode(const Tiles& tiles, ff::point_int tile)
+{
+    size_t nNode = _nodes.size();
+
+    if (_freeNodes.size())
+    {
+        nNode = _freeNodes.back();
+        _freeNodes.pop_back();
+    }
+    else
+    {
+        _nodes.emplace_back();
+    }
+
+    MazeGraphNode& node = _nodes[nNode];
+    node._tile = tile;
+    node._exits = tiles.GetExits(tile);
+    std::fill(std::begin(node._edges), std::end(node._edges), ff::constants::invalid_unsigned<size_t>());
+
+    _tileNodes[GetTileIndex(tile)] = nNode;
+    return nNode;
+}
+
+// Its edges must already be removed
+void MazeGraph::RemoveNode(size_t nNode)
+{
+    MazeGraphNode& node = _nodes[nNode];
+    _tileNodes[GetTileIndex(node._tile)] = ff::constants::invalid_unsigned<size_t>();
+    node._tile = ff::point_int(-1, -1);
+    node._exits = 0;
+
+    _freeNodes.push_back(nNode);
+}
+
+void MazeGraph::RemoveEdge(size_t nEdge)
+{
+    MazeGraphEdge& edge = _edges[nEdge];
+    size_t& nNodeEdge = _nodes[edge._from]._edges[ExitIndex(DirToExit(edge._startDir))];
+
+    if (nNodeEdge == nEdge)
+    {
+        nNodeEdge = ff::constants::invalid_unsigned<size_t>();
+    }
+
+    for (size_t nTile : _edgeTiles[nEdge])
+    {
+        for (size_t& nTileEdge : _tileEdges[nTile])
+        {
+            if (nTileEdge == nEdge)
+            {
+                nTileEdge = ff::constants::invalid_unsigned<size_t>();
+            }
+        }
+    }
+
+    _edgeTiles[nEdge].clear();
+    edge._from = ff::constants::invalid_unsigned<size_t>();
+    edge._to = ff::constants::invalid_unsigned<size_t>();
+
+    _freeEdges.push_back(nEdge);
+}
+
+void MazeGraph::TraceEdge(const Tiles& tiles, size_t nNode, ff::point_int dir)
+{
+    size_t nEdge = _edges.size();
+
+    if (_freeEdges.size())
+    {
+        nEdge = _freeEdges.back();
+        _freeEdges.pop_back();
+    }
+    else
+    {
+        _edges.emplace_back();
+        _edgeTiles.emplace_back();
+    }
+
+    MazeGraphEdge& edge = _edges[nEdge];
+    std::vector<size_t>& edgeTiles = _edgeTiles[nEdge];
+
+    edge._from = nNode;
+    edge._to = ff::constants::invalid_unsigned<size_t>();
+    edge._startDir = dir;
+    edge._endDir = dir;
+    edge._tiles = 0;
+    edge._pixels = 0;
+
+    size_t nMaxSteps = (size_t)(_size.x + 4) * (size_t)(_size.y + 4);
+    ff::point_int tile = _nodes[nNode]._tile;
+
+    while (edge._tiles < nMaxSteps)
+    {
+        tile = StepTile(tile, dir);
+        edge._tiles++;
+
+        size_t nTile = GetTileIndex(tile);
+        if (nTile != ff::constants::invalid_unsigned<size_t>())
+        {
+            _tileEdges[nTile][ExitIndex(DirToExit(dir))] = nEdge;
+            edgeTiles.push_back(nTile);
+
+            if (_tileNodes[nTile] != ff::constants::invalid_unsigned<size_t>())
+            {
+                edge._to = _tileNodes[nTile];
+                edge._endDir = dir;
+                break;
+            }
+        }
+
+        if (nTile == ff::constants::invalid_unsigned<size_t>() || tiles.GetZone(tile) == ZONE_OUT_OF_BOUNDS)
+        {
+            // Can't turn out of bounds, so keep going straight through the tunnel
+
+            if (tiles.IsWall(tile + dir))
+            {
+                break;
+            }
+        }
+        else
+        {
+            BYTE exits = (BYTE)(tiles.GetExits(tile) & ~DirToExit(-dir));
+            if (CountExits(exits) != 1)
+            {
+                break;
+            }
+
+            dir = ExitToDir((TileExit)exits);
+        }
+    }
+
+    edge._pixels = (int)edge._tiles * PixelsPerTile().x;
+
+    _nodes[nNode]._edges[ExitIndex(DirToExit(edge._startDir))] = nEdge;
+}
+
+// Moves like PlayingMaze::CheckTunnel, which warps actors once they are two tiles outside the maze
+ff::point_int MazeGraph::StepTile(ff::point_int tile, ff::point_int dir) const
+{
+    tile += dir;
+
+    if (tile.x < -1)
+    {
+        tile.x = _size.x;
+    }
+    else if (tile.x > _size.x)
+    {
+        tile.x = -1;
+    }
+    else if (tile.y < -1)
+    {
+        tile.y = _size.y;
+    }
+    else if (tile.y > _size.y)
+    {
+        tile.y = -1;
+    }
+
+    return tile;
+}
+
+size_t MazeGraph::GetTileIndex(ff::point_int tile) const
+{
+    if (tile.x >= 0 && tile.x < _size.x &&
+        tile.y >= 0 && tile.y < _size.y)
+    {
+        return tile.y * _size.x + tile.x;
+    }
+
+    return ff::constants::invalid_unsigned<size_t>();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+class Tiles;
+
+// A decision point in the maze: any open tile that doesn't have exactly two exits.
+// Removed nodes keep their index with a tile of (-1, -1) and no exits.
+struct MazeGraphNode
+{
+    ff::point_int _tile;
+    BYTE _exits; // TileExit flags
+    size_t _edges[4]; // edge leaving through each exit (up, left, down, right), or invalid
+};
+
+// A corridor from one node to another, only ever has one way to go.
+// Removed edges keep their index with an invalid _from.
+struct MazeGraphEdge
+{
+    size_t _from;
+    size_t _to; // invalid if the corridor never reaches another node
+    ff::point_int _startDir; // direction when leaving _from
+    ff::point_int _endDir; // direction when arriving at _to
+    size_t _tiles; // number of tile steps from _from to _to
+    int _pixels;
+};
+
+// Junction graph derived from the walls and zones in Tiles. The owning IMaze shares it between copies and
+// updates the nodes and edges around a tile when its wall or zone changes.
+class MazeGraph
+{
+public:
+    MazeGraph(const Tiles& tiles);
+
+    size_t GetNodeCount() const;
+    const MazeGraphNode& GetNode(size_t nNode) const;
+    size_t GetEdgeCount() const;
+    const MazeGraphEdge& GetEdge(size_t nEdge) const;
+
+    size_t GetNodeIndex(ff::point_int tile) const;
+    bool IsNode(ff::point_int tile) const;
+
+    // True when the wall or out of bounds zone at tile isn't what the graph was measured with
+    bool NeedsUpdate(const Tiles& tiles, ff::point_int tile) const;
+    void Update(const Tiles& tiles, ff::point_int tile);
+
+private:
+    static BYTE GetTileShape(const Tiles& tiles, ff::point_int tile);
+    static bool IsNodeTile(const Tiles& tiles, ff::point_int tile);
+
+    size_t AddNode(const Tiles& tiles, ff::point_int tile);
+    void RemoveNode(size_t nNode);
+    void RemoveEdge(size_t nEdge);
+    void TraceEdge(const Tiles& tiles, size_t nNode, ff::point_int dir);
+    ff::point_int StepTile(ff::point_int tile, ff::point_int dir) const;
+    size_t GetTileIndex(ff::point_int tile) const;
+
+    ff::point_int _size;
+    std::vector<MazeGraphNode> _nodes;
+    std::vector<MazeGraphEdge> _edges;
+    std::vector<size_t> _freeNodes;
+    std::vector<size_t> _freeEdges;
+    std::vector<BYTE> _tileShapes; // from GetTileShape, for each tile
+    std::vector<size_t> _tileNodes;
+    std::vector<std::array<size_t, 4>> _tileEdges; // edges that enter each tile, by the direction they enter
+    std::vector<std::vector<size_t>> _edgeTiles; // tiles entered by each edge, to clear _tileEdges when it's removed
+};
@@ -0,0 +1,443 @@
+#include "pch.h"
+#include "Core/Difficulty.h"
+#include "Core/GhostPersonality.h"
+#include "Core/Maze.h"
+#include "Core/MazeCache.h"
+#include "Core/MazePack.h"
+#include "Core/Mazes.h"
+#include "Core/Tiles.h"
+
+// File layout: PackHeader, then arrays of PackTiles, PackMaze, and PackMazes entries,
+// then the data they point to. All offsets are from the start of the file and 8 byte aligned.
+
+static const DWORD PACK_MAGIC = 0x4B505A4D; // "MZPK"
+static const DWORD PACK_VERSION = 5; // bump whenever Difficulty or a Pack struct changes layout
+
+struct PackHeader
+{
+    DWORD _magic;
+    DWORD _version;
+    DWORD _checksum; // of everything after the header
+    DWORD _size;
+    DWORD _difficultySize;
+    DWORD _tilesCount;
+    DWORD _tilesOffset;
+    DWORD _mazeCount;
+    DWORD _mazeOffset;
+    DWORD _mazesCount;
+    DWORD _mazesOffset;
+    DWORD _padding;
+};
+
+struct PackTiles
+{
+    char _name[48];
+    int _width;
+    int _height;
+    DWORD _contentOffset;
+    DWORD _zoneOffset;
+    DWORD _wallsOffset;
+    DWORD _exitsOffset;
+};
+
+struct PackMaze
+{
+    char _name[48];
+    DWORD _charType;
+    DWORD _tiles; // index into the PackTiles array
+    DirectX::XMFLOAT4 _borderColor;
+    DirectX::XMFLOAT4 _fillColor;
+    DirectX::XMFLOAT4 _backgroundColor;
+};
+
+struct PackMazes
+{
+    char _name[48];
+    DWORD _lives;
+    DWORD _freeLife;
+    DWORD _freeRepeat;
+    DWORD _freeMax;
+    DWORD _mazeIndexesOffset; // array of DWORD indexes into the PackMaze array
+    DWORD _mazeIndexCount;
+    DWORD _difficultiesOffset; // array of Difficulty
+    DWORD _difficultyCount;
+};
+
+static DWORD PackChecksum(const BYTE* pData, size_t nSize)
+{
+    // FNV-1a
+    DWORD hash = 2166136261;
+
+    for (size_t i = 0; i < nSize; i++)
+    {
+        hash = (hash ^ pData[i]) * 16777619;
+    }
+
+    return hash;
+}
+
+static bool PackNameEquals(const char* szName, std::string_view name)
+{
+    return name.size() < 48 && !::strncmp(szName, name.data(), name.size()) && !szName[name.size()];
+}
+
+MazePack::MazePack(const BYTE* pData, size_t nSize)
+    : _data(pData)
+    , _size(nSize)
+{
+}
+
+MazePack::~MazePack()
+{
+    if (_data)
+    {
+        ::UnmapViewOfFile(_data);
+    }
+}
+
+// static
+std::shared_ptr<MazePack> MazePack::Open(const std::filesystem::path& path)
+{
+    HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    check_ret_val(hFile != INVALID_HANDLE_VALUE, nullptr);
+
+    LARGE_INTEGER fileSize{};
+    HANDLE hMapping = nullptr;
+
+    if (::GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(PackHeader))
+    {
+        hMapping = ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+
+    ::CloseHandle(hFile);
+    check_ret_val(hMapping, nullptr);
+
+    const BYTE* pData = (const BYTE*)::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(hMapping);
+    assert_ret_val(pData, nullptr);
+
+    // The pack takes ownership of the mapped view
+    std::shared_ptr<MazePack> pack = std::make_shared<MazePack>(pData, (size_t)fileSize.QuadPart);
+    const PackHeader& header = *(const PackHeader*)pData;
+
+    check_ret_val(header._magic == PACK_MAGIC &&
+        header._version == PACK_VERSION &&
+        header._difficultySize == sizeof(Difficulty) &&
+        header._size == pack->_size, nullptr);
+
+    assert_ret_val(header._checksum == PackChecksum(pData + sizeof(PackHeader), pack->_size - sizeof(PackHeader)), nullptr);
+
+    return pack;
+}
+
+// static
+std::shared_ptr<MazePack> MazePack::Get()
+{
+    // Mazes can be loaded from any thread
+    static std::shared_ptr<MazePack> s_pack = MazePack::Open(MazePack::GetDefaultPath());
+    return s_pack;
+}
+
+// static
+std::filesystem::path MazePack::GetDefaultPath()
+{
+    wchar_t szPath[MAX_PATH];
+    DWORD nLength = ::GetModuleFileNameW(nullptr, szPath, _countof(szPath));
+
+    return std::filesystem::path(std::wstring_view(szPath, nLength)).parent_path() / L"mazes.pack";
+}
+
+const void* MazePack::GetData(size_t nOffset, size_t nSize) const
+{
+    return (nOffset <= _size && nSize <= _size - nOffset) ? _data + nOffset : nullptr;
+}
+
+template<typename T>
+const T* MazePack::FindEntry(size_t nOffset, size_t nCount, std::string_view name) const
+{
+    const T* pEntries = (const T*)GetData(nOffset, nCount * sizeof(T));
+    assert_ret_val(pEntries, nullptr);
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        if (PackNameEquals(pEntries[i]._name, name))
+        {
+            return &pEntries[i];
+        }
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<Tiles> MazePack::CreateTiles(std::string_view name)
+{
+    const PackHeader& header = *(const PackHeader*)_data;
+    const PackTiles* pEntry = FindEntry<PackTiles>(header._tilesOffset, header._tilesCount, name);
+    check_ret_val(pEntry, nullptr);
+
+    size_t nTiles = pEntry->_width * pEntry->_height;
+    size_t nWalls = Tiles::GetWallStride(pEntry->_width) * pEntry->_height;
+
+    const TileContent* pContent = (const TileContent*)GetData(pEntry->_contentOffset, nTiles * sizeof(TileContent));
+    const TileZone* pZone = (const TileZone*)GetData(pEntry->_zoneOffset, nTiles * sizeof(TileZone));
+    const uint64_t* pWalls = (const uint64_t*)GetData(pEntry->_wallsOffset, nWalls * sizeof(uint64_t));
+    const BYTE* pExits = (const BYTE*)GetData(pEntry->_exitsOffset, nTiles);
+    assert_ret_val(pContent && pZone && pWalls && pExits, nullptr);
+
+    std::shared_ptr<Tiles> tiles = std::make_shared<Tiles>();
+    tiles->SetView(ff::point_int(pEntry->_width, pEntry->_height), shared_from_this(), pContent, pZone, pWalls, pExits);
+
+    return tiles;
+}
+
+std::shared_ptr<IMaze> MazePack::CreateMaze(std::string_view name)
+{
+    const PackHeader& header = *(const PackHeader*)_data;
+    const PackMaze* pEntry = FindEntry<PackMaze>(header._mazeOffset, header._mazeCount, name);
+    check_ret_val(pEntry, nullptr);
+
+    const PackTiles* pTilesEntry = (const PackTiles*)GetData(header._tilesOffset, header._tilesCount * sizeof(PackTiles));
+    assert_ret_val(pTilesEntry && pEntry->_tiles < header._tilesCount, nullptr);
+
+    std::shared_ptr<Tiles> tiles = CreateTiles(pTilesEntry[pEntry->_tiles]._name);
+    assert_ret_val(tiles, nullptr);
+
+    return IMaze::Create((CharType)pEntry->_charType, tiles, pEntry->_borderColor, pEntry->_fillColor, pEntry->_backgroundColor);
+}
+
+std::shared_ptr<IMazes> MazePack::CreateMazes(std::string_view id)
+{
+    const PackHeader& header = *(const PackHeader*)_data;
+    const PackMazes* pEntry = FindEntry<PackMazes>(header._mazesOffset, header._mazesCount, id);
+    check_ret_val(pEntry, nullptr);
+
+    const PackMaze* pMazeEntries = (const PackMaze*)GetData(header._mazeOffset, header._mazeCount * sizeof(PackMaze));
+    const DWORD* pMazeIndexes = (const DWORD*)GetData(pEntry->_mazeIndexesOffset, pEntry->_mazeIndexCount * sizeof(DWORD));
+    const Difficulty* pDiffs = (const Difficulty*)GetData(pEntry->_difficultiesOffset, pEntry->_difficultyCount * sizeof(Difficulty));
+    assert_ret_val(pMazeEntries && pMazeIndexes && pDiffs, nullptr);
+
+    std::shared_ptr<IMazes> mazes = IMazes::Create();
+    mazes->SetStartingLives(pEntry->_lives);
+    mazes->SetFreeLifeScore(pEntry->_freeLife, pEntry->_freeRepeat, pEntry->_freeMax);
+    mazes->SetID(id);
+
+    for (size_t i = 0; i < pEntry->_mazeIndexCount; i++)
+    {
+        assert_ret_val(pMazeIndexes[i] < header._mazeCount, nullptr);
+
+        std::shared_ptr<IMaze> maze = CreateMaze(pMazeEntries[pMazeIndexes[i]]._name);
+        assert_ret_val(maze, nullptr);
+        mazes->AddMaze(mazes->GetMazeCount(), maze);
+    }
+
+    for (size_t i = 0; i < pEntry->_difficultyCount; i++)
+    {
+        // Personality programs run without bounds checks, so make sure nothing in the file can break them
+
+        for (const GhostPersonality& personality : pDiffs[i]._personalities)
+        {
+            assert_ret_val(ValidateGhostPersonality(personality), nullptr);
+        }
+
+        mazes->AddDifficulty(mazes->GetDifficultyCount(), pDiffs[i]);
+    }
+
+    return mazes;
+}
+
+static const ff::dict* GetPackSourceDict(ff::resource_values& values, std::string_view name)
+{
+    ff::value_ptr rawValue = values.get_resource_value(name);
+    assert_ret_val(rawValue, nullptr);
+
+    ff::value_ptr dictValue = rawValue->try_convert<ff::dict>();
+    assert_ret_val(dictValue, nullptr);
+
+    // The value is cached by the resource, so the dict stays alive
+    return &dictValue->get<ff::dict>();
+}
+
+// Appends raw data to the pack, always 8 byte aligned so that the wall bitmaps can be read in place
+static DWORD AppendPackData(std::vector<BYTE>& pack, const void* pData, size_t nSize)
+{
+    pack.resize((pack.size() + 7) & ~(size_t)7);
+
+    DWORD nOffset = (DWORD)pack.size();
+    pack.insert(pack.end(), (const BYTE*)pData, (const BYTE*)pData + nSize);
+
+    return nOffset;
+}
+
+bool CompileMazePack(const std::filesystem::path& path)
+{
+    std::shared_ptr<ff::resource_values> valuesMaze = ff::auto_resource<ff::resource_values>("values_maze").object();
+    std::shared_ptr<ff::resource_values> valuesMazes = ff::auto_resource<ff::resource_values>("values_mazes").object();
+    assert_ret_val(valuesMaze && valuesMazes, false);
+
+    std::vector<PackTiles> tilesEntries;
+    std::vector<PackMaze> mazeEntries;
+    std::vector<PackMazes> mazesEntries;
+    std::vector<std::vector<DWORD>> mazeIndexes;
+    std::vector<std::vector<Difficulty>> difficulties;
+    std::vector<std::shared_ptr<Tiles>> tilesObjects;
+
+    auto addMaze = [&](std::string_view mazeName) -> DWORD
+        {
+            for (size_t i = 0; i < mazeEntries.size(); i++)
+            {
+                if (PackNameEquals(mazeEntries[i]._name, mazeName))
+                {
+                    return (DWORD)i;
+                }
+            }
+
+            const ff::dict* pMazeDict = GetPackSourceDict(*valuesMaze, mazeName);
+            std::shared_ptr<IMaze> maze = CreateMazeFromValues(mazeName);
+            assert_ret_val(pMazeDict && maze && mazeName.size() < 48, ff::constants::invalid_unsigned<DWORD>());
+
+            std::string tilesName = pMazeDict->get<std::string>("tiles", std::string("tiles-0"));
+            assert_ret_val(tilesName.size() < 48, ff::constants::invalid_unsigned<DWORD>());
+
+            PackMaze mazeEntry{};
+            strncpy_s(mazeEntry._name, mazeName.data(), mazeName.size());
+            mazeEntry._charType = (DWORD)maze->GetCharType();
+            mazeEntry._borderColor = maze->GetBorderColor();
+            mazeEntry._fillColor = maze->GetFillColor();
+            mazeEntry._backgroundColor = maze->GetBackgroundColor();
+            mazeEntry._tiles = (DWORD)tilesEntries.size();
+
+            for (size_t i = 0; i < tilesEntries.size(); i++)
+            {
+                if (PackNameEquals(tilesEntries[i]._name, tilesName))
+                {
+                    mazeEntry._tiles = (DWORD)i;
+                    break;
+                }
+            }
+
+            if (mazeEntry._tiles == tilesEntries.size())
+            {
+                PackTiles tilesEntry{};
+                strncpy_s(tilesEntry._name, tilesName.c_str(), tilesName.size());
+                tilesEntry._width = maze->GetSizeInTiles().x;
+                tilesEntry._height = maze->GetSizeInTiles().y;
+
+                // Always parse the source values, the maze's own tiles might have come from an old pack
+                std::shared_ptr<Tiles> tiles = CreateTilesFromValues(tilesName);
+                assert_ret_val(tiles && tiles->GetSize() == maze->GetSizeInTiles(), ff::constants::invalid_unsigned<DWORD>());
+
+                tilesEntries.push_back(tilesEntry);
+                tilesObjects.push_back(tiles);
+            }
+
+            mazeEntries.push_back(mazeEntry);
+            return (DWORD)(mazeEntries.size() - 1);
+        };
+
+    for (std::string_view mazeName : MazeCache::GetBuiltInMazeNames())
+    {
+        assert_ret_val(addMaze(mazeName) != ff::constants::invalid_unsigned<DWORD>(), false);
+    }
+
+    for (std::string_view id : MazeCache::GetBuiltInMazesIds())
+    {
+        const ff::dict* pMazesDict = GetPackSourceDict(*valuesMazes, id);
+        std::shared_ptr<IMazes> mazes = CreateMazesFromValues(id);
+        assert_ret_val(pMazesDict && mazes && id.size() < 48, false);
+
+        PackMazes mazesEntry{};
+        strncpy_s(mazesEntry._name, id.data(), id.size());
+        mazesEntry._lives = (DWORD)mazes->GetStartingLives();
+        mazesEntry._freeLife = (DWORD)mazes->GetFreeLifeScore();
+        mazesEntry._freeRepeat = (DWORD)mazes->GetFreeLifeRepeat();
+        mazesEntry._freeMax = (DWORD)mazes->GetMaxFreeLives();
+
+        std::vector<DWORD> indexes;
+        for (const std::string& mazeName : pMazesDict->get<std::vector<std::string>>("mazes"))
+        {
+            DWORD index = addMaze(mazeName);
+            assert_ret_val(index != ff::constants::invalid_unsigned<DWORD>(), false);
+            indexes.push_back(index);
+        }
+
+        std::vector<Difficulty> diffs;
+        for (size_t i = 0; i < mazes->GetDifficultyCount(); i++)
+        {
+            diffs.push_back(mazes->GetDifficulty(i));
+        }
+
+        mazesEntries.push_back(mazesEntry);
+        mazeIndexes.push_back(std::move(indexes));
+        difficulties.push_back(std::move(diffs));
+    }
+
+    // Write everything
+
+    std::vector<BYTE> pack;
+    pack.resize(sizeof(PackHeader));
+
+    PackHeader header{};
+    header._magic = PACK_MAGIC;
+    header._version = PACK_VERSION;
+    header._difficultySize = sizeof(Difficulty);
+    header._tilesCount = (DWORD)tilesEntries.size();
+    header._mazeCount = (DWORD)mazeEntries.size();
+    header._mazesCount = (DWORD)mazesEntries.size();
+
+    for (size_t i = 0; i < tilesEntries.size(); i++)
+    {
+        const Tiles& tiles = *tilesObjects[i];
+        PackTiles& entry = tilesEntries[i];
+        ff::point_int size(entry._width, entry._height);
+        size_t nWallStride = Tiles::GetWallStride(size.x);
+
+        std::vector<TileContent> content;
+        std::vector<TileZone> zones;
+        std::vector<uint64_t> walls(nWallStride * size.y);
+        std::vector<BYTE> exits;
+
+        for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
+        {
+            for (; tile.x < size.x; tile.x++)
+            {
+                content.push_back(tiles.GetContent(tile));
+                zones.push_back(tiles.GetZone(tile));
+                exits.push_back(tiles.GetExits(tile));
+
+                if (tiles.IsWall(tile))
+                {
+                    walls[tile.y * nWallStride + (tile.x >> 6)] |= (uint64_t)1 << (tile.x & 63);
+                }
+            }
+        }
+
+        entry._contentOffset = AppendPackData(pack, content.data(), ff::vector_byte_size(content));
+        entry._zoneOffset = AppendPackData(pack, zones.data(), ff::vector_byte_size(zones));
+        entry._wallsOffset = AppendPackData(pack, walls.data(), ff::vector_byte_size(walls));
+        entry._exitsOffset = AppendPackData(pack, exits.data(), ff::vector_byte_size(exits));
+    }
+
+    for (size_t i = 0; i < mazesEntries.size(); i++)
+    {
+        mazesEntries[i]._mazeIndexesOffset = AppendPackData(pack, mazeIndexes[i].data(), ff::vector_byte_size(mazeIndexes[i]));
+        mazesEntries[i]._mazeIndexCount = (DWORD)mazeIndexes[i].size();
+        mazesEntries[i]._difficultiesOffset = AppendPackData(pack, difficulties[i].data(), ff::vector_byte_size(difficulties[i]));
+        mazesEntries[i]._difficultyCount = (DWORD)difficulties[i].size();
+    }
+
+    header._tilesOffset = AppendPackData(pack, tilesEntries.data(), ff::vector_byte_size(tilesEntries));
+    header._mazeOffset = AppendPackData(pack, mazeEntries.data(), ff::vector_byte_size(mazeEntries));
+    header._mazesOffset = AppendPackData(pack, mazesEntries.data(), ff::vector_byte_size(mazesEntries));
+    header._size = (DWORD)pack.size();
+    header._checksum = PackChecksum(pack.data() + sizeof(PackHeader), pack.size() - sizeof(PackHeader));
+    CopyMemory(pack.data(), &header, sizeof(header));
+
+    HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    assert_ret_val(hFile != INVALID_HANDLE_VALUE, false);
+
+    DWORD nWritten = 0;
+    bool bWritten = ::WriteFile(hFile, pack.data(), (DWORD)pack.size(), &nWritten, nullptr) && nWritten == pack.size();
+    ::CloseHandle(hFile);
+
+    return bWritten;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+class IMaze;
+class IMazes;
+class Tiles;
+
+// A memory mapped file with every built-in maze already parsed, see CompileMazePack.
+// Tiles created from the pack view its memory directly until they are changed.
+class MazePack : public std::enable_shared_from_this<MazePack>
+{
+public:
+    MazePack(const BYTE* pData, size_t nSize);
+    ~MazePack();
+
+    static std::shared_ptr<MazePack> Open(const std::filesystem::path& path);
+    static std::shared_ptr<MazePack> Get();
+    static std::filesystem::path GetDefaultPath();
+
+    std::shared_ptr<Tiles> CreateTiles(std::string_view name);
+    std::shared_ptr<IMaze> CreateMaze(std::string_view name);
+    std::shared_ptr<IMazes> CreateMazes(std::string_view id);
+
+private:
+    const void* GetData(size_t nOffset, size_t nSize) const;
+    template<typename T> const T* FindEntry(size_t nOffset, size_t nCount, std::string_view name) const;
+
+    const BYTE* _data;
+    size_t _size;
+};
+
+// Loads all built-in mazes from resource values and writes them into a pack file
+bool CompileMazePack(const std::filesystem::path& path);
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "Core/Difficulty.h"
 #include "Core/Maze.h"
+#include "Core/MazeCache.h"
 #include "Core/Mazes.h"
 #include "Core/Stats.h"
 #include "Core/Tiles.h"
@@ -60,11 +61,13 @@ std::shared_ptr<IMazes> IMazes::Create()
 
 std::shared_ptr<IMazes> CreateMazesFromId(std::string_view id)
 {
-    static std::shared_ptr<ff::resource_values> values_mazes;
-    if (!values_mazes)
-    {
-        values_mazes = ff::auto_resource<ff::resource_values>("values_mazes").object();
-    }
+    return MazeCache::Get().GetMazes(id);
+}
+
+std::shared_ptr<IMazes> CreateMazesFromValues(std::string_view id)
+{
+    // Mazes can be loaded from any thread
+    static std::shared_ptr<ff::resource_values> values_mazes = ff::auto_resource<ff::resource_values>("values_mazes").object();
 
     ff::value_ptr rawValue = values_mazes->get_resource_value(id);
     assert_ret_val(rawValue, nullptr);
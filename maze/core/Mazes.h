@@ -39,3 +39,4 @@ public:
 };
 
 std::shared_ptr<IMazes> CreateMazesFromId(std::string_view id);
+std::shared_ptr<IMazes> CreateMazesFromValues(std::string_view id);
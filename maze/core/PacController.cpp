@@ -0,0 +1,603 @@
+#include "pch.h"
+#include "Core/Actors.h"
+#include "Core/GhostPaths.h"
+#include "Core/Helpers.h"
+#include "Core/Maze.h"
+#include "Core/MazeFlowField.h"
+#include "Core/PacController.h"
+#include "Core/PlayingMaze.h"
+#include "Core/Random.h"
+#include "Core/Tiles.h"
+
+// Once Pac is past the middle of a tile, it's too late to turn there, so plan from the next one
+static ff::point_int GetPlanningTile(const IPlayingActor& pac, ff::point_int size)
+{
+    ff::point_int tile = pac.GetTile();
+    ff::point_int dir = pac.GetDir();
+    ff::point_int toCenter = TileCenterToPixel(tile) - pac.GetPixel();
+
+    if (toCenter.x * dir.x + toCenter.y * dir.y < 0)
+    {
+        tile += dir;
+    }
+
+    return WrapTile(tile, size);
+}
+
+// Same order as the TileExit bits
+static size_t GetExitIndex(ff::point_int dir)
+{
+    switch (DirToExit(dir))
+    {
+        default:
+        case EXIT_UP: return 0;
+        case EXIT_LEFT: return 1;
+        case EXIT_DOWN: return 2;
+        case EXIT_RIGHT: return 3;
+    }
+}
+
+// Every frame, it measures how soon a dangerous ghost could get to each tile, starting from the path the maze
+// predicted for it. Then it searches out from Pac, only through tiles that Pac reaches first, and heads for the
+// closest and densest dots. When no dots are safe, it runs to wherever the ghosts are furthest behind.
+class AutopilotController : public IPacController
+{
+public:
+    // IPacController
+    virtual ff::point_int GetPressDir(IPlayingMaze* pPlay) override;
+
+private:
+    void Resize(ff::point_int size);
+    void SearchGhosts(IPlayingMaze* pPlay, const Tiles& tiles);
+    ff::point_int SearchPac(IPlayingMaze* pPlay, const Tiles& tiles, ff::point_int startTile);
+    float GetDotValue(const Tiles& tiles, ff::point_int tile, bool bGhostsNear) const;
+    size_t GetIndex(ff::point_int tile) const;
+    ff::point_int Wrap(ff::point_int tile) const;
+
+    static constexpr uint16_t NO_DISTANCE = 0xFFFF;
+    static constexpr uint16_t SAFE_DISTANCE = 2; // ghosts must be at least this many tiles behind Pac
+    static constexpr uint16_t NEAR_DISTANCE = 8; // worth using a power dot
+    static constexpr uint16_t HOUSE_EXIT_DISTANCE = 2; // for ghosts still inside the house
+    static constexpr uint16_t CHANGE_PATH_DISTANCE = 2; // extra for a ghost to leave its predicted path
+    static constexpr size_t ESCAPE_NODES = 1; // safe intersections needed that way before going for dots, so Pac isn't trapped
+    static constexpr float SCARED_GHOST_VALUE = 4;
+
+    ff::point_int _size{};
+    std::vector<uint16_t> _ghostDistances; // to the closest dangerous ghost, for each tile
+    std::vector<uint16_t> _ghostMoveDistances; // for each tile and the way a ghost entered it
+    std::vector<size_t> _ghostQueue;
+    std::vector<uint16_t> _pacDistances;
+    std::vector<BYTE> _firstExits; // which of the four ways Pac leaves its own tile to get to each tile
+    std::vector<ff::point_int> _queue;
+    std::vector<ff::point_int> _inputs; // Pac's tile, then the tile, dir, and state of each ghost
+    std::vector<ff::point_int> _lastInputs;
+    ff::point_int _lastPress{};
+};
+
+// static
+std::shared_ptr<IPacController> IPacController::CreateAutopilot()
+{
+    return std::make_shared<AutopilotController>();
+}
+
+ff::point_int AutopilotController::GetPressDir(IPlayingMaze* pPlay)
+{
+    check_ret_val(pPlay && pPlay->GetGameState() == GS_PLAYING && pPlay->GetPacState() == PAC_NORMAL, ff::point_int(0, 0));
+
+    std::shared_ptr<IPlayingActor> pac = pPlay->GetPac();
+    const Tiles& tiles = pPlay->GetMaze()->GetTiles();
+    ff::point_int tile = GetPlanningTile(*pac, tiles.GetSize());
+    ff::point_int dir = pac->GetDir();
+
+    // Nothing changes until Pac or a ghost gets to another tile, so most frames reuse the last decision
+
+    _inputs.clear();
+    _inputs.push_back(tile);
+
+    for (size_t i = 0; i < pPlay->GetGhostCount(); i++)
+    {
+        std::shared_ptr<IPlayingActor> ghost = pPlay->GetGhost(i);
+        _inputs.push_back(ghost->GetTile());
+        _inputs.push_back(ghost->GetDir());
+        _inputs.push_back(ff::point_int((int)pPlay->GetGhostState(i), 0));
+    }
+
+    if (_inputs != _lastInputs || _size != tiles.GetSize())
+    {
+        std::swap(_inputs, _lastInputs);
+
+        Resize(tiles.GetSize());
+        SearchGhosts(pPlay, tiles);
+
+        _lastPress = SearchPac(pPlay, tiles, tile);
+    }
+
+    return (_lastPress.x || _lastPress.y) ? _lastPress : dir;
+}
+
+void AutopilotController::Resize(ff::point_int size)
+{
+    if (_size != size)
+    {
+        size_t nTiles = (size_t)size.x * (size_t)size.y;
+
+        _size = size;
+        _ghostDistances.resize(nTiles);
+        _ghostMoveDistances.resize(nTiles * 4);
+        _ghostQueue.reserve(nTiles * 4);
+        _pacDistances.resize(nTiles);
+        _firstExits.resize(nTiles);
+        _queue.reserve(nTiles);
+    }
+}
+
+// Ghosts with a predicted path are expected to follow it, leaving it costs a few extra tiles. Ghosts can't turn
+// around, so the search keeps track of which way each ghost entered a tile. The only exceptions are dead ends,
+// and scatter/chase changes that aren't predicted here.
+void AutopilotController::SearchGhosts(IPlayingMaze* pPlay, const Tiles& tiles)
+{
+    const MazeFlowField& houseField = pPlay->GetMaze()->GetHouseFlowField();
+    const GhostPaths* pPaths = pPlay->GetGhostPaths();
+
+    std::fill(_ghostDistances.begin(), _ghostDistances.end(), NO_DISTANCE);
+    std::fill(_ghostMoveDistances.begin(), _ghostMoveDistances.end(), NO_DISTANCE);
+    _ghostQueue.clear();
+
+    auto addMove = [this](size_t nTile, size_t nExit, uint16_t nDistance)
+        {
+            size_t nMove = nTile * 4 + nExit;
+            if (_ghostMoveDistances[nMove] > nDistance)
+            {
+                _ghostMoveDistances[nMove] = nDistance;
+                _ghostDistances[nTile] = std::min(_ghostDistances[nTile], nDistance);
+                _ghostQueue.push_back(nMove);
+            }
+        };
+
+    for (size_t i = 0; i < pPlay->GetGhostCount(); i++)
+    {
+        GhostState state = pPlay->GetGhostState(i);
+
+        if (state == GHOST_CHASE || state == GHOST_SCATTER || state == GHOST_SCARED_FLASH)
+        {
+            std::shared_ptr<IPlayingActor> ghost = pPlay->GetGhost(i);
+            ff::point_int tile = Wrap(ghost->GetTile());
+            ff::point_int dir = ghost->GetDir();
+
+            if (houseField.IsValid() && houseField.GetDistance(tile) == ff::constants::invalid_unsigned<size_t>())
+            {
+                // Can't walk out of the house, so it will come out above the door soon
+                addMove(GetIndex(houseField.GetGoalTile()), GetExitIndex(ff::point_int(0, -1)), HOUSE_EXIT_DISTANCE);
+            }
+            else if (dir.x || dir.y)
+            {
+                // Pac moves a bit faster, so it can't follow too closely either
+
+                size_t nBehind = GetIndex(Wrap(tile - dir));
+                _ghostDistances[nBehind] = std::min<uint16_t>(_ghostDistances[nBehind], 1);
+
+                size_t nPathTiles = (pPaths && i < pPaths->GetCount()) ? pPaths->GetTileCount(i) : 0;
+                if (nPathTiles)
+                {
+                    const ff::point_int* pTiles = pPaths->GetTiles(i);
+                    const ff::point_int* pDirs = pPaths->GetDirs(i);
+                    ff::point_int enterDir = dir;
+
+                    for (size_t nPath = 0; nPath < nPathTiles; nPath++)
+                    {
+                        ff::point_int pathTile = Wrap(pTiles[nPath]);
+                        size_t nTile = GetIndex(pathTile);
+                        if (nTile >= _ghostDistances.size())
+                        {
+                            break;
+                        }
+
+                        _ghostDistances[nTile] = std::min(_ghostDistances[nTile], (uint16_t)nPath);
+
+                        // The target moves with Pac, so the ghost could still change its mind at any junction.
+                        // After the last tile, it could go any way at all.
+
+                        bool bLast = (nPath + 1 == nPathTiles);
+                        BYTE backExit = DirToExit(-enterDir);
+                        BYTE exits = tiles.GetExits(pathTile);
+                        exits = (exits != backExit) ? (BYTE)(exits & ~backExit) : exits;
+                        exits = bLast ? exits : (BYTE)(exits & ~DirToExit(pDirs[nPath]));
+
+                        uint16_t nNextDist = (uint16_t)(nPath + 1 + (bLast ? 0 : CHANGE_PATH_DISTANCE));
+
+                        for (BYTE exit = EXIT_UP, nExit = 0; exit <= EXIT_RIGHT; exit <<= 1, nExit++)
+                        {
+                            if (exits & exit)
+                            {
+                                addMove(GetIndex(Wrap(pathTile + ExitToDir((TileExit)exit))), nExit, nNextDist);
+                            }
+                        }
+
+                        enterDir = pDirs[nPath];
+                    }
+                }
+                else
+                {
+                    addMove(GetIndex(tile), GetExitIndex(dir), 0);
+                }
+            }
+        }
+    }
+
+    for (size_t nQueue = 0; nQueue < _ghostQueue.size(); nQueue++)
+    {
+        size_t nMove = _ghostQueue[nQueue];
+        size_t nTile = nMove / 4;
+        size_t nBackExit = (nMove % 4 + 2) % 4;
+        ff::point_int tile((int)(nTile % _size.x), (int)(nTile / _size.x));
+        uint16_t nNextDist = _ghostMoveDistances[nMove] + 1;
+        BYTE exits = tiles.GetExits(tile);
+
+        if (exits != (1 << nBackExit))
+        {
+            exits &= ~(1 << nBackExit);
+        }
+
+        for (BYTE exit = EXIT_UP, nExit = 0; exit <= EXIT_RIGHT; exit <<= 1, nExit++)
+        {
+            if (exits & exit)
+            {
+                addMove(GetIndex(Wrap(tile + ExitToDir((TileExit)exit))), nExit, nNextDist);
+            }
+        }
+    }
+}
+
+ff::point_int AutopilotController::SearchPac(IPlayingMaze* pPlay, const Tiles& tiles, ff::point_int startTile)
+{
+    size_t nStart = GetIndex(startTile);
+    check_ret_val(nStart < _pacDistances.size(), ff::point_int(0, 0));
+
+    // Everything is kept for each way Pac can leave its tile, to compare them at the end
+
+    bool bGhostsNear = (_ghostDistances[nStart] < NEAR_DISTANCE);
+    float values[4]{};
+    size_t safeTiles[4]{};
+    size_t safeNodes[4]{};
+
+    std::fill(_pacDistances.begin(), _pacDistances.end(), NO_DISTANCE);
+    _pacDistances[nStart] = 0;
+    _queue.clear();
+    _queue.push_back(startTile);
+
+    for (size_t nQueue = 0; nQueue < _queue.size(); nQueue++)
+    {
+        ff::point_int tile = _queue[nQueue];
+        size_t nTile = GetIndex(tile);
+        uint16_t nNextDist = _pacDistances[nTile] + 1;
+        BYTE exits = tiles.GetExits(tile);
+
+        for (BYTE exit = EXIT_UP, nExit = 0; exit <= EXIT_RIGHT; exit <<= 1, nExit++)
+        {
+            if (!(exits & exit))
+            {
+                continue;
+            }
+
+            ff::point_int nextTile = Wrap(tile + ExitToDir((TileExit)exit));
+            size_t nNext = GetIndex(nextTile);
+
+            if (_pacDistances[nNext] != NO_DISTANCE ||
+                (_ghostDistances[nNext] != NO_DISTANCE && _ghostDistances[nNext] < nNextDist + SAFE_DISTANCE))
+            {
+                continue;
+            }
+
+            BYTE nFirstExit = (nTile == nStart) ? nExit : _firstExits[nTile];
+            float value = GetDotValue(tiles, nextTile, bGhostsNear) / nNextDist;
+
+            _pacDistances[nNext] = nNextDist;
+            _firstExits[nNext] = nFirstExit;
+            _queue.push_back(nextTile);
+
+            values[nFirstExit] = std::max(values[nFirstExit], value);
+            safeTiles[nFirstExit]++;
+            safeNodes[nFirstExit] += (CountExits(tiles.GetExits(nextTile)) > 2) ? 1 : 0;
+        }
+    }
+
+    // Chase scared ghosts that can be reached safely
+
+    for (size_t i = 0; i < pPlay->GetGhostCount(); i++)
+    {
+        if (pPlay->GetGhostState(i) == GHOST_SCARED)
+        {
+            size_t nGhost = GetIndex(Wrap(pPlay->GetGhost(i)->GetTile()));
+            uint16_t nDist = (nGhost < _pacDistances.size()) ? _pacDistances[nGhost] : NO_DISTANCE;
+
+            if (nDist && nDist != NO_DISTANCE)
+            {
+                float& value = values[_firstExits[nGhost]];
+                value = std::max(value, SCARED_GHOST_VALUE / nDist);
+            }
+        }
+    }
+
+    // Go for the best dots, but not into a small pocket that ghosts could close off. Otherwise run to
+    // where there's the most room, or when trapped, away from the closest ghost.
+
+    size_t nBestValue = _countof(values);
+    size_t nBestRoom = _countof(values);
+
+    for (size_t i = 0; i < _countof(values); i++)
+    {
+        if (safeNodes[i] >= ESCAPE_NODES && values[i] > 0 && (nBestValue == _countof(values) || values[i] > values[nBestValue]))
+        {
+            nBestValue = i;
+        }
+
+        if (safeTiles[i] && (nBestRoom == _countof(values) || safeTiles[i] > safeTiles[nBestRoom]))
+        {
+            nBestRoom = i;
+        }
+    }
+
+    if (nBestValue != _countof(values))
+    {
+        return ExitToDir((TileExit)(1 << nBestValue));
+    }
+
+    if (nBestRoom != _countof(values))
+    {
+        return ExitToDir((TileExit)(1 << nBestRoom));
+    }
+
+    BYTE exits = tiles.GetExits(startTile);
+    ff::point_int bestDir(0, 0);
+    int bestGhostDist = -1;
+
+    for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+    {
+        if (exits & exit)
+        {
+            int nGhostDist = _ghostDistances[GetIndex(Wrap(startTile + ExitToDir((TileExit)exit)))];
+
+            if (nGhostDist > bestGhostDist)
+            {
+                bestGhostDist = nGhostDist;
+                bestDir = ExitToDir((TileExit)exit);
+            }
+        }
+    }
+
+    return bestDir;
+}
+
+// Power dots are saved for when ghosts get close. Dots with other dots around them are worth a bit more.
+float AutopilotController::GetDotValue(const Tiles& tiles, ff::point_int tile, bool bGhostsNear) const
+{
+    TileContent content[9];
+    TileZone zones[9];
+    float value;
+
+    switch (tiles.GetContent(tile))
+    {
+        case CONTENT_DOT:
+            value = 1;
+            break;
+
+        case CONTENT_POWER:
+            value = bGhostsNear ? 8.0f : 0.25f;
+            break;
+
+        default:
+            return 0;
+    }
+
+    tiles.GetNeighbors(tile, content, zones);
+
+    for (TileContent neighbor : content)
+    {
+        if (neighbor == CONTENT_DOT || neighbor == CONTENT_POWER)
+        {
+            value += 0.125f;
+        }
+    }
+
+    return value;
+}
+
+// Returns invalid for tiles outside the maze
+size_t AutopilotController::GetIndex(ff::point_int tile) const
+{
+    if (tile.x >= 0 && tile.x < _size.x && tile.y >= 0 && tile.y < _size.y)
+    {
+        return (size_t)tile.y * (size_t)_size.x + (size_t)tile.x;
+    }
+
+    return ff::constants::invalid_unsigned<size_t>();
+}
+
+// Like WrapTile, but tiles are never more than one maze away, so it doesn't need to divide
+ff::point_int AutopilotController::Wrap(ff::point_int tile) const
+{
+    tile.x += (tile.x < 0) ? _size.x : ((tile.x >= _size.x) ? -_size.x : 0);
+    tile.y += (tile.y < 0) ? _size.y : ((tile.y >= _size.y) ? -_size.y : 0);
+    return tile;
+}
+
+// Ghost danger comes from actually playing copies of the maze, where ghosts make their real decisions every frame.
+// Predicted ghost paths are only a guess at those same decisions, so rollouts don't read them, and the copies
+// never ask for them either. The autopilot that breaks ties does use them.
+class RolloutController : public IPacController
+{
+public:
+    RolloutController(size_t nRollouts, size_t nFrames);
+
+    // IPacController
+    virtual ff::point_int GetPressDir(IPlayingMaze* pPlay) override;
+
+private:
+    struct Rollout
+    {
+        size_t _exit; // index of the first way to go
+        uint64_t _seed;
+        float _value;
+    };
+
+    ff::point_int Decide(IPlayingMaze* pPlay, ff::point_int tile);
+    float PlayRollout(const IPlayingMaze& play, ff::point_int firstDir, uint64_t nSeed) const;
+
+    static constexpr float DEATH_VALUE = -5000; // worse than any amount of points
+    static constexpr float WIN_VALUE = 5000;
+    static constexpr float TIE_VALUE = 10; // one dot, less than this doesn't beat what the autopilot wants
+
+    size_t _rollouts;
+    size_t _frames;
+    std::shared_ptr<IPacController> _autopilot; // breaks ties, since most rollouts find nothing when dots are far away
+    std::vector<Rollout> _work;
+    Random _random; // seeds each rollout, so the same game always gets the same decisions
+    ff::point_int _lastTile{ -1, -1 };
+    ff::point_int _lastPress{};
+};
+
+// static
+std::shared_ptr<IPacController> IPacController::CreateRollouts(size_t nRollouts, size_t nFrames)
+{
+    return std::make_shared<RolloutController>(nRollouts, nFrames);
+}
+
+RolloutController::RolloutController(size_t nRollouts, size_t nFrames)
+    : _rollouts(std::max<size_t>(nRollouts, 1))
+    , _frames(std::max<size_t>(nFrames, 1))
+    , _autopilot(IPacController::CreateAutopilot())
+{
+}
+
+ff::point_int RolloutController::GetPressDir(IPlayingMaze* pPlay)
+{
+    check_ret_val(pPlay && pPlay->GetGameState() == GS_PLAYING && pPlay->GetPacState() == PAC_NORMAL, ff::point_int(0, 0));
+
+    std::shared_ptr<IPlayingActor> pac = pPlay->GetPac();
+    ff::point_int tile = GetPlanningTile(*pac, pPlay->GetMaze()->GetSizeInTiles());
+
+    if (tile != _lastTile)
+    {
+        _lastTile = tile;
+        _lastPress = Decide(pPlay, tile);
+    }
+
+    return (_lastPress.x || _lastPress.y) ? _lastPress : pac->GetDir();
+}
+
+ff::point_int RolloutController::Decide(IPlayingMaze* pPlay, ff::point_int tile)
+{
+    ff::point_int autopilotDir = _autopilot->GetPressDir(pPlay);
+    BYTE exits = pPlay->GetMaze()->GetTiles().GetExits(tile);
+
+    if (CountExits(exits) < 2)
+    {
+        return autopilotDir;
+    }
+
+    // Every rollout starts from a copy of the same maze and only writes its own value, so they can all run at once
+
+    _work.clear();
+
+    for (BYTE exit = EXIT_UP, nExit = 0; exit <= EXIT_RIGHT; exit <<= 1, nExit++)
+    {
+        for (size_t i = 0; (exits & exit) && i < _rollouts; i++)
+        {
+            uint64_t nSeed = ((uint64_t)_random.Next() << 32) | _random.Next();
+            _work.push_back(Rollout{ nExit, nSeed, 0.0f });
+        }
+    }
+
+    std::for_each(std::execution::par, _work.begin(), _work.end(), [this, pPlay](Rollout& rollout)
+        {
+            rollout._value = PlayRollout(*pPlay, ExitToDir((TileExit)(1 << rollout._exit)), rollout._seed);
+        });
+
+    float totals[4]{};
+
+    for (const Rollout& rollout : _work)
+    {
+        totals[rollout._exit] += rollout._value;
+    }
+
+    // Every exit has the same number of rollouts, so comparing totals compares averages
+
+    size_t nBest = _countof(totals);
+    float tieValue = TIE_VALUE * (float)_rollouts;
+
+    for (size_t i = 0; i < _countof(totals); i++)
+    {
+        if ((exits & (1 << i)) && (nBest == _countof(totals) || totals[i] > totals[nBest]))
+        {
+            nBest = i;
+        }
+    }
+
+    size_t nAutopilot = (autopilotDir.x || autopilotDir.y) ? GetExitIndex(autopilotDir) : _countof(totals);
+
+    if (nAutopilot != _countof(totals) && (exits & (1 << nAutopilot)) && totals[nAutopilot] + tieValue >= totals[nBest])
+    {
+        return autopilotDir;
+    }
+
+    return ExitToDir((TileExit)(1 << nBest));
+}
+
+// Pac goes the first way until it can turn, then picks random ways at each junction without turning around
+float RolloutController::PlayRollout(const IPlayingMaze& play, ff::point_int firstDir, uint64_t nSeed) const
+{
+    std::shared_ptr<IPlayingMaze> copy = play.Clone();
+    assert_ret_val(copy, 0.0f);
+
+    Random random(nSeed);
+    IPlayingActor& pac = *copy->GetPac();
+    const Tiles& tiles = copy->GetMaze()->GetTiles();
+    DWORD nStartScore = copy->GetStats()._score;
+    ff::point_int press = firstDir;
+    ff::point_int lastTile = GetPlanningTile(pac, tiles.GetSize());
+    float value = 0;
+
+    for (size_t i = 0; i < _frames && copy->GetGameState() == GS_PLAYING; i++)
+    {
+        ff::point_int tile = GetPlanningTile(pac, tiles.GetSize());
+
+        if (tile != lastTile && pac.GetDir() == press)
+        {
+            lastTile = tile;
+
+            BYTE exits = tiles.GetExits(tile);
+            BYTE forward = (BYTE)(exits & ~DirToExit(-pac.GetDir()));
+            exits = forward ? forward : exits;
+
+            size_t nChoice = random.Next(CountExits(exits));
+
+            for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+            {
+                if ((exits & exit) && !nChoice--)
+                {
+                    press = ExitToDir((TileExit)exit);
+                    break;
+                }
+            }
+        }
+
+        pac.SetPressDir(press);
+        copy->Advance();
+    }
+
+    switch (copy->GetGameState())
+    {
+        case GS_CAUGHT:
+            value = DEATH_VALUE;
+            break;
+
+        case GS_WINNING:
+            value = WIN_VALUE;
+            break;
+
+        default:
+            break;
+    }
+
+    return value + (float)(copy->GetStats()._score - nStartScore);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+class IPlayingMaze;
+
+// Decides which way Pac should go, instead of a person pressing buttons. Called once per frame, before the maze
+// advances, and the result is given to Pac's SetPressDir.
+class IPacController
+{
+public:
+    virtual ~IPacController() = default;
+
+    // Built-in bot, for soak tests and for watching the game play itself
+    static std::shared_ptr<IPacController> CreateAutopilot();
+
+    // Plays short games with random turns from copies of the maze, on every core, and goes the way that turned out
+    // best. Much slower than the autopilot but plays better, for checking that difficulties can be beaten.
+    static std::shared_ptr<IPacController> CreateRollouts(size_t nRollouts, size_t nFrames);
+
+    virtual ff::point_int GetPressDir(IPlayingMaze* pPlay) = 0;
+};
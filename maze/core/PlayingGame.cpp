@@ -8,16 +8,38 @@
 #include "Core/PlayingMaze.h"
 #include "Core/RenderMaze.h"
 #include "Core/RenderText.h"
+#include "Core/Replay.h"
+#include "Core/RewindBuffer.h"
 
 static const size_t INITIAL_LIVES = 3;
 
+// Rewinding goes back up to 30 seconds, restoring a keyframe and replaying inputs to get between them
+static const size_t REWIND_SECONDS = 30;
+static const size_t REWIND_KEYFRAME_FRAMES = 30;
+static const size_t REWIND_MAX_BYTES = 8 * 1024 * 1024; // shared by all players
+
+// Saved with each rewind keyframe, in front of the maze snapshot
+struct PlayerRewindState
+{
+    uint32_t _lives;
+    uint32_t _nextFreeLife;
+    uint32_t _freeLivesLeft;
+};
+
 class Player : public IPlayer, public IPlayingMazeHost
 {
 public:
-    Player(size_t nPlayer, std::shared_ptr<IMazes> pMazes);
+    Player(size_t nPlayer, std::shared_ptr<IMazes> pMazes, size_t nRewindBytes, uint64_t nSeed);
 
     bool Advance();
+    bool CanRewind() const;
+    size_t Rewind(size_t nFrames); // returns how many frames it went back
+    void ClearRewind();
+    void SetRewindBytes(size_t nBytes); // zero turns off rewind
+    void SetFastForward(bool bFastForward); // before each Advance of the game
     const std::vector<FruitType>& GetDisplayFruits();
+    ff::point_int GetPressDir() const;
+    void SetPressDir(ff::point_int dir);
 
     // IPlayer
     virtual size_t GetLevel() const override;
@@ -40,6 +62,9 @@ private:
     void OnPacWon();
     void OnPacDied();
     void CheckFreeLife();
+    bool AdvanceMaze();
+    void InitRewind();
+    void AddRewindKeyframe();
 
     bool _isGameOver{};
     Stats _stats{};
@@ -50,14 +75,28 @@ private:
     size_t _freeLivesLeft{ 1 };
     size_t _player{};
     std::shared_ptr<IPlayingMaze> _playMaze;
+    std::shared_ptr<IPlayingActor> _pac; // recording reads its press every frame, without copying pointers
     std::shared_ptr<ISoundEffects> _sounds;
     std::shared_ptr<IMazes> _mazes;
     std::vector<FruitType> _displayFruits;
+    Random _levelSeeds;
+
+    // Rewind
+    RewindBuffer _rewind;
+    std::vector<BYTE> _rewindState;
+    size_t _rewindBytes{};
+    bool _replaying{};
+
+    // Fast forward
+    bool _fastForward{};
+    DWORD _fastForwardEffects{}; // bit for each effect that already played during this Advance
 };
 
-Player::Player(size_t nPlayer, std::shared_ptr<IMazes> pMazes)
+Player::Player(size_t nPlayer, std::shared_ptr<IMazes> pMazes, size_t nRewindBytes, uint64_t nSeed)
     : _player(nPlayer)
     , _mazes(pMazes)
+    , _levelSeeds(nSeed + nPlayer, RANDOM_LEVELS)
+    , _rewindBytes(nRewindBytes)
 {
     _lives = _mazes->GetStartingLives();
     _nextFreeLife = _mazes->GetFreeLifeScore();
@@ -75,31 +114,146 @@ bool Player::Advance()
 
     if (_playMaze)
     {
-        _playMaze->Advance();
-
-        CheckFreeLife();
-
-        switch (_playMaze->GetGameState())
+        if (_rewind.GetStateSize())
         {
-            case GS_DIED:
-                bDied = true;
-                OnPacDied();
-                break;
-
-            case GS_WON:
-                OnPacWon();
-                break;
+            _rewind.AddFrame(PressDirToByte(GetPressDir()));
         }
+
+        bDied = AdvanceMaze();
+
+        AddRewindKeyframe();
     }
 
     return !_isGameOver && !bDied;
 }
 
+bool Player::CanRewind() const
+{
+    return _playMaze && !_isGameOver && _rewind.GetFrameCount();
+}
+
+// Goes back to the start of an earlier frame, without sound
+size_t Player::Rewind(size_t nFrames)
+{
+    const BYTE* pState = nullptr;
+    const BYTE* pInputs = nullptr;
+    size_t nInputs = 0;
+
+    nFrames = std::min(nFrames, _rewind.GetFrameCount());
+    check_ret_val(CanRewind() && _rewind.Rewind(nFrames, pState, pInputs, nInputs), 0);
+
+    PlayerRewindState state;
+    ::CopyMemory(&state, pState, sizeof(state));
+
+    if (!_playMaze->LoadSnapshot(pState + sizeof(state), _rewind.GetStateSize() - sizeof(state)))
+    {
+        assert(false);
+        ClearRewind();
+        return 0;
+    }
+
+    _lives = state._lives;
+    _nextFreeLife = state._nextFreeLife;
+    _freeLivesLeft = state._freeLivesLeft;
+
+    // Rewinding is for practice, it shouldn't get a high score
+    _stats._cheated = true;
+
+    std::shared_ptr<IPlayingActor> pac = _playMaze->GetPac();
+    _replaying = true;
+
+    for (size_t i = 0; i < nInputs; i++)
+    {
+        pac->SetPressDir(ByteToPressDir(pInputs[i]));
+        AdvanceMaze();
+    }
+
+    _replaying = false;
+
+    return nFrames;
+}
+
+void Player::ClearRewind()
+{
+    _rewind.Clear();
+    AddRewindKeyframe();
+}
+
+void Player::SetRewindBytes(size_t nBytes)
+{
+    _rewindBytes = nBytes;
+    _rewind = RewindBuffer();
+    _rewindState.clear();
+
+    InitRewind();
+}
+
+void Player::SetFastForward(bool bFastForward)
+{
+    _fastForward = bFastForward;
+    _fastForwardEffects = 0;
+}
+
+// Returns true if Pac died
+bool Player::AdvanceMaze()
+{
+    _playMaze->Advance();
+
+    CheckFreeLife();
+
+    switch (_playMaze->GetGameState())
+    {
+        case GS_DIED:
+            OnPacDied();
+            return true;
+
+        case GS_WON:
+            OnPacWon();
+            break;
+    }
+
+    return false;
+}
+
+// Keyframes are saved between frames, so loading one is the same as replaying up to it
+void Player::AddRewindKeyframe()
+{
+    if (_playMaze && _rewind.NeedsKeyframe())
+    {
+        PlayerRewindState state;
+        state._lives = (uint32_t)_lives;
+        state._nextFreeLife = (uint32_t)_nextFreeLife;
+        state._freeLivesLeft = (uint32_t)_freeLivesLeft;
+
+        ::CopyMemory(_rewindState.data(), &state, sizeof(state));
+
+        if (!_playMaze->SaveSnapshot(_rewindState.data() + sizeof(state), _rewindState.size() - sizeof(state)) ||
+            !_rewind.AddKeyframe(_rewindState.data()))
+        {
+            // Recording will start over with the next level
+            _rewind = RewindBuffer();
+        }
+    }
+}
+
 const std::vector<FruitType>& Player::GetDisplayFruits()
 {
     return _displayFruits;
 }
 
+ff::point_int Player::GetPressDir() const
+{
+    return _pac ? _pac->GetPressDir() : ff::point_int{};
+}
+
+void Player::SetPressDir(ff::point_int dir)
+{
+    if (_pac)
+    {
+        _pac->SetPressDir(dir);
+    }
+}
+
 size_t Player::GetLevel() const
 {
     return _level;
@@ -123,7 +277,11 @@ void Player::SetLevel(size_t nLevel)
         std::shared_ptr<IMaze> pMaze = _mazes->GetMaze(_level % nMazeCount);
         const Difficulty& diff = _mazes->GetDifficulty(_level);
 
-        pPlayMaze = IPlayingMaze::Create(pMaze, diff, this);
+        // Each level's seed comes from the game's seed, so replays play out the same
+        uint64_t nSeed = _levelSeeds.Next();
+        nSeed = (nSeed << 32) | _levelSeeds.Next();
+
+        pPlayMaze = IPlayingMaze::Create(pMaze, diff, this, nSeed);
         pSounds = ISoundEffects::Create(pMaze->GetCharType());
 
         FruitType prevFruit = FRUIT_NONE;
@@ -153,7 +311,30 @@ void Player::SetLevel(size_t nLevel)
     }
 
     _playMaze = pPlayMaze;
+    _pac = pPlayMaze->GetPac();
     _sounds = pSounds;
+
+    // Can't rewind into the previous level, and the new one may need bigger keyframes
+    InitRewind();
+}
+
+void Player::InitRewind()
+{
+    size_t nRewindStateSize = (_playMaze && _rewindBytes) ? sizeof(PlayerRewindState) + _playMaze->GetSnapshotSize() : 0;
+
+    if (nRewindStateSize != _rewind.GetStateSize())
+    {
+        _rewindState.resize(nRewindStateSize);
+        _rewindState.shrink_to_fit();
+
+        if (nRewindStateSize)
+        {
+            // When a level is too big to fit, rewinding just doesn't work
+            _rewind.Init(nRewindStateSize, REWIND_SECONDS * IdealFramesPerSecond(), REWIND_KEYFRAME_FRAMES, _rewindBytes);
+        }
+    }
+
+    ClearRewind();
 }
 
 std::shared_ptr<IPlayingMaze> Player::GetPlayingMaze()
@@ -233,7 +414,7 @@ void Player::CheckFreeLife()
         _nextFreeLife = _freeLifeRepeat ? _nextFreeLife + _freeLifeRepeat : 0;
     }
 
-    if constexpr (ff::constants::debug_build)
+    if (ff::constants::debug_build && !IsHeadless() && !_replaying)
     {
         static bool s_bCheating = false;
 
@@ -282,11 +463,30 @@ bool Player::IsPlayingLevel()
 // IPlayingMazeHost
 bool Player::IsEffectEnabled(AudioEffect effect)
 {
+    if (_replaying)
+    {
+        return false;
+    }
+
     if (effect == EFFECT_INTRO)
     {
         return !_level && !_player;
     }
 
+    if (_fastForward && (effect < EFFECT_FIRST_BACKGROUND || effect > EFFECT_LAST_BACKGROUND))
+    {
+        // Dots and bouncing would just buzz, anything else plays once for each frame that gets shown
+        static_assert(EFFECT_COUNT <= sizeof(DWORD) * 8);
+        DWORD bit = (DWORD)1 << effect;
+
+        if (effect == EFFECT_EAT_DOT1 || effect == EFFECT_EAT_DOT2 || effect == EFFECT_FRUIT_BOUNCE || (_fastForwardEffects & bit))
+        {
+            return false;
+        }
+
+        _fastForwardEffects |= bit;
+    }
+
     return true;
 }
 
@@ -303,7 +503,7 @@ void Player::OnPacUsingTunnel()
 class PlayingGame : public IPlayingGame
 {
 public:
-    PlayingGame(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost);
+    PlayingGame(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost, uint64_t nSeed, std::shared_ptr<Replay> pPlayback);
 
     // IPlayingGame
 
@@ -322,10 +522,21 @@ public:
     virtual bool IsPaused() const override;
     virtual void TogglePaused() override;
     virtual void PausedAdvance() override;
+    virtual bool CanRewind() const override;
+    virtual void Rewind(size_t nFrames) override;
+    virtual std::shared_ptr<Replay> GetReplay() override;
+    virtual bool IsPlayingReplay() const override;
+    virtual size_t GetReplayDivergedFrame() const override;
+    virtual void SetRecording(bool bRecording) override;
+    virtual size_t GetSpeed() const override;
+    virtual void SetSpeed(size_t nSpeed) override;
 
 private:
     void InternalAdvance(bool bForce);
-    void InternalAdvanceOne();
+    bool InternalAdvanceOne();
+    void AddReplayFrame(Player* pPlayer);
+    void AddReplayCheckpoint();
+    uint64_t GetStateHash();
 
     IPlayingGameHost* _host{};
 
@@ -333,6 +544,17 @@ private:
     std::shared_ptr<IRenderText> _renderText;
     std::shared_ptr<Player> _players[2];
 
+    // Replays
+    std::shared_ptr<Replay> _replay;
+    std::shared_ptr<Replay> _playback;
+    size_t _playbackDivergedFrame{ ff::constants::invalid_unsigned<size_t>() };
+    std::vector<uint64_t> _hashBuffer;
+    bool _recording{ true };
+
+    // Fast forward
+    size_t _speed{ 1 };
+    double _advanceMicroseconds{}; // smoothed time for all the steps in one Advance
+
     bool _isGameOver{};
     bool _paused{};
     bool _singleAdvance{};
@@ -345,26 +567,41 @@ private:
     static const int _nStatusTiles = 2;
 };
 
-std::shared_ptr<IPlayingGame> IPlayingGame::Create(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost)
+std::shared_ptr<IPlayingGame> IPlayingGame::Create(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost, uint64_t nSeed)
+{
+    return std::make_shared<PlayingGame>(pMazes, nPlayers, pHost, nSeed, nullptr);
+}
+
+std::shared_ptr<IPlayingGame> IPlayingGame::Create(std::shared_ptr<Replay> pPlayback, IPlayingGameHost* pHost)
 {
-    return std::make_shared<PlayingGame>(pMazes, nPlayers, pHost);
+    assert_ret_val(pPlayback, nullptr);
+
+    std::shared_ptr<IMazes> pMazes = CreateMazesFromId(pPlayback->GetMazesID());
+    check_ret_val(pMazes && pMazes->GetMazeCount(), nullptr);
+
+    return std::make_shared<PlayingGame>(pMazes, pPlayback->GetPlayers(), pHost, pPlayback->GetSeed(), pPlayback);
 }
 
-PlayingGame::PlayingGame(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost)
+PlayingGame::PlayingGame(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost, uint64_t nSeed, std::shared_ptr<Replay> pPlayback)
     : _host(pHost)
     , _mazes(pMazes)
-    , _renderText(IRenderText::Create())
+    , _renderText(!IsHeadless() ? IRenderText::Create() : nullptr)
+    , _replay(std::make_shared<Replay>(pMazes->GetID(), nPlayers, nSeed))
+    , _playback(pPlayback)
 {
     assert(pMazes && nPlayers >= 1 && nPlayers <= _countof(_players));
 
     for (size_t i = 0; i < nPlayers; i++)
     {
-        _players[i] = std::make_shared<Player>(i, pMazes);
+        _players[i] = std::make_shared<Player>(i, pMazes, REWIND_MAX_BYTES / nPlayers, nSeed);
     }
 }
 
-void PlayingGame::InternalAdvanceOne()
+// Returns false when the host should get a chance to look at the game before any more steps
+bool PlayingGame::InternalAdvanceOne()
 {
+    bool bKeepGoing = true;
+
     std::shared_ptr<Player> pPlayer = _players[_player];
 
     if (_switchPlayer)
@@ -378,6 +615,9 @@ void PlayingGame::InternalAdvanceOne()
         {
             _player = nNewPlayer;
             pPlayer = _players[_player];
+
+            // Don't rewind back into the turn before the other player's turn
+            pPlayer->ClearRewind();
         }
         else if (pPlayer->IsGameOver())
         {
@@ -386,6 +626,11 @@ void PlayingGame::InternalAdvanceOne()
         }
     }
 
+    if (_recording)
+    {
+        AddReplayFrame(pPlayer.get());
+    }
+
     if (_gameOverCounter)
     {
         _gameOverCounter++;
@@ -398,6 +643,7 @@ void PlayingGame::InternalAdvanceOne()
             if (_host)
             {
                 _host->OnPlayerGameOver(this, pPlayer);
+                bKeepGoing = false;
             }
         }
     }
@@ -417,23 +663,125 @@ void PlayingGame::InternalAdvanceOne()
     }
 
     _counter++;
+
+    if (_recording)
+    {
+        AddReplayCheckpoint();
+    }
+
+    return bKeepGoing && !_isGameOver;
+}
+
+// Replays see the same press as the player that's about to move, after switching players
+void PlayingGame::AddReplayFrame(Player* pPlayer)
+{
+    if (pPlayer && IsPlayingReplay())
+    {
+        pPlayer->SetPressDir(_playback->GetPressDir(_replay->GetFrameCount()));
+    }
+
+    _replay->AddFrame(pPlayer ? pPlayer->GetPressDir() : ff::point_int{});
+}
+
+void PlayingGame::AddReplayCheckpoint()
+{
+    if (_replay->GetFrameCount() % Replay::CHECKPOINT_FRAMES)
+    {
+        return;
+    }
+
+    uint64_t nHash = GetStateHash();
+    size_t nCheckpoint = _replay->GetCheckpointCount();
+    _replay->AddCheckpoint(nHash);
+
+    if (_playback &&
+        _playbackDivergedFrame == ff::constants::invalid_unsigned<size_t>() &&
+        nCheckpoint < _playback->GetCheckpointCount() &&
+        _playback->GetCheckpoint(nCheckpoint) != nHash)
+    {
+        _playbackDivergedFrame = _replay->GetFrameCount();
+
+        std::string text = ff::string::concat("Replay of ", _playback->GetMazesID(), " diverged by frame ", _playbackDivergedFrame, "\n");
+        ::OutputDebugStringA(text.c_str());
+    }
+}
+
+// FNV-1a, a word at a time, of everything that decides how the rest of the game plays out. Only the current
+// player's maze is included, the other one can't change until it's their turn.
+uint64_t PlayingGame::GetStateHash()
+{
+    uint64_t nHash = 0xCBF29CE484222325;
+
+    auto addWords = [&nHash](const uint64_t* pWords, size_t nCount)
+        {
+            for (const uint64_t* pWord = pWords; nCount; nCount--, pWord++)
+            {
+                nHash = (nHash ^ *pWord) * 0x100000001B3;
+            }
+        };
+
+    uint64_t game[] = { _player, _isGameOver, _switchPlayer, _gameOverCounter };
+    addWords(game, _countof(game));
+
+    for (const std::shared_ptr<Player>& pPlayer : _players)
+    {
+        if (pPlayer)
+        {
+            uint64_t player[] = { pPlayer->GetScore(), pPlayer->GetLives(), pPlayer->GetLevel(), pPlayer->IsGameOver() };
+            addWords(player, _countof(player));
+        }
+    }
+
+    std::shared_ptr<IPlayingMaze> pPlayMaze = _players[_player]->GetPlayingMaze();
+    if (pPlayMaze)
+    {
+        // Zero padded to whole words
+        size_t nSize = pPlayMaze->GetSnapshotSize();
+        _hashBuffer.resize((nSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        _hashBuffer.back() = 0;
+
+        if (pPlayMaze->SaveSnapshot((BYTE*)_hashBuffer.data(), nSize))
+        {
+            addWords(_hashBuffer.data(), _hashBuffer.size());
+        }
+    }
+
+    return nHash;
 }
 
 void PlayingGame::InternalAdvance(bool bForce)
 {
     if (bForce || !_paused)
     {
-        size_t speed = 1;
+        auto startTime = std::chrono::steady_clock::now();
+        bool bFastForward = (_speed > 1);
+
+        for (const std::shared_ptr<Player>& pPlayer : _players)
+        {
+            if (pPlayer)
+            {
+                pPlayer->SetFastForward(bFastForward);
+            }
+        }
 
-        if (ff::constants::debug_build && ff::input::keyboard().pressing(VK_INSERT))
+        // Every step is the same as a normal frame, so fast forward isn't cheating and replays still match
+        for (size_t i = 0; i < _speed; i++)
         {
-            // Is this cheating? If so, set _bCheated in the stats
-            speed = 4;
+            if (i && _host)
+            {
+                _host->OnFastForwardStep(this);
+            }
+
+            if (!InternalAdvanceOne())
+            {
+                break;
+            }
         }
 
-        for (; speed > 0; speed--)
+        if (bFastForward)
         {
-            InternalAdvanceOne();
+            double micro = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+            _advanceMicroseconds = _advanceMicroseconds ? _advanceMicroseconds * 0.9 + micro * 0.1 : micro;
         }
     }
 }
@@ -457,6 +805,7 @@ void PlayingGame::Render(ff::dxgi::draw_base& draw)
     ff::point_int totalTiles = GetSizeInTiles();
     bool bShowScores = (!_host || _host->IsShowingScoreBar(this));
     bool bShowStatus = (!_host || _host->IsShowingStatusBar(this));
+    bool bShowTrails = (_host && _host->IsShowingGhostTrails(this));
     std::shared_ptr<IPlayingMaze> pPlayMaze = _players[_player]->GetPlayingMaze();
 
     if (bShowScores)
@@ -483,6 +832,17 @@ void PlayingGame::Render(ff::dxgi::draw_base& draw)
         _renderText->DrawText(draw, "HIGH SCORE", ff::point_float(9 * tileSize.x, 0), 0, &s_colorText, nullptr, nullptr);
         _renderText->DrawText(draw, szHighScore.c_str(), ff::point_float(10 * tileSize.x, tileSize.y), 0, &s_colorText, nullptr, nullptr);
 
+        if (_speed > 1)
+        {
+            // Red once the steps don't fit in a frame
+            double frameMicroseconds = 1000000.0 / IdealFramesPerSecondF();
+            char szSpeed[24];
+            _snprintf_s(szSpeed, _TRUNCATE, "%IuX %.1fMS", _speed, _advanceMicroseconds / 1000.0);
+
+            _renderText->DrawText(draw, szSpeed, ff::point_float(0, 2 * tileSize.y), 0,
+                (_advanceMicroseconds > frameMicroseconds) ? &s_colorGameOver : &s_colorText, nullptr, nullptr);
+        }
+
         if (_singleAdvance)
         {
             std::string szFrame = FormatScoreAsString(_counter);
@@ -545,6 +905,11 @@ void PlayingGame::Render(ff::dxgi::draw_base& draw)
 
         pPlayMaze->Render(draw);
 
+        if (bShowTrails)
+        {
+            pPlayMaze->GetRenderMaze()->RenderGhostTrails(draw, pPlayMaze.get());
+        }
+
         if (bShowScores)
         {
             draw.world_matrix_stack().pop();
@@ -761,3 +1126,65 @@ void PlayingGame::PausedAdvance()
         InternalAdvance(true);
     }
 }
+
+bool PlayingGame::CanRewind() const
+{
+    return !_isGameOver && !_gameOverCounter && !_switchPlayer && !IsPlayingReplay() && _players[_player] && _players[_player]->CanRewind();
+}
+
+void PlayingGame::Rewind(size_t nFrames)
+{
+    if (CanRewind())
+    {
+        // The replay goes back too, rewinding never leaves the current player's turn
+        size_t nRewound = _players[_player]->Rewind(nFrames);
+        _replay->Truncate(_replay->GetFrameCount() - std::min(nRewound, _replay->GetFrameCount()));
+    }
+}
+
+std::shared_ptr<Replay> PlayingGame::GetReplay()
+{
+    return _replay;
+}
+
+bool PlayingGame::IsPlayingReplay() const
+{
+    return _playback && _replay->GetFrameCount() < _playback->GetFrameCount();
+}
+
+size_t PlayingGame::GetReplayDivergedFrame() const
+{
+    return _playbackDivergedFrame;
+}
+
+void PlayingGame::SetRecording(bool bRecording)
+{
+    // Replays need to count frames to play back
+    assert_ret(!_playback);
+
+    _recording = bRecording;
+
+    for (std::shared_ptr<Player>& pPlayer : _players)
+    {
+        if (pPlayer)
+        {
+            pPlayer->SetRewindBytes(bRecording ? REWIND_MAX_BYTES / GetPlayers() : 0);
+        }
+    }
+}
+
+size_t PlayingGame::GetSpeed() const
+{
+    return _speed;
+}
+
+void PlayingGame::SetSpeed(size_t nSpeed)
+{
+    nSpeed = std::max<size_t>(1, std::min(nSpeed, (size_t)MAX_SPEED));
+
+    if (nSpeed != _speed)
+    {
+        _speed = nSpeed;
+        _advanceMicroseconds = 0;
+    }
+}
@@ -4,6 +4,7 @@ class IMazes;
 class IPlayer;
 class IPlayingGameHost;
 class IPlayingMaze;
+class Replay;
 struct Stats;
 
 class IPlayingGame
@@ -11,7 +12,8 @@ class IPlayingGame
 public:
     virtual ~IPlayingGame() = default;
 
-    static std::shared_ptr<IPlayingGame> Create(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost);
+    static std::shared_ptr<IPlayingGame> Create(std::shared_ptr<IMazes> pMazes, size_t nPlayers, IPlayingGameHost* pHost, uint64_t nSeed);
+    static std::shared_ptr<IPlayingGame> Create(std::shared_ptr<Replay> pPlayback, IPlayingGameHost* pHost);
 
     virtual void Advance() = 0;
     virtual void Render(ff::dxgi::draw_base& draw) = 0;
@@ -28,6 +30,23 @@ public:
     virtual bool IsPaused() const = 0;
     virtual void TogglePaused() = 0;
     virtual void PausedAdvance() = 0;
+
+    // Practice mode, rewound games can't get a high score
+    virtual bool CanRewind() const = 0;
+    virtual void Rewind(size_t nFrames) = 0;
+
+    // Every game records a replay. Playing one back ignores what's pressed until it runs out.
+    virtual std::shared_ptr<Replay> GetReplay() = 0;
+    virtual bool IsPlayingReplay() const = 0;
+    virtual size_t GetReplayDivergedFrame() const = 0; // invalid if every checkpoint matched
+
+    // Games that don't record have no replay and can't rewind. Only for measuring what recording costs.
+    virtual void SetRecording(bool bRecording) = 0;
+
+    // Fast forward runs more than one step for each Advance, only the last step gets rendered
+    static const size_t MAX_SPEED = 64;
+    virtual size_t GetSpeed() const = 0;
+    virtual void SetSpeed(size_t nSpeed) = 0;
 };
 
 class IPlayer
@@ -51,5 +70,7 @@ class IPlayingGameHost
 public:
     virtual bool IsShowingScoreBar(IPlayingGame* pGame) const = 0;
     virtual bool IsShowingStatusBar(IPlayingGame* pGame) const = 0;
+    virtual bool IsShowingGhostTrails(IPlayingGame* pGame) const = 0;
     virtual void OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlayer>) = 0;
+    virtual void OnFastForwardStep(IPlayingGame* pGame) = 0; // before each extra step, to update what's pressed
 };
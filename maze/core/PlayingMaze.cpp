@@ -2,8 +2,11 @@
 #include "Core/Actors.h"
 #include "Core/Audio.h"
 #include "Core/GhostBrains.h"
+#include "Core/GhostPaths.h"
 #include "Core/Helpers.h"
 #include "Core/Maze.h"
+#include "Core/MazeDistances.h"
+#include "Core/MazeGraph.h"
 #include "Core/PlayingMaze.h"
 #include "Core/RenderMaze.h"
 #include "Core/RenderText.h"
@@ -19,6 +22,117 @@ static const int FRUIT_BUBBLE_SPREAD = 13;
 static const int POWER_BUBBLE_SPREAD = 13;
 static const int GHOST_BUBBLE_SPREAD = 13;
 
+// The start of a snapshot. It's followed by an ActorSnapshot for each ghost, the fruit's choices at each maze graph
+// node, and then a bit for each dot that the level started with, set when the dot is still there.
+// Everything has a fixed size so that snapshots can be saved to disk. Change VERSION when the layout changes.
+struct PlayingMazeSnapshot
+{
+    static constexpr uint32_t MAGIC = 0x534D4150; // "PAMS"
+    static constexpr uint32_t VERSION = 2;
+
+    // The counting part of Stats. High scores belong to the player, not the game, so rewinding never touches them.
+    struct StatsSnapshot
+    {
+        uint32_t _cheated;
+        uint32_t _gamesStarted;
+        uint32_t _levelsBeaten;
+        uint32_t _dotsEaten;
+        uint32_t _powerEaten;
+        uint32_t _fruitsEaten;
+        uint32_t _ghostsEaten[GHOST_PERSONALITY_COUNT];
+        uint32_t _ghostDeathCount[GHOST_PERSONALITY_COUNT];
+        uint32_t _tunnelsUsed;
+        uint32_t _score;
+    };
+
+    uint32_t _magic;
+    uint32_t _version;
+    uint32_t _size; // of the whole snapshot
+    uint32_t _ghosts;
+    uint32_t _nodes;
+    uint32_t _levelDots;
+    ff::point_int _mazeSize;
+
+    StatsSnapshot _stats;
+    uint32_t _random[4];
+    uint32_t _cosmeticRandom[4];
+    ActorSnapshot _pac;
+    ActorSnapshot _fruit;
+
+    uint32_t _state;
+    uint32_t _stateCounter;
+    uint32_t _dotCount;
+    uint32_t _dotCountTotal;
+    uint32_t _lastDotCounter;
+    uint32_t _globalDotIndex;
+    uint32_t _globalDotCounter;
+    uint32_t _dotEffect;
+    uint32_t _ghostCount;
+    uint32_t _ghostScatterCountdown;
+    uint32_t _ghostScaredCountdown;
+    uint32_t _ghostChaseCountdown;
+    uint32_t _ghostEatenCountdown;
+    uint32_t _ghostEatenIndex;
+    uint32_t _ghostScatterChaseIndex;
+    uint32_t _fruitCounter;
+    uint32_t _currentFruit;
+    uint32_t _fruitDots[2];
+};
+
+static void SaveStats(const Stats& stats, PlayingMazeSnapshot::StatsSnapshot& snapshot)
+{
+    snapshot._cheated = stats._cheated ? 1 : 0;
+    snapshot._gamesStarted = stats._gamesStarted;
+    snapshot._levelsBeaten = stats._levelsBeaten;
+    snapshot._dotsEaten = stats._dotsEaten;
+    snapshot._powerEaten = stats._powerEaten;
+    snapshot._fruitsEaten = stats._fruitsEaten;
+    snapshot._tunnelsUsed = stats._tunnelsUsed;
+    snapshot._score = stats._score;
+
+    for (size_t i = 0; i < GHOST_PERSONALITY_COUNT; i++)
+    {
+        snapshot._ghostsEaten[i] = stats._ghostsEaten[i];
+        snapshot._ghostDeathCount[i] = stats._ghostDeathCount[i];
+    }
+}
+
+static void LoadStats(const PlayingMazeSnapshot::StatsSnapshot& snapshot, Stats& stats)
+{
+    stats._cheated = snapshot._cheated != 0;
+    stats._gamesStarted = snapshot._gamesStarted;
+    stats._levelsBeaten = snapshot._levelsBeaten;
+    stats._dotsEaten = snapshot._dotsEaten;
+    stats._powerEaten = snapshot._powerEaten;
+    stats._fruitsEaten = snapshot._fruitsEaten;
+    stats._tunnelsUsed = snapshot._tunnelsUsed;
+    stats._score = snapshot._score;
+
+    for (size_t i = 0; i < GHOST_PERSONALITY_COUNT; i++)
+    {
+        stats._ghostsEaten[i] = snapshot._ghostsEaten[i];
+        stats._ghostDeathCount[i] = snapshot._ghostDeathCount[i];
+    }
+}
+
+static void SaveRandom(const Random& random, uint32_t snapshot[4])
+{
+    std::copy(random.GetState().begin(), random.GetState().end(), snapshot);
+}
+
+static void LoadRandom(const uint32_t snapshot[4], Random& random)
+{
+    Random::State state;
+    std::copy(snapshot, snapshot + state.size(), state.begin());
+    random.SetState(state);
+}
+
+// A state of all zeros can't come from a real game
+static bool IsValidRandom(const uint32_t snapshot[4])
+{
+    return snapshot[0] || snapshot[1] || snapshot[2] || snapshot[3];
+}
+
 static bool operator<(
     const std::pair<ff::point_int, ff::point_int>& lhs,
     const std::pair<ff::point_int, ff::point_int>& rhs)
@@ -29,19 +143,24 @@ static bool operator<(
 class PlayingMaze : public IPlayingMaze
 {
 public:
-    PlayingMaze(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost);
+    PlayingMaze(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost, uint64_t nSeed);
 
     // IPlayingMaze
 
     virtual void Advance() override;
     virtual void Render(ff::dxgi::draw_base& draw) override;
     virtual void Reset() override;
+    virtual std::shared_ptr<IPlayingMaze> Clone() const override;
+    virtual size_t GetSnapshotSize() const override;
+    virtual bool SaveSnapshot(BYTE* pData, size_t nSize) const override;
+    virtual bool LoadSnapshot(const BYTE* pData, size_t nSize) override;
 
     virtual GameState GetGameState() const override;
     virtual const Stats& GetStats() const override;
     virtual std::shared_ptr<IMaze> GetMaze() const override;
     virtual std::shared_ptr<IRenderMaze> GetRenderMaze() override;
     virtual const Difficulty& GetDifficulty() const override;
+    virtual Random& GetRandom() override;
 
     virtual PacState GetPacState() const override;
     virtual std::shared_ptr<IPlayingActor> GetPac() override;
@@ -52,6 +171,7 @@ public:
     virtual ff::point_int GetGhostEyeDir(size_t nGhost) const override;
     virtual GhostState GetGhostState(size_t nGhost) const override;
     virtual std::shared_ptr<IPlayingActor> GetGhost(size_t nGhost) override;
+    virtual const GhostPaths* GetGhostPaths() override;
 
     virtual ff::point_int GetGhostStartPixel() const override;
     virtual ff::point_int GetGhostStartTile() const override;
@@ -83,6 +203,7 @@ private:
 
     void InitActorPositions();
     void InitDotCount();
+    void ClearLevelDotBit(ff::point_int tile);
 
     void RenderDebugGhostPaths(ff::dxgi::draw_base& draw);
 
@@ -90,7 +211,7 @@ private:
     void AdvanceRenderer();
     void AdvanceActors();
     void AdvancePac(PacActor& pac);
-    void AdvanceGhost(GhostActor& ghost);
+    void AdvanceGhost(size_t nGhost);
     void AdvanceFruit(FruitActor& fruit);
     void AdvanceCustomActors();
 
@@ -103,36 +224,52 @@ private:
 
     void CheckPacCollisions(PacActor& pac);
     bool CheckTunnel(PlayingActor& actor);
+    bool WrapTunnelPixel(ff::point_int& pixel, ff::point_int dir) const;
     bool CheckGhostsScared(bool& scared, bool& eyes) const;
 
     void OnPacEatDot(PacActor& pac, bool bPower);
     void OnPacEatFruit(PacActor& pac, FruitActor& fruit);
-    void OnPacEatGhost(PacActor& pac, GhostActor& ghost);
-    void OnGhostEatPac(PacActor& pac, GhostActor& ghost);
+    void OnPacEatGhost(PacActor& pac, size_t nGhost);
+    void OnGhostEatPac(PacActor& pac, size_t nGhost);
 
-    size_t GhostIndex(GhostActor& ghost);
-    ff::point_int GhostDecidePress(GhostActor& ghost);
+    bool GetGhostChoices(MoveState move, ff::point_int tile, ff::point_int dir, ff::stack_vector<ff::point_int, 4>& tiles, ff::point_int& press);
     ff::point_int GhostDecidePress(IGhostBrains* brains, MoveState move, ff::point_int tile, ff::point_int dir);
+    ff::point_int QueueGhostDecision(size_t nGhost);
+    void DecideQueuedGhosts();
+    void UpdateGhostSnapshot();
+    void UpdateGhostPaths();
+    ff::point_int GetGhostLeaveDir(size_t nGhost) const;
     void FlipGhosts();
     void ScareGhosts(bool bScared);
     bool ReleaseGhost();
     size_t CountGhostsInHouse();
 
     ff::point_int FruitDecideDir(FruitActor& fruit);
+    size_t FruitExitChoice(const ff::point_int* pTiles, size_t nTiles) const;
+    void MeasureFruitExit();
 
     bool IsWall(ff::point_int tile);
     bool HitWall(ff::point_int tile, ff::point_int dir);
+    bool IsDebugKeyPressed(int vk) const;
 
     std::shared_ptr<IMaze> _maze;
+    const Tiles* _tiles{}; // owned by _maze, cached for fast wall tests
     std::shared_ptr<IRenderMaze> _renderMaze;
     std::shared_ptr<IRenderText> _renderText;
     std::shared_ptr<ISoundEffects> _sound;
     IPlayingMazeHost* _host;
+    bool _lookAhead{}; // copied by Clone, only plays the game without any effects or debug keys
 
     // Actors
     std::shared_ptr<PacActor> _pac;
     std::shared_ptr<FruitActor> _fruit;
-    std::shared_ptr<GhostActor> _ghosts[4];
+    std::shared_ptr<GhostStates> _ghosts;
+    std::vector<std::shared_ptr<GhostActor>> _ghostActors; // for GetGhost
+    std::vector<size_t> _ghostAdvanceCounts; // for the current frame
+    std::vector<GhostDecision> _ghostDecisions; // waiting for the current step to end
+    GhostSnapshot _ghostSnapshot{};
+    GhostPaths _ghostPaths;
+    bool _ghostPathsDirty{ true }; // predicted lazily, at most once per frame
     std::vector<std::shared_ptr<PointActor>> _points;
     std::vector<std::shared_ptr<CustomActor>> _customs;
 
@@ -141,6 +278,8 @@ private:
     GameState _state{ GS_BEFORE_TIME };
     Difficulty _difficulty{};
     size_t _stateCounter{};
+    Random _random;
+    Random _cosmeticRandom; // bubbles and other effects that don't change the game
 
     // Dot stuff
     size_t _dotCount{};
@@ -168,42 +307,80 @@ private:
     size_t _nFruitDots[2]{};
     ff::point_int _fruitPixel{};
     std::vector<std::pair<ff::point_int, ff::point_int>> _fruitStartTiles;
+    std::vector<BYTE> _fruitChoices; // exits already taken from each junction, low bits while wandering, high bits while exiting
+    std::vector<uint32_t> _fruitExitDistances; // to the current exit for each tile, measured when the fruit shows up
+    std::vector<ff::point_int> _fruitExitQueue;
+    ff::point_int _fruitExitDistancesTile{}; // the exit that _fruitExitDistances were measured for
+    static constexpr uint32_t NO_FRUIT_EXIT_DISTANCE = 0xFFFFFFFF;
+
+    // Snapshot stuff
+    struct LevelDot
+    {
+        ff::point_int _tile;
+        TileContent _content;
+    };
+
+    std::shared_ptr<std::vector<LevelDot>> _levelDots; // every dot when the level started, shared with clones
+    std::vector<BYTE> _levelDotBits; // one bit for each of _levelDots that's still there, saved as is in snapshots
 };
 
 static const DirectX::XMFLOAT4 s_ghostPointsTextColor(0, 1, 1, 1);
 static const DirectX::XMFLOAT4 s_fruitPointsTextColor(1, 0.7216f, 1, 1);
 
 // static
-std::shared_ptr<IPlayingMaze> IPlayingMaze::Create(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost)
+std::shared_ptr<IPlayingMaze> IPlayingMaze::Create(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost, uint64_t nSeed)
 {
-    return std::make_shared<PlayingMaze>(pMaze, difficulty, pHost);
+    return std::make_shared<PlayingMaze>(pMaze, difficulty, pHost, nSeed);
 }
 
-PlayingMaze::PlayingMaze(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost)
+PlayingMaze::PlayingMaze(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost, uint64_t nSeed)
     : _host(pHost)
     , _difficulty(difficulty)
+    , _random(nSeed, RANDOM_GAMEPLAY)
+    , _cosmeticRandom(nSeed, RANDOM_COSMETIC)
     , _pac(std::make_shared<PacActor>())
     , _fruit(std::make_shared<FruitActor>())
+    , _ghosts(std::make_shared<GhostStates>())
 {
-    for (auto& ghost : _ghosts)
+    // There are always enough ghosts for each personality, even if some never become active
+
+    _ghosts->SetCount(std::max(GHOST_PERSONALITY_COUNT, std::min(_difficulty._ghostCount, MAX_GHOST_COUNT)));
+
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        ghost = std::make_shared<GhostActor>();
+        _ghostActors.push_back(std::make_shared<GhostActor>(_ghosts, i));
     }
 
+    _ghostPaths.SetCount(_ghosts->GetCount());
+
     // Clone the maze so that it can be modified
     _maze = pMaze->Clone(false);
-    _renderMaze = IRenderMaze::Create(_maze);
-    _renderText = IRenderText::Create();
+    _tiles = &_maze->GetTiles();
+
+    // Cached mazes are already measured, otherwise measure now instead of during the first ghost decisions
+    _maze->GetGraph();
+    _maze->GetHouseFlowField();
+
+    if (_difficulty.UsesPathTargeting())
+    {
+        _maze->GetDistances();
+    }
+
+    if (!IsHeadless())
+    {
+        _renderMaze = IRenderMaze::Create(_maze);
+        _renderText = IRenderText::Create();
+    }
 
     if (!pHost || pHost->IsPlayingLevel())
     {
         _sound = ISoundEffects::Create(_maze->GetCharType());
     }
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        std::shared_ptr<IGhostBrains> brains = IGhostBrains::Create(i);
-        _ghosts[i]->SetBrains(brains);
+        std::shared_ptr<IGhostBrains> brains = IGhostBrains::Create(i, GetGhostPersonality(i));
+        _ghosts->SetBrains(i, brains);
     }
 
     UpdateScatterChaseTimes(_ghostScatterChaseIndex);
@@ -213,97 +390,95 @@ PlayingMaze::PlayingMaze(std::shared_ptr<IMaze> pMaze, const Difficulty& difficu
 
 void PlayingMaze::InitActorPositions()
 {
-    bool bFoundFruit = false;
-
     _fruitStartTiles.clear();
+    _fruitChoices.resize(_maze->GetGraph().GetNodeCount());
     _fruit->SetActive(false);
     _pac->SetActive(false);
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        _ghosts[i]->SetActive(false);
+        _ghosts->SetActive(i, false);
     }
 
     _ghostCount = 0;
 
-    for (ff::point_int tile(0, 0), size = _maze->GetSizeInTiles();
-        tile.y < size.y; tile.x = 0, tile.y++)
+    const TileCensus& census = _tiles->GetCensus();
+
+    if (census._contentCounts[CONTENT_GHOST_DOOR])
     {
-        for (; tile.x < size.x; tile.x++)
-        {
-            TileContent content = _maze->GetTileContent(tile);
-            TileZone zone = _maze->GetTileZone(tile);
+        ff::point_int tile = census._ghostDoor;
 
-            if (content == CONTENT_GHOST_DOOR && !_ghostCount)
-            {
-                _ghostCount = std::min(_difficulty._ghostCount, _countof(_ghosts));
-                _ghostStartTile = tile + ff::point_int(0, -1);
-                _ghostStartPixel = TileMiddleRightToPixel(_ghostStartTile);
+        _ghostCount = std::min(_difficulty._ghostCount, _ghosts->GetCount());
+        _ghostStartTile = tile + ff::point_int(0, -1);
+        _ghostStartPixel = TileMiddleRightToPixel(_ghostStartTile);
+        _fruitPixel = TileMiddleRightToPixel(tile + ff::point_int(0, 5));
 
-                if (!bFoundFruit)
-                {
-                    _fruitPixel = TileMiddleRightToPixel(tile + ff::point_int(0, 5));
-                }
+        _ghostHouseRect = ff::rect_int(
+            TileTopLeftToPixel(tile + ff::point_int(-1, 2)),
+            TileBottomRightToPixel(tile + ff::point_int(2, 2)));
 
-                _ghostHouseRect = ff::rect_int(
-                    TileTopLeftToPixel(tile + ff::point_int(-1, 2)),
-                    TileBottomRightToPixel(tile + ff::point_int(2, 2)));
+        _ghosts->SetActive(0, _ghostCount >= 1);
+        _ghosts->SetPixel(0, TileMiddleRightToPixel(tile + ff::point_int(0, -1)));
+        _ghosts->SetDir(0, ff::point_int(-1, 0));
 
-                _ghosts[0]->SetActive(_ghostCount >= 1);
-                _ghosts[0]->SetPixel(TileMiddleRightToPixel(tile + ff::point_int(0, -1)));
-                _ghosts[0]->SetDir(ff::point_int(-1, 0));
+        // Everyone else starts in the house, in their personality's spot
 
-                _ghosts[1]->SetActive(_ghostCount >= 2);
-                _ghosts[1]->SetHouseState(HOUSE_INSIDE);
-                _ghosts[1]->SetPixel(TileMiddleRightToPixel(tile + ff::point_int(0, 2)));
-                _ghosts[1]->SetDir(ff::point_int(0, 1));
+        static const ff::point_int s_houseOffsets[GHOST_PERSONALITY_COUNT] =
+        {
+            ff::point_int(0, 2),
+            ff::point_int(0, 2),
+            ff::point_int(-2, 2),
+            ff::point_int(2, 2),
+        };
 
-                _ghosts[2]->SetActive(_ghostCount >= 3);
-                _ghosts[2]->SetHouseState(HOUSE_INSIDE);
-                _ghosts[2]->SetPixel(TileMiddleRightToPixel(tile + ff::point_int(-2, 2)));
-                _ghosts[2]->SetDir(ff::point_int(0, -1));
+        for (size_t i = 1; i < _ghosts->GetCount(); i++)
+        {
+            size_t nPersonality = GetGhostPersonality(i);
 
-                _ghosts[3]->SetActive(_ghostCount >= 4);
-                _ghosts[3]->SetHouseState(HOUSE_INSIDE);
-                _ghosts[3]->SetPixel(TileMiddleRightToPixel(tile + ff::point_int(2, 2)));
-                _ghosts[3]->SetDir(ff::point_int(0, -1));
-            }
-            else if (content == CONTENT_PAC_START && !_pac->IsActive() &&
-                (!_host || _host->GetMazePlayer() != ff::constants::invalid_unsigned<size_t>()))
-            {
-                _pac->SetActive(true);
-                _pac->SetPixel(TileMiddleRightToPixel(tile));
-                _pac->SetDir(ff::point_int(-1, 0));
-            }
-            else if (content == CONTENT_FRUIT_START && !bFoundFruit)
-            {
-                _fruitPixel = TileMiddleRightToPixel(tile);
+            _ghosts->SetActive(i, _ghostCount > i);
+            _ghosts->SetHouseState(i, HOUSE_INSIDE);
+            _ghosts->SetPixel(i, TileMiddleRightToPixel(tile + s_houseOffsets[nPersonality]));
+            _ghosts->SetDir(i, ff::point_int(0, (nPersonality < 2) ? 1 : -1));
+        }
+    }
 
-                bFoundFruit = true;
-            }
-            else if (content == CONTENT_NOTHING && zone == ZONE_GHOST_SLOW)
-            {
-                if (tile.x == 0)
-                {
-                    std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x - 1, tile.y), ff::point_int(1, 0));
-                    _fruitStartTiles.push_back(pair);
-                }
-                else if (tile.x == size.x - 1)
-                {
-                    std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x + 1, tile.y), ff::point_int(-1, 0));
-                    _fruitStartTiles.push_back(pair);
-                }
-                else if (tile.y == 0)
-                {
-                    std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x, tile.y - 1), ff::point_int(0, 1));
-                    _fruitStartTiles.push_back(pair);
-                }
-                else if (tile.y == size.y - 1)
-                {
-                    std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x, tile.y + 1), ff::point_int(0, -1));
-                    _fruitStartTiles.push_back(pair);
-                }
-            }
+    if (census._contentCounts[CONTENT_PAC_START] &&
+        (!_host || _host->GetMazePlayer() != ff::constants::invalid_unsigned<size_t>()))
+    {
+        _pac->SetActive(true);
+        _pac->SetPixel(TileMiddleRightToPixel(census._pacStart));
+        _pac->SetDir(ff::point_int(-1, 0));
+    }
+
+    if (census._contentCounts[CONTENT_FRUIT_START])
+    {
+        // Takes priority over the spot below the ghost house
+        _fruitPixel = TileMiddleRightToPixel(census._fruitStart);
+    }
+
+    ff::point_int size = _maze->GetSizeInTiles();
+
+    for (ff::point_int tile : census._tunnelTiles)
+    {
+        if (tile.x == 0)
+        {
+            std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x - 1, tile.y), ff::point_int(1, 0));
+            _fruitStartTiles.push_back(pair);
+        }
+        else if (tile.x == size.x - 1)
+        {
+            std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x + 1, tile.y), ff::point_int(-1, 0));
+            _fruitStartTiles.push_back(pair);
+        }
+        else if (tile.y == 0)
+        {
+            std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x, tile.y - 1), ff::point_int(0, 1));
+            _fruitStartTiles.push_back(pair);
+        }
+        else if (tile.y == size.y - 1)
+        {
+            std::pair<ff::point_int, ff::point_int> pair(ff::point_int(tile.x, tile.y + 1), ff::point_int(0, -1));
+            _fruitStartTiles.push_back(pair);
         }
     }
 }
@@ -312,27 +487,34 @@ void PlayingMaze::InitDotCount()
 {
     // Set the dot count for each ghost
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        _ghosts[i]->SetDotCounter(_difficulty.GetGhostDotCounter(i));
+        _ghosts->SetDotCounter(i, _difficulty.GetGhostDotCounter(GetGhostPersonality(i)));
     }
 
     // Count dots
 
-    ff::point_int size = _maze->GetSizeInTiles();
+    const TileCensus& census = _tiles->GetCensus();
+    size_t nDots = census._contentCounts[CONTENT_DOT] + census._contentCounts[CONTENT_POWER];
 
-    for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
-    {
-        for (; tile.x < size.x; tile.x++)
+    _dotCount += nDots;
+    _dotCountTotal += nDots;
+
+    // Remember where they all were, for snapshots
+
+    _levelDots = std::make_shared<std::vector<LevelDot>>();
+    _levelDots->reserve(nDots);
+
+    _tiles->ForEachDot([this](ff::point_int tile, TileContent content)
         {
-            TileContent content = _maze->GetTileContent(tile);
+            _levelDots->push_back(LevelDot{ tile, content });
+        });
 
-            if (content == CONTENT_DOT || content == CONTENT_POWER)
-            {
-                _dotCount++;
-                _dotCountTotal++;
-            }
-        }
+    _levelDotBits.assign((_levelDots->size() + 7) / 8, 0);
+
+    for (size_t i = 0; i < _levelDots->size(); i++)
+    {
+        _levelDotBits[i / 8] |= (BYTE)(1 << (i % 8));
     }
 
     // Update fruit dot count
@@ -340,6 +522,21 @@ void PlayingMaze::InitDotCount()
     _difficulty.GetFruitDotCount(_dotCount, _nFruitDots[0], _nFruitDots[1]);
 }
 
+// Level dots are in reading order, the same as ForEachDot found them
+void PlayingMaze::ClearLevelDotBit(ff::point_int tile)
+{
+    auto iter = std::lower_bound(_levelDots->begin(), _levelDots->end(), tile, [](const LevelDot& dot, ff::point_int tile)
+        {
+            return dot._tile.y < tile.y || (dot._tile.y == tile.y && dot._tile.x < tile.x);
+        });
+
+    if (iter != _levelDots->end() && iter->_tile == tile)
+    {
+        size_t i = iter - _levelDots->begin();
+        _levelDotBits[i / 8] &= (BYTE)~(1 << (i % 8));
+    }
+}
+
 std::shared_ptr<IRenderMaze> PlayingMaze::GetRenderMaze()
 {
     return _renderMaze;
@@ -350,6 +547,11 @@ const Difficulty& PlayingMaze::GetDifficulty() const
     return _difficulty;
 }
 
+Random& PlayingMaze::GetRandom()
+{
+    return _random;
+}
+
 void PlayingMaze::SetGameState(GameState state)
 {
     bool bLevel = !_host || _host->IsPlayingLevel();
@@ -406,6 +608,11 @@ void PlayingMaze::AddPointDisplay(
     const DirectX::XMFLOAT4& color,
     bool bFades)
 {
+    if (_lookAhead)
+    {
+        return;
+    }
+
     std::shared_ptr<PointActor> point = std::make_shared<PointActor>();
 
     point->SetActive(true);
@@ -434,17 +641,22 @@ void PlayingMaze::AddBubble(IPlayingActor& pac, int maxCount, int spread)
         "bubble-3-anim",
     };
 
-    int count = maxCount - rand() % (maxCount / 2);
+    if (_lookAhead)
+    {
+        return;
+    }
+
+    int count = maxCount - (int)_cosmeticRandom.Next((size_t)(maxCount / 2));
 
     for (int i = 0; i < count; i++)
     {
         ff::point_float pos = (pac.GetPixel() + ff::point_int(
-            rand() % spread - spread / 2,
-            rand() % spread - spread / 2)).cast<float>();
-        float scale = 1.0f + (rand() % 9 - 4) / 12.0f;
-        float timeScale = 1.0f + (rand() % 9 - 4) / 12.0f;
-        float velocity = (rand() % 10) / -100.0f;
-        const char* animName = s_names[rand() % s_names.size()];
+            (int)_cosmeticRandom.Next((size_t)spread) - spread / 2,
+            (int)_cosmeticRandom.Next((size_t)spread) - spread / 2)).cast<float>();
+        float scale = 1.0f + ((int)_cosmeticRandom.Next(9) - 4) / 12.0f;
+        float timeScale = 1.0f + ((int)_cosmeticRandom.Next(9) - 4) / 12.0f;
+        float velocity = _cosmeticRandom.Next(10) / -100.0f;
+        const char* animName = s_names[_cosmeticRandom.Next(s_names.size())];
 
         AddCustomActor(std::make_shared<SpriteAnimActor>(
             animName,
@@ -542,6 +754,7 @@ void PlayingMaze::Advance()
     AdvanceRenderer();
 
     _stateCounter++;
+    _ghostPathsDirty = true;
 }
 
 void PlayingMaze::AdvanceSounds()
@@ -598,7 +811,10 @@ void PlayingMaze::AdvanceRenderer()
         bAdvancePac = false;
     }
 
-    _renderMaze->Advance(bAdvancePac, bAdvanceGhosts, bAdvanceDots, this);
+    if (_renderMaze)
+    {
+        _renderMaze->Advance(bAdvancePac, bAdvanceGhosts, bAdvanceDots, this);
+    }
 }
 
 void PlayingMaze::AdvanceActors()
@@ -613,24 +829,36 @@ void PlayingMaze::AdvanceActors()
         UpdateActorSpeeds();
     }
 
-    // Move ghosts
+    // Move ghosts one step at a time, so every ghost that reaches the middle of a tile during a step can decide
+    // where to go next in one batch
+
+    size_t nSteps = 0;
+    _ghostAdvanceCounts.resize(_ghosts->GetCount());
+
+    for (size_t nGhost = 0; nGhost < _ghosts->GetCount(); nGhost++)
+    {
+        _ghostAdvanceCounts[nGhost] = _ghosts->IsActive(nGhost) ? _ghosts->GetAdvanceCount(nGhost) : 0;
+        nSteps = std::max(nSteps, _ghostAdvanceCounts[nGhost]);
+    }
 
-    for (size_t nGhost = 0; nGhost < _countof(_ghosts); nGhost++)
+    for (size_t nStep = 0; nStep < nSteps; nStep++)
     {
-        GhostActor& ghost = *_ghosts[nGhost];
+        // Every ghost that decides in this step sees where all of them were before any moved,
+        // so a deciding ghost is still in the middle of its tile
+        UpdateGhostSnapshot();
 
-        if (ghost.IsActive())
+        for (size_t nGhost = 0; nGhost < _ghosts->GetCount(); nGhost++)
         {
-            for (size_t i = ghost.GetAdvanceCount(); i > 0; i--)
-            {
-                // Ghost eyes can still move when another ghost was just eaten
+            // Ghost eyes can still move when another ghost was just eaten
 
-                if (!_ghostEatenCountdown || ghost.GetMoveState() == MOVE_EYES)
-                {
-                    AdvanceGhost(ghost);
-                }
+            if (_ghostAdvanceCounts[nGhost] > nStep &&
+                (!_ghostEatenCountdown || _ghosts->GetMoveState(nGhost) == MOVE_EYES))
+            {
+                AdvanceGhost(nGhost);
             }
         }
+
+        DecideQueuedGhosts();
     }
 
     if (!_ghostEatenCountdown)
@@ -657,7 +885,7 @@ void PlayingMaze::AdvanceActors()
         AdvanceCustomActors();
         CheckPacCollisions(*_pac);
 
-        if (ff::constants::debug_build && _pac->IsActive() && ff::input::keyboard().pressing('4'))
+        if (_pac->IsActive() && IsDebugKeyPressed('4'))
         {
             _stats._cheated = true;
 
@@ -742,29 +970,29 @@ void PlayingMaze::AdvancePac(PacActor& pac)
     }
 }
 
-void PlayingMaze::AdvanceGhost(GhostActor& ghost)
+void PlayingMaze::AdvanceGhost(size_t nGhost)
 {
     // Cache info about the ghost
 
-    ff::point_int dir = ghost.GetDir();
-    ff::point_int tile = ghost.GetTile();
-    ff::point_int pixel = ghost.GetPixel();
-    ff::point_int press = ghost.GetPressDir();
+    ff::point_int dir = _ghosts->GetDir(nGhost);
+    ff::point_int tile = _ghosts->GetTile(nGhost);
+    ff::point_int pixel = _ghosts->GetPixel(nGhost);
+    ff::point_int press = _ghosts->GetPressDir(nGhost);
     ff::point_int center = TileCenterToPixel(tile);
 
-    if (ghost.GetHouseState() == HOUSE_INSIDE)
+    if (_ghosts->GetHouseState(nGhost) == HOUSE_INSIDE)
     {
-        if (ghost.GetMoveState() == MOVE_EYES)
+        if (_ghosts->GetMoveState(nGhost) == MOVE_EYES)
         {
             // Move towards the bottom of the house before leaving
 
             ff::point_int target(_ghostStartPixel.x, _ghostHouseRect.bottom);
 
-            if (GhostIndex(ghost) == 2)
+            if (GetGhostPersonality(nGhost) == 2)
             {
                 target.x -= PixelsPerTile().x * 2;
             }
-            else if (GhostIndex(ghost) == 3)
+            else if (GetGhostPersonality(nGhost) == 3)
             {
                 target.x += PixelsPerTile().x * 2;
             }
@@ -780,8 +1008,8 @@ void PlayingMaze::AdvanceGhost(GhostActor& ghost)
             else
             {
                 dir = ff::point_int(0, -1);
-                ghost.SetMoveState(MOVE_NORMAL);
-                ghost.SetHouseState(HOUSE_INSIDE);
+                _ghosts->SetMoveState(nGhost, MOVE_NORMAL);
+                _ghosts->SetHouseState(nGhost, HOUSE_INSIDE);
             }
         }
         else if (pixel.y == _ghostHouseRect.top || pixel.y == _ghostHouseRect.bottom)
@@ -791,7 +1019,7 @@ void PlayingMaze::AdvanceGhost(GhostActor& ghost)
             dir.y = -dir.y;
         }
     }
-    else if (ghost.GetHouseState() == HOUSE_LEAVING)
+    else if (_ghosts->GetHouseState(nGhost) == HOUSE_LEAVING)
     {
         // Move towards the position above the ghost door
 
@@ -805,15 +1033,15 @@ void PlayingMaze::AdvanceGhost(GhostActor& ghost)
         }
         else
         {
-            ghost.SetHouseState(HOUSE_OUTSIDE);
+            _ghosts->SetHouseState(nGhost, HOUSE_OUTSIDE);
             dir = ff::point_int(-1, 0);
         }
     }
-    else if (ghost.GetMoveState() == MOVE_EYES && pixel == _ghostStartPixel)
+    else if (_ghosts->GetMoveState(nGhost) == MOVE_EYES && pixel == _ghostStartPixel)
     {
         // Enter the ghost house
 
-        ghost.SetHouseState(HOUSE_INSIDE);
+        _ghosts->SetHouseState(nGhost, HOUSE_INSIDE);
     }
     else if (pixel == center)
     {
@@ -821,22 +1049,22 @@ void PlayingMaze::AdvanceGhost(GhostActor& ghost)
 
         if (press.x || press.y)
         {
-            ghost.SetDir(dir = press);
+            _ghosts->SetDir(nGhost, dir = press);
             press = ff::point_int(0, 0);
         }
 
-        press = GhostDecidePress(ghost);
+        press = QueueGhostDecision(nGhost);
     }
 
     pixel += dir;
 
-    ghost.SetDir(dir);
-    ghost.SetPressDir(press);
-    ghost.SetPixel(pixel);
-
     // Check for warp tunnel usage
 
-    CheckTunnel(ghost);
+    WrapTunnelPixel(pixel, dir);
+
+    _ghosts->SetDir(nGhost, dir);
+    _ghosts->SetPressDir(nGhost, press);
+    _ghosts->SetPixel(nGhost, pixel);
 }
 
 void PlayingMaze::AdvanceFruit(FruitActor& fruit)
@@ -905,20 +1133,22 @@ void PlayingMaze::UpdateFruitMode()
         _difficulty.GetFruit() != FRUIT_NONE)
     {
         _nCurrentFruit++;
-        _nFruitCounter = _difficulty.GetFruitFrames(_maze->GetCharType());
+        _nFruitCounter = _difficulty.GetFruitFrames(_maze->GetCharType(), _random);
 
         _fruit->SetActive(true);
 
         if (_difficulty.IsFruitMoving(_maze->GetCharType()) && _fruitStartTiles.size())
         {
             // Set the start
-            size_t nFruitStart = (rand() % _fruitStartTiles.size());
+            size_t nFruitStart = _random.Next(_fruitStartTiles.size());
 
             _fruit->SetPixel(TileCenterToPixel(_fruitStartTiles[nFruitStart].first));
             _fruit->SetDir(_fruitStartTiles[nFruitStart].second);
 
             // Set the end
-            _fruit->SetExitTile(_fruitStartTiles[rand() % _fruitStartTiles.size()].first);
+            _fruit->SetExitTile(_fruitStartTiles[_random.Next(_fruitStartTiles.size())].first);
+            std::fill(_fruitChoices.begin(), _fruitChoices.end(), (BYTE)0);
+            MeasureFruitExit();
         }
         else
         {
@@ -930,7 +1160,7 @@ void PlayingMaze::UpdateFruitMode()
 
         if (type == FRUIT_RANDOM)
         {
-            type = (FruitType)(rand() % (FRUIT_RANDOM - FRUIT_0) + FRUIT_0);
+            type = (FruitType)(_random.Next(FRUIT_RANDOM - FRUIT_0) + FRUIT_0);
         }
 
         _fruit->SetType(type);
@@ -950,13 +1180,11 @@ void PlayingMaze::UpdateGhostMode()
         {
             // Reactivate the ghost that was just eaten
 
-            for (size_t i = 0; i < _countof(_ghosts); i++)
+            for (size_t i = 0; i < _ghosts->GetCount(); i++)
             {
-                GhostActor& ghost = *_ghosts[i];
-
-                if (ghost.IsActive() && ghost.GetMoveState() == MOVE_EATEN)
+                if (_ghosts->IsActive(i) && _ghosts->GetMoveState(i) == MOVE_EATEN)
                 {
-                    ghost.SetMoveState(MOVE_EYES);
+                    _ghosts->SetMoveState(i, MOVE_EYES);
                 }
             }
         }
@@ -990,13 +1218,17 @@ void PlayingMaze::UpdateGhostMode()
 
 void PlayingMaze::UpdateGhostHouse()
 {
-    // The red ghost can never stay inside the house
+    // Red ghosts can never stay inside the house, a swarm has more than one
 
-    if (_ghosts[0]->IsActive() &&
-        _ghosts[0]->GetMoveState() == MOVE_NORMAL &&
-        _ghosts[0]->GetHouseState() == HOUSE_INSIDE)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        _ghosts[0]->SetHouseState(HOUSE_LEAVING);
+        if (GetGhostPersonality(i) == 0 &&
+            _ghosts->IsActive(i) &&
+            _ghosts->GetMoveState(i) == MOVE_NORMAL &&
+            _ghosts->GetHouseState(i) == HOUSE_INSIDE)
+        {
+            _ghosts->SetHouseState(i, HOUSE_LEAVING);
+        }
     }
 
     // check if a new ghost should be released
@@ -1026,14 +1258,12 @@ void PlayingMaze::UpdateGhostHouse()
     }
     else
     {
-        for (size_t i = 0; i < _countof(_ghosts); i++)
+        for (size_t i = 0; i < _ghosts->GetCount(); i++)
         {
-            GhostActor& ghost = *_ghosts[i];
-
-            if (ghost.IsActive() &&
-                ghost.GetMoveState() == MOVE_NORMAL &&
-                ghost.GetHouseState() == HOUSE_INSIDE &&
-                !ghost.GetDotCounter())
+            if (_ghosts->IsActive(i) &&
+                _ghosts->GetMoveState(i) == MOVE_NORMAL &&
+                _ghosts->GetHouseState(i) == HOUSE_INSIDE &&
+                !_ghosts->GetDotCounter(i))
             {
                 ReleaseGhost();
                 break;
@@ -1048,22 +1278,20 @@ void PlayingMaze::UpdateActorSpeeds()
 
     _fruit->SetSpeed(_difficulty.GetFruitSpeed());
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        GhostActor& ghost = *_ghosts[i];
-
-        if (ghost.IsActive())
+        if (_ghosts->IsActive(i))
         {
-            TileZone zone = _maze->GetTileZone(ghost.GetTile());
+            TileZone zone = _maze->GetTileZone(_ghosts->GetTile(i));
             bool bTunnel = (zone == ZONE_GHOST_SLOW || zone == ZONE_OUT_OF_BOUNDS);
 
             size_t speed = _difficulty.GetGhostSpeed(
-                ghost.GetMoveState(),
-                ghost.GetHouseState(),
+                _ghosts->GetMoveState(i),
+                _ghosts->GetHouseState(i),
                 bTunnel,
-                !i, _dotCount);
+                GetGhostPersonality(i) == 0, _dotCount);
 
-            ghost.SetSpeed(speed);
+            _ghosts->SetSpeed(i, speed);
         }
     }
 }
@@ -1082,20 +1310,17 @@ static const size_t s_nMaxCollideDist =
 ((PixelsPerTile().x / 2) * (PixelsPerTile().x / 2)) +
 ((PixelsPerTile().y / 2) * (PixelsPerTile().y / 2));
 
-static bool ActorsCollide(PlayingActor& actor1, PlayingActor& actor2)
+static bool PixelsCollide(ff::point_int pixel1, ff::point_int pixel2)
 {
-    if (actor1.IsActive() && actor2.IsActive())
-    {
-        ff::point_int dist = (actor2.GetPixel() - actor1.GetPixel());
-        size_t nDist = dist.x * dist.x + dist.y * dist.y;
+    ff::point_int dist = (pixel2 - pixel1);
+    size_t nDist = dist.x * dist.x + dist.y * dist.y;
 
-        if (nDist < s_nMaxCollideDist)
-        {
-            return true;
-        }
-    }
+    return nDist < s_nMaxCollideDist;
+}
 
-    return false;
+static bool ActorsCollide(PlayingActor& actor1, PlayingActor& actor2)
+{
+    return actor1.IsActive() && actor2.IsActive() && PixelsCollide(actor1.GetPixel(), actor2.GetPixel());
 }
 
 void PlayingMaze::CheckPacCollisions(PacActor& pac)
@@ -1115,6 +1340,7 @@ void PlayingMaze::CheckPacCollisions(PacActor& pac)
     if (content == CONTENT_DOT || content == CONTENT_POWER)
     {
         _maze->SetTileContent(pacTile, CONTENT_NOTHING);
+        ClearLevelDotBit(pacTile);
 
         OnPacEatDot(pac, content == CONTENT_POWER);
     }
@@ -1124,29 +1350,27 @@ void PlayingMaze::CheckPacCollisions(PacActor& pac)
     if (_state != GS_WINNING && // Can't eat the last dot and a ghost at the same time
         !_ghostEatenCountdown) // Can't eat two ghosts at once
     {
-        for (size_t i = 0; i < _countof(_ghosts); i++)
+        for (size_t i = 0; i < _ghosts->GetCount(); i++)
         {
-            GhostActor& ghost = *_ghosts[i];
-
-            if (ghost.IsActive())
+            if (_ghosts->IsActive(i))
             {
-                bool bCollide = ActorsCollide(pac, ghost);
+                bool bCollide = pac.IsActive() && PixelsCollide(pac.GetPixel(), _ghosts->GetPixel(i));
 
-                if (bCollide && ghost.GetMoveState() == MOVE_NORMAL)
+                if (bCollide && _ghosts->GetMoveState(i) == MOVE_NORMAL)
                 {
-                    OnGhostEatPac(pac, ghost);
+                    OnGhostEatPac(pac, i);
                     break;
                 }
-                else if ((bCollide && ghost.GetMoveState() == MOVE_SCARED) ||
-                    ghost.GetMoveState() == MOVE_WAITING_TO_BE_EATEN)
+                else if ((bCollide && _ghosts->GetMoveState(i) == MOVE_SCARED) ||
+                    _ghosts->GetMoveState(i) == MOVE_WAITING_TO_BE_EATEN)
                 {
                     if (!_ghostEatenCountdown)
                     {
-                        OnPacEatGhost(pac, ghost);
+                        OnPacEatGhost(pac, i);
                     }
                     else
                     {
-                        ghost.SetMoveState(MOVE_WAITING_TO_BE_EATEN);
+                        _ghosts->SetMoveState(i, MOVE_WAITING_TO_BE_EATEN);
                     }
                 }
             }
@@ -1156,43 +1380,49 @@ void PlayingMaze::CheckPacCollisions(PacActor& pac)
 
 bool PlayingMaze::CheckTunnel(PlayingActor& actor)
 {
-    ff::point_int dir = actor.GetDir();
-    ff::point_int tile = actor.GetTile();
     ff::point_int pixel = actor.GetPixel();
-    bool bMoved = false;
+
+    if (WrapTunnelPixel(pixel, actor.GetDir()))
+    {
+        if (_host && &actor == _pac.get())
+        {
+            _host->OnPacUsingTunnel();
+        }
+
+        actor.SetPixel(pixel);
+        return true;
+    }
+
+    return false;
+}
+
+bool PlayingMaze::WrapTunnelPixel(ff::point_int& pixel, ff::point_int dir) const
+{
+    ff::point_int tile = PixelAndDirToTile(pixel, dir);
+    ff::point_int size = _maze->GetSizeInTiles();
 
     if (dir.x < 0 && tile.x < -1)
     {
-        pixel.x = TileBottomRightToPixel(_maze->GetSizeInTiles()).x;
-        bMoved = true;
+        pixel.x = TileBottomRightToPixel(size).x;
+        return true;
     }
-    else if (dir.x > 0 && tile.x > _maze->GetSizeInTiles().x)
+    else if (dir.x > 0 && tile.x > size.x)
     {
         pixel.x = -PixelsPerTile().x;
-        bMoved = true;
+        return true;
     }
     else if (dir.y < 0 && tile.y < -1)
     {
-        pixel.y = TileBottomRightToPixel(_maze->GetSizeInTiles()).y;
-        bMoved = true;
+        pixel.y = TileBottomRightToPixel(size).y;
+        return true;
     }
-    else if (dir.y > 0 && tile.y > _maze->GetSizeInTiles().y)
+    else if (dir.y > 0 && tile.y > size.y)
     {
         pixel.y = -PixelsPerTile().y;
-        bMoved = true;
+        return true;
     }
 
-    if (bMoved)
-    {
-        if (_host && &actor == _pac.get())
-        {
-            _host->OnPacUsingTunnel();
-        }
-
-        actor.SetPixel(pixel);
-    }
-
-    return bMoved;
+    return false;
 }
 
 bool PlayingMaze::CheckGhostsScared(bool& scared, bool& eyes) const
@@ -1200,17 +1430,15 @@ bool PlayingMaze::CheckGhostsScared(bool& scared, bool& eyes) const
     scared = false;
     eyes = false;
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        const GhostActor& ghost = *_ghosts[i];
-
-        if (ghost.IsActive())
+        if (_ghosts->IsActive(i))
         {
-            scared |= (ghost.GetMoveState() == MOVE_SCARED ||
-                ghost.GetMoveState() == MOVE_EATEN ||
-                ghost.GetMoveState() == MOVE_WAITING_TO_BE_EATEN);
+            scared |= (_ghosts->GetMoveState(i) == MOVE_SCARED ||
+                _ghosts->GetMoveState(i) == MOVE_EATEN ||
+                _ghosts->GetMoveState(i) == MOVE_WAITING_TO_BE_EATEN);
 
-            eyes |= (ghost.GetMoveState() == MOVE_EYES);
+            eyes |= (_ghosts->GetMoveState(i) == MOVE_EYES);
         }
     }
 
@@ -1221,7 +1449,7 @@ void PlayingMaze::OnPacEatDot(PacActor& pac, bool bPower)
 {
     _lastDotCounter = 0;
 
-    if (ff::constants::debug_build && ff::input::keyboard().pressing('7'))
+    if (IsDebugKeyPressed('7'))
     {
         _stats._cheated = true;
         _dotCount = 1;
@@ -1240,16 +1468,14 @@ void PlayingMaze::OnPacEatDot(PacActor& pac, bool bPower)
     }
     else
     {
-        for (size_t i = 0; i < _countof(_ghosts); i++)
+        for (size_t i = 0; i < _ghosts->GetCount(); i++)
         {
-            GhostActor& ghost = *_ghosts[i];
-
-            if (ghost.IsActive() &&
-                ghost.GetMoveState() == MOVE_NORMAL &&
-                ghost.GetHouseState() == HOUSE_INSIDE &&
-                ghost.GetDotCounter())
+            if (_ghosts->IsActive(i) &&
+                _ghosts->GetMoveState(i) == MOVE_NORMAL &&
+                _ghosts->GetHouseState(i) == HOUSE_INSIDE &&
+                _ghosts->GetDotCounter(i))
             {
-                ghost.SetDotCounter(ghost.GetDotCounter() - 1);
+                _ghosts->SetDotCounter(i, _ghosts->GetDotCounter(i) - 1);
                 break;
             }
         }
@@ -1313,18 +1539,18 @@ void PlayingMaze::OnPacEatFruit(PacActor& pac, FruitActor& fruit)
     fruit.Reset();
 }
 
-void PlayingMaze::OnPacEatGhost(PacActor& pac, GhostActor& ghost)
+void PlayingMaze::OnPacEatGhost(PacActor& pac, size_t nGhost)
 {
-    ghost.SetMoveState(MOVE_EATEN);
+    _ghosts->SetMoveState(nGhost, MOVE_EATEN);
 
     _ghostEatenCountdown = _difficulty.GetEatenFrames();
-    _stats._ghostsEaten[GhostIndex(ghost)]++;
+    _stats._ghostsEaten[GetGhostPersonality(nGhost)]++;
 
     size_t nPoints = _difficulty.GetGhostPoints(_ghostEatenIndex);
     AddPoints(nPoints);
 
     AddPointDisplay(
-        ghost.GetPixel(),
+        _ghosts->GetPixel(nGhost),
         ff::point_float(1, 1),
         nPoints,
         _ghostEatenCountdown,
@@ -1333,49 +1559,27 @@ void PlayingMaze::OnPacEatGhost(PacActor& pac, GhostActor& ghost)
     _ghostEatenIndex++;
 
     PlayEffect(EFFECT_EAT_GHOST);
-    AddBubble(ghost, GHOST_BUBBLE_COUNT, GHOST_BUBBLE_SPREAD);
+    AddBubble(*_ghostActors[nGhost], GHOST_BUBBLE_COUNT, GHOST_BUBBLE_SPREAD);
 }
 
-void PlayingMaze::OnGhostEatPac(PacActor& pac, GhostActor& ghost)
+void PlayingMaze::OnGhostEatPac(PacActor& pac, size_t nGhost)
 {
-    if (ff::constants::debug_build && ff::input::keyboard().pressing('6'))
+    if (IsDebugKeyPressed('6'))
     {
         _stats._cheated = true;
         return;
     }
 
-    _stats._ghostDeathCount[GhostIndex(ghost)]++;
+    _stats._ghostDeathCount[GetGhostPersonality(nGhost)]++;
 
     SetGameState(GS_CAUGHT);
 }
 
-size_t PlayingMaze::GhostIndex(GhostActor& ghost)
+// Lists the tiles a ghost could move to next, in priority order. Returns true when brains need to pick one,
+// otherwise press is already decided.
+bool PlayingMaze::GetGhostChoices(MoveState move, ff::point_int tile, ff::point_int dir, ff::stack_vector<ff::point_int, 4>& tiles, ff::point_int& press)
 {
-    for (size_t i = 0; i < _countof(_ghosts); i++)
-    {
-        if (&ghost == _ghosts[i].get())
-        {
-            return i;
-        }
-    }
-
-    assert(false);
-    return 0;
-}
-
-ff::point_int PlayingMaze::GhostDecidePress(GhostActor& ghost)
-{
-    return GhostDecidePress(
-        ghost.GetBrains(),
-        ghost.GetMoveState(),
-        ghost.GetTile() + ghost.GetDir(),
-        ghost.GetDir());
-}
-
-ff::point_int PlayingMaze::GhostDecidePress(IGhostBrains* brains, MoveState move, ff::point_int tile, ff::point_int dir)
-{
-    ff::point_int press(0, 0);
-    ff::point_int prevTile = tile - dir;
+    press = ff::point_int(0, 0);
     TileZone zone = _maze->GetTileZone(tile);
 
     bool bAllowTurn = (zone != ZONE_OUT_OF_BOUNDS);
@@ -1389,33 +1593,16 @@ ff::point_int PlayingMaze::GhostDecidePress(IGhostBrains* brains, MoveState move
 
     if (bAllowTurn)
     {
-        ff::point_int leftTile = tile + ff::point_int(-1, 0);
-        ff::point_int rightTile = tile + ff::point_int(1, 0);
-        ff::point_int upTile = tile + ff::point_int(0, -1);
-        ff::point_int downTile = tile + ff::point_int(0, 1);
-
-        // Create a list of test tiles in priority order
-
-        ff::stack_vector<ff::point_int, 4> tiles;
+        BYTE exits = (BYTE)(_tiles->GetExits(tile) & ~DirToExit(-dir));
 
-        if (upTile != prevTile && !IsWall(upTile))
-        {
-            tiles.push_back(upTile);
-        }
+        // Create a list of test tiles in priority order, never going back where it came from
 
-        if (leftTile != prevTile && !IsWall(leftTile))
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
         {
-            tiles.push_back(leftTile);
-        }
-
-        if (downTile != prevTile && !IsWall(downTile))
-        {
-            tiles.push_back(downTile);
-        }
-
-        if (rightTile != prevTile && !IsWall(rightTile))
-        {
-            tiles.push_back(rightTile);
+            if (exits & exit)
+            {
+                tiles.push_back(tile + ExitToDir((TileExit)exit));
+            }
         }
 
         if (!tiles.size())
@@ -1430,7 +1617,28 @@ ff::point_int PlayingMaze::GhostDecidePress(IGhostBrains* brains, MoveState move
 
             press = tiles[0] - tile;
         }
-        else if (brains)
+        else
+        {
+            return true;
+        }
+    }
+
+    if (press == dir)
+    {
+        press = ff::point_int(0, 0);
+    }
+
+    return false;
+}
+
+ff::point_int PlayingMaze::GhostDecidePress(IGhostBrains* brains, MoveState move, ff::point_int tile, ff::point_int dir)
+{
+    ff::stack_vector<ff::point_int, 4> tiles;
+    ff::point_int press;
+
+    if (GetGhostChoices(move, tile, dir, tiles, press))
+    {
+        if (brains)
         {
             // Need to use brains to decide which way to go
 
@@ -1444,39 +1652,160 @@ ff::point_int PlayingMaze::GhostDecidePress(IGhostBrains* brains, MoveState move
             {
                 // Poorly design AI, doesn't do what I ask of it
 
-                press = tiles[rand() % tiles.size()] - tile;
+                press = tiles[_random.Next(tiles.size())] - tile;
             }
         }
         else
         {
             // No brains, just use random selection
 
-            press = tiles[rand() % tiles.size()] - tile;
+            press = tiles[_random.Next(tiles.size())] - tile;
+        }
+
+        if (press == dir)
+        {
+            press = ff::point_int(0, 0);
         }
     }
 
-    if (press == dir)
+    return press;
+}
+
+// Ghosts with real choices wait for DecideQueuedGhosts, the rest get their press right away
+ff::point_int PlayingMaze::QueueGhostDecision(size_t nGhost)
+{
+    ff::point_int dir = _ghosts->GetDir(nGhost);
+    ff::point_int tile = _ghosts->GetTile(nGhost) + dir;
+    ff::stack_vector<ff::point_int, 4> tiles;
+    ff::point_int press;
+
+    if (GetGhostChoices(_ghosts->GetMoveState(nGhost), tile, dir, tiles, press))
     {
-        press = ff::point_int(0, 0);
+        GhostDecision decision{};
+        decision._ghost = nGhost;
+        decision._tile = tile;
+        decision._choiceCount = tiles.size();
+        std::copy(tiles.begin(), tiles.end(), decision._choices);
+
+        _ghostDecisions.push_back(decision);
     }
 
     return press;
 }
 
-void PlayingMaze::FlipGhosts()
+void PlayingMaze::DecideQueuedGhosts()
 {
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    if (_ghostDecisions.empty())
     {
-        GhostActor& ghost = *_ghosts[i];
+        return;
+    }
+
+    DecideGhosts(_ghostSnapshot, _ghostDecisions.data(), _ghostDecisions.size(), _random);
+
+    for (const GhostDecision& decision : _ghostDecisions)
+    {
+        ff::point_int press = decision._result - decision._tile;
+
+        _ghosts->SetPressDir(decision._ghost, (press != _ghosts->GetDir(decision._ghost)) ? press : ff::point_int(0, 0));
+    }
+
+    _ghostDecisions.clear();
+}
+
+void PlayingMaze::UpdateGhostSnapshot()
+{
+    GhostSnapshot& snapshot = _ghostSnapshot;
+    size_t nCount = _ghosts->GetCount();
+
+    snapshot._pacPixel = _pac->GetPixel();
+    snapshot._pacDir = _pac->GetDir();
+    snapshot._mazeSize = _maze->GetSizeInTiles();
+    snapshot._ghostStartPixel = _ghostStartPixel;
+    snapshot._randomScatter = _difficulty.HasRandomGhostMovement(GetCharType());
+    snapshot._personalities = _difficulty._personalities;
+    snapshot._distances = _difficulty.UsesPathTargeting() ? &_maze->GetDistances() : nullptr;
+    snapshot._houseFlowField = &_maze->GetHouseFlowField();
+    snapshot._ghostPixels.resize(nCount);
+    snapshot._ghostStates.resize(nCount);
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        snapshot._ghostPixels[i] = _ghosts->GetPixel(i);
+        snapshot._ghostStates[i] = GetGhostState(i);
+    }
+}
+
+// Only ghosts following a target get a path. Each one only predicts past the point where its old path stopped
+// matching where it really is, or all over again when its target tile moved.
+void PlayingMaze::UpdateGhostPaths()
+{
+    _ghostPathsDirty = false;
+    _ghostPaths.BeginUpdate();
+
+    UpdateGhostSnapshot();
+
+    // Predictions use a copy of the gameplay stream, looking ahead must never change the game
+    Random random = _random;
+    ff::point_int targetPixel;
+
+    auto step = [this, &targetPixel](ff::point_int tile, ff::point_int dir)
+        {
+            ff::stack_vector<ff::point_int, 4> tiles;
+            ff::point_int press;
+
+            if (GetGhostChoices(MOVE_NORMAL, tile, dir, tiles, press))
+            {
+                ff::point_int choice = _ghostSnapshot._distances
+                    ? DecideForPathTarget(*_ghostSnapshot._distances, targetPixel, tiles.data(), tiles.size())
+                    : DecideForTarget(targetPixel, tiles.data(), tiles.size());
+
+                press = choice - tile;
+            }
+
+            return (press.x || press.y) ? press : dir;
+        };
+
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
+    {
+        GhostState state = _ghostSnapshot._ghostStates[i];
+
+        if ((state == GHOST_CHASE || state == GHOST_SCATTER) && _ghosts->GetHouseState(i) == HOUSE_OUTSIDE)
+        {
+            targetPixel = GetGhostTargetPixel(_ghostSnapshot, i, random);
+            _ghostPaths.Update(i, _ghosts->GetTile(i), GetGhostLeaveDir(i), PixelToTile(targetPixel), step);
+        }
+        else
+        {
+            _ghostPaths.Invalidate(i);
+        }
+    }
+
+    _ghostPaths.EndUpdate();
+}
+
+// Until a ghost reaches the middle of its tile, the turn it already decided on is still waiting in its press dir
+ff::point_int PlayingMaze::GetGhostLeaveDir(size_t nGhost) const
+{
+    ff::point_int dir = _ghosts->GetDir(nGhost);
+    ff::point_int press = _ghosts->GetPressDir(nGhost);
+    ff::point_int toCenter = TileCenterToPixel(_ghosts->GetTile(nGhost)) - _ghosts->GetPixel(nGhost);
+    bool bBeforeCenter = (toCenter.x * dir.x + toCenter.y * dir.y >= 0);
+
+    return (bBeforeCenter && (press.x || press.y)) ? press : dir;
+}
 
-        if (ghost.IsActive() &&
-            ghost.GetMoveState() != MOVE_EYES &&
-            ghost.GetMoveState() != MOVE_EATEN &&
-            ghost.GetMoveState() != MOVE_WAITING_TO_BE_EATEN &&
-            ghost.GetHouseState() == HOUSE_OUTSIDE)
+void PlayingMaze::FlipGhosts()
+{
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
+    {
+        if (_ghosts->IsActive(i) &&
+            _ghosts->GetMoveState(i) != MOVE_EYES &&
+            _ghosts->GetMoveState(i) != MOVE_EATEN &&
+            _ghosts->GetMoveState(i) != MOVE_WAITING_TO_BE_EATEN &&
+            _ghosts->GetHouseState(i) == HOUSE_OUTSIDE)
         {
-            ff::point_int dir = ghost.GetDir();
-            ghost.SetPressDir(-dir);
+            ff::point_int dir = _ghosts->GetDir(i);
+            _ghosts->SetPressDir(i, -dir);
         }
     }
 }
@@ -1494,22 +1823,20 @@ void PlayingMaze::ScareGhosts(bool bScared)
 
     if (!bScared || _ghostScaredCountdown)
     {
-        for (size_t i = 0; i < _countof(_ghosts); i++)
+        for (size_t i = 0; i < _ghosts->GetCount(); i++)
         {
-            GhostActor& ghost = *_ghosts[i];
-
-            if (ghost.IsActive())
+            if (_ghosts->IsActive(i))
             {
-                if (bScared && ghost.GetMoveState() == MOVE_NORMAL)
+                if (bScared && _ghosts->GetMoveState(i) == MOVE_NORMAL)
                 {
-                    ghost.SetMoveState(MOVE_SCARED);
+                    _ghosts->SetMoveState(i, MOVE_SCARED);
                 }
                 else if (!bScared &&
-                    ghost.GetMoveState() != MOVE_EYES &&
-                    ghost.GetMoveState() != MOVE_EATEN &&
-                    ghost.GetMoveState() != MOVE_WAITING_TO_BE_EATEN)
+                    _ghosts->GetMoveState(i) != MOVE_EYES &&
+                    _ghosts->GetMoveState(i) != MOVE_EATEN &&
+                    _ghosts->GetMoveState(i) != MOVE_WAITING_TO_BE_EATEN)
                 {
-                    ghost.SetMoveState(MOVE_NORMAL);
+                    _ghosts->SetMoveState(i, MOVE_NORMAL);
                 }
             }
         }
@@ -1518,15 +1845,13 @@ void PlayingMaze::ScareGhosts(bool bScared)
 
 bool PlayingMaze::ReleaseGhost()
 {
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        GhostActor& ghost = *_ghosts[i];
-
-        if (ghost.IsActive() &&
-            ghost.GetMoveState() == MOVE_NORMAL &&
-            ghost.GetHouseState() == HOUSE_INSIDE)
+        if (_ghosts->IsActive(i) &&
+            _ghosts->GetMoveState(i) == MOVE_NORMAL &&
+            _ghosts->GetHouseState(i) == HOUSE_INSIDE)
         {
-            ghost.SetHouseState(HOUSE_LEAVING);
+            _ghosts->SetHouseState(i, HOUSE_LEAVING);
 
             _lastDotCounter = 0;
 
@@ -1541,13 +1866,11 @@ size_t PlayingMaze::CountGhostsInHouse()
 {
     size_t nCount = 0;
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    for (size_t i = 0; i < _ghosts->GetCount(); i++)
     {
-        GhostActor& ghost = *_ghosts[i];
-
-        if (ghost.IsActive() &&
-            ghost.GetMoveState() == MOVE_NORMAL &&
-            ghost.GetHouseState() == HOUSE_INSIDE)
+        if (_ghosts->IsActive(i) &&
+            _ghosts->GetMoveState(i) == MOVE_NORMAL &&
+            _ghosts->GetHouseState(i) == HOUSE_INSIDE)
         {
             nCount++;
         }
@@ -1556,86 +1879,149 @@ size_t PlayingMaze::CountGhostsInHouse()
     return nCount;
 }
 
-class CFruitBrains : public IGhostBrains
+// Wanders randomly until it's time to leave, then follows the exit distances. Either way, it never takes the same
+// way out of a junction twice, so it can't go around in circles forever.
+ff::point_int PlayingMaze::FruitDecideDir(FruitActor& fruit)
 {
-public:
-    virtual ff::point_int Decide(IPlayingMaze* pPlay, const ff::point_int* pTiles, size_t nTiles) override;
-    virtual ff::point_int GetTargetPixel(IPlayingMaze* pPlay) override;
-
-private:
-    std::vector<std::pair<ff::point_int, ff::point_int>> _chosenRandom;
-    std::vector<std::pair<ff::point_int, ff::point_int>> _chosenExit;
-};
+    ff::stack_vector<ff::point_int, 4> tiles;
+    ff::point_int tile = fruit.GetTile();
+    ff::point_int dir = fruit.GetDir();
+    ff::point_int press;
 
-ff::point_int CFruitBrains::Decide(IPlayingMaze* pPlay, const ff::point_int* pTiles, size_t nTiles)
-{
-    assert_ret_val(pPlay && pTiles && nTiles, ff::point_int(0, 0));
+    if (GetGhostChoices(MOVE_SCARED, tile, dir, tiles, press))
+    {
+        bool bExiting = (GetFruitState() == FRUIT_EXITING);
+        size_t nNode = _maze->GetGraph().GetNodeIndex(tile);
+        BYTE* pChosen = (nNode < _fruitChoices.size()) ? &_fruitChoices[nNode] : nullptr;
+        ff::point_int choices[4];
+        size_t nChoices = tiles.size();
 
-    std::vector<ff::point_int> tiles;
-    tiles.insert(tiles.end(), pTiles, pTiles + nTiles);
+        std::copy(tiles.begin(), tiles.end(), choices);
 
-    while (tiles.size())
-    {
-        bool bExiting = (pPlay->GetFruitState() == FRUIT_EXITING);
+        while (nChoices)
+        {
+            size_t nChoice = bExiting ? FruitExitChoice(choices, nChoices) : _random.Next(nChoices);
+            ff::point_int choiceDir = choices[nChoice] - tile;
+            BYTE chosenBit = (BYTE)(DirToExit(choiceDir) << (bExiting ? 4 : 0));
 
-        // Either go towards the exit, or pick a random tile
-        ff::point_int tile = bExiting
-            ? DecideForTarget(GetTargetPixel(pPlay), tiles.data(), tiles.size())
-            : tiles[rand() % tiles.size()];
+            if ((pChosen && (*pChosen & chosenBit)) || (!bExiting && _maze->GetTileZone(choices[nChoice]) == ZONE_GHOST_SLOW))
+            {
+                // Bad choice, try again
+                std::copy(choices + nChoice + 1, choices + nChoices, choices + nChoice);
+                nChoices--;
+            }
+            else
+            {
+                if (pChosen)
+                {
+                    *pChosen |= chosenBit;
+                }
 
-        std::pair<ff::point_int, ff::point_int> choice(pPlay->GetFruit()->GetTile(), tile);
+                press = choiceDir;
+                break;
+            }
+        }
 
-        // See if the current choice has been made already
-        std::vector<std::pair<ff::point_int, ff::point_int>>& chosen = bExiting ? _chosenExit : _chosenRandom;
+        if (!nChoices)
+        {
+            // All choices have been made already, fall back to a random one
+            press = tiles[_random.Next(tiles.size())] - tile;
+        }
 
-        auto iter = std::find(chosen.begin(), chosen.end(), choice);
-        if (iter != chosen.end() || (!bExiting && pPlay->GetMaze()->GetTileZone(tile) == ZONE_GHOST_SLOW))
+        if (press == dir)
         {
-            // Bad choice, try again
+            press = ff::point_int(0, 0);
+        }
+    }
+
+    return (press.x || press.y) ? press : dir;
+}
 
-            tiles.erase(std::find(tiles.begin(), tiles.end(), tile));
+// The choice closest to the exit, in priority order when they're tied
+size_t PlayingMaze::FruitExitChoice(const ff::point_int* pTiles, size_t nTiles) const
+{
+    size_t nBest = ff::constants::invalid_unsigned<size_t>();
+    uint32_t nBestDist = NO_FRUIT_EXIT_DISTANCE;
+    ff::point_int size = _tiles->GetSize();
+
+    for (size_t i = 0; i < nTiles; i++)
+    {
+        ff::point_int tile = pTiles[i];
+        uint32_t nDist = NO_FRUIT_EXIT_DISTANCE;
+
+        if (tile == _fruit->GetExitTile())
+        {
+            nDist = 0;
         }
-        else
+        else if (tile.x >= 0 && tile.x < size.x && tile.y >= 0 && tile.y < size.y && !_fruitExitDistances.empty())
         {
-            chosen.push_back(choice);
+            nDist = _fruitExitDistances[tile.y * size.x + tile.x];
+        }
 
-            return tile;
+        if (nDist < nBestDist)
+        {
+            nBest = i;
+            nBestDist = nDist;
         }
     }
 
-    // All choices have been made already, fall back to a random tile
+    if (nBest == ff::constants::invalid_unsigned<size_t>())
+    {
+        // Can't get there from here, so just head that way
+        ff::point_int bestTile = DecideForTarget(TileCenterToPixel(_fruit->GetExitTile()), pTiles, nTiles);
+        nBest = std::find(pTiles, pTiles + nTiles, bestTile) - pTiles;
+    }
 
-    return pTiles[rand() % nTiles];
+    return (nBest < nTiles) ? nBest : 0;
 }
 
-ff::point_int CFruitBrains::GetTargetPixel(IPlayingMaze* pPlay)
+// Measures the way out once when the fruit shows up, into memory kept from the last fruit
+void PlayingMaze::MeasureFruitExit()
 {
-    assert_ret_val(pPlay, ff::point_int(0, 0));
+    ff::point_int size = _tiles->GetSize();
+    ff::point_int exitTile = _fruit->GetExitTile();
+    ff::point_int edgeTile(std::clamp(exitTile.x, 0, size.x - 1), std::clamp(exitTile.y, 0, size.y - 1));
 
-    return TileCenterToPixel(pPlay->GetFruitExitTile());
-}
+    _fruitExitDistancesTile = exitTile;
+    _fruitExitDistances.resize((size_t)size.x * (size_t)size.y);
+    std::fill(_fruitExitDistances.begin(), _fruitExitDistances.end(), NO_FRUIT_EXIT_DISTANCE);
+    _fruitExitQueue.clear();
 
-ff::point_int PlayingMaze::FruitDecideDir(FruitActor& fruit)
-{
-    if (!fruit.GetBrains())
+    if (!_tiles->IsWall(edgeTile))
     {
-        std::shared_ptr<CFruitBrains> brains = std::make_shared<CFruitBrains>();
-        fruit.SetBrains(brains);
+        _fruitExitDistances[edgeTile.y * size.x + edgeTile.x] = 1;
+        _fruitExitQueue.push_back(edgeTile);
     }
 
-    ff::point_int dir = GhostDecidePress(fruit.GetBrains(), MOVE_SCARED, fruit.GetTile(), fruit.GetDir());
+    // Doesn't wrap around, since fruit that goes into any tunnel is gone
+
+    for (size_t nQueue = 0; nQueue < _fruitExitQueue.size(); nQueue++)
+    {
+        ff::point_int tile = _fruitExitQueue[nQueue];
+        uint32_t nNextDist = _fruitExitDistances[tile.y * size.x + tile.x] + 1;
+        BYTE exits = _tiles->GetExits(tile);
+
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            ff::point_int nextTile = tile + ExitToDir((TileExit)exit);
+
+            if ((exits & exit) && nextTile.x >= 0 && nextTile.x < size.x && nextTile.y >= 0 && nextTile.y < size.y)
+            {
+                uint32_t& nDist = _fruitExitDistances[nextTile.y * size.x + nextTile.x];
 
-    return (dir.x || dir.y) ? dir : fruit.GetDir();
+                if (nDist == NO_FRUIT_EXIT_DISTANCE)
+                {
+                    nDist = nNextDist;
+                    _fruitExitQueue.push_back(nextTile);
+                }
+            }
+        }
+    }
 }
 
 bool PlayingMaze::IsWall(ff::point_int tile)
 {
-    TileContent content = _maze->GetTileContent(tile);
-
-    return
-        content == CONTENT_WALL ||
-        content == CONTENT_GHOST_WALL ||
-        content == CONTENT_GHOST_DOOR;
+    return _tiles->IsWall(tile);
 }
 
 bool PlayingMaze::HitWall(ff::point_int tile, ff::point_int dir)
@@ -1643,8 +2029,16 @@ bool PlayingMaze::HitWall(ff::point_int tile, ff::point_int dir)
     return IsWall(tile + dir);
 }
 
+// Look-ahead copies and headless games don't have a keyboard
+bool PlayingMaze::IsDebugKeyPressed(int vk) const
+{
+    return ff::constants::debug_build && !_lookAhead && !IsHeadless() && ff::input::keyboard().pressing(vk);
+}
+
 void PlayingMaze::Render(ff::dxgi::draw_base& draw)
 {
+    assert_ret(_renderMaze);
+
     bool bRenderPac = (_state >= GS_READY && !_ghostEatenCountdown);
     bool bRenderGhosts = (_state >= GS_READY && (_state <= GS_CAUGHT));
     bool bRenderCustom = bRenderGhosts;
@@ -1670,7 +2064,7 @@ void PlayingMaze::Render(ff::dxgi::draw_base& draw)
             _renderMaze->RenderPoints(draw, this);
         }
 
-        if (ff::constants::debug_build && ff::input::keyboard().pressing('5'))
+        if (IsDebugKeyPressed('5'))
         {
             _stats._cheated = true;
 
@@ -1686,16 +2080,19 @@ void PlayingMaze::Reset()
 {
     // Reset the state of any animations
 
-    _renderMaze->Reset();
+    if (_renderMaze)
+    {
+        _renderMaze->Reset();
+    }
 
     // Reset each actor
     {
         _pac->Reset();
         _fruit->Reset();
 
-        for (size_t i = 0; i < _countof(_ghosts); i++)
+        for (size_t i = 0; i < _ghosts->GetCount(); i++)
         {
-            _ghosts[i]->Reset();
+            _ghosts->Reset(i);
         }
 
         _points.clear();
@@ -1715,71 +2112,272 @@ void PlayingMaze::Reset()
 
     InitActorPositions();
 
+    _ghostPaths.Clear();
+    _ghostPathsDirty = true;
+
     SetGameState(GS_READY);
 }
 
-void PlayingMaze::RenderDebugGhostPaths(ff::dxgi::draw_base& draw)
+std::shared_ptr<IPlayingMaze> PlayingMaze::Clone() const
 {
-    if constexpr (!ff::constants::debug_build)
+    std::shared_ptr<PlayingMaze> clone = std::make_shared<PlayingMaze>(*this);
+    clone->_lookAhead = true;
+    clone->_host = nullptr;
+    clone->_renderMaze = nullptr;
+    clone->_renderText = nullptr;
+    clone->_sound = nullptr;
+
+    // Eating dots only changes the copy's tiles, so it keeps sharing the measurements
+
+    clone->_maze = _maze->Clone(false);
+    clone->_tiles = &clone->_maze->GetTiles();
+
+    // Actors are shared pointers, so they need their own copies too
+
+    clone->_pac = std::make_shared<PacActor>(*_pac);
+    clone->_fruit = std::make_shared<FruitActor>(*_fruit);
+    clone->_ghosts = std::make_shared<GhostStates>(*_ghosts);
+    clone->_ghostActors.clear();
+
+    for (size_t i = 0; i < clone->_ghosts->GetCount(); i++)
     {
-        return;
+        clone->_ghostActors.push_back(std::make_shared<GhostActor>(clone->_ghosts, i));
     }
 
-    for (size_t i = 0; i < _countof(_ghosts); i++)
+    // Points and bubbles don't change the game
+    clone->_points.clear();
+    clone->_customs.clear();
+
+    return clone;
+}
+
+size_t PlayingMaze::GetSnapshotSize() const
+{
+    return sizeof(PlayingMazeSnapshot) +
+        _ghosts->GetCount() * sizeof(ActorSnapshot) +
+        _fruitChoices.size() +
+        (_levelDots->size() + 7) / 8;
+}
+
+bool PlayingMaze::SaveSnapshot(BYTE* pData, size_t nSize) const
+{
+    size_t nSnapshotSize = GetSnapshotSize();
+    assert_ret_val(pData && nSize >= nSnapshotSize, false);
+
+    // Zeroed first so that the same game always saves the same bytes
+
+    PlayingMazeSnapshot snapshot;
+    ::ZeroMemory(&snapshot, sizeof(snapshot));
+
+    snapshot._magic = PlayingMazeSnapshot::MAGIC;
+    snapshot._version = PlayingMazeSnapshot::VERSION;
+    snapshot._size = (uint32_t)nSnapshotSize;
+    snapshot._ghosts = (uint32_t)_ghosts->GetCount();
+    snapshot._nodes = (uint32_t)_fruitChoices.size();
+    snapshot._levelDots = (uint32_t)_levelDots->size();
+    snapshot._mazeSize = _tiles->GetSize();
+
+    ::SaveStats(_stats, snapshot._stats);
+    ::SaveRandom(_random, snapshot._random);
+    ::SaveRandom(_cosmeticRandom, snapshot._cosmeticRandom);
+    _pac->SaveSnapshot(snapshot._pac);
+    _fruit->SaveSnapshot(snapshot._fruit);
+
+    snapshot._state = (uint32_t)_state;
+    snapshot._stateCounter = (uint32_t)_stateCounter;
+    snapshot._dotCount = (uint32_t)_dotCount;
+    snapshot._dotCountTotal = (uint32_t)_dotCountTotal;
+    snapshot._lastDotCounter = (uint32_t)_lastDotCounter;
+    snapshot._globalDotIndex = (uint32_t)_globalDotIndex;
+    snapshot._globalDotCounter = (uint32_t)_globalDotCounter;
+    snapshot._dotEffect = (uint32_t)_dotEffect;
+    snapshot._ghostCount = (uint32_t)_ghostCount;
+    snapshot._ghostScatterCountdown = (uint32_t)_ghostScatterCountdown;
+    snapshot._ghostScaredCountdown = (uint32_t)_ghostScaredCountdown;
+    snapshot._ghostChaseCountdown = (uint32_t)_ghostChaseCountdown;
+    snapshot._ghostEatenCountdown = (uint32_t)_ghostEatenCountdown;
+    snapshot._ghostEatenIndex = (uint32_t)_ghostEatenIndex;
+    snapshot._ghostScatterChaseIndex = (uint32_t)_ghostScatterChaseIndex;
+    snapshot._fruitCounter = (uint32_t)_nFruitCounter;
+    snapshot._currentFruit = (uint32_t)_nCurrentFruit;
+    snapshot._fruitDots[0] = (uint32_t)_nFruitDots[0];
+    snapshot._fruitDots[1] = (uint32_t)_nFruitDots[1];
+
+    BYTE* pWrite = pData;
+    ::CopyMemory(pWrite, &snapshot, sizeof(snapshot));
+    pWrite += sizeof(snapshot);
+
+    for (size_t i = 0; i < _ghosts->GetCount(); i++, pWrite += sizeof(ActorSnapshot))
+    {
+        ActorSnapshot ghost;
+        _ghosts->SaveSnapshot(i, ghost);
+        ::CopyMemory(pWrite, &ghost, sizeof(ghost));
+    }
+
+    if (_fruitChoices.size())
     {
-        GhostActor& ghost = *_ghosts[i];
+        ::CopyMemory(pWrite, _fruitChoices.data(), _fruitChoices.size());
+        pWrite += _fruitChoices.size();
+    }
+
+    // Eating dots is the only way that tiles change while playing
+
+    ::CopyMemory(pWrite, _levelDotBits.data(), _levelDotBits.size());
 
-        if (ghost.IsActive() &&
-            ghost.GetMoveState() == MOVE_NORMAL &&
-            ghost.GetHouseState() == HOUSE_OUTSIDE &&
-            ghost.GetBrains())
+    return true;
+}
+
+bool PlayingMaze::LoadSnapshot(const BYTE* pData, size_t nSize)
+{
+    PlayingMazeSnapshot snapshot;
+    check_ret_val(pData && nSize >= sizeof(snapshot), false);
+    ::CopyMemory(&snapshot, pData, sizeof(snapshot));
+
+    // Could be an old file or from a different level
+
+    check_ret_val(snapshot._magic == PlayingMazeSnapshot::MAGIC &&
+        snapshot._version == PlayingMazeSnapshot::VERSION &&
+        snapshot._size == GetSnapshotSize() &&
+        snapshot._size <= nSize &&
+        snapshot._ghosts == _ghosts->GetCount() &&
+        snapshot._nodes == _fruitChoices.size() &&
+        snapshot._levelDots == _levelDots->size() &&
+        snapshot._mazeSize == _tiles->GetSize() &&
+        ::IsValidRandom(snapshot._random) &&
+        ::IsValidRandom(snapshot._cosmeticRandom), false);
+
+    ::LoadStats(snapshot._stats, _stats);
+    ::LoadRandom(snapshot._random, _random);
+    ::LoadRandom(snapshot._cosmeticRandom, _cosmeticRandom);
+    _pac->LoadSnapshot(snapshot._pac);
+    _fruit->LoadSnapshot(snapshot._fruit);
+
+    _state = (GameState)snapshot._state;
+    _stateCounter = snapshot._stateCounter;
+    _dotCount = snapshot._dotCount;
+    _dotCountTotal = snapshot._dotCountTotal;
+    _lastDotCounter = snapshot._lastDotCounter;
+    _globalDotIndex = snapshot._globalDotIndex;
+    _globalDotCounter = snapshot._globalDotCounter;
+    _dotEffect = snapshot._dotEffect;
+    _ghostCount = snapshot._ghostCount;
+    _ghostScatterCountdown = snapshot._ghostScatterCountdown;
+    _ghostScaredCountdown = snapshot._ghostScaredCountdown;
+    _ghostChaseCountdown = snapshot._ghostChaseCountdown;
+    _ghostEatenCountdown = snapshot._ghostEatenCountdown;
+    _ghostEatenIndex = snapshot._ghostEatenIndex;
+    _ghostScatterChaseIndex = snapshot._ghostScatterChaseIndex;
+    _nFruitCounter = snapshot._fruitCounter;
+    _nCurrentFruit = snapshot._currentFruit;
+    _nFruitDots[0] = snapshot._fruitDots[0];
+    _nFruitDots[1] = snapshot._fruitDots[1];
+
+    const BYTE* pRead = pData + sizeof(snapshot);
+
+    for (size_t i = 0; i < _ghosts->GetCount(); i++, pRead += sizeof(ActorSnapshot))
+    {
+        ActorSnapshot ghost;
+        ::CopyMemory(&ghost, pRead, sizeof(ghost));
+        _ghosts->LoadSnapshot(i, ghost);
+    }
+
+    if (_fruitChoices.size())
+    {
+        ::CopyMemory(_fruitChoices.data(), pRead, _fruitChoices.size());
+        pRead += _fruitChoices.size();
+    }
+
+    // Only touch the dots that are different, one at a time like eating them. Batched changes would make the
+    // graph and flow field listeners rebuild everything.
+
+    for (size_t i = 0; i < _levelDots->size(); i++)
+    {
+        const LevelDot& dot = (*_levelDots)[i];
+        TileContent content = (pRead[i / 8] & (1 << (i % 8))) ? dot._content : CONTENT_NOTHING;
+
+        if (_tiles->GetContent(dot._tile) != content)
         {
-            ff::point_int tile = ghost.GetTile();
-            ff::point_int dir = ghost.GetDir();
-            ff::point_float lineOffset = ff::point_float((float)i - 2, (float)i - 2);
+            _maze->SetTileContent(dot._tile, content);
+        }
+    }
 
-            ff::point_float points[35];
-            points[0] = TileCenterToPixelF(tile) + lineOffset;
+    ::CopyMemory(_levelDotBits.data(), pRead, _levelDotBits.size());
 
-            for (size_t h = 1; h < _countof(points); h++)
-            {
-                ff::point_int press = GhostDecidePress(ghost.GetBrains(), ghost.GetMoveState(), tile, dir);
+    // Everything else comes from what was just loaded
 
-                if (press.x || press.y)
-                {
-                    dir = press;
-                }
+    if (_fruit->IsActive() &&
+        _difficulty.IsFruitMoving(_maze->GetCharType()) &&
+        (_fruitExitDistances.empty() || _fruit->GetExitTile() != _fruitExitDistancesTile))
+    {
+        MeasureFruitExit();
+    }
 
-                tile += dir;
-                points[h] = TileCenterToPixelF(tile) + lineOffset;
-            }
+    _ghostPaths.Clear();
+    _ghostPathsDirty = true;
+    _points.clear();
+    _customs.clear();
+
+    return true;
+}
+
+void PlayingMaze::RenderDebugGhostPaths(ff::dxgi::draw_base& draw)
+{
+    if constexpr (!ff::constants::debug_build)
+    {
+        return;
+    }
 
-            DirectX::XMFLOAT4 color(1, 1, 1, 1);
-            color.w = 0.5f;
+    const GhostPaths& paths = *GetGhostPaths();
+    ff::point_int mazePixels = TileTopLeftToPixel(_maze->GetSizeInTiles());
 
-            ff::point_int target = ghost.GetBrains()->GetTargetPixel(this);
+    for (size_t i = 0; i < paths.GetCount(); i++)
+    {
+        size_t nTiles = paths.GetTileCount(i);
+        const ff::point_int* pTiles = paths.GetTiles(i);
 
-            target.x = std::max(target.x, 0);
-            target.x = std::min(target.x, TileTopLeftToPixel(_maze->GetSizeInTiles()).x);
+        if (!nTiles)
+        {
+            continue;
+        }
 
-            target.y = std::max(target.y, 0);
-            target.y = std::min(target.y, TileTopLeftToPixel(_maze->GetSizeInTiles()).y);
+        float offset = (float)GetGhostPersonality(i) - 2;
+        ff::point_float lineOffset(offset, offset);
 
-            ff::point_float targetF((float)target.x, (float)target.y);
+        DirectX::XMFLOAT4 color(1, 1, 1, 1);
+        color.w = 0.5f;
 
-            draw.draw_rectangle(ff::rect_float(targetF - PixelsPerTileF() / 2.0f, targetF + PixelsPerTileF() / 2.0f), color);
+        ff::point_int target = TileCenterToPixel(paths.GetTargetTile(i));
 
-            for (size_t h = 0; h < _countof(points) - 1; h++)
-            {
-                DirectX::XMStoreFloat4(&color,
-                    DirectX::XMVectorSubtract(
-                        DirectX::XMLoadFloat4(&color),
-                        DirectX::XMVectorSet(0, 0, 0, 0.019231f)));
+        target.x = std::max(target.x, 0);
+        target.x = std::min(target.x, mazePixels.x);
 
-                draw.draw_line(points[h], points[h + 1], color, 1);
-            }
+        target.y = std::max(target.y, 0);
+        target.y = std::min(target.y, mazePixels.y);
+
+        ff::point_float targetF((float)target.x, (float)target.y);
+
+        draw.draw_rectangle(ff::rect_float(targetF - PixelsPerTileF() / 2.0f, targetF + PixelsPerTileF() / 2.0f), color);
+
+        for (size_t h = 0; h + 1 < nTiles; h++)
+        {
+            DirectX::XMStoreFloat4(&color,
+                DirectX::XMVectorSubtract(
+                    DirectX::XMLoadFloat4(&color),
+                    DirectX::XMVectorSet(0, 0, 0, 0.019231f)));
+
+            draw.draw_line(TileCenterToPixelF(pTiles[h]) + lineOffset, TileCenterToPixelF(pTiles[h + 1]) + lineOffset, color, 1);
         }
     }
+
+    const GhostPathCost& cost = paths.GetCost();
+    std::string text = ff::string::concat(
+        "PATHS:", std::to_string(cost._ghosts),
+        " KEPT:", std::to_string(cost._tilesReused),
+        " NEW:", std::to_string(cost._tilesPredicted),
+        " ", std::to_string(cost._microseconds), "US");
+
+    DirectX::XMFLOAT4 textColor(1, 1, 1, 1);
+    _renderText->DrawText(draw, text.c_str(), ff::point_float(0, 0), 0, &textColor, nullptr, nullptr);
 }
 
 GameState PlayingMaze::GetGameState() const
@@ -1835,25 +2433,23 @@ bool PlayingMaze::IsPowerPac() const
 
 size_t PlayingMaze::GetGhostCount() const
 {
-    return _countof(_ghosts);
+    return _ghosts->GetCount();
 }
 
 ff::point_int PlayingMaze::GetGhostEyeDir(size_t nGhost) const
 {
     assert_ret_val(nGhost >= 0 && nGhost < GetGhostCount(), ff::point_int(0, 0));
 
-    const GhostActor& ghost = *_ghosts[nGhost];
-
-    if (ghost.GetHouseState() != HOUSE_OUTSIDE)
+    if (_ghosts->GetHouseState(nGhost) != HOUSE_OUTSIDE)
     {
-        return ghost.GetDir();
+        return _ghosts->GetDir(nGhost);
     }
     else
     {
-        ff::point_int press = _ghosts[nGhost]->GetPressDir();
+        ff::point_int press = _ghosts->GetPressDir(nGhost);
 
         return (!press.x && !press.y)
-            ? _ghosts[nGhost]->GetDir()
+            ? _ghosts->GetDir(nGhost)
             : press;
     }
 }
@@ -1862,21 +2458,21 @@ GhostState PlayingMaze::GetGhostState(size_t nGhost) const
 {
     assert_ret_val(nGhost >= 0 && nGhost < GetGhostCount(), GHOST_INVALID);
 
-    const GhostActor& ghost = *_ghosts[nGhost];
+    MoveState move = _ghosts->GetMoveState(nGhost);
 
-    if (!ghost.IsActive() ||
-        ghost.GetMoveState() == MOVE_EATEN ||
-        ghost.GetMoveState() == MOVE_WAITING_TO_BE_EATEN)
+    if (!_ghosts->IsActive(nGhost) ||
+        move == MOVE_EATEN ||
+        move == MOVE_WAITING_TO_BE_EATEN)
     {
         return GHOST_INVALID;
     }
-    else if (ghost.GetMoveState() == MOVE_SCARED)
+    else if (move == MOVE_SCARED)
     {
         return (_ghostScaredCountdown < 122 && (_ghostScaredCountdown % 27) < 14)
             ? GHOST_SCARED_FLASH
             : GHOST_SCARED;
     }
-    else if (ghost.GetMoveState() == MOVE_EYES)
+    else if (move == MOVE_EYES)
     {
         return GHOST_EYES;
     }
@@ -1892,7 +2488,17 @@ std::shared_ptr<IPlayingActor> PlayingMaze::GetGhost(size_t nGhost)
 {
     assert_ret_val(nGhost >= 0 && nGhost < GetGhostCount(), nullptr);
 
-    return _ghosts[nGhost];
+    return _ghostActors[nGhost];
+}
+
+const GhostPaths* PlayingMaze::GetGhostPaths()
+{
+    if (_ghostPathsDirty)
+    {
+        UpdateGhostPaths();
+    }
+
+    return &_ghostPaths;
 }
 
 ff::point_int PlayingMaze::GetGhostStartPixel() const
@@ -1,5 +1,6 @@
 #pragma once
 #include "Core/Difficulty.h"
+#include "Core/Random.h"
 #include "Core/Stats.h"
 
 class IMaze;
@@ -7,6 +8,7 @@ class IRenderMaze;
 class IPlayingActor;
 class IPlayingMazeHost;
 class CustomActor;
+class GhostPaths;
 class PointActor;
 enum AudioEffect;
 enum FruitType;
@@ -55,17 +57,29 @@ class IPlayingMaze
 public:
     virtual ~IPlayingMaze() = default;
 
-    static std::shared_ptr<IPlayingMaze> Create(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost);
+    static std::shared_ptr<IPlayingMaze> Create(std::shared_ptr<IMaze> pMaze, const Difficulty& difficulty, IPlayingMazeHost* pHost, uint64_t nSeed);
 
     virtual void Advance() = 0;
     virtual void Render(ff::dxgi::draw_base& draw) = 0;
     virtual void Reset() = 0;
 
+    // Copies everything that changes how the game plays out, for looking ahead. The copy has no host, doesn't
+    // render or make sounds, and can be advanced on any thread. Can be called from many threads at once.
+    virtual std::shared_ptr<IPlayingMaze> Clone() const = 0;
+
+    // Saves everything that changes while playing into GetSnapshotSize() bytes of flat, versioned data that can also
+    // be written to disk. Loading only works in a maze created from the same maze and difficulty. Points, bubbles,
+    // and sounds aren't saved, and the host isn't told about the loaded game state.
+    virtual size_t GetSnapshotSize() const = 0;
+    virtual bool SaveSnapshot(BYTE* pData, size_t nSize) const = 0;
+    virtual bool LoadSnapshot(const BYTE* pData, size_t nSize) = 0;
+
     virtual GameState GetGameState() const = 0;
     virtual const Stats& GetStats() const = 0;
     virtual std::shared_ptr<IMaze> GetMaze() const = 0;
     virtual std::shared_ptr<IRenderMaze> GetRenderMaze() = 0;
     virtual const Difficulty& GetDifficulty() const = 0;
+    virtual Random& GetRandom() = 0; // gameplay stream, for anything that changes how the game plays out
 
     virtual PacState GetPacState() const = 0;
     virtual std::shared_ptr<IPlayingActor> GetPac() = 0;
@@ -76,6 +90,7 @@ public:
     virtual ff::point_int GetGhostEyeDir(size_t nGhost) const = 0;
     virtual GhostState GetGhostState(size_t nGhost) const = 0;
     virtual std::shared_ptr<IPlayingActor> GetGhost(size_t nGhost) = 0;
+    virtual const GhostPaths* GetGhostPaths() = 0; // predicted for this frame, null when nothing predicts them
 
     virtual ff::point_int GetGhostStartPixel() const = 0;
     virtual ff::point_int GetGhostStartTile() const = 0;
@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "Core/Random.h"
+
+static uint64_t SplitMix64(uint64_t& nState)
+{
+    uint64_t z = (nState += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+static uint32_t RotateLeft(uint32_t n, int nShift)
+{
+    return (n << nShift) | (n >> (32 - nShift));
+}
+
+Random::Random(uint64_t nSeed, RandomStream stream)
+{
+    Seed(nSeed, stream);
+}
+
+// static
+uint64_t Random::NewSeed()
+{
+    static std::atomic<uint64_t> s_nCounter;
+    uint64_t nState = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count() + s_nCounter++;
+    return SplitMix64(nState);
+}
+
+void Random::Seed(uint64_t nSeed, RandomStream stream)
+{
+    // The stream picks a different spot to start from, and SplitMix64 spreads the bits so the state is never all zero
+
+    uint64_t nState = nSeed ^ ((uint64_t)stream << 32);
+    uint64_t nLow = SplitMix64(nState);
+    uint64_t nHigh = SplitMix64(nState);
+
+    _state[0] = (uint32_t)nLow;
+    _state[1] = (uint32_t)(nLow >> 32);
+    _state[2] = (uint32_t)nHigh;
+    _state[3] = (uint32_t)(nHigh >> 32);
+}
+
+uint32_t Random::Next()
+{
+    uint32_t nResult = RotateLeft(_state[1] * 5, 7) * 9;
+    uint32_t t = _state[1] << 9;
+
+    _state[2] ^= _state[0];
+    _state[3] ^= _state[1];
+    _state[1] ^= _state[2];
+    _state[0] ^= _state[3];
+    _state[2] ^= t;
+    _state[3] = RotateLeft(_state[3], 11);
+
+    return nResult;
+}
+
+size_t Random::Next(size_t nCount)
+{
+    assert_ret_val(nCount, 0);
+
+    // Scales instead of using modulo, which is faster and only a tiny bit uneven for the small counts used here
+    return (size_t)(((uint64_t)Next() * (uint64_t)nCount) >> 32);
+}
+
+const Random::State& Random::GetState() const
+{
+    return _state;
+}
+
+void Random::SetState(const State& state)
+{
+    // All zero would only ever return zero
+    assert_ret(state[0] || state[1] || state[2] || state[3]);
+    _state = state;
+}
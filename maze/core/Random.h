@@ -0,0 +1,33 @@
+#pragma once
+
+// Separate streams from the same seed, so cosmetic effects never change what happens in a game
+enum RandomStream : uint32_t
+{
+    RANDOM_GAMEPLAY,
+    RANDOM_COSMETIC,
+    RANDOM_LEVELS, // seeds for each level of a game
+};
+
+// Small xoshiro128** generator. Every playing maze owns its own, instead of sharing the global rand(),
+// so a seed always plays out the same way and mazes can run on different threads.
+class Random
+{
+public:
+    Random(uint64_t nSeed = 0, RandomStream stream = RANDOM_GAMEPLAY);
+
+    // Different every time, for when nobody asked for a particular seed
+    static uint64_t NewSeed();
+
+    void Seed(uint64_t nSeed, RandomStream stream = RANDOM_GAMEPLAY);
+
+    uint32_t Next();
+    size_t Next(size_t nCount); // from zero to nCount - 1
+
+    // For snapshots, so a rewound game rolls the same numbers again
+    typedef std::array<uint32_t, 4> State;
+    const State& GetState() const;
+    void SetState(const State& state);
+
+private:
+    State _state;
+};
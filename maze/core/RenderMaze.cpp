@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Core/Actors.h"
+#include "Core/GhostPaths.h"
 #include "Core/GlobalResources.h"
 #include "Core/Helpers.h"
 #include "Core/Maze.h"
@@ -28,6 +29,7 @@ public:
     virtual void RenderDots(ff::dxgi::draw_base& draw) override;
     virtual void RenderActors(ff::dxgi::draw_base& draw, bool bPac, bool bGhosts, bool bCustom, IPlayingMaze* pPlay) override;
     virtual void RenderPoints(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay) override;
+    virtual void RenderGhostTrails(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay) override;
     virtual void RenderFreeLives(ff::dxgi::draw_base& draw, IPlayingMaze* play, size_t nLives, ff::point_float leftPixel) override;
     virtual void RenderStatusFruits(ff::dxgi::draw_base& draw, const FruitType* pTypes, size_t nCount, ff::point_float rightPixel) override;
     virtual std::shared_ptr<IMaze> GetMaze() const override;
@@ -35,8 +37,10 @@ public:
     // IMazeListener
     virtual void OnTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent) override;
     virtual void OnAllTilesChanged() override;
+    virtual void OnTilesChanged(const ff::rect_int* pRects, size_t nRects) override;
 
 private:
+    void UpdateWallSprites(IMaze* pClone, ff::rect_int rect);
     void RenderFruit(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay);
     void RenderScaredGhosts(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay);
     void RenderGhosts(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay);
@@ -62,23 +66,24 @@ private:
     ff::auto_resource<ff::sprite_list> _outlineSprites;
     ff::auto_resource<ff::sprite_list> _wallBgSprites;
     ff::auto_resource<ff::sprite_base> _fruitSprites[13];
-    std::vector<std::vector<size_t>> _mazeSprites;
+    TileChunks<size_t> _mazeSprites; // only chunks with walls use memory
 
     // Pac and Ghost sprites:
     ff::auto_resource<ff::animation_base> _pacAnim[2];
     ff::auto_resource<ff::animation_base> _pacPowerAnim[2];
     ff::auto_resource<ff::animation_base> _pacDyingAnim[2];
-    ff::auto_resource<ff::animation_base> _ghostMoveAnim[4];
-    ff::auto_resource<ff::animation_base> _ghostScaredAnim[4];
-    ff::auto_resource<ff::animation_base> _ghostFlashAnim[4];
-    ff::auto_resource<ff::animation_base> _ghostEyesAnim[4];
-    ff::auto_resource<ff::animation_base> _ghostPupilsAnim[4];
+    ff::auto_resource<ff::animation_base> _ghostMoveAnim[GHOST_PERSONALITY_COUNT];
+    ff::auto_resource<ff::animation_base> _ghostScaredAnim[GHOST_PERSONALITY_COUNT];
+    ff::auto_resource<ff::animation_base> _ghostFlashAnim[GHOST_PERSONALITY_COUNT];
+    ff::auto_resource<ff::animation_base> _ghostEyesAnim[GHOST_PERSONALITY_COUNT];
+    ff::auto_resource<ff::animation_base> _ghostPupilsAnim[GHOST_PERSONALITY_COUNT];
     ff::auto_resource<ff::animation_base> _powerAnim;
     ff::auto_resource<ff::animation_base> _dotAnim;
     ff::auto_resource<ff::animation_base> _powerAuraAnim;
     ff::auto_resource<ff::animation_base> _keepAliveAnim[3];
 
     static const DirectX::XMFLOAT4 _colorGhostDoor;
+    static const DirectX::XMFLOAT4 _colorGhostTrails[GHOST_PERSONALITY_COUNT]; // for each personality
     static const ff::point_float _spriteScale;
     static const size_t _pacDyingFirstFrameCount = 30;
     static const size_t _pacDyingFrameCount = 12;
@@ -88,6 +93,14 @@ private:
 };
 
 const DirectX::XMFLOAT4 RenderMaze::_colorGhostDoor(1, 0.7216f, 1, 1);
+
+const DirectX::XMFLOAT4 RenderMaze::_colorGhostTrails[GHOST_PERSONALITY_COUNT] =
+{
+    DirectX::XMFLOAT4(1, 0, 0, 0.375f),
+    DirectX::XMFLOAT4(1, 0.7216f, 1, 0.375f),
+    DirectX::XMFLOAT4(0, 1, 1, 0.375f),
+    DirectX::XMFLOAT4(1, 0.7216f, 0.3176f, 0.375f),
+};
 const ff::point_float RenderMaze::_spriteScale(0.125f, 0.125f);
 
 const WallDefine RenderMaze::_wallDefines[46] =
@@ -493,25 +506,52 @@ void RenderMaze::OnAllTilesChanged()
 
     ff::point_int tiles = pClone->GetSizeInTiles();
 
-    _mazeSprites.resize(tiles.y);
+    _mazeSprites = TileChunks<size_t>(ff::constants::invalid_unsigned<size_t>());
+    _mazeSprites.SetSize(tiles);
 
-    for (int y = 0; y < tiles.y; y++)
+    UpdateWallSprites(pClone.get(), ff::rect_int(0, 0, tiles.x, tiles.y));
+}
+
+void RenderMaze::OnTilesChanged(const ff::rect_int* pRects, size_t nRects)
+{
+    assert_ret(_maze);
+
+    ff::point_int tiles = _maze->GetSizeInTiles();
+
+    if (_mazeSprites.GetSize() != tiles)
     {
-        _mazeSprites[y].resize(tiles.x);
+        OnAllTilesChanged();
+        return;
+    }
 
-        for (int x = 0; x < tiles.x; x++)
-        {
-            _mazeSprites[y][x] = ff::constants::invalid_unsigned<size_t>();
-        }
+    std::shared_ptr<IMaze> pClone = _maze->Clone(false);
+
+    for (size_t i = 0; i < nRects; i++)
+    {
+        // Wall sprites depend on their neighbors too
+
+        ff::rect_int rect(
+            std::max(pRects[i].left - 1, 0),
+            std::max(pRects[i].top - 1, 0),
+            std::min(pRects[i].right + 1, tiles.x),
+            std::min(pRects[i].bottom + 1, tiles.y));
+
+        UpdateWallSprites(pClone.get(), rect);
     }
+}
 
+void RenderMaze::UpdateWallSprites(IMaze* pClone, ff::rect_int rect)
+{
     // Figure out each wall sprite
 
-    for (int y = 0; y < tiles.y; y++)
+    const Tiles& tiles = pClone->GetTiles();
+
+    for (int y = rect.top; y < rect.bottom; y++)
     {
-        for (int x = 0; x < tiles.x; x++)
+        for (int x = rect.left; x < rect.right; x++)
         {
             bool bWall = false;
+            _mazeSprites.Set(ff::point_int(x, y), ff::constants::invalid_unsigned<size_t>());
 
             switch (pClone->GetTileContent(ff::point_int(x, y)))
             {
@@ -529,31 +569,9 @@ void RenderMaze::OnAllTilesChanged()
 
             // Get everything that surrounds the wall
 
-            TileContent content[9] =
-            {
-                pClone->GetTileContent(ff::point_int(x - 1, y - 1)),
-                pClone->GetTileContent(ff::point_int(x + 0, y - 1)),
-                pClone->GetTileContent(ff::point_int(x + 1, y - 1)),
-                pClone->GetTileContent(ff::point_int(x - 1, y + 0)),
-                pClone->GetTileContent(ff::point_int(x + 0, y + 0)),
-                pClone->GetTileContent(ff::point_int(x + 1, y + 0)),
-                pClone->GetTileContent(ff::point_int(x - 1, y + 1)),
-                pClone->GetTileContent(ff::point_int(x + 0, y + 1)),
-                pClone->GetTileContent(ff::point_int(x + 1, y + 1)),
-            };
-
-            TileZone zone[9] =
-            {
-                pClone->GetTileZone(ff::point_int(x - 1, y - 1)),
-                pClone->GetTileZone(ff::point_int(x + 0, y - 1)),
-                pClone->GetTileZone(ff::point_int(x + 1, y - 1)),
-                pClone->GetTileZone(ff::point_int(x - 1, y + 0)),
-                pClone->GetTileZone(ff::point_int(x + 0, y + 0)),
-                pClone->GetTileZone(ff::point_int(x + 1, y + 0)),
-                pClone->GetTileZone(ff::point_int(x - 1, y + 1)),
-                pClone->GetTileZone(ff::point_int(x + 0, y + 1)),
-                pClone->GetTileZone(ff::point_int(x + 1, y + 1)),
-            };
+            TileContent content[9];
+            TileZone zone[9];
+            tiles.GetNeighbors(ff::point_int(x, y), content, zone);
 
             // Check every sprite definition until a match is found
 
@@ -615,12 +633,12 @@ void RenderMaze::OnAllTilesChanged()
 
                 if (bMatch)
                 {
-                    _mazeSprites[y][x] = nSprite;
+                    _mazeSprites.Set(ff::point_int(x, y), nSprite);
                     break;
                 }
             }
 
-            assert_msg(_mazeSprites[y][x] != ff::constants::invalid_unsigned<size_t>(), "Couldn't find a wall sprite match");
+            assert_msg(_mazeSprites.Get(ff::point_int(x, y)) != ff::constants::invalid_unsigned<size_t>(), "Couldn't find a wall sprite match");
         }
     }
 }
@@ -726,20 +744,20 @@ void RenderMaze::RenderTheMaze(ff::dxgi::draw_base& draw)
 
     for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++, topLeft.x = 0, topLeft.y += tileSize.y)
     {
-        size_t* pSprite = _mazeSprites[tile.y].data();
-
-        for (; tile.x < size.x; tile.x++, topLeft.x += tileSize.x, pSprite++)
+        for (; tile.x < size.x; tile.x++, topLeft.x += tileSize.x)
         {
-            if (*pSprite != ff::constants::invalid_unsigned<size_t>())
+            size_t nSprite = _mazeSprites.Get(tile);
+
+            if (nSprite != ff::constants::invalid_unsigned<size_t>())
             {
                 const ff::sprite_base* pSprites[3] =
                 {
-                    bgSprites->get(*pSprite),
-                    wallSprites->get(*pSprite),
-                    outlineSprites->get(*pSprite)
+                    bgSprites->get(nSprite),
+                    wallSprites->get(nSprite),
+                    outlineSprites->get(nSprite)
                 };
 
-                bool bGhostDoor = (*pSprite == 21);
+                bool bGhostDoor = (nSprite == 21);
                 const DirectX::XMFLOAT4* pColors = bGhostDoor ? ghostDoorColors : colors;
 
                 for (size_t i = 0; i < 3; i++)
@@ -761,28 +779,22 @@ void RenderMaze::RenderDots(ff::dxgi::draw_base& draw)
     ff::animation_base* dotAnim = _dotAnim.object().get();
     check_ret(powerAnim && dotAnim);
 
-    ff::point_int size = _maze->GetSizeInTiles();
     float dotFrame = _powerCounter * dotAnim->frames_per_second() / 60.0f;
     float powerFrame = _powerCounter * powerAnim->frames_per_second() / 60.0f + powerAnim->frame_length() / 2.0f;
 
     draw.push_no_overlap();
 
-    for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
-    {
-        for (; tile.x < size.x; tile.x++)
+    _maze->GetTiles().ForEachDot([this, &draw, dotAnim, powerAnim, dotFrame, powerFrame](ff::point_int tile, TileContent content)
         {
-            switch (_maze->GetTileContent(tile))
+            if (content == CONTENT_DOT)
             {
-                case CONTENT_DOT:
-                    dotAnim->draw_frame(draw, ff::transform(TileCenterToPixelF(tile), _spriteScale), dotFrame + tile.x / 2 + tile.y / 2);
-                    break;
-
-                case CONTENT_POWER:
-                    powerAnim->draw_frame(draw, ff::transform(TileCenterToPixelF(tile), _spriteScale), powerFrame);
-                    break;
+                dotAnim->draw_frame(draw, ff::transform(TileCenterToPixelF(tile), _spriteScale), dotFrame + tile.x / 2 + tile.y / 2);
             }
-        }
-    }
+            else
+            {
+                powerAnim->draw_frame(draw, ff::transform(TileCenterToPixelF(tile), _spriteScale), powerFrame);
+            }
+        });
 
     draw.pop_no_overlap();
 }
@@ -829,6 +841,30 @@ void RenderMaze::RenderPoints(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay)
     }
 }
 
+// Lines from each ghost along the tiles it's expected to walk through, until the path leaves the maze
+void RenderMaze::RenderGhostTrails(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay)
+{
+    const GhostPaths* pPaths = pPlay ? pPlay->GetGhostPaths() : nullptr;
+    check_ret(pPaths);
+
+    ff::rect_int mazeRect(ff::point_int(0, 0), _maze->GetSizeInTiles());
+
+    for (size_t i = 0; i < pPaths->GetCount(); i++)
+    {
+        size_t nTiles = pPaths->GetTileCount(i);
+        const ff::point_int* pTiles = pPaths->GetTiles(i);
+        const DirectX::XMFLOAT4& color = _colorGhostTrails[GetGhostPersonality(i)];
+        ff::point_float pixel = pPlay->GetGhost(i)->GetPixel().cast<float>();
+
+        for (size_t h = 1; h < nTiles && mazeRect.contains(pTiles[h]); h++)
+        {
+            ff::point_float nextPixel = TileCenterToPixelF(pTiles[h]);
+            draw.draw_line(pixel, nextPixel, color, 1);
+            pixel = nextPixel;
+        }
+    }
+}
+
 void RenderMaze::RenderFruit(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay)
 {
     check_ret(pPlay->GetFruitState() != FRUIT_INVALID);
@@ -871,9 +907,10 @@ void RenderMaze::RenderScaredGhosts(ff::dxgi::draw_base& draw, IPlayingMaze* pPl
         GhostState state = pPlay->GetGhostState(i);
         if (state == GHOST_SCARED || state == GHOST_SCARED_FLASH)
         {
+            size_t nPersonality = GetGhostPersonality(i);
             ff::animation_base* anim = (state == GHOST_SCARED_FLASH)
-                ? _ghostFlashAnim[i].object().get()
-                : _ghostScaredAnim[i].object().get();
+                ? _ghostFlashAnim[nPersonality].object().get()
+                : _ghostScaredAnim[nPersonality].object().get();
 
             if (anim)
             {
@@ -893,10 +930,11 @@ void RenderMaze::RenderGhosts(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay)
         GhostState state = pPlay->GetGhostState(i);
         if (state == GHOST_CHASE || state == GHOST_SCATTER || state == GHOST_EYES)
         {
+            size_t nPersonality = GetGhostPersonality(i);
             ff::animation_base* bodyAnim = (state == GHOST_EYES)
-                ? _ghostEyesAnim[i].object().get()
-                : _ghostMoveAnim[i].object().get();
-            ff::animation_base* pupilsAnim = _ghostPupilsAnim[i].object().get();
+                ? _ghostEyesAnim[nPersonality].object().get()
+                : _ghostMoveAnim[nPersonality].object().get();
+            ff::animation_base* pupilsAnim = _ghostPupilsAnim[nPersonality].object().get();
 
             if (bodyAnim)
             {
@@ -19,6 +19,7 @@ public:
     virtual void RenderDots(ff::dxgi::draw_base& draw) = 0;
     virtual void RenderActors(ff::dxgi::draw_base& draw, bool bPac, bool bGhosts, bool bCustom, IPlayingMaze* pPlay) = 0;
     virtual void RenderPoints(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay) = 0;
+    virtual void RenderGhostTrails(ff::dxgi::draw_base& draw, IPlayingMaze* pPlay) = 0;
 
     virtual void RenderFreeLives(ff::dxgi::draw_base& draw, IPlayingMaze* play, size_t nLives, ff::point_float leftPixel) = 0;
     virtual void RenderStatusFruits(ff::dxgi::draw_base& draw, const FruitType* pTypes, size_t nCount, ff::point_float rightPixel) = 0;
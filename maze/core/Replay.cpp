@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "Core/Helpers.h"
+#include "Core/Replay.h"
+#include "Core/Stats.h"
+
+// File layout: the header, the mazes ID, the press runs (each is a 7-bits-per-byte frame count then the press),
+// then the checkpoint hashes. Everything is little endian.
+struct ReplayHeader
+{
+    static const uint32_t MAGIC = 0x59504C52; // "RLPY"
+    static const uint32_t VERSION = 2; // bump whenever the checkpoint hash changes
+
+    uint32_t _magic;
+    uint32_t _version;
+    uint64_t _seed;
+    uint32_t _players;
+    uint32_t _frames;
+    uint32_t _checkpointFrames;
+    uint32_t _checkpoints;
+    uint32_t _mazesIdSize;
+    uint32_t _runsSize;
+};
+
+static const size_t HIGH_SCORE_COUNT = sizeof(Stats::_highScores) / sizeof(Stats::HighScore);
+static std::string_view s_replays = "Replays";
+
+static std::string GetHighScoreKey(std::string_view mazesId, size_t nSlot)
+{
+    return ff::string::concat(mazesId, "-", nSlot);
+}
+
+Replay::Replay(std::string_view mazesId, size_t nPlayers, uint64_t nSeed)
+    : _mazesId(mazesId)
+    , _players(nPlayers)
+    , _seed(nSeed)
+    , _frames(0)
+    , _readRun(0)
+    , _readRunStart(0)
+{
+}
+
+Replay::~Replay()
+{
+}
+
+// static
+std::shared_ptr<Replay> Replay::Load(const BYTE* pData, size_t nSize)
+{
+    ReplayHeader header;
+    check_ret_val(pData && nSize >= sizeof(header), nullptr);
+    ::CopyMemory(&header, pData, sizeof(header));
+
+    check_ret_val(header._magic == ReplayHeader::MAGIC &&
+        header._version == ReplayHeader::VERSION &&
+        header._checkpointFrames == CHECKPOINT_FRAMES &&
+        header._checkpoints == header._frames / CHECKPOINT_FRAMES &&
+        header._players >= 1 && header._players <= 2 &&
+        nSize == sizeof(header) + (size_t)header._mazesIdSize + header._runsSize + header._checkpoints * sizeof(uint64_t), nullptr);
+
+    const BYTE* pRead = pData + sizeof(header);
+    std::string_view mazesId((const char*)pRead, header._mazesIdSize);
+    pRead += header._mazesIdSize;
+
+    std::shared_ptr<Replay> replay = std::make_shared<Replay>(mazesId, header._players, header._seed);
+
+    for (const BYTE* pRunsEnd = pRead + header._runsSize; pRead < pRunsEnd; )
+    {
+        size_t nFrames = 0;
+
+        for (size_t nShift = 0; ; nShift += 7)
+        {
+            check_ret_val(pRead < pRunsEnd && nShift < 32, nullptr);
+            BYTE value = *pRead++;
+            nFrames |= (size_t)(value & 0x7F) << nShift;
+
+            if (!(value & 0x80))
+            {
+                break;
+            }
+        }
+
+        check_ret_val(pRead < pRunsEnd && nFrames && nFrames <= header._frames - replay->_frames, nullptr);
+        replay->_runs.push_back(PressRun{ (uint32_t)nFrames, *pRead++ });
+        replay->_frames += nFrames;
+    }
+
+    check_ret_val(replay->_frames == header._frames, nullptr);
+
+    replay->_checkpoints.resize(header._checkpoints);
+    ::CopyMemory(replay->_checkpoints.data(), pRead, header._checkpoints * sizeof(uint64_t));
+
+    return replay;
+}
+
+// static
+std::shared_ptr<Replay> Replay::Load(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    check_ret_val(file.is_open(), nullptr);
+
+    std::vector<BYTE> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Load(bytes.data(), bytes.size());
+}
+
+std::vector<BYTE> Replay::Save() const
+{
+    std::vector<BYTE> runs;
+    runs.reserve(_runs.size() * 2);
+
+    for (const PressRun& run : _runs)
+    {
+        size_t nFrames = run._frames;
+        for (; nFrames >= 0x80; nFrames >>= 7)
+        {
+            runs.push_back((BYTE)(nFrames | 0x80));
+        }
+
+        runs.push_back((BYTE)nFrames);
+        runs.push_back(run._press);
+    }
+
+    ReplayHeader header;
+    ::ZeroMemory(&header, sizeof(header));
+
+    header._magic = ReplayHeader::MAGIC;
+    header._version = ReplayHeader::VERSION;
+    header._seed = _seed;
+    header._players = (uint32_t)_players;
+    header._frames = (uint32_t)_frames;
+    header._checkpointFrames = (uint32_t)CHECKPOINT_FRAMES;
+    header._checkpoints = (uint32_t)_checkpoints.size();
+    header._mazesIdSize = (uint32_t)_mazesId.size();
+    header._runsSize = (uint32_t)runs.size();
+
+    std::vector<BYTE> bytes;
+    bytes.reserve(sizeof(header) + _mazesId.size() + runs.size() + _checkpoints.size() * sizeof(uint64_t));
+    bytes.insert(bytes.end(), (const BYTE*)&header, (const BYTE*)&header + sizeof(header));
+    bytes.insert(bytes.end(), _mazesId.begin(), _mazesId.end());
+    bytes.insert(bytes.end(), runs.begin(), runs.end());
+    bytes.insert(bytes.end(), (const BYTE*)_checkpoints.data(), (const BYTE*)(_checkpoints.data() + _checkpoints.size()));
+
+    return bytes;
+}
+
+bool Replay::Save(const std::filesystem::path& path) const
+{
+    std::vector<BYTE> bytes = Save();
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)bytes.data(), bytes.size());
+
+    assert_ret_val(file.good(), false);
+    return true;
+}
+
+// static
+std::shared_ptr<Replay> Replay::LoadHighScore(std::string_view mazesId, size_t nSlot)
+{
+    ff::dict dict = ff::settings(s_replays);
+    std::shared_ptr<ff::data_base> data = dict.get<ff::data_base>(GetHighScoreKey(mazesId, nSlot));
+
+    // Empty for scores that were saved without a replay
+    check_ret_val(data && data->size(), nullptr);
+    return Load(data->data(), data->size());
+}
+
+// static
+void Replay::InsertHighScore(std::string_view mazesId, size_t nSlot, const Replay* pReplay)
+{
+    assert_ret(nSlot < HIGH_SCORE_COUNT);
+
+    ff::dict dict = ff::settings(s_replays);
+
+    // Shift down existing replays, like Stats::InsertHighScore
+
+    for (size_t i = HIGH_SCORE_COUNT - 1; i > nSlot; i--)
+    {
+        std::shared_ptr<ff::data_base> data = dict.get<ff::data_base>(GetHighScoreKey(mazesId, i - 1));
+        if (!data)
+        {
+            data = std::make_shared<ff::data_vector>(std::vector<uint8_t>());
+        }
+
+        dict.set<ff::data_base>(GetHighScoreKey(mazesId, i), data, ff::saved_data_type::none);
+    }
+
+    std::vector<uint8_t> bytes = pReplay ? pReplay->Save() : std::vector<uint8_t>();
+    dict.set<ff::data_base>(GetHighScoreKey(mazesId, nSlot), std::make_shared<ff::data_vector>(std::move(bytes)), ff::saved_data_type::none);
+
+    ff::settings(s_replays, dict);
+}
+
+const std::string& Replay::GetMazesID() const
+{
+    return _mazesId;
+}
+
+size_t Replay::GetPlayers() const
+{
+    return _players;
+}
+
+uint64_t Replay::GetSeed() const
+{
+    return _seed;
+}
+
+size_t Replay::GetFrameCount() const
+{
+    return _frames;
+}
+
+ff::point_int Replay::GetPressDir(size_t nFrame) const
+{
+    check_ret_val(nFrame < _frames, ff::point_int{});
+
+    if (nFrame < _readRunStart)
+    {
+        _readRun = 0;
+        _readRunStart = 0;
+    }
+
+    while (nFrame >= _readRunStart + _runs[_readRun]._frames)
+    {
+        _readRunStart += _runs[_readRun]._frames;
+        _readRun++;
+    }
+
+    return ByteToPressDir(_runs[_readRun]._press);
+}
+
+void Replay::AddFrame(ff::point_int pressDir)
+{
+    BYTE press = PressDirToByte(pressDir);
+
+    if (_runs.size() && _runs.back()._press == press && _runs.back()._frames < UINT32_MAX)
+    {
+        _runs.back()._frames++;
+    }
+    else
+    {
+        _runs.push_back(PressRun{ 1, press });
+    }
+
+    _frames++;
+}
+
+void Replay::Truncate(size_t nFrames)
+{
+    check_ret(nFrames < _frames);
+
+    while (_frames - _runs.back()._frames >= nFrames)
+    {
+        _frames -= _runs.back()._frames;
+        _runs.pop_back();
+
+        if (_runs.empty())
+        {
+            break;
+        }
+    }
+
+    if (_runs.size())
+    {
+        _runs.back()._frames -= (uint32_t)(_frames - nFrames);
+        _frames = nFrames;
+    }
+
+    _checkpoints.resize(std::min(_checkpoints.size(), nFrames / CHECKPOINT_FRAMES));
+    _readRun = 0;
+    _readRunStart = 0;
+}
+
+size_t Replay::GetCheckpointCount() const
+{
+    return _checkpoints.size();
+}
+
+uint64_t Replay::GetCheckpoint(size_t nCheckpoint) const
+{
+    assert_ret_val(nCheckpoint < _checkpoints.size(), 0);
+    return _checkpoints[nCheckpoint];
+}
+
+void Replay::AddCheckpoint(uint64_t nHash)
+{
+    _checkpoints.push_back(nHash);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Everything needed to play a game again exactly: the mazes, the number of players, the seed, and what was pressed
+// on every frame. Presses are stored as runs since they rarely change. Every CHECKPOINT_FRAMES frames there's also a
+// hash of the game, so playback can tell as soon as it stops matching.
+class Replay
+{
+public:
+    Replay(std::string_view mazesId, size_t nPlayers, uint64_t nSeed);
+    ~Replay();
+
+    static const size_t CHECKPOINT_FRAMES = 60;
+
+    static std::shared_ptr<Replay> Load(const BYTE* pData, size_t nSize);
+    static std::shared_ptr<Replay> Load(const std::filesystem::path& path);
+    std::vector<BYTE> Save() const;
+    bool Save(const std::filesystem::path& path) const;
+
+    // Replays of high scores are saved with the settings, in the same slots as Stats::_highScores
+    static std::shared_ptr<Replay> LoadHighScore(std::string_view mazesId, size_t nSlot);
+    static void InsertHighScore(std::string_view mazesId, size_t nSlot, const Replay* pReplay);
+
+    const std::string& GetMazesID() const;
+    size_t GetPlayers() const;
+    uint64_t GetSeed() const;
+
+    size_t GetFrameCount() const;
+    ff::point_int GetPressDir(size_t nFrame) const; // fast when frames are read in order
+    void AddFrame(ff::point_int pressDir);
+    void Truncate(size_t nFrames); // after rewinding
+
+    size_t GetCheckpointCount() const;
+    uint64_t GetCheckpoint(size_t nCheckpoint) const; // hash after (nCheckpoint + 1) * CHECKPOINT_FRAMES frames
+    void AddCheckpoint(uint64_t nHash);
+
+private:
+    struct PressRun
+    {
+        uint32_t _frames;
+        BYTE _press;
+    };
+
+    std::string _mazesId;
+    size_t _players;
+    uint64_t _seed;
+    size_t _frames;
+    std::vector<PressRun> _runs;
+    std::vector<uint64_t> _checkpoints;
+
+    // Last run that was read
+    mutable size_t _readRun;
+    mutable size_t _readRunStart;
+};
@@ -0,0 +1,312 @@
+#include "pch.h"
+#include "Core/RewindBuffer.h"
+
+// Keyframes are encoded as the XOR with the keyframe before it, which is mostly zeros, so only runs of changed words
+// get stored. Each run is a count of unchanged words, a count of changed words, then the changed words.
+// Short unchanged runs stay inside a changed run, which limits how much bigger than the state an encoding can be.
+// States are padded with zeros to whole words.
+static const size_t MIN_SAME_RUN = 2;
+static const size_t MAX_ENCODE_OVERHEAD = 16;
+
+static BYTE* WriteCount(BYTE* pWrite, size_t nCount)
+{
+    for (; nCount >= 0x80; nCount >>= 7)
+    {
+        *pWrite++ = (BYTE)(nCount | 0x80);
+    }
+
+    *pWrite++ = (BYTE)nCount;
+    return pWrite;
+}
+
+static const BYTE* ReadCount(const BYTE* pRead, size_t& nCount)
+{
+    nCount = 0;
+
+    for (size_t nShift = 0; ; nShift += 7)
+    {
+        BYTE value = *pRead++;
+        nCount |= (size_t)(value & 0x7F) << nShift;
+
+        if (!(value & 0x80))
+        {
+            return pRead;
+        }
+    }
+}
+
+RewindBuffer::RewindBuffer()
+    : _stateSize(0)
+    , _keyframeFrames(1)
+    , _maxFrames(0)
+    , _firstKey(0)
+    , _keyCount(0)
+    , _firstInput(0)
+    , _frameCount(0)
+{
+}
+
+RewindBuffer::~RewindBuffer()
+{
+}
+
+bool RewindBuffer::Init(size_t nStateSize, size_t nMaxFrames, size_t nKeyframeFrames, size_t nMaxBytes)
+{
+    assert_ret_val(nStateSize && nMaxFrames && nKeyframeFrames, false);
+
+    // Up to two keyframes worth of frames past nMaxFrames, since only whole keyframes get dropped
+    size_t nStateWords = (nStateSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    size_t nMaxEncoded = nStateWords * sizeof(uint64_t) + MAX_ENCODE_OVERHEAD;
+    size_t nInputCount = nMaxFrames + 2 * nKeyframeFrames;
+    size_t nKeyCount = nInputCount / nKeyframeFrames + 1;
+    size_t nFixedBytes = nKeyCount * sizeof(Keyframe) + nInputCount + 2 * nStateWords * sizeof(uint64_t) + nMaxEncoded + nKeyframeFrames;
+
+    _stateSize = 0;
+    _data = std::vector<BYTE>();
+    _keys = std::vector<Keyframe>();
+    _inputs = std::vector<BYTE>();
+    _newestState = std::vector<uint64_t>();
+    _nextState = std::vector<uint64_t>();
+    _encoded = std::vector<BYTE>();
+    _replayInputs = std::vector<BYTE>();
+    Clear();
+
+    // Must have room for at least one keyframe, but no more than every keyframe changing every byte
+    check_ret_val(nMaxBytes >= nFixedBytes + nMaxEncoded, false);
+    size_t nDataBytes = std::min(nMaxBytes - nFixedBytes, nKeyCount * nMaxEncoded);
+
+    _stateSize = nStateSize;
+    _keyframeFrames = nKeyframeFrames;
+    _maxFrames = nMaxFrames;
+    _data.resize(nDataBytes);
+    _keys.resize(nKeyCount);
+    _inputs.resize(nInputCount);
+    _newestState.resize(nStateWords);
+    _nextState.resize(nStateWords);
+    _encoded.resize(nMaxEncoded);
+    _replayInputs.resize(nKeyframeFrames);
+
+    return true;
+}
+
+void RewindBuffer::Clear()
+{
+    _firstKey = 0;
+    _keyCount = 0;
+    _firstInput = 0;
+    _frameCount = 0;
+
+    // The oldest keyframe is never decoded, so what it's compared with doesn't matter
+    std::fill(_newestState.begin(), _newestState.end(), 0);
+}
+
+size_t RewindBuffer::GetStateSize() const
+{
+    return _stateSize;
+}
+
+size_t RewindBuffer::GetFrameCount() const
+{
+    return _frameCount;
+}
+
+size_t RewindBuffer::GetMemorySize() const
+{
+    return _data.capacity() +
+        _keys.capacity() * sizeof(Keyframe) +
+        _inputs.capacity() +
+        _newestState.capacity() * sizeof(uint64_t) +
+        _nextState.capacity() * sizeof(uint64_t) +
+        _encoded.capacity() +
+        _replayInputs.capacity();
+}
+
+bool RewindBuffer::NeedsKeyframe() const
+{
+    return _stateSize && _frameCount == _keyCount * _keyframeFrames;
+}
+
+bool RewindBuffer::AddKeyframe(const BYTE* pState)
+{
+    assert_ret_val(pState && NeedsKeyframe(), false);
+
+    while (_keyCount > 1 && _frameCount - _keyframeFrames >= _maxFrames)
+    {
+        DropOldestKeyframe();
+    }
+
+    ::CopyMemory(_nextState.data(), pState, _stateSize);
+
+    size_t nSize = Encode();
+    size_t nOffset = 0;
+    assert_ret_val(AllocKeyframe(nSize, nOffset), false);
+
+    ::CopyMemory(_data.data() + nOffset, _encoded.data(), nSize);
+    _keys[(_firstKey + _keyCount) % _keys.size()] = Keyframe{ nOffset, nSize };
+    _keyCount++;
+
+    std::swap(_newestState, _nextState);
+
+    return true;
+}
+
+void RewindBuffer::AddFrame(BYTE input)
+{
+    assert_ret(_keyCount && _frameCount < _keyCount * _keyframeFrames);
+
+    // Wraps at most once, and dividing is slow for every frame
+    size_t nInput = _firstInput + _frameCount;
+    _inputs[(nInput < _inputs.size()) ? nInput : nInput - _inputs.size()] = input;
+    _frameCount++;
+}
+
+bool RewindBuffer::Rewind(size_t nFrames, const BYTE*& pState, const BYTE*& pInputs, size_t& nInputs)
+{
+    nFrames = std::min(nFrames, _frameCount);
+    check_ret_val(nFrames, false);
+
+    size_t nTarget = _frameCount - nFrames;
+    size_t nKey = nTarget / _keyframeFrames;
+
+    // Undo newer keyframes until the one before the target is decoded
+    for (; _keyCount > nKey + 1; _keyCount--)
+    {
+        Decode(GetKeyframe(_keyCount - 1));
+    }
+
+    _frameCount = nTarget;
+    nInputs = nTarget - nKey * _keyframeFrames;
+
+    for (size_t i = 0; i < nInputs; i++)
+    {
+        _replayInputs[i] = _inputs[(_firstInput + nKey * _keyframeFrames + i) % _inputs.size()];
+    }
+
+    pState = (const BYTE*)_newestState.data();
+    pInputs = _replayInputs.data();
+
+    return true;
+}
+
+const RewindBuffer::Keyframe& RewindBuffer::GetKeyframe(size_t nKey) const
+{
+    return _keys[(_firstKey + nKey) % _keys.size()];
+}
+
+// Compares _nextState with _newestState
+size_t RewindBuffer::Encode()
+{
+    const uint64_t* pState = _nextState.data();
+    const uint64_t* pPrev = _newestState.data();
+    size_t nWords = _newestState.size();
+    BYTE* pWrite = _encoded.data();
+
+    for (size_t i = 0; i < nWords; )
+    {
+        size_t nSameStart = i;
+        while (i < nWords && pState[i] == pPrev[i])
+        {
+            i++;
+        }
+
+        size_t nChangedStart = i;
+        size_t nSameRun = 0;
+        for (; i < nWords && nSameRun < MIN_SAME_RUN; i++)
+        {
+            nSameRun = (pState[i] == pPrev[i]) ? nSameRun + 1 : 0;
+        }
+
+        if (nSameRun == MIN_SAME_RUN)
+        {
+            i -= nSameRun;
+        }
+
+        pWrite = WriteCount(pWrite, nChangedStart - nSameStart);
+        pWrite = WriteCount(pWrite, i - nChangedStart);
+
+        for (size_t h = nChangedStart; h < i; h++, pWrite += sizeof(uint64_t))
+        {
+            uint64_t change = pState[h] ^ pPrev[h];
+            ::CopyMemory(pWrite, &change, sizeof(change));
+        }
+    }
+
+    size_t nSize = pWrite - _encoded.data();
+    assert(nSize <= _encoded.size());
+
+    return nSize;
+}
+
+void RewindBuffer::Decode(const Keyframe& key)
+{
+    const BYTE* pRead = _data.data() + key._offset;
+    const BYTE* pEnd = pRead + key._size;
+    uint64_t* pState = _newestState.data();
+
+    for (size_t i = 0; pRead < pEnd; )
+    {
+        size_t nSame = 0;
+        size_t nChanged = 0;
+        pRead = ReadCount(pRead, nSame);
+        pRead = ReadCount(pRead, nChanged);
+        i += nSame;
+
+        assert_ret(i + nChanged <= _newestState.size());
+
+        for (size_t h = 0; h < nChanged; h++, i++, pRead += sizeof(uint64_t))
+        {
+            uint64_t change;
+            ::CopyMemory(&change, pRead, sizeof(change));
+            pState[i] ^= change;
+        }
+    }
+}
+
+bool RewindBuffer::AllocKeyframe(size_t nSize, size_t& nOffset)
+{
+    while (_keyCount)
+    {
+        const Keyframe& oldest = GetKeyframe(0);
+        const Keyframe& newest = GetKeyframe(_keyCount - 1);
+        size_t nHead = newest._offset + newest._size;
+        size_t nTail = oldest._offset;
+
+        if (nHead > nTail)
+        {
+            // Used bytes don't wrap, so there's room at the end and before the oldest keyframe
+            if (nHead + nSize <= _data.size())
+            {
+                nOffset = nHead;
+                return true;
+            }
+
+            if (nSize <= nTail)
+            {
+                nOffset = 0;
+                return true;
+            }
+        }
+        else if (nHead + nSize <= nTail)
+        {
+            nOffset = nHead;
+            return true;
+        }
+
+        DropOldestKeyframe();
+    }
+
+    nOffset = 0;
+    return nSize <= _data.size();
+}
+
+void RewindBuffer::DropOldestKeyframe()
+{
+    assert_ret(_keyCount);
+
+    size_t nFrames = std::min(_keyframeFrames, _frameCount);
+
+    _firstKey = (_firstKey + 1) % _keys.size();
+    _keyCount--;
+    _firstInput = (_firstInput + nFrames) % _inputs.size();
+    _frameCount -= nFrames;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Remembers the last few seconds of a game so that it can be played backwards.
+// Every few frames a keyframe stores the whole state, as the bytes that changed since the keyframe before it.
+// Frames in between only store one byte of input, so getting back to them means replaying from their keyframe.
+// All memory is allocated by Init, the oldest frames get dropped to make room for new ones.
+class RewindBuffer
+{
+public:
+    RewindBuffer();
+    ~RewindBuffer();
+
+    // Keeps up to nMaxFrames frames, with a keyframe every nKeyframeFrames, using less than nMaxBytes
+    bool Init(size_t nStateSize, size_t nMaxFrames, size_t nKeyframeFrames, size_t nMaxBytes);
+    void Clear();
+
+    size_t GetStateSize() const;
+    size_t GetFrameCount() const; // how far back it can go
+    size_t GetMemorySize() const;
+
+    // Recording, before each frame: AddKeyframe when it's needed, then always AddFrame
+    bool NeedsKeyframe() const;
+    bool AddKeyframe(const BYTE* pState);
+    void AddFrame(BYTE input);
+
+    // Forgets the newest nFrames frames. To get back to the new newest frame, load pState and then replay
+    // the nInputs frames from pInputs. The pointers are valid until the next call.
+    bool Rewind(size_t nFrames, const BYTE*& pState, const BYTE*& pInputs, size_t& nInputs);
+
+private:
+    struct Keyframe
+    {
+        size_t _offset;
+        size_t _size;
+    };
+
+    const Keyframe& GetKeyframe(size_t nKey) const; // 0 is the oldest
+    size_t Encode();
+    void Decode(const Keyframe& key);
+    bool AllocKeyframe(size_t nSize, size_t& nOffset);
+    void DropOldestKeyframe();
+
+    size_t _stateSize;
+    size_t _keyframeFrames;
+    size_t _maxFrames;
+
+    // Encoded keyframes, each one is contiguous and they wrap around like the rest
+    std::vector<BYTE> _data;
+    std::vector<Keyframe> _keys;
+    size_t _firstKey;
+    size_t _keyCount;
+
+    // One input for every frame since the oldest keyframe
+    std::vector<BYTE> _inputs;
+    size_t _firstInput;
+    size_t _frameCount;
+
+    std::vector<uint64_t> _newestState; // decoded newest keyframe, the others are found by undoing changes
+    std::vector<uint64_t> _nextState; // keyframe being added
+    std::vector<BYTE> _encoded;
+    std::vector<BYTE> _replayInputs;
+};
@@ -0,0 +1,1006 @@
+#include "pch.h"
+#include "Core/Actors.h"
+#include "Core/Difficulty.h"
+#include "Core/GhostBrains.h"
+#include "Core/Helpers.h"
+#include "Core/Maze.h"
+#include "Core/MazeCache.h"
+#include "Core/MazeDistances.h"
+#include "Core/Mazes.h"
+#include "Core/PacController.h"
+#include "Core/PlayingGame.h"
+#include "Core/PlayingMaze.h"
+#include "Core/Random.h"
+#include "Core/Replay.h"
+#include "Core/SelfTest.h"
+#include "Core/Tiles.h"
+
+static const size_t WALL_TEST_READS = 4000000;
+static const ff::point_int SHIFT_TEST_SIZE(37, 23);
+static const ff::point_int SHIFT_BENCH_SIZE(2048, 2048);
+static const size_t SHIFT_BENCH_PASSES = 16;
+static const ff::point_int CHUNK_BENCH_SIZE(2048, 2048);
+static const size_t CHUNK_BENCH_LOOKUPS = 4000000;
+static const size_t DECISION_BENCH_COUNT = 1000000;
+static const size_t FOLLOWING_TARGET_DECISIONS = 16;
+static const size_t SWARM_PLAYING_FRAMES = 600;
+static const size_t SWARM_MAX_FRAMES = 20000;
+static const size_t BATCH_PLAY_FRAMES = 7200;
+static const size_t BATCH_BENCH_DECISIONS = 1048576;
+static const size_t RECORD_BENCH_FRAMES = 7200;
+static const size_t RECORD_BENCH_BLOCK_FRAMES = 600;
+static const size_t RECORD_BENCH_PASSES = 5;
+static const double RECORD_MAX_OVERHEAD = 0.02;
+static const size_t AUTOPILOT_MAX_FRAMES = 36000;
+static const size_t AUTOPILOT_MIN_LEVELS = 1;
+static const double AUTOPILOT_MAX_MICROSECONDS = 50.0;
+
+// Calls func nPasses times and returns the nanoseconds for each of nItems in a pass
+template<typename T>
+static double TimePerItem(size_t nPasses, size_t nItems, T&& func)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < nPasses; i++)
+    {
+        func();
+    }
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return nanoseconds / std::max<size_t>(nPasses * nItems, 1);
+}
+
+// What movement and ghosts did before Tiles kept exits, four virtual calls into the maze
+static BYTE GetExitsFromContent(const IMaze& maze, ff::point_int tile)
+{
+    BYTE exits = EXIT_NONE;
+    exits |= Tiles::IsWallContent(maze.GetTileContent(ff::point_int(tile.x, tile.y - 1))) ? EXIT_NONE : EXIT_UP;
+    exits |= Tiles::IsWallContent(maze.GetTileContent(ff::point_int(tile.x - 1, tile.y))) ? EXIT_NONE : EXIT_LEFT;
+    exits |= Tiles::IsWallContent(maze.GetTileContent(ff::point_int(tile.x, tile.y + 1))) ? EXIT_NONE : EXIT_DOWN;
+    exits |= Tiles::IsWallContent(maze.GetTileContent(ff::point_int(tile.x + 1, tile.y))) ? EXIT_NONE : EXIT_RIGHT;
+    return exits;
+}
+
+static std::shared_ptr<Tiles> CreateRandomTiles(ff::point_int size, bool bChunked, uint64_t nSeed)
+{
+    Random random(nSeed);
+    std::shared_ptr<Tiles> tiles = std::make_shared<Tiles>();
+    tiles->SetSize(size);
+    tiles->SetChunked(bChunked);
+    tiles->BeginChanges();
+
+    for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < size.x; tile.x++)
+        {
+            tiles->SetContent(tile, (TileContent)random.Next(TILE_CONTENT_COUNT));
+            tiles->SetZone(tile, (TileZone)random.Next(TILE_ZONE_COUNT));
+        }
+    }
+
+    tiles->CommitChanges();
+    return tiles;
+}
+
+// Each tile has to come from the tile that was shift away from it, tiles shifted in from outside are empty
+static bool IsShiftOf(const Tiles& shifted, const Tiles& source, ff::point_int shift, bool bWrap)
+{
+    ff::point_int size = source.GetSize();
+    check_ret_val(shifted.GetSize() == size, false);
+
+    for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < size.x; tile.x++)
+        {
+            ff::point_int from = tile - shift;
+            if (bWrap)
+            {
+                from.x = ((from.x % size.x) + size.x) % size.x;
+                from.y = ((from.y % size.y) + size.y) % size.y;
+            }
+
+            bool bInside = from.x >= 0 && from.x < size.x && from.y >= 0 && from.y < size.y;
+            TileContent content = bInside ? source.GetContent(from) : CONTENT_NOTHING;
+            TileZone zone = bInside ? source.GetZone(from) : ZONE_NORMAL;
+
+            if (shifted.GetContent(tile) != content ||
+                shifted.GetZone(tile) != zone ||
+                shifted.IsWall(tile) != Tiles::IsWallContent(content))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// A shipped maze in the middle of a huge out of bounds area, like a big custom maze that's mostly filler
+static std::shared_ptr<Tiles> CreateSparseTiles(const Tiles& maze, ff::point_int size, ff::point_int offset)
+{
+    std::shared_ptr<Tiles> tiles = std::make_shared<Tiles>();
+    tiles->SetSize(size);
+    tiles->BeginChanges();
+
+    for (ff::point_int tile(0, 0); tile.y < size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < size.x; tile.x++)
+        {
+            tiles->SetZone(tile, ZONE_OUT_OF_BOUNDS);
+        }
+    }
+
+    for (ff::point_int tile(0, 0); tile.y < maze.GetSize().y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < maze.GetSize().x; tile.x++)
+        {
+            tiles->SetContent(tile + offset, maze.GetContent(tile));
+            tiles->SetZone(tile + offset, maze.GetZone(tile));
+        }
+    }
+
+    tiles->CommitChanges();
+    return tiles;
+}
+
+// Ghosts arriving at random junctions of a maze from random directions, they can go any way but back
+static std::vector<GhostDecision> CreateGhostDecisions(const Tiles& tiles, size_t nCount, size_t nGhosts, Random& random)
+{
+    std::vector<ff::point_int> junctions;
+
+    for (ff::point_int tile(0, 0); tile.y < tiles.GetSize().y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < tiles.GetSize().x; tile.x++)
+        {
+            if (!tiles.IsWall(tile) && tiles.GetZone(tile) != ZONE_OUT_OF_BOUNDS && CountExits(tiles.GetExits(tile)) > 2)
+            {
+                junctions.push_back(tile);
+            }
+        }
+    }
+
+    std::vector<GhostDecision> decisions;
+    decisions.reserve(junctions.empty() ? 0 : nCount);
+
+    for (size_t i = 0; i < nCount && !junctions.empty(); i++)
+    {
+        GhostDecision decision{};
+        decision._ghost = i % nGhosts;
+        decision._tile = junctions[random.Next(junctions.size())];
+
+        BYTE exits = tiles.GetExits(decision._tile);
+        size_t nBehind = random.Next(CountExits(exits));
+
+        for (BYTE exit = EXIT_UP; exit <= EXIT_RIGHT; exit <<= 1)
+        {
+            if ((exits & exit) && nBehind--)
+            {
+                decision._choices[decision._choiceCount++] = decision._tile + ExitToDir((TileExit)exit);
+            }
+        }
+
+        decisions.push_back(decision);
+    }
+
+    return decisions;
+}
+
+// Targets anywhere in the maze, including walls and a ring of tiles around the edge like the scatter corners.
+// Following targets stay near a tile that wanders around the maze, like ghosts chasing Pac.
+static std::vector<ff::point_int> CreateTargetPixels(const Tiles& tiles, size_t nCount, bool bFollowing, Random& random)
+{
+    std::vector<ff::point_int> targets;
+    targets.reserve(nCount);
+
+    ff::point_int size = tiles.GetSize();
+    ff::point_int wander(size.x / 2, size.y / 2);
+
+    for (size_t i = 0; i < nCount; i++)
+    {
+        ff::point_int tile((int)random.Next(size.x + 4) - 2, (int)random.Next(size.y + 4) - 2);
+
+        if (bFollowing)
+        {
+            if (!(i % FOLLOWING_TARGET_DECISIONS))
+            {
+                wander += ExitToDir((TileExit)(EXIT_UP << random.Next(4)));
+                wander = ff::point_int(std::clamp(wander.x, 0, size.x - 1), std::clamp(wander.y, 0, size.y - 1));
+            }
+
+            tile = wander + ff::point_int((int)random.Next(9) - 4, (int)random.Next(9) - 4);
+        }
+
+        targets.push_back(TileCenterToPixel(tile));
+    }
+
+    return targets;
+}
+
+// What PlayingMaze packs for the brains each step, read through the same calls that the brains make
+static GhostSnapshot GetGhostSnapshot(IPlayingMaze& play)
+{
+    GhostSnapshot snapshot{};
+    snapshot._pacPixel = play.GetPac()->GetPixel();
+    snapshot._pacDir = play.GetPac()->GetDir();
+    snapshot._mazeSize = play.GetMaze()->GetSizeInTiles();
+    snapshot._ghostStartPixel = play.GetGhostStartPixel();
+    snapshot._randomScatter = play.GetDifficulty().HasRandomGhostMovement(play.GetCharType());
+    snapshot._personalities = play.GetDifficulty()._personalities;
+    snapshot._distances = play.GetDifficulty().UsesPathTargeting() ? &play.GetMaze()->GetDistances() : nullptr;
+    snapshot._houseFlowField = &play.GetMaze()->GetHouseFlowField();
+
+    for (size_t i = 0; i < play.GetGhostCount(); i++)
+    {
+        snapshot._ghostPixels.push_back(play.GetGhost(i)->GetPixel());
+        snapshot._ghostStates.push_back(play.GetGhostState(i));
+    }
+
+    return snapshot;
+}
+
+SelfTest::SelfTest()
+    : _checks(0)
+    , _failures(0)
+{
+}
+
+SelfTest::~SelfTest()
+{
+}
+
+// static
+bool SelfTest::IsTestName(std::string_view name)
+{
+    if (name == "all")
+    {
+        return true;
+    }
+
+    for (const auto& test : GetTests())
+    {
+        if (test.first == name)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SelfTest::Run(std::string_view name)
+{
+    _report = ff::string::concat("Self test: ", name,
+#ifdef _DEBUG
+        ", debug build so the timings don't mean much",
+#endif
+        "\n");
+
+    for (const auto& test : GetTests())
+    {
+        if (name == "all" || name == test.first)
+        {
+            _report += ff::string::concat("  ", test.first, ":\n");
+            (this->*test.second)();
+        }
+    }
+
+    _report += ff::string::concat("  Checks: ", _checks, ", failed ", _failures, "\n");
+    return !_failures;
+}
+
+const std::string& SelfTest::GetReport() const
+{
+    return _report;
+}
+
+// static
+const std::vector<std::pair<std::string_view, SelfTest::TestFunc>>& SelfTest::GetTests()
+{
+    static const std::vector<std::pair<std::string_view, TestFunc>> s_tests =
+    {
+        { "walls", &SelfTest::TestWalls },
+        { "shift", &SelfTest::TestShift },
+        { "chunks", &SelfTest::TestChunks },
+        { "path", &SelfTest::TestPathTargeting },
+        { "swarm", &SelfTest::TestSwarm },
+        { "batch", &SelfTest::TestBatchDecisions },
+        { "record", &SelfTest::TestRecording },
+        { "autopilot", &SelfTest::TestAutopilot },
+    };
+
+    return s_tests;
+}
+
+// static
+std::vector<SelfTest::ShippedMaze> SelfTest::GetShippedMazes()
+{
+    std::vector<ShippedMaze> mazes;
+
+    for (std::string_view id : MazeCache::GetBuiltInMazesIds())
+    {
+        std::shared_ptr<IMazes> pMazes = MazeCache::Get().GetMazes(id);
+
+        for (size_t i = 0; pMazes && i < pMazes->GetMazeCount(); i++)
+        {
+            mazes.push_back(ShippedMaze{ ff::string::concat(id, " #", i + 1), pMazes->GetMaze(i) });
+        }
+    }
+
+    for (std::string_view name : MazeCache::GetBuiltInMazeNames())
+    {
+        std::shared_ptr<IMaze> pMaze = MazeCache::Get().GetMaze(name);
+        if (pMaze)
+        {
+            mazes.push_back(ShippedMaze{ std::string(name), pMaze });
+        }
+    }
+
+    return mazes;
+}
+
+void SelfTest::Check(bool bCondition, std::string_view what)
+{
+    _checks++;
+
+    if (!bCondition)
+    {
+        _failures++;
+        _report += ff::string::concat("    FAIL: ", what, "\n");
+    }
+}
+
+// The packed wall bits and exits have to agree with the content everywhere, including just outside the maze
+void SelfTest::TestWalls()
+{
+    std::vector<ShippedMaze> mazes = GetShippedMazes();
+    Check(!mazes.empty(), "shipped mazes load");
+
+    for (const ShippedMaze& shipped : mazes)
+    {
+        const IMaze& maze = *shipped._maze;
+        const Tiles& tiles = maze.GetTiles();
+        ff::point_int size = tiles.GetSize();
+        size_t nTiles = (size_t)(size.x + 2) * (size.y + 2);
+        size_t nPasses = std::max<size_t>(WALL_TEST_READS / nTiles, 1);
+        bool bSame = true;
+
+        for (ff::point_int tile(-1, -1); tile.y <= size.y; tile.y++)
+        {
+            for (tile.x = -1; tile.x <= size.x; tile.x++)
+            {
+                bSame &= Tiles::IsWallContent(maze.GetTileContent(tile)) == tiles.IsWall(tile);
+                bSame &= GetExitsFromContent(maze, tile) == tiles.GetExits(tile);
+            }
+        }
+
+        Check(bSame, ff::string::concat(shipped._name, " walls and exits match the content"));
+
+        size_t nContentWalls = 0;
+        size_t nPackedWalls = 0;
+        size_t nContentExits = 0;
+        size_t nPackedExits = 0;
+
+        double contentWall = TimePerItem(nPasses, nTiles, [&]()
+            {
+                for (ff::point_int tile(-1, -1); tile.y <= size.y; tile.y++)
+                {
+                    for (tile.x = -1; tile.x <= size.x; tile.x++)
+                    {
+                        nContentWalls += Tiles::IsWallContent(maze.GetTileContent(tile));
+                    }
+                }
+            });
+
+        double packedWall = TimePerItem(nPasses, nTiles, [&]()
+            {
+                for (ff::point_int tile(-1, -1); tile.y <= size.y; tile.y++)
+                {
+                    for (tile.x = -1; tile.x <= size.x; tile.x++)
+                    {
+                        nPackedWalls += tiles.IsWall(tile);
+                    }
+                }
+            });
+
+        double contentExits = TimePerItem(nPasses, nTiles, [&]()
+            {
+                for (ff::point_int tile(-1, -1); tile.y <= size.y; tile.y++)
+                {
+                    for (tile.x = -1; tile.x <= size.x; tile.x++)
+                    {
+                        nContentExits += GetExitsFromContent(maze, tile);
+                    }
+                }
+            });
+
+        double packedExits = TimePerItem(nPasses, nTiles, [&]()
+            {
+                for (ff::point_int tile(-1, -1); tile.y <= size.y; tile.y++)
+                {
+                    for (tile.x = -1; tile.x <= size.x; tile.x++)
+                    {
+                        nPackedExits += tiles.GetExits(tile);
+                    }
+                }
+            });
+
+        // The sums also keep the loops from being optimized away
+        Check(nContentWalls == nPackedWalls && nContentExits == nPackedExits, ff::string::concat(shipped._name, " timed passes agree"));
+
+        _report += ff::string::concat("    ", shipped._name, " (", size.x, "x", size.y, "), ns per tile: ",
+            "wall content=", contentWall, " packed=", packedWall,
+            ", exits content=", contentExits, " packed=", packedExits, "\n");
+    }
+}
+
+// Shifts copies of an odd sized maze every way, then times a big maze scrolling one row or column at a time.
+// The time is for all of Shift, which also rebuilds the walls, exits, and census and tells listeners.
+void SelfTest::TestShift()
+{
+    static const ff::point_int s_shifts[] =
+    {
+        ff::point_int(0, -1),
+        ff::point_int(-1, 0),
+        ff::point_int(0, 1),
+        ff::point_int(1, 0),
+        ff::point_int(-5, 3),
+        ff::point_int(7, -2),
+        ff::point_int(SHIFT_TEST_SIZE.x + 2, 1),
+        ff::point_int(-3, -2 * SHIFT_TEST_SIZE.y - 1),
+    };
+
+    for (bool bChunked : { false, true })
+    {
+        std::shared_ptr<Tiles> source = CreateRandomTiles(SHIFT_TEST_SIZE, bChunked, 1);
+        std::shared_ptr<Tiles> original = source->Clone();
+
+        for (bool bWrap : { false, true })
+        {
+            for (ff::point_int shift : s_shifts)
+            {
+                std::shared_ptr<Tiles> shifted = source->Clone();
+                shifted->Shift(shift, bWrap);
+
+                Check(IsShiftOf(*shifted, *source, shift, bWrap), ff::string::concat(
+                    bChunked ? "chunked" : "dense", bWrap ? " wrapped" : "", " shift by ", shift.x, ",", shift.y));
+            }
+        }
+
+        Check(IsShiftOf(*source, *original, ff::point_int(0, 0), false), ff::string::concat(bChunked ? "chunked" : "dense", " shifted copies leave the source alone"));
+    }
+
+    std::shared_ptr<Tiles> tiles = CreateRandomTiles(SHIFT_BENCH_SIZE, false, 2);
+    size_t nTiles = (size_t)SHIFT_BENCH_SIZE.x * SHIFT_BENCH_SIZE.y;
+
+    for (bool bWrap : { false, true })
+    {
+        for (ff::point_int shift : { ff::point_int(0, 1), ff::point_int(1, 0) })
+        {
+            double nanoseconds = TimePerItem(SHIFT_BENCH_PASSES, 1, [&]()
+                {
+                    tiles->Shift(shift, bWrap);
+                });
+
+            _report += ff::string::concat("    ", SHIFT_BENCH_SIZE.x, "x", SHIFT_BENCH_SIZE.y, bWrap ? " wrapped" : "",
+                " shift by ", shift.x, ",", shift.y, ": ", nanoseconds / 1000000.0, " ms, ", nanoseconds / nTiles, " ns per tile\n");
+        }
+    }
+}
+
+// Chunked storage has to read the same as dense storage, including the 3x3 neighbors that rendering reads
+// straight from memory. Then compares their memory and lookup speed on a huge maze that's mostly filler.
+void SelfTest::TestChunks()
+{
+    std::vector<ShippedMaze> mazes = GetShippedMazes();
+    if (mazes.empty())
+    {
+        Check(false, "shipped mazes load");
+        return;
+    }
+
+    const Tiles& maze = mazes.front()._maze->GetTiles();
+    ff::point_int offset = (CHUNK_BENCH_SIZE - maze.GetSize()) / 2;
+    std::shared_ptr<Tiles> dense = CreateSparseTiles(maze, CHUNK_BENCH_SIZE, offset);
+    std::shared_ptr<Tiles> chunked = dense->Clone();
+    chunked->SetChunked(true);
+
+    bool bSame = true;
+    for (ff::point_int tile(0, 0); tile.y < CHUNK_BENCH_SIZE.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < CHUNK_BENCH_SIZE.x; tile.x++)
+        {
+            bSame &= dense->GetContent(tile) == chunked->GetContent(tile) && dense->GetZone(tile) == chunked->GetZone(tile);
+            bSame &= dense->IsWall(tile) == chunked->IsWall(tile) && dense->GetExits(tile) == chunked->GetExits(tile);
+        }
+    }
+
+    Check(bSame, "chunked content, zones, walls, and exits match dense");
+
+    // The maze and the filler around it, crossing chunk edges
+    ff::point_int neighborsStart = offset - ff::point_int(2, 2);
+    ff::point_int neighborsEnd = offset + maze.GetSize() + ff::point_int(2, 2);
+    size_t nNeighborTiles = (size_t)(neighborsEnd.x - neighborsStart.x) * (neighborsEnd.y - neighborsStart.y);
+    bSame = true;
+
+    for (ff::point_int tile = neighborsStart; tile.y < neighborsEnd.y; tile.x = neighborsStart.x, tile.y++)
+    {
+        for (; tile.x < neighborsEnd.x; tile.x++)
+        {
+            TileContent denseContent[9], chunkedContent[9];
+            TileZone denseZone[9], chunkedZone[9];
+            dense->GetNeighbors(tile, denseContent, denseZone);
+            chunked->GetNeighbors(tile, chunkedContent, chunkedZone);
+
+            bSame &= !std::memcmp(denseContent, chunkedContent, sizeof(denseContent)) && !std::memcmp(denseZone, chunkedZone, sizeof(denseZone));
+        }
+    }
+
+    Check(bSame, "chunked neighbors match dense");
+
+    Random random(3);
+    std::vector<ff::point_int> lookups;
+    lookups.reserve(CHUNK_BENCH_LOOKUPS);
+
+    for (size_t i = 0; i < CHUNK_BENCH_LOOKUPS; i++)
+    {
+        lookups.emplace_back((int)random.Next(CHUNK_BENCH_SIZE.x), (int)random.Next(CHUNK_BENCH_SIZE.y));
+    }
+
+    size_t nDenseSum = 0;
+    size_t nChunkedSum = 0;
+    double times[4]{};
+    size_t nNeighborPasses = std::max<size_t>(CHUNK_BENCH_LOOKUPS / nNeighborTiles, 1);
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        const Tiles& tiles = i ? *chunked : *dense;
+        size_t& nSum = i ? nChunkedSum : nDenseSum;
+
+        times[i * 2] = TimePerItem(1, lookups.size(), [&]()
+            {
+                for (ff::point_int tile : lookups)
+                {
+                    nSum += (size_t)tiles.GetContent(tile) + (size_t)tiles.GetZone(tile);
+                }
+            });
+
+        times[i * 2 + 1] = TimePerItem(nNeighborPasses, nNeighborTiles, [&]()
+            {
+                for (ff::point_int tile = neighborsStart; tile.y < neighborsEnd.y; tile.x = neighborsStart.x, tile.y++)
+                {
+                    for (; tile.x < neighborsEnd.x; tile.x++)
+                    {
+                        TileContent content[9];
+                        TileZone zone[9];
+                        tiles.GetNeighbors(tile, content, zone);
+                        nSum += (size_t)content[4] + (size_t)zone[0] + (size_t)zone[8];
+                    }
+                }
+            });
+    }
+
+    Check(nDenseSum == nChunkedSum, "timed dense and chunked lookups agree");
+
+    _report += ff::string::concat("    ", CHUNK_BENCH_SIZE.x, "x", CHUNK_BENCH_SIZE.y, " around ", mazes.front()._name,
+        ", KB: dense=", dense->GetMemorySize() / 1024, " chunked=", chunked->GetMemorySize() / 1024, "\n",
+        "    ns per random lookup: dense=", times[0], " chunked=", times[2],
+        ", ns per 3x3 neighbors: dense=", times[1], " chunked=", times[3], "\n");
+}
+
+// Path targeting has to pick a choice with the shortest walk whenever every choice can walk to the target,
+// and a decision should cost no more than picking by straight line distance
+void SelfTest::TestPathTargeting()
+{
+    for (const ShippedMaze& shipped : GetShippedMazes())
+    {
+        const Tiles& tiles = shipped._maze->GetTiles();
+        const MazeDistances& distances = shipped._maze->GetDistances();
+        if (!distances.IsValid())
+        {
+            continue;
+        }
+
+        Random random(4);
+        std::vector<GhostDecision> decisions = CreateGhostDecisions(tiles, DECISION_BENCH_COUNT, 1, random);
+        std::string times;
+
+        for (bool bFollowing : { false, true })
+        {
+            std::vector<ff::point_int> targets = CreateTargetPixels(tiles, decisions.size(), bFollowing, random);
+            bool bShortest = true;
+            bool bSameDistances = true;
+
+            for (size_t i = 0; i < decisions.size(); i++)
+            {
+                const GhostDecision& decision = decisions[i];
+                ff::point_int targetTile = PixelToTile(targets[i]);
+                size_t nBest = ff::constants::invalid_unsigned<size_t>();
+                bool bAllWalk = true;
+                size_t dists[4];
+
+                distances.GetDistances(decision._choices, decision._choiceCount, targetTile, dists);
+
+                for (size_t h = 0; h < decision._choiceCount; h++)
+                {
+                    size_t nDist = distances.GetDistance(decision._choices[h], targetTile);
+                    bSameDistances &= nDist == dists[h];
+                    bAllWalk &= nDist != ff::constants::invalid_unsigned<size_t>();
+                    nBest = std::min(nBest, nDist);
+                }
+
+                ff::point_int choice = DecideForPathTarget(distances, targets[i], decision._choices, decision._choiceCount);
+                bShortest &= !bAllWalk || distances.GetDistance(choice, targetTile) == nBest;
+            }
+
+            Check(bSameDistances, ff::string::concat(shipped._name, " distances to a target match distances from it"));
+            Check(bShortest, ff::string::concat(shipped._name, " path targeting picks the shortest walk"));
+
+            int nEuclidSum = 0;
+            int nPathSum = 0;
+
+            double euclid = TimePerItem(1, decisions.size(), [&]()
+                {
+                    for (size_t i = 0; i < decisions.size(); i++)
+                    {
+                        ff::point_int choice = DecideForTarget(targets[i], decisions[i]._choices, decisions[i]._choiceCount);
+                        nEuclidSum += choice.x + choice.y;
+                    }
+                });
+
+            double path = TimePerItem(1, decisions.size(), [&]()
+                {
+                    for (size_t i = 0; i < decisions.size(); i++)
+                    {
+                        ff::point_int choice = DecideForPathTarget(distances, targets[i], decisions[i]._choices, decisions[i]._choiceCount);
+                        nPathSum += choice.x + choice.y;
+                    }
+                });
+
+            Check(nEuclidSum && nPathSum, ff::string::concat(shipped._name, " timed decisions ran"));
+            times += ff::string::concat(bFollowing ? ", following targets: " : "random targets: ", "straight line=", euclid, " path=", path);
+        }
+
+        _report += ff::string::concat("    ", shipped._name, ", ns per decision with ", times, "\n");
+    }
+}
+
+// Big swarms of ghosts have to all be in play, and a frame of them moving should fit in a 60 Hz frame on one core.
+// Only frames where ghosts are moving count, Pac stands still so the maze restarts whenever Pac is caught.
+// Ghosts that Pac could walk to are out of the house, only the ones with no dot counter get out without dots eaten.
+void SelfTest::TestSwarm()
+{
+    std::shared_ptr<IMazes> pMazes = MazeCache::Get().GetMazes(MazeCache::GetBuiltInMazesIds().front());
+    if (!pMazes || !pMazes->GetMazeCount() || !pMazes->GetDifficultyCount())
+    {
+        Check(false, "shipped mazes load");
+        return;
+    }
+
+    for (size_t nGhosts : { 64, 256, 1024 })
+    {
+        Difficulty difficulty = pMazes->GetDifficulty(0);
+        difficulty._ghostCount = nGhosts;
+
+        std::shared_ptr<IPlayingMaze> pPlay = IPlayingMaze::Create(pMazes->GetMaze(0), difficulty, nullptr, nGhosts);
+        std::vector<double> frameMicroseconds;
+        size_t nMostActive = 0;
+        size_t nMostRoaming = 0;
+        const MazeDistances& distances = pPlay->GetMaze()->GetDistances();
+        ff::point_int pacStart = pPlay->GetMaze()->GetTiles().GetCensus()._pacStart;
+
+        for (size_t nFrame = 0; nFrame < SWARM_MAX_FRAMES && frameMicroseconds.size() < SWARM_PLAYING_FRAMES; nFrame++)
+        {
+            if (pPlay->GetGameState() == GS_DIED || pPlay->GetGameState() == GS_WON)
+            {
+                pPlay->Reset();
+            }
+
+            bool bPlaying = pPlay->GetGameState() == GS_PLAYING;
+            auto frameStart = std::chrono::steady_clock::now();
+
+            pPlay->Advance();
+
+            if (bPlaying)
+            {
+                frameMicroseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count());
+
+                size_t nActive = 0;
+                size_t nRoaming = 0;
+                for (size_t i = 0; i < pPlay->GetGhostCount(); i++)
+                {
+                    nActive += pPlay->GetGhostState(i) != GHOST_INVALID;
+                    nRoaming += distances.GetDistance(pacStart, PixelToTile(pPlay->GetGhost(i)->GetPixel())) != ff::constants::invalid_unsigned<size_t>();
+                }
+
+                nMostActive = std::max(nMostActive, nActive);
+                nMostRoaming = std::max(nMostRoaming, nRoaming);
+            }
+        }
+
+        std::sort(frameMicroseconds.begin(), frameMicroseconds.end());
+        double p50 = frameMicroseconds.empty() ? 0.0 : frameMicroseconds[frameMicroseconds.size() / 2];
+        double p99 = frameMicroseconds.empty() ? 0.0 : frameMicroseconds[(frameMicroseconds.size() - 1) * 99 / 100];
+
+        Check(pPlay->GetGhostCount() == nGhosts && nMostActive == nGhosts, ff::string::concat(nGhosts, " ghosts are all in play"));
+        Check(nMostRoaming * 4 > nGhosts, ff::string::concat(nGhosts, " ghosts get out of the house"));
+        Check(frameMicroseconds.size() == SWARM_PLAYING_FRAMES, ff::string::concat(nGhosts, " ghosts played ", SWARM_PLAYING_FRAMES, " frames"));
+#ifndef _DEBUG
+        Check(p99 < 1000000.0 / IdealFramesPerSecondF(), ff::string::concat(nGhosts, " ghosts keep up with ", IdealFramesPerSecond(), " Hz"));
+#endif
+
+        _report += ff::string::concat("    ", nGhosts, " ghosts, us per frame: p50=", p50, " p99=", p99,
+            ", max=", frameMicroseconds.empty() ? 0.0 : frameMicroseconds.back(), ", most out of the house=", nMostRoaming, "\n");
+    }
+}
+
+// Deciding for every ghost at once has to pick the same as each ghost's brains deciding one at a time through the game,
+// with the same random numbers. The autopilot plays Pac, so ghosts also get scared and eaten.
+// Throughput is for a step's worth of decisions at a time, one for each ghost, while none of them are scared.
+void SelfTest::TestBatchDecisions()
+{
+    std::shared_ptr<IMazes> pMazes = MazeCache::Get().GetMazes(MazeCache::GetBuiltInMazesIds().front());
+    if (!pMazes || !pMazes->GetMazeCount() || !pMazes->GetDifficultyCount())
+    {
+        Check(false, "shipped mazes load");
+        return;
+    }
+
+    for (bool bPath : { false, true })
+    {
+        for (size_t nGhosts : { 4, 512 })
+        {
+            Difficulty difficulty = pMazes->GetDifficulty(0);
+            difficulty._ghostCount = nGhosts;
+            difficulty._pathTargeting = bPath;
+
+            std::shared_ptr<IPlayingMaze> pPlay = IPlayingMaze::Create(pMazes->GetMaze(0), difficulty, nullptr, 5);
+            const Tiles& tiles = pPlay->GetMaze()->GetTiles();
+            std::shared_ptr<IPacController> pController = IPacController::CreateAutopilot();
+            std::vector<std::shared_ptr<IGhostBrains>> brains;
+            size_t stateCounts[GHOST_EYES + 1]{};
+            std::vector<BYTE> benchState; // the last frame with no scared ghosts or eyes
+            Random random(6);
+            bool bSame = true;
+
+            for (size_t i = 0; i < nGhosts; i++)
+            {
+                brains.push_back(IGhostBrains::Create(i, GetGhostPersonality(i)));
+            }
+
+            for (size_t nFrame = 0; nFrame < BATCH_PLAY_FRAMES; nFrame++)
+            {
+                if (pPlay->GetGameState() == GS_DIED || pPlay->GetGameState() == GS_WON)
+                {
+                    pPlay->Reset();
+                }
+
+                pPlay->GetPac()->SetPressDir(pController->GetPressDir(pPlay.get()));
+
+                pPlay->Advance();
+
+                if (pPlay->GetGameState() != GS_PLAYING)
+                {
+                    continue;
+                }
+
+                GhostSnapshot snapshot = GetGhostSnapshot(*pPlay);
+                std::vector<GhostDecision> decisions = CreateGhostDecisions(tiles, nGhosts, nGhosts, random);
+                Random batchRandom = pPlay->GetRandom();
+
+                DecideGhosts(snapshot, decisions.data(), decisions.size(), batchRandom);
+
+                for (const GhostDecision& decision : decisions)
+                {
+                    bSame &= decision._result == brains[decision._ghost]->Decide(pPlay.get(), decision._choices, decision._choiceCount);
+                    stateCounts[snapshot._ghostStates[decision._ghost]]++;
+                }
+
+                // Both used up the same random numbers
+                bSame &= batchRandom.Next() == pPlay->GetRandom().Next();
+
+                if (std::all_of(snapshot._ghostStates.begin(), snapshot._ghostStates.end(),
+                    [](GhostState state) { return state == GHOST_CHASE || state == GHOST_SCATTER; }))
+                {
+                    benchState.resize(pPlay->GetSnapshotSize());
+                    verify(pPlay->SaveSnapshot(benchState.data(), benchState.size()));
+                }
+            }
+
+            std::string_view mode = bPath ? "path targeting" : "straight line";
+            Check(bSame, ff::string::concat(nGhosts, " ghosts with ", mode, " decide the same in a batch as through their brains"));
+            Check(stateCounts[GHOST_CHASE] && stateCounts[GHOST_SCATTER] && stateCounts[GHOST_SCARED] && stateCounts[GHOST_EYES],
+                ff::string::concat(nGhosts, " ghosts with ", mode, " decided in every state"));
+
+            // Time every ghost following its target, scared ghosts just pick at random
+            if (benchState.empty() || !pPlay->LoadSnapshot(benchState.data(), benchState.size()))
+            {
+                Check(false, ff::string::concat(nGhosts, " ghosts with ", mode, " had a frame to time decisions in"));
+                return;
+            }
+
+            GhostSnapshot snapshot = GetGhostSnapshot(*pPlay);
+            std::vector<GhostDecision> decisions = CreateGhostDecisions(tiles, BATCH_BENCH_DECISIONS, nGhosts, random);
+            if (decisions.size() != BATCH_BENCH_DECISIONS)
+            {
+                Check(false, ff::string::concat(nGhosts, " ghosts with ", mode, " made decisions to time"));
+                return;
+            }
+
+            size_t nSteps = decisions.size() / nGhosts;
+            int nSum = 0;
+
+            double batch = TimePerItem(1, decisions.size(), [&]()
+                {
+                    for (size_t i = 0; i < nSteps; i++)
+                    {
+                        DecideGhosts(snapshot, &decisions[i * nGhosts], nGhosts, random);
+                    }
+                });
+
+            // What the game did before batches, calling back into it for everything each ghost looks at
+            double callbacks = TimePerItem(1, decisions.size(), [&]()
+                {
+                    for (const GhostDecision& decision : decisions)
+                    {
+                        ff::point_int choice = brains[decision._ghost]->Decide(pPlay.get(), decision._choices, decision._choiceCount);
+                        nSum += choice.x + choice.y;
+                    }
+                });
+
+            Check(nSum != 0, ff::string::concat(nGhosts, " ghosts with ", mode, " timed decisions ran"));
+
+            _report += ff::string::concat("    ", nGhosts, " ghosts with ", mode,
+                ", decisions checked: chase=", stateCounts[GHOST_CHASE], " scatter=", stateCounts[GHOST_SCATTER],
+                " scared=", stateCounts[GHOST_SCARED] + stateCounts[GHOST_SCARED_FLASH], " eyes=", stateCounts[GHOST_EYES],
+                ", million decisions per second: batch=", 1000.0 / batch, " through brains=", 1000.0 / callbacks, "\n");
+        }
+    }
+}
+
+// Recording the replay and the rewind buffer has to cost less than 2% of a frame, which is the autopilot picking a press
+// and then the game advancing, the same as -headless counts it. Two autopilots play the same game, one without
+// recording. They take turns a block of frames at a time so that both see the same caches and clock speed, and each
+// block's fastest time from a few passes counts, to ignore interruptions.
+void SelfTest::TestRecording()
+{
+    std::shared_ptr<IMazes> pMazes = MazeCache::Get().GetMazes(MazeCache::GetBuiltInMazesIds().front());
+    if (!pMazes || !pMazes->GetMazeCount())
+    {
+        Check(false, "shipped mazes load");
+        return;
+    }
+
+    size_t nBlocks = RECORD_BENCH_FRAMES / RECORD_BENCH_BLOCK_FRAMES;
+    std::vector<double> blockMicroseconds[2] =
+    {
+        std::vector<double>(nBlocks, std::numeric_limits<double>::max()),
+        std::vector<double>(nBlocks, std::numeric_limits<double>::max()),
+    };
+    bool bSame = true;
+    bool bRewind[2]{};
+    size_t nFrames[2]{};
+    size_t nReplayFrames[2]{};
+
+    for (size_t nPass = 0; nPass < RECORD_BENCH_PASSES; nPass++)
+    {
+        std::shared_ptr<IPlayingGame> games[2];
+        std::shared_ptr<IPacController> controllers[2];
+
+        for (size_t i = 0; i < 2; i++)
+        {
+            games[i] = IPlayingGame::Create(pMazes, 1, nullptr, 7);
+            games[i]->SetRecording(!i);
+            controllers[i] = IPacController::CreateAutopilot();
+            nFrames[i] = 0;
+        }
+
+        for (size_t nBlock = 0; nBlock < nBlocks; nBlock++)
+        {
+            // Whichever goes first could be slower, so it switches every block
+            for (size_t nTurn = 0; nTurn < 2; nTurn++)
+            {
+                size_t i = (nTurn + nBlock) % 2;
+                auto blockStart = std::chrono::steady_clock::now();
+
+                for (size_t nFrame = 0; nFrame < RECORD_BENCH_BLOCK_FRAMES && !games[i]->IsGameOver(); nFrame++, nFrames[i]++)
+                {
+                    std::shared_ptr<IPlayer> pPlayer = games[i]->GetPlayer(games[i]->GetCurrentPlayer());
+                    std::shared_ptr<IPlayingMaze> pPlay = pPlayer ? pPlayer->GetPlayingMaze() : nullptr;
+                    if (pPlay)
+                    {
+                        pPlay->GetPac()->SetPressDir(controllers[i]->GetPressDir(pPlay.get()));
+                    }
+
+                    games[i]->Advance();
+                    bRewind[i] |= games[i]->CanRewind();
+                }
+
+                double blockTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - blockStart).count();
+                blockMicroseconds[i][nBlock] = std::min(blockMicroseconds[i][nBlock], blockTime);
+            }
+        }
+
+        bSame &= nFrames[0] == nFrames[1] &&
+            games[0]->IsGameOver() == games[1]->IsGameOver() &&
+            games[0]->GetPlayer(0)->GetScore() == games[1]->GetPlayer(0)->GetScore() &&
+            games[0]->GetPlayer(0)->GetLevel() == games[1]->GetPlayer(0)->GetLevel();
+
+        for (size_t i = 0; i < 2; i++)
+        {
+            nReplayFrames[i] = games[i]->GetReplay()->GetFrameCount();
+        }
+    }
+
+    double microseconds[2] =
+    {
+        std::accumulate(blockMicroseconds[0].begin(), blockMicroseconds[0].end(), 0.0),
+        std::accumulate(blockMicroseconds[1].begin(), blockMicroseconds[1].end(), 0.0),
+    };
+
+    size_t nFrameCount = std::max<size_t>(nFrames[0], 1);
+    double overhead = nFrames[0] ? microseconds[0] / microseconds[1] - 1.0 : 0.0;
+
+    Check(nFrames[0] > 0, "the autopilot played a game to record");
+    Check(bSame, "games play the same with and without recording");
+    Check(bRewind[0] && !bRewind[1], "only the recorded game can rewind");
+    Check(nReplayFrames[0] == nFrames[0] && !nReplayFrames[1], "only the recorded game has a replay");
+#ifndef _DEBUG
+    Check(overhead < RECORD_MAX_OVERHEAD, ff::string::concat("recording costs less than ", RECORD_MAX_OVERHEAD * 100.0, "% of a frame"));
+#endif
+
+    _report += ff::string::concat("    ", nFrames[0], " frames, us per frame: recording=", microseconds[0] / nFrameCount,
+        " not recording=", microseconds[1] / nFrameCount, ", overhead=", overhead * 100.0, "%\n");
+}
+
+// The autopilot has to clear early levels and pick presses in well under 50 us on average. It plays a whole game, and
+// only frames where Pac can move are timed since it doesn't think during the others.
+void SelfTest::TestAutopilot()
+{
+    std::shared_ptr<IMazes> pMazes = MazeCache::Get().GetMazes(MazeCache::GetBuiltInMazesIds().front());
+    if (!pMazes || !pMazes->GetMazeCount())
+    {
+        Check(false, "shipped mazes load");
+        return;
+    }
+
+    std::shared_ptr<IPlayingGame> pGame = IPlayingGame::Create(pMazes, 1, nullptr, 7);
+    std::shared_ptr<IPacController> pController = IPacController::CreateAutopilot();
+    std::vector<double> frameMicroseconds;
+    size_t nLevels = 0;
+
+    for (size_t nFrame = 0; nFrame < AUTOPILOT_MAX_FRAMES && !pGame->IsGameOver(); nFrame++)
+    {
+        std::shared_ptr<IPlayer> pPlayer = pGame->GetPlayer(pGame->GetCurrentPlayer());
+        std::shared_ptr<IPlayingMaze> pPlay = pPlayer ? pPlayer->GetPlayingMaze() : nullptr;
+        if (pPlay)
+        {
+            bool bPlaying = pPlay->GetGameState() == GS_PLAYING;
+            auto frameStart = std::chrono::steady_clock::now();
+
+            ff::point_int press = pController->GetPressDir(pPlay.get());
+
+            if (bPlaying)
+            {
+                frameMicroseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - frameStart).count());
+            }
+
+            pPlay->GetPac()->SetPressDir(press);
+        }
+
+        pGame->Advance();
+        nLevels = std::max(nLevels, pGame->GetPlayer(0)->GetLevel());
+    }
+
+    std::sort(frameMicroseconds.begin(), frameMicroseconds.end());
+    double mean = std::accumulate(frameMicroseconds.begin(), frameMicroseconds.end(), 0.0) / std::max<size_t>(frameMicroseconds.size(), 1);
+    double p50 = frameMicroseconds.empty() ? 0.0 : frameMicroseconds[frameMicroseconds.size() / 2];
+    double p99 = frameMicroseconds.empty() ? 0.0 : frameMicroseconds[(frameMicroseconds.size() - 1) * 99 / 100];
+
+    Check(nLevels >= AUTOPILOT_MIN_LEVELS, ff::string::concat("the autopilot clears at least ", AUTOPILOT_MIN_LEVELS, " level"));
+#ifndef _DEBUG
+    Check(mean < AUTOPILOT_MAX_MICROSECONDS, ff::string::concat("the autopilot picks a press in less than ", AUTOPILOT_MAX_MICROSECONDS, " us"));
+#endif
+
+    _report += ff::string::concat("    ", frameMicroseconds.size(), " frames, levels cleared=", nLevels, ", us per press: mean=", mean,
+        " p50=", p50, " p99=", p99, ", max=", frameMicroseconds.empty() ? 0.0 : frameMicroseconds.back(), "\n");
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+class IMaze;
+
+// Checks that the fast tile and ghost code agrees with the simple code it replaced, and times them against each other.
+// Run with "-headless -selftest <name>". Timings are only worth reading in release builds.
+class SelfTest
+{
+public:
+    SelfTest();
+    ~SelfTest();
+
+    static bool IsTestName(std::string_view name);
+
+    // "all" runs every test. Returns false when any check failed.
+    bool Run(std::string_view name);
+    const std::string& GetReport() const;
+
+private:
+    struct ShippedMaze
+    {
+        std::string _name;
+        std::shared_ptr<IMaze> _maze;
+    };
+
+    typedef void (SelfTest::* TestFunc)();
+    static const std::vector<std::pair<std::string_view, TestFunc>>& GetTests();
+    static std::vector<ShippedMaze> GetShippedMazes();
+
+    void Check(bool bCondition, std::string_view what);
+    void TestWalls();
+    void TestShift();
+    void TestChunks();
+    void TestPathTargeting();
+    void TestSwarm();
+    void TestBatchDecisions();
+    void TestRecording();
+    void TestAutopilot();
+
+    std::string _report;
+    size_t _checks;
+    size_t _failures;
+};
@@ -0,0 +1,142 @@
+#include "pch.h"
+#include "Core/StaticTiles.h"
+#include "Core/Tiles.h"
+
+// These front-end layouts never change, so they get parsed by the compiler instead of at startup.
+// They aren't in Values.Tiles.res.json, CreateTilesFromValues finds them here.
+
+static constexpr char s_titleFrontRows[][15] =
+{
+    "XXXXXXXXXXXXXX",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "XXXX          ",
+    "|||X          ",
+    "|||X          ",
+    "|||X          ",
+    "XXXX          ",
+    "====          ",
+    "XXXX          ",
+    "|||X          ",
+    "|||X          ",
+    "|||X          ",
+    "XXXX          ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "XXX           ",
+    "XXX           ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "XXXXXXXXXXXXXX",
+};
+
+static constexpr char s_titleBackRows[][15] =
+{
+    "XXXXXXXXXXXXXX",
+    "X             ",
+    "X XXXXX XXXX X",
+    "X,XXXXX XXXX X",
+    "X XXXXX XXXX X",
+    "X            X",
+    "X XXXXX XXXXXX",
+    "X XXXXX XXXXXX",
+    "X    XX       ",
+    "XXXX XX XXXXXX",
+    "|||X XX XXXXXX",
+    "|||X XX       ",
+    "|||X XXXX OOO-",
+    "XXXX XXXX O|||",
+    "====      O|||",
+    "XXXX XXXX O|||",
+    "|||X XXXX OOOO",
+    "|||X XXXX     ",
+    "|||X XXXX XXXX",
+    "XXXX XXXX XXXX",
+    "X            X",
+    "X XXXXXXX XX X",
+    "X XXXXXXX XX X",
+    "X         XX X",
+    "XXX XX XX XX +",
+    "XXX XX XX XX X",
+    "X   XX XX    X",
+    "X,XXXX XXXXX X",
+    "X XXXX XXXXX X",
+    "X            X",
+    "XXXXXXXXXXXXXX",
+};
+
+static constexpr char s_highScoreRows[][15] =
+{
+    "XXXXXXXXXXXXXX",
+    "X             ",
+    "X      XXXXXXX",
+    "X      XXXXXXX",
+    "X      XX     ",
+    "X      XXXXXXX",
+    "X      XXXXXXX",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "X             ",
+    "XXXXXXXXXXXXXX",
+};
+
+static_assert(IsValidHalfTiles(s_titleFrontRows));
+static_assert(IsValidHalfTiles(s_titleBackRows));
+static_assert(IsValidHalfTiles(s_highScoreRows));
+
+static constexpr auto s_titleFront = ParseStaticHalfTiles(s_titleFrontRows);
+static constexpr auto s_titleBack = ParseStaticHalfTiles(s_titleBackRows);
+static constexpr auto s_highScore = ParseStaticHalfTiles(s_highScoreRows);
+
+// Only the back title maze has a ghost house, the others are just decoration
+static_assert(s_titleBack.Contains(CONTENT_GHOST_DOOR) && s_titleBack.Contains(CONTENT_PAC_START));
+
+std::shared_ptr<Tiles> CreateBuiltInTiles(std::string_view name)
+{
+    if (name == "title-tiles-front")
+    {
+        return CreateStaticTiles(s_titleFront);
+    }
+
+    if (name == "title-tiles-back")
+    {
+        return CreateStaticTiles(s_titleBack);
+    }
+
+    if (name == "high-score-tiles")
+    {
+        return CreateStaticTiles(s_highScore);
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Core/Tiles.h"
+
+// Tile string characters, shared by the runtime parser and the compile time parser
+
+constexpr TileContent TileCharToContent(char ch)
+{
+    switch (ch)
+    {
+        case 'X': return CONTENT_WALL;
+        case 'O': return CONTENT_GHOST_WALL;
+        case '-': return CONTENT_GHOST_DOOR;
+        case '+': return CONTENT_PAC_START;
+        case '.': return CONTENT_DOT;
+        case ',': return CONTENT_POWER;
+        default: return CONTENT_NOTHING;
+    }
+}
+
+constexpr TileZone TileCharToZone(char ch)
+{
+    switch (ch)
+    {
+        case '=': return ZONE_GHOST_SLOW;
+        case '*': return ZONE_GHOST_NO_TURN;
+        case '|': return ZONE_OUT_OF_BOUNDS;
+        default: return ZONE_NORMAL;
+    }
+}
+
+constexpr bool IsValidTileChar(char ch)
+{
+    return ch == ' ' || TileCharToContent(ch) != CONTENT_NOTHING || TileCharToZone(ch) != ZONE_NORMAL;
+}
+
+// A no-turn tile next to a dot also gets a dot
+constexpr TileContent TileStringContent(const char* pRow, int x, int nWidth)
+{
+    if (pRow[x] == '*' && ((x > 0 && pRow[x - 1] == '.') || (x + 1 < nWidth && pRow[x + 1] == '.')))
+    {
+        return CONTENT_DOT;
+    }
+
+    return TileCharToContent(pRow[x]);
+}
+
+// Tile planes built at compile time, in the same layout that Tiles uses so it can view them directly
+template<int Width, int Height>
+struct StaticTiles
+{
+    static constexpr int WallStride = (Width + 63) / 64;
+
+    TileContent _content[Width * Height]{};
+    TileZone _zone[Width * Height]{};
+    uint64_t _walls[WallStride * Height]{};
+    BYTE _exits[Width * Height]{};
+
+    constexpr bool IsWall(int x, int y) const
+    {
+        return x >= 0 && x < Width && y >= 0 && y < Height && ((_walls[y * WallStride + (x >> 6)] >> (x & 63)) & 1) != 0;
+    }
+
+    constexpr bool Contains(TileContent content) const
+    {
+        for (TileContent tileContent : _content)
+        {
+            if (tileContent == content)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+// Every row must be full width and only use known characters
+template<size_t Height, size_t RowSize>
+constexpr bool IsValidHalfTiles(const char (&rows)[Height][RowSize])
+{
+    if (Height == 0 || RowSize < 2)
+    {
+        return false;
+    }
+
+    for (size_t y = 0; y < Height; y++)
+    {
+        for (size_t x = 0; x + 1 < RowSize; x++)
+        {
+            if (!IsValidTileChar(rows[y][x]))
+            {
+                return false;
+            }
+        }
+
+        if (rows[y][RowSize - 1])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Same as mirroring "half-tiles" at runtime, each row is the left half of the maze
+template<size_t Height, size_t RowSize>
+constexpr StaticTiles<(int)(RowSize - 1) * 2, (int)Height> ParseStaticHalfTiles(const char (&rows)[Height][RowSize])
+{
+    constexpr int nHalfWidth = (int)(RowSize - 1);
+    constexpr int nWidth = nHalfWidth * 2;
+    static_assert(nWidth % 2 == 0);
+
+    StaticTiles<nWidth, (int)Height> tiles{};
+
+    for (int y = 0; y < (int)Height; y++)
+    {
+        for (int x = 0; x < nHalfWidth; x++)
+        {
+            TileContent content = TileStringContent(rows[y], x, nHalfWidth);
+            TileZone zone = TileCharToZone(rows[y][x]);
+
+            for (int tileX : { x, nWidth - 1 - x })
+            {
+                tiles._content[y * nWidth + tileX] = content;
+                tiles._zone[y * nWidth + tileX] = zone;
+
+                if (Tiles::IsWallContent(content))
+                {
+                    tiles._walls[y * tiles.WallStride + (tileX >> 6)] |= (uint64_t)1 << (tileX & 63);
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < (int)Height; y++)
+    {
+        for (int x = 0; x < nWidth; x++)
+        {
+            tiles._exits[y * nWidth + x] = (BYTE)(
+                (!tiles.IsWall(x, y - 1) ? EXIT_UP : EXIT_NONE) |
+                (!tiles.IsWall(x - 1, y) ? EXIT_LEFT : EXIT_NONE) |
+                (!tiles.IsWall(x, y + 1) ? EXIT_DOWN : EXIT_NONE) |
+                (!tiles.IsWall(x + 1, y) ? EXIT_RIGHT : EXIT_NONE));
+        }
+    }
+
+    return tiles;
+}
+
+// Wraps static tile data without copying it, until something changes
+template<int Width, int Height>
+std::shared_ptr<Tiles> CreateStaticTiles(const StaticTiles<Width, Height>& data)
+{
+    std::shared_ptr<Tiles> tiles = std::make_shared<Tiles>();
+    tiles->SetView(
+        ff::point_int(Width, Height),
+        std::shared_ptr<const void>(std::shared_ptr<const void>(), &data), // doesn't own the static data
+        data._content,
+        data._zone,
+        data._walls,
+        data._exits);
+
+    return tiles;
+}
+
+// Returns nullptr when the name isn't a layout that's built into the code
+std::shared_ptr<Tiles> CreateBuiltInTiles(std::string_view name);
@@ -58,7 +58,7 @@ size_t Stats::GetHighScoreSlot(size_t nScore)
     return ff::constants::invalid_unsigned<size_t>();
 }
 
-void Stats::InsertHighScore(size_t nScore, size_t nLevel, const std::string& szName)
+size_t Stats::InsertHighScore(size_t nScore, size_t nLevel, const std::string& szName)
 {
     size_t nSlot = GetHighScoreSlot(nScore);
 
@@ -86,6 +86,8 @@ void Stats::InsertHighScore(size_t nScore, size_t nLevel, const std::string& szN
 
         _highScores[nSlot] = hs;
     }
+
+    return nSlot;
 }
 
 static std::string_view s_scores = "Scores";
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Core/Actors.h"
+
 struct Stats
 {
     struct HighScore
@@ -16,8 +18,8 @@ struct Stats
     DWORD _dotsEaten;
     DWORD _powerEaten;
     DWORD _fruitsEaten;
-    DWORD _ghostsEaten[4];
-    DWORD _ghostDeathCount[4];
+    DWORD _ghostsEaten[GHOST_PERSONALITY_COUNT]; // per personality
+    DWORD _ghostDeathCount[GHOST_PERSONALITY_COUNT]; // per personality
     DWORD _tunnelsUsed;
     DWORD _score;
     HighScore _highScores[10];
@@ -31,7 +33,7 @@ struct Stats
     Stats& operator+=(const Stats& rhs);
 
     size_t GetHighScoreSlot(size_t nScore);
-    void InsertHighScore(size_t nScore, size_t nLevel, const std::string& szName);
+    size_t InsertHighScore(size_t nScore, size_t nLevel, const std::string& szName); // returns the slot
 
     static void Load();
     static void Save();
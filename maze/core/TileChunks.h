@@ -0,0 +1,420 @@
+#pragma once
+
+// A plane of tile values stored in 32x32 chunks, for very large mazes that are mostly filler.
+// Chunks are shared by copies of the plane until one of them writes to it, and all chunks that
+// only hold one value (like the fill value) can share the same memory. The parts of edge chunks
+// that are outside of the size always hold the fill value.
+template<typename T>
+class TileChunks
+{
+public:
+    static const int CHUNK_SHIFT = 5;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+
+    using Chunk = std::array<T, CHUNK_SIZE * CHUNK_SIZE>;
+
+    TileChunks(T fill = T{})
+        : _fill(fill)
+        , _size(0, 0)
+        , _cols(0)
+    {
+    }
+
+    ff::point_int GetSize() const
+    {
+        return _size;
+    }
+
+    // Throws away all old values
+    void SetSize(ff::point_int size)
+    {
+        _size = size;
+        _cols = (size.x + CHUNK_MASK) >> CHUNK_SHIFT;
+        _chunks.assign(_cols * ((size.y + CHUNK_MASK) >> CHUNK_SHIFT), GetUniformChunk(_fill));
+    }
+
+    // Keeps the values that are still within the new size, new tiles get the fill value.
+    // Chunks only move around in the table, none of them are copied.
+    void Resize(ff::point_int size)
+    {
+        size_t nOldCols = _cols;
+        size_t nOldRows = GetRowCount(_size);
+        size_t nCols = (size.x + CHUNK_MASK) >> CHUNK_SHIFT;
+        size_t nRows = GetRowCount(size);
+        size_t nKeepCols = std::min(nCols, nOldCols);
+        size_t nKeepRows = std::min(nRows, nOldRows);
+
+        // Rows that get wider move from the end of the table, rows that get narrower move from the start
+
+        _chunks.resize(std::max(_chunks.size(), nCols * nRows));
+
+        if (nCols > nOldCols)
+        {
+            for (size_t y = nKeepRows; y-- > 0; )
+            {
+                std::move_backward(&_chunks[y * nOldCols], &_chunks[y * nOldCols + nKeepCols], &_chunks[y * nCols + nKeepCols]);
+            }
+        }
+        else if (nCols < nOldCols)
+        {
+            for (size_t y = 0; y < nKeepRows; y++)
+            {
+                std::move(&_chunks[y * nOldCols], &_chunks[y * nOldCols + nKeepCols], &_chunks[y * nCols]);
+            }
+        }
+
+        _chunks.resize(nCols * nRows);
+        std::shared_ptr<Chunk> fill = GetUniformChunk(_fill);
+
+        for (size_t y = 0; y < nRows; y++)
+        {
+            for (size_t x = (y < nKeepRows) ? nKeepCols : 0; x < nCols; x++)
+            {
+                _chunks[y * nCols + x] = fill;
+            }
+        }
+
+        _size = size;
+        _cols = nCols;
+        FillOutside();
+    }
+
+    // Moves every value by shift. Values that move off an edge come back on the other side when wrapping,
+    // otherwise they're gone and the fill value moves in. Shifting by whole chunks only moves chunks around
+    // in the table. Other shifts have to build new chunks, except where all of a chunk's values come from
+    // chunks that only hold the same one value.
+    void Shift(ff::point_int shift, bool bWrap)
+    {
+        if (!_size.x || !_size.y)
+        {
+            return;
+        }
+
+        if (bWrap)
+        {
+            shift.x = ((shift.x % _size.x) + _size.x) % _size.x;
+            shift.y = ((shift.y % _size.y) + _size.y) % _size.y;
+        }
+
+        bool bWholeChunks = !((shift.x | shift.y) & CHUNK_MASK) && (!bWrap || !((_size.x | _size.y) & CHUNK_MASK));
+
+        if (bWholeChunks)
+        {
+            ShiftWholeChunks(ff::point_int(shift.x >> CHUNK_SHIFT, shift.y >> CHUNK_SHIFT), bWrap);
+        }
+        else
+        {
+            ShiftTiles(shift, bWrap);
+        }
+    }
+
+    T GetFill() const
+    {
+        return _fill;
+    }
+
+    // The tile must be within the size
+    T Get(ff::point_int tile) const
+    {
+        return (*_chunks[GetChunkIndex(tile)])[GetIndexInChunk(tile)];
+    }
+
+    void Set(ff::point_int tile, T value)
+    {
+        std::shared_ptr<Chunk>& chunk = _chunks[GetChunkIndex(tile)];
+        size_t nIndex = GetIndexInChunk(tile);
+
+        if ((*chunk)[nIndex] != value)
+        {
+            if (chunk.use_count() > 1)
+            {
+                chunk = std::make_shared<Chunk>(*chunk);
+            }
+
+            (*chunk)[nIndex] = value;
+        }
+    }
+
+    // Points to the tile's value, the rest of its chunk row follows it and the next row is CHUNK_SIZE away
+    const T* GetData(ff::point_int tile) const
+    {
+        return _chunks[GetChunkIndex(tile)]->data() + GetIndexInChunk(tile);
+    }
+
+    static bool IsSameChunk(ff::point_int tile1, ff::point_int tile2)
+    {
+        return !(((tile1.x ^ tile2.x) | (tile1.y ^ tile2.y)) >> CHUNK_SHIFT);
+    }
+
+    // Lets chunks that ended up holding one value share memory again
+    void Compact()
+    {
+        for (std::shared_ptr<Chunk>& chunk : _chunks)
+        {
+            T value = chunk->front();
+
+            if (std::all_of(chunk->begin(), chunk->end(), [value](T other) { return other == value; }))
+            {
+                chunk = GetUniformChunk(value);
+            }
+        }
+    }
+
+    // Bytes used by chunks that aren't shared with a uniform chunk
+    size_t GetMemorySize() const
+    {
+        size_t nSize = _chunks.size() * sizeof(std::shared_ptr<Chunk>) + _uniformChunks.size() * sizeof(Chunk);
+
+        for (const std::shared_ptr<Chunk>& chunk : _chunks)
+        {
+            if (std::find(_uniformChunks.begin(), _uniformChunks.end(), chunk) == _uniformChunks.end())
+            {
+                nSize += sizeof(Chunk);
+            }
+        }
+
+        return nSize;
+    }
+
+private:
+    static size_t GetRowCount(ff::point_int size)
+    {
+        return (size.y + CHUNK_MASK) >> CHUNK_SHIFT;
+    }
+
+    void ShiftWholeChunks(ff::point_int chunkShift, bool bWrap)
+    {
+        int nCols = (int)_cols;
+        int nRows = (int)GetRowCount(_size);
+        std::shared_ptr<Chunk> fill = GetUniformChunk(_fill);
+
+        if (bWrap)
+        {
+            std::rotate(_chunks.begin(), _chunks.end() - chunkShift.y * nCols, _chunks.end());
+
+            for (int y = 0; y < nRows && chunkShift.x; y++)
+            {
+                auto row = _chunks.begin() + y * nCols;
+                std::rotate(row, row + nCols - chunkShift.x, row + nCols);
+            }
+
+            return;
+        }
+
+        // Same as ShiftPlane in Tiles.cpp, but with chunk pointers
+
+        chunkShift.x = std::clamp(chunkShift.x, -nCols, nCols);
+        chunkShift.y = std::clamp(chunkShift.y, -nRows, nRows);
+        int nMoveRows = nRows - std::abs(chunkShift.y);
+        int nMoveCols = nCols - std::abs(chunkShift.x);
+
+        if (chunkShift.y > 0)
+        {
+            std::move_backward(_chunks.begin(), _chunks.begin() + nMoveRows * nCols, _chunks.end());
+            std::fill(_chunks.begin(), _chunks.begin() + chunkShift.y * nCols, fill);
+        }
+        else if (chunkShift.y < 0)
+        {
+            std::move(_chunks.begin() - chunkShift.y * nCols, _chunks.end(), _chunks.begin());
+            std::fill(_chunks.begin() + nMoveRows * nCols, _chunks.end(), fill);
+        }
+
+        for (int y = 0; y < nRows && chunkShift.x; y++)
+        {
+            auto row = _chunks.begin() + y * nCols;
+
+            if (chunkShift.x > 0)
+            {
+                std::move_backward(row, row + nMoveCols, row + nCols);
+                std::fill(row, row + chunkShift.x, fill);
+            }
+            else
+            {
+                std::move(row - chunkShift.x, row + nCols, row);
+                std::fill(row + nMoveCols, row + nCols, fill);
+            }
+        }
+
+        // Chunks that moved to the right or bottom edge may have values outside of the size now
+        FillOutside();
+    }
+
+    void ShiftTiles(ff::point_int shift, bool bWrap)
+    {
+        // Where each column and row of the table gets its values from, or -1 for the fill value
+
+        std::vector<int> fromX(_cols << CHUNK_SHIFT, -1);
+        std::vector<int> fromY(GetRowCount(_size) << CHUNK_SHIFT, -1);
+
+        for (int x = 0; x < _size.x; x++)
+        {
+            int nFrom = bWrap ? (x - shift.x + _size.x) % _size.x : x - shift.x;
+            fromX[x] = (nFrom >= 0 && nFrom < _size.x) ? nFrom : -1;
+        }
+
+        for (int y = 0; y < _size.y; y++)
+        {
+            int nFrom = bWrap ? (y - shift.y + _size.y) % _size.y : y - shift.y;
+            fromY[y] = (nFrom >= 0 && nFrom < _size.y) ? nFrom : -1;
+        }
+
+        std::shared_ptr<Chunk> fill = GetUniformChunk(_fill);
+        std::vector<std::shared_ptr<Chunk>> chunks(_chunks.size());
+
+        for (size_t nChunk = 0; nChunk < chunks.size(); nChunk++)
+        {
+            int nLeft = (int)(nChunk % _cols) << CHUNK_SHIFT;
+            int nTop = (int)(nChunk / _cols) << CHUNK_SHIFT;
+
+            // Keep sharing a uniform chunk when that's where all the values come from
+
+            int fromCols[CHUNK_SIZE];
+            int fromRows[CHUNK_SIZE];
+            size_t nFromCols = GetFromChunks(&fromX[nLeft], fromCols);
+            size_t nFromRows = GetFromChunks(&fromY[nTop], fromRows);
+            const std::shared_ptr<Chunk>* pUniform = nullptr;
+            bool bUniform = true;
+
+            for (size_t y = 0; y < nFromRows && bUniform; y++)
+            {
+                for (size_t x = 0; x < nFromCols && bUniform; x++)
+                {
+                    const std::shared_ptr<Chunk>& from = (fromCols[x] < 0 || fromRows[y] < 0)
+                        ? fill
+                        : _chunks[fromRows[y] * _cols + fromCols[x]];
+
+                    pUniform = pUniform ? pUniform : &from;
+                    bUniform = (from == *pUniform) && IsUniformChunk(from);
+                }
+            }
+
+            if (bUniform)
+            {
+                chunks[nChunk] = *pUniform;
+                continue;
+            }
+
+            std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+
+            for (int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (int x = 0; x < CHUNK_SIZE; x++)
+                {
+                    int nFromX = fromX[nLeft + x];
+                    int nFromY = fromY[nTop + y];
+
+                    (*chunk)[(y << CHUNK_SHIFT) + x] = (nFromX < 0 || nFromY < 0)
+                        ? _fill
+                        : Get(ff::point_int(nFromX, nFromY));
+                }
+            }
+
+            chunks[nChunk] = chunk;
+        }
+
+        _chunks = std::move(chunks);
+        Compact();
+    }
+
+    // The distinct chunk columns (or rows) that a chunk's worth of from values come from, -1 for the fill value
+    static size_t GetFromChunks(const int* pFrom, int* pChunks)
+    {
+        size_t nCount = 0;
+
+        for (int i = 0; i < CHUNK_SIZE; i++)
+        {
+            int nChunk = (pFrom[i] < 0) ? -1 : (pFrom[i] >> CHUNK_SHIFT);
+
+            if (std::find(pChunks, pChunks + nCount, nChunk) == pChunks + nCount)
+            {
+                pChunks[nCount++] = nChunk;
+            }
+        }
+
+        return nCount;
+    }
+
+    // Puts the fill value back into the parts of the right and bottom edge chunks that are outside of the size
+    void FillOutside()
+    {
+        int nCols = (int)_cols;
+        int nRows = (int)GetRowCount(_size);
+        if (!nCols || !nRows)
+        {
+            return;
+        }
+
+        int nInsideX = _size.x - ((nCols - 1) << CHUNK_SHIFT);
+        int nInsideY = _size.y - ((nRows - 1) << CHUNK_SHIFT);
+
+        for (int y = 0; y < nRows && nInsideX < CHUNK_SIZE; y++)
+        {
+            FillChunkOutside(_chunks[y * nCols + nCols - 1], nInsideX, (y == nRows - 1) ? nInsideY : CHUNK_SIZE);
+        }
+
+        for (int x = 0; x < nCols && nInsideY < CHUNK_SIZE; x++)
+        {
+            FillChunkOutside(_chunks[(nRows - 1) * nCols + x], (x == nCols - 1) ? nInsideX : CHUNK_SIZE, nInsideY);
+        }
+    }
+
+    void FillChunkOutside(std::shared_ptr<Chunk>& chunk, int nInsideX, int nInsideY)
+    {
+        for (int y = 0; y < CHUNK_SIZE; y++)
+        {
+            for (int x = (y < nInsideY) ? nInsideX : 0; x < CHUNK_SIZE; x++)
+            {
+                size_t nIndex = (y << CHUNK_SHIFT) + x;
+
+                if ((*chunk)[nIndex] != _fill)
+                {
+                    if (chunk.use_count() > 1)
+                    {
+                        chunk = std::make_shared<Chunk>(*chunk);
+                    }
+
+                    (*chunk)[nIndex] = _fill;
+                }
+            }
+        }
+    }
+
+    bool IsUniformChunk(const std::shared_ptr<Chunk>& chunk) const
+    {
+        return std::find(_uniformChunks.begin(), _uniformChunks.end(), chunk) != _uniformChunks.end();
+    }
+
+    size_t GetChunkIndex(ff::point_int tile) const
+    {
+        return (tile.y >> CHUNK_SHIFT) * _cols + (tile.x >> CHUNK_SHIFT);
+    }
+
+    static size_t GetIndexInChunk(ff::point_int tile)
+    {
+        return ((tile.y & CHUNK_MASK) << CHUNK_SHIFT) + (tile.x & CHUNK_MASK);
+    }
+
+    std::shared_ptr<Chunk> GetUniformChunk(T value)
+    {
+        for (const std::shared_ptr<Chunk>& chunk : _uniformChunks)
+        {
+            if (chunk->front() == value)
+            {
+                return chunk;
+            }
+        }
+
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+        chunk->fill(value);
+        _uniformChunks.push_back(chunk);
+
+        return chunk;
+    }
+
+    T _fill;
+    ff::point_int _size;
+    size_t _cols;
+    std::vector<std::shared_ptr<Chunk>> _chunks;
+    std::vector<std::shared_ptr<Chunk>> _uniformChunks; // always referenced here, so writing to them makes a copy
+};
@@ -1,6 +1,15 @@
 #include "pch.h"
 #include "Core/Tiles.h"
 #include "Core/Maze.h"
+#include "Core/MazeCache.h"
+#include "Core/StaticTiles.h"
+
+// The byte scans use SSE2 where it's always there, and the plain loops after them everywhere else
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TILES_SSE2 1
+#else
+#define TILES_SSE2 0
+#endif
 
 static std::shared_ptr<Tiles> CreateTilesFromString(const char* szTiles, ff::point_int size, bool bMirror)
 {
@@ -8,35 +17,19 @@ static std::shared_ptr<Tiles> CreateTilesFromString(const char* szTiles, ff::poi
     assert_ret_val(!bMirror || !(size.x % 2), nullptr);
 
     std::shared_ptr<Tiles> pTiles = std::make_shared<Tiles>();
+    pTiles->BeginChanges();
     pTiles->SetSize(size);
 
-    const char* sz = szTiles;
+    int maxX = bMirror ? size.x / 2 : size.x;
 
     for (int y = 0; y < size.y; y++)
     {
-        int maxX = bMirror ? size.x / 2 : size.x;
-        for (int x = 0; x < maxX; x++, sz++)
-        {
-            TileContent content = CONTENT_NOTHING;
-            TileZone zone = ZONE_NORMAL;
+        const char* pRow = szTiles + y * maxX;
 
-            switch (*sz)
-            {
-                case 'X': content = CONTENT_WALL; break;
-                case 'O': content = CONTENT_GHOST_WALL; break;
-                case '-': content = CONTENT_GHOST_DOOR; break;
-                case '+': content = CONTENT_PAC_START; break;
-                case '.': content = CONTENT_DOT; break;
-                case ',': content = CONTENT_POWER; break;
-                case '=': zone = ZONE_GHOST_SLOW; break;
-                case '*': zone = ZONE_GHOST_NO_TURN; break;
-                case '|': zone = ZONE_OUT_OF_BOUNDS; break;
-            }
-
-            if (*sz == '*' && ((x > 0 && sz[-1] == '.') || (x + 1 < maxX && sz[1] == '.')))
-            {
-                content = CONTENT_DOT;
-            }
+        for (int x = 0; x < maxX; x++)
+        {
+            TileContent content = TileStringContent(pRow, x, maxX);
+            TileZone zone = TileCharToZone(pRow[x]);
 
             pTiles->SetContent(ff::point_int(x, y), content);
             pTiles->SetZone(ff::point_int(x, y), zone);
@@ -49,17 +42,27 @@ static std::shared_ptr<Tiles> CreateTilesFromString(const char* szTiles, ff::poi
         }
     }
 
+    pTiles->CommitChanges();
     return pTiles;
 }
 
 std::shared_ptr<Tiles> CreateTilesFromResource(std::string_view name)
 {
-    static std::shared_ptr<ff::resource_values> values_tiles;
-    if (!values_tiles)
+    return MazeCache::Get().GetTiles(name);
+}
+
+std::shared_ptr<Tiles> CreateTilesFromValues(std::string_view name)
+{
+    // The front-end layouts only exist in the code, so there's just one copy of them
+    std::shared_ptr<Tiles> builtInTiles = CreateBuiltInTiles(name);
+    if (builtInTiles)
     {
-        values_tiles = ff::auto_resource<ff::resource_values>("values_tiles").object();
+        return builtInTiles;
     }
 
+    // Mazes can be loaded from any thread
+    static std::shared_ptr<ff::resource_values> values_tiles = ff::auto_resource<ff::resource_values>("values_tiles").object();
+
     ff::value_ptr rawValue = values_tiles->get_resource_value(name);
     assert_ret_val(rawValue, nullptr);
 
@@ -93,27 +96,39 @@ std::shared_ptr<Tiles> CreateTilesFromResource(std::string_view name)
 }
 
 Tiles::Tiles()
-    : _size(0, 0)
+    : _hasID(false)
+    , _size(0, 0)
+    , _census{}
+    , _changeDepth(0)
+    , _changedAll(false)
 {
-    ::CoCreateGuid(&_id);
 }
 
 Tiles::~Tiles()
 {
-    assert(!_listeners.size());
+    assert(!_listeners.size() && !_changeDepth);
 }
 
 std::shared_ptr<Tiles> Tiles::Clone()
 {
+    // The clone shares all tile data until it is changed
+
     std::shared_ptr<Tiles> pTiles = std::make_shared<Tiles>();
     pTiles->_size = _size;
-    pTiles->_content = _content;
-    pTiles->_zone = _zone;
+    pTiles->_planes = _planes;
+    pTiles->_eaten = _eaten;
+    pTiles->_census = _census;
     return pTiles;
 }
 
 REFGUID Tiles::GetID() const
 {
+    if (!_hasID)
+    {
+        ::CoCreateGuid(&_id);
+        _hasID = true;
+    }
+
     return _id;
 }
 
@@ -124,8 +139,21 @@ ff::point_int Tiles::GetSize() const
 
 void Tiles::SetSize(ff::point_int newSize)
 {
-    if (newSize != _size)
+    if (newSize != _size && IsChunked())
     {
+        MakeWritable();
+        _planes->_contentChunks.Resize(newSize);
+        _planes->_zoneChunks.Resize(newSize);
+        _size = newSize;
+
+        RebuildWalls();
+        RebuildCensus();
+        NotifyAllTilesChanged();
+    }
+    else if (newSize != _size)
+    {
+        MakeWritable();
+
         std::vector<TileContent> newContent;
         std::vector<TileZone> newZone;
 
@@ -143,59 +171,218 @@ void Tiles::SetSize(ff::point_int newSize)
                 y < newSize.y && y < _size.y;
                 y++, nNewOffset += newSize.x, nOldOffset += _size.x)
             {
-                CopyMemory(newContent.data() + nNewOffset, _content.data() + nOldOffset, nCopy * sizeof(TileContent));
-                CopyMemory(newZone.data() + nNewOffset, _zone.data() + nOldOffset, nCopy * sizeof(TileZone));
+                CopyMemory(newContent.data() + nNewOffset, _planes->_content + nOldOffset, nCopy * sizeof(TileContent));
+                CopyMemory(newZone.data() + nNewOffset, _planes->_zone + nOldOffset, nCopy * sizeof(TileZone));
             }
         }
 
         _size = newSize;
-        _content = newContent;
-        _zone = newZone;
+        _planes->_contentData = newContent;
+        _planes->_zoneData = newZone;
 
-        for (size_t i = 0; i < _listeners.size(); i++)
+        RebuildWalls();
+        RebuildCensus();
+        NotifyAllTilesChanged();
+    }
+}
+
+// Adds how many bytes equal each value below nValues into pCounts, comparing 16 bytes at a time
+static void CountBytes(const BYTE* pData, size_t nSize, size_t* pCounts, size_t nValues)
+{
+    const size_t nMaxValues = 8;
+    assert(nValues <= nMaxValues);
+
+    size_t i = 0;
+
+#if TILES_SSE2
+    while (i + 16 <= nSize)
+    {
+        // Byte counters overflow after 255 blocks
+        size_t nEnd = std::min(nSize & ~(size_t)15, i + 255 * 16);
+        __m128i counters[nMaxValues]{};
+
+        for (; i < nEnd; i += 16)
         {
-            _listeners[i]->OnAllTilesChanged();
+            __m128i data = _mm_loadu_si128((const __m128i*)(pData + i));
+
+            for (size_t value = 0; value < nValues; value++)
+            {
+                counters[value] = _mm_sub_epi8(counters[value], _mm_cmpeq_epi8(data, _mm_set1_epi8((char)value)));
+            }
+        }
+
+        for (size_t value = 0; value < nValues; value++)
+        {
+            __m128i sums = _mm_sad_epu8(counters[value], _mm_setzero_si128());
+            pCounts[value] += (size_t)_mm_cvtsi128_si32(sums) + (size_t)_mm_extract_epi16(sums, 4);
+        }
+    }
+#endif
+
+    for (; i < nSize; i++)
+    {
+        if (pData[i] < nValues)
+        {
+            pCounts[pData[i]]++;
         }
     }
 }
 
-void Tiles::Shift(ff::point_int shift)
+// Returns the index of the first byte equal to value, or invalid
+static size_t FindByte(const BYTE* pData, size_t nSize, BYTE value)
 {
-    if (shift.x || shift.y)
+    size_t i = 0;
+
+#if TILES_SSE2
+    __m128i match = _mm_set1_epi8((char)value);
+
+    for (; i + 16 <= nSize; i += 16)
     {
-        std::vector<TileContent> newContent;
-        std::vector<TileZone> newZone;
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(pData + i)), match));
+        if (mask)
+        {
+            for (; !(mask & 1); mask >>= 1, i++);
+            return i;
+        }
+    }
+#endif
 
-        newContent.resize(_content.size());
-        newZone.resize(_zone.size());
+    for (; i < nSize; i++)
+    {
+        if (pData[i] == value)
+        {
+            return i;
+        }
+    }
 
-        ZeroMemory(newContent.data(), ff::vector_byte_size(newContent));
-        ZeroMemory(newZone.data(), ff::vector_byte_size(newZone));
+    return ff::constants::invalid_unsigned<size_t>();
+}
+
+// Calls func with the index of every byte that equals either value
+template<typename Func>
+static void ForEachByte(const BYTE* pData, size_t nSize, BYTE value1, BYTE value2, Func&& func)
+{
+    size_t i = 0;
+
+#if TILES_SSE2
+    __m128i match1 = _mm_set1_epi8((char)value1);
+    __m128i match2 = _mm_set1_epi8((char)value2);
+
+    for (; i + 16 <= nSize; i += 16)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i*)(pData + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(data, match1), _mm_cmpeq_epi8(data, match2)));
+
+        for (size_t j = i; mask; mask >>= 1, j++)
+        {
+            if (mask & 1)
+            {
+                func(j);
+            }
+        }
+    }
+#endif
+
+    for (; i < nSize; i++)
+    {
+        if (pData[i] == value1 || pData[i] == value2)
+        {
+            func(i);
+        }
+    }
+}
+
+static ff::point_int* GetCensusPosition(TileCensus& census, TileContent content)
+{
+    switch (content)
+    {
+        case CONTENT_PAC_START: return &census._pacStart;
+        case CONTENT_GHOST_DOOR: return &census._ghostDoor;
+        case CONTENT_FRUIT_START: return &census._fruitStart;
+        default: return nullptr;
+    }
+}
+
+// Moves every row and column of a plane in place. Tiles shifted off the edge are dropped, or wrap around to the other side.
+template<typename T>
+static void ShiftPlane(T* pData, ff::point_int size, ff::point_int shift, bool bWrap)
+{
+    static_assert(sizeof(T) == 1);
+
+    if (bWrap)
+    {
+        shift.x = ((shift.x % size.x) + size.x) % size.x;
+        shift.y = ((shift.y % size.y) + size.y) % size.y;
 
-        ff::point_int copyTiles(_size.x - abs(shift.x), _size.y - abs(shift.y));
+        if (shift.y)
+        {
+            std::rotate(pData, pData + (size.y - shift.y) * size.x, pData + size.y * size.x);
+        }
+
+        for (int y = 0; shift.x && y < size.y; y++)
+        {
+            T* pRow = pData + y * size.x;
+            std::rotate(pRow, pRow + size.x - shift.x, pRow + size.x);
+        }
+    }
+    else if (abs(shift.x) >= size.x || abs(shift.y) >= size.y)
+    {
+        ZeroMemory(pData, size.x * size.y);
+    }
+    else
+    {
+        int nMoveRows = size.y - abs(shift.y);
+        int nMoveCols = size.x - abs(shift.x);
 
-        if (copyTiles.x > 0 && copyTiles.y > 0)
+        if (shift.y > 0)
         {
-            int nOldOffset = (shift.x < 0) ? -shift.x : 0;
-            int nNewOffset = (shift.x > 0) ? shift.x : 0;
+            MoveMemory(pData + shift.y * size.x, pData, nMoveRows * size.x);
+            ZeroMemory(pData, shift.y * size.x);
+        }
+        else if (shift.y < 0)
+        {
+            MoveMemory(pData, pData - shift.y * size.x, nMoveRows * size.x);
+            ZeroMemory(pData + nMoveRows * size.x, -shift.y * size.x);
+        }
 
-            nOldOffset += (shift.y < 0) ? (-shift.y * _size.x) : 0;
-            nNewOffset += (shift.y > 0) ? (shift.y * _size.x) : 0;
+        for (int y = 0; shift.x && y < size.y; y++)
+        {
+            T* pRow = pData + y * size.x;
 
-            for (int y = 0; y < copyTiles.y; y++)
+            if (shift.x > 0)
             {
-                CopyMemory(newContent.data() + nNewOffset, _content.data() + nOldOffset, copyTiles.x * sizeof(TileContent));
-                CopyMemory(newZone.data() + nNewOffset, _zone.data() + nOldOffset, copyTiles.x * sizeof(TileZone));
+                MoveMemory(pRow + shift.x, pRow, nMoveCols);
+                ZeroMemory(pRow, shift.x);
+            }
+            else
+            {
+                MoveMemory(pRow, pRow - shift.x, nMoveCols);
+                ZeroMemory(pRow + nMoveCols, -shift.x);
             }
         }
+    }
+}
 
-        _content = newContent;
-        _zone = newZone;
+void Tiles::Shift(ff::point_int shift, bool bWrap)
+{
+    if ((shift.x || shift.y) && _size.x && _size.y)
+    {
+        MakeWritable();
 
-        for (size_t i = 0; i < _listeners.size(); i++)
+        if (_planes->_chunked)
         {
-            _listeners[i]->OnAllTilesChanged();
+            _planes->_contentChunks.Shift(shift, bWrap);
+            _planes->_zoneChunks.Shift(shift, bWrap);
+        }
+        else
+        {
+            ShiftPlane(_planes->_contentData.data(), _size, shift, bWrap);
+            ShiftPlane(_planes->_zoneData.data(), _size, shift, bWrap);
         }
+
+        RebuildWalls();
+        RebuildCensus();
+        NotifyAllTilesChanged();
     }
 }
 
@@ -204,7 +391,7 @@ TileContent Tiles::GetContent(ff::point_int tile) const
     if (tile.x >= 0 && tile.x < _size.x &&
         tile.y >= 0 && tile.y < _size.y)
     {
-        return _content.at(tile.y * _size.x + tile.x);
+        return IsEaten(tile.y * _size.x + tile.x) ? CONTENT_NOTHING : GetBaseContent(tile);
     }
 
     return CONTENT_NOTHING;
@@ -216,14 +403,64 @@ void Tiles::SetContent(ff::point_int tile, TileContent content)
         tile.y >= 0 && tile.y < _size.y)
     {
         size_t nTile = tile.y * _size.x + tile.x;
+        TileContent baseContent = GetBaseContent(tile);
+        TileContent oldContent = IsEaten(nTile) ? CONTENT_NOTHING : baseContent;
+
+        if (content == oldContent)
+        {
+            // Nothing to change
+        }
+        else if (!CanWritePlanes() &&
+            !_planes->_chunked &&
+            content == CONTENT_NOTHING &&
+            (baseContent == CONTENT_DOT || baseContent == CONTENT_POWER))
+        {
+            // Eating a dot doesn't need a private copy of the tiles
 
-        TileContent oldContent = _content[nTile];
-        _content[nTile] = content;
+            if (_eaten.empty())
+            {
+                _eaten.resize((_size.x * _size.y + 63) / 64);
+            }
 
-        for (size_t i = 0; i < _listeners.size(); i++)
+            _eaten[nTile / 64] |= (uint64_t)1 << (nTile % 64);
+        }
+        else if (content == baseContent)
+        {
+            // Putting an eaten dot back
+
+            _eaten[nTile / 64] &= ~((uint64_t)1 << (nTile % 64));
+        }
+        else
+        {
+            MakeWritable();
+
+            if (_planes->_chunked)
+            {
+                _planes->_contentChunks.Set(tile, content);
+            }
+            else
+            {
+                _planes->_contentData[nTile] = content;
+            }
+
+            if (IsWallContent(oldContent) != IsWallContent(content))
+            {
+                _planes->_wallData[tile.y * _planes->_wallStride + (tile.x >> 6)] ^= (uint64_t)1 << (tile.x & 63);
+
+                UpdateExits(ff::point_int(tile.x, tile.y - 1));
+                UpdateExits(ff::point_int(tile.x - 1, tile.y));
+                UpdateExits(ff::point_int(tile.x, tile.y + 1));
+                UpdateExits(ff::point_int(tile.x + 1, tile.y));
+            }
+        }
+
+        if (content != oldContent)
         {
-            _listeners[i]->OnTileChanged(tile, oldContent, content);
+            TileZone zone = GetBaseZone(tile);
+            UpdateCensus(tile, oldContent, content, zone, zone);
         }
+
+        NotifyTileChanged(tile, oldContent, content);
     }
 }
 
@@ -232,7 +469,7 @@ TileZone Tiles::GetZone(ff::point_int tile) const
     if (tile.x >= 0 && tile.x < _size.x &&
         tile.y >= 0 && tile.y < _size.y)
     {
-        return _zone.at(tile.y * _size.x + tile.x);
+        return GetBaseZone(tile);
     }
 
     return ZONE_OUT_OF_BOUNDS;
@@ -243,12 +480,625 @@ void Tiles::SetZone(ff::point_int tile, TileZone zone)
     if (tile.x >= 0 && tile.x < _size.x &&
         tile.y >= 0 && tile.y < _size.y)
     {
-        size_t nTile = tile.y * _size.x + tile.x;
-        _zone[nTile] = zone;
+        TileZone oldZone = GetBaseZone(tile);
+        TileContent content = GetContent(tile);
+
+        if (oldZone != zone)
+        {
+            MakeWritable();
+
+            if (_planes->_chunked)
+            {
+                _planes->_zoneChunks.Set(tile, zone);
+            }
+            else
+            {
+                _planes->_zoneData[tile.y * _size.x + tile.x] = zone;
+            }
+
+            UpdateCensus(tile, content, content, oldZone, zone);
+        }
+
+        NotifyTileChanged(tile, content, content);
+    }
+}
+
+const TileCensus& Tiles::GetCensus() const
+{
+    return _census;
+}
+
+void Tiles::ForEachDot(const std::function<void(ff::point_int tile, TileContent content)>& func) const
+{
+    if (!_census._contentCounts[CONTENT_DOT] && !_census._contentCounts[CONTENT_POWER])
+    {
+        return;
+    }
+
+    for (int y = 0; y < _size.y; y++)
+    {
+        size_t nCount = 0;
+
+        for (int x = 0; x < _size.x; x += (int)nCount)
+        {
+            const BYTE* pContent = (const BYTE*)GetContentRun(ff::point_int(x, y), nCount);
+
+            ForEachByte(pContent, nCount, CONTENT_DOT, CONTENT_POWER, [this, &func, pContent, x, y](size_t i)
+                {
+                    ff::point_int tile(x + (int)i, y);
+
+                    if (!IsEaten(tile.y * _size.x + tile.x))
+                    {
+                        func(tile, (TileContent)pContent[i]);
+                    }
+                });
+        }
+    }
+}
+
+void Tiles::GetNeighbors(ff::point_int tile, TileContent content[9], TileZone zone[9]) const
+{
+    const TileContent* pContent = nullptr;
+    const TileZone* pZone = nullptr;
+    size_t nStride = 0;
+
+    if (tile.x > 0 && tile.y > 0 && tile.x + 1 < _size.x && tile.y + 1 < _size.y && _eaten.empty())
+    {
+        ff::point_int topLeft(tile.x - 1, tile.y - 1);
+
+        if (!_planes->_chunked)
+        {
+            nStride = _size.x;
+            pContent = _planes->_content + topLeft.y * nStride + topLeft.x;
+            pZone = _planes->_zone + topLeft.y * nStride + topLeft.x;
+        }
+        else if (TileChunks<TileContent>::IsSameChunk(topLeft, ff::point_int(tile.x + 1, tile.y + 1)))
+        {
+            nStride = TileChunks<TileContent>::CHUNK_SIZE;
+            pContent = _planes->_contentChunks.GetData(topLeft);
+            pZone = _planes->_zoneChunks.GetData(topLeft);
+        }
+    }
+
+    for (int y = 0, i = 0; y < 3; y++, pContent += nStride, pZone += nStride)
+    {
+        for (int x = 0; x < 3; x++, i++)
+        {
+            ff::point_int neighbor(tile.x + x - 1, tile.y + y - 1);
+            content[i] = pContent ? pContent[x] : GetContent(neighbor);
+            zone[i] = pZone ? pZone[x] : GetZone(neighbor);
+        }
+    }
+}
+
+bool Tiles::IsChunked() const
+{
+    return _planes && _planes->_chunked;
+}
+
+void Tiles::SetChunked(bool bChunked)
+{
+    if (bChunked != IsChunked())
+    {
+        MakeWritable();
+        Planes& planes = *_planes;
+
+        if (bChunked)
+        {
+            planes._contentChunks.SetSize(_size);
+            planes._zoneChunks.SetSize(_size);
+
+            for (ff::point_int tile(0, 0); tile.y < _size.y; tile.x = 0, tile.y++)
+            {
+                for (; tile.x < _size.x; tile.x++)
+                {
+                    planes._contentChunks.Set(tile, planes._contentData[tile.y * _size.x + tile.x]);
+                    planes._zoneChunks.Set(tile, planes._zoneData[tile.y * _size.x + tile.x]);
+                }
+            }
+
+            planes._contentChunks.Compact();
+            planes._zoneChunks.Compact();
+
+            std::vector<TileContent>().swap(planes._contentData);
+            std::vector<TileZone>().swap(planes._zoneData);
+            std::vector<BYTE>().swap(planes._exitData);
+        }
+        else
+        {
+            planes._contentData.resize(_size.x * _size.y);
+            planes._zoneData.resize(_size.x * _size.y);
+
+            for (ff::point_int tile(0, 0); tile.y < _size.y; tile.x = 0, tile.y++)
+            {
+                for (; tile.x < _size.x; tile.x++)
+                {
+                    planes._contentData[tile.y * _size.x + tile.x] = planes._contentChunks.Get(tile);
+                    planes._zoneData[tile.y * _size.x + tile.x] = planes._zoneChunks.Get(tile);
+                }
+            }
+
+            planes._contentChunks.SetSize(ff::point_int(0, 0));
+            planes._zoneChunks.SetSize(ff::point_int(0, 0));
+        }
+
+        planes._chunked = bChunked;
+        RebuildWalls();
+    }
+}
+
+size_t Tiles::GetMemorySize() const
+{
+    size_t nSize = ff::vector_byte_size(_eaten);
+
+    if (_planes)
+    {
+        const Planes& planes = *_planes;
+        nSize += ff::vector_byte_size(planes._zoneData) + ff::vector_byte_size(planes._contentData) +
+            ff::vector_byte_size(planes._wallData) + ff::vector_byte_size(planes._exitData);
+
+        if (planes._chunked)
+        {
+            nSize += planes._contentChunks.GetMemorySize() + planes._zoneChunks.GetMemorySize();
+        }
+    }
+
+    return nSize;
+}
+
+// static
+size_t Tiles::GetWallStride(int nWidth)
+{
+    return (nWidth + 63) / 64;
+}
+
+void Tiles::SetView(
+    ff::point_int size,
+    std::shared_ptr<const void> view,
+    const TileContent* pContent,
+    const TileZone* pZone,
+    const uint64_t* pWalls,
+    const BYTE* pExits)
+{
+    std::shared_ptr<Planes> planes = std::make_shared<Planes>();
+    planes->_view = view;
+    planes->_content = pContent;
+    planes->_zone = pZone;
+    planes->_walls = pWalls;
+    planes->_exits = pExits;
+    planes->_wallStride = GetWallStride(size.x);
+
+    _size = size;
+    _planes = planes;
+    _eaten.clear();
+
+    RebuildCensus();
+    NotifyAllTilesChanged();
+}
+
+void Tiles::Planes::UpdatePointers()
+{
+    _zone = !_chunked ? _zoneData.data() : nullptr;
+    _content = !_chunked ? _contentData.data() : nullptr;
+    _walls = _wallData.data();
+    _exits = !_chunked ? _exitData.data() : nullptr;
+}
+
+bool Tiles::CanWritePlanes() const
+{
+    return _planes && _planes.use_count() == 1 && !_planes->_view;
+}
+
+bool Tiles::IsEaten(size_t nTile) const
+{
+    return !_eaten.empty() && (_eaten[nTile / 64] & ((uint64_t)1 << (nTile % 64))) != 0;
+}
+
+TileContent Tiles::GetBaseContent(ff::point_int tile) const
+{
+    return !_planes->_chunked ? _planes->_content[tile.y * _size.x + tile.x] : _planes->_contentChunks.Get(tile);
+}
+
+TileZone Tiles::GetBaseZone(ff::point_int tile) const
+{
+    return !_planes->_chunked ? _planes->_zone[tile.y * _size.x + tile.x] : _planes->_zoneChunks.Get(tile);
+}
+
+// Returns the tile's data and how many more tiles in the row follow it in memory
+const TileContent* Tiles::GetContentRun(ff::point_int tile, size_t& nCount) const
+{
+    if (_planes->_chunked)
+    {
+        nCount = std::min<size_t>(TileChunks<TileContent>::CHUNK_SIZE - (tile.x & TileChunks<TileContent>::CHUNK_MASK), _size.x - tile.x);
+        return _planes->_contentChunks.GetData(tile);
+    }
+
+    nCount = _size.x - tile.x;
+    return _planes->_content + tile.y * _size.x + tile.x;
+}
+
+const TileZone* Tiles::GetZoneRun(ff::point_int tile, size_t& nCount) const
+{
+    if (_planes->_chunked)
+    {
+        nCount = std::min<size_t>(TileChunks<TileZone>::CHUNK_SIZE - (tile.x & TileChunks<TileZone>::CHUNK_MASK), _size.x - tile.x);
+        return _planes->_zoneChunks.GetData(tile);
+    }
+
+    nCount = _size.x - tile.x;
+    return _planes->_zone + tile.y * _size.x + tile.x;
+}
+
+void Tiles::RebuildCensus()
+{
+    TileCensus census{};
+
+    for (int y = 0; y < _size.y; y++)
+    {
+        size_t nCount = 0;
+
+        for (int x = 0; x < _size.x; x += (int)nCount)
+        {
+            const TileContent* pContent = GetContentRun(ff::point_int(x, y), nCount);
+            const TileZone* pZone = GetZoneRun(ff::point_int(x, y), nCount);
+
+            CountBytes((const BYTE*)pContent, nCount, census._contentCounts, TILE_CONTENT_COUNT);
+            CountBytes((const BYTE*)pZone, nCount, census._zoneCounts, TILE_ZONE_COUNT);
+        }
+    }
+
+    // Eaten dots are in the planes, but don't count
+
+    for (size_t i = 0; i < _eaten.size(); i++)
+    {
+        for (size_t nTile = i * 64, bits = _eaten[i]; bits; bits >>= 1, nTile++)
+        {
+            if (bits & 1)
+            {
+                census._contentCounts[_planes->_content[nTile]]--;
+                census._contentCounts[CONTENT_NOTHING]++;
+            }
+        }
+    }
+
+    census._pacStart = census._contentCounts[CONTENT_PAC_START] ? FindFirstContent(CONTENT_PAC_START) : ff::point_int(0, 0);
+    census._ghostDoor = census._contentCounts[CONTENT_GHOST_DOOR] ? FindFirstContent(CONTENT_GHOST_DOOR) : ff::point_int(0, 0);
+    census._fruitStart = census._contentCounts[CONTENT_FRUIT_START] ? FindFirstContent(CONTENT_FRUIT_START) : ff::point_int(0, 0);
+
+    _census = std::move(census);
+    UpdateTunnelTiles();
+}
+
+void Tiles::UpdateCensus(ff::point_int tile, TileContent oldContent, TileContent newContent, TileZone oldZone, TileZone newZone)
+{
+    _census._contentCounts[oldContent]--;
+    _census._contentCounts[newContent]++;
+    _census._zoneCounts[oldZone]--;
+    _census._zoneCounts[newZone]++;
+
+    ff::point_int* pOldPos = GetCensusPosition(_census, oldContent);
+    if (pOldPos && *pOldPos == tile && oldContent != newContent)
+    {
+        *pOldPos = _census._contentCounts[oldContent] ? FindFirstContent(oldContent) : ff::point_int(0, 0);
+    }
+
+    ff::point_int* pNewPos = GetCensusPosition(_census, newContent);
+    if (pNewPos && (_census._contentCounts[newContent] == 1 || tile.y < pNewPos->y || (tile.y == pNewPos->y && tile.x < pNewPos->x)))
+    {
+        *pNewPos = tile;
+    }
+
+    if (!tile.x || !tile.y || tile.x == _size.x - 1 || tile.y == _size.y - 1)
+    {
+        UpdateTunnelTile(tile);
+    }
+}
+
+void Tiles::UpdateTunnelTiles()
+{
+    _census._tunnelTiles.clear();
+
+    for (ff::point_int tile(0, 0); tile.y < _size.y; tile.y++)
+    {
+        // Only the edges of the maze
+        int nStep = (!tile.y || tile.y == _size.y - 1) ? 1 : std::max(_size.x - 1, 1);
+
+        for (tile.x = 0; tile.x < _size.x; tile.x += nStep)
+        {
+            if (IsTunnelTile(tile))
+            {
+                _census._tunnelTiles.push_back(tile);
+            }
+        }
+    }
+}
+
+// Adds or removes one edge tile, keeping the list in reading order
+void Tiles::UpdateTunnelTile(ff::point_int tile)
+{
+    std::vector<ff::point_int>& tunnels = _census._tunnelTiles;
+    auto iter = std::lower_bound(tunnels.begin(), tunnels.end(), tile, [](ff::point_int lhs, ff::point_int rhs)
+    {
+        return lhs.y < rhs.y || (lhs.y == rhs.y && lhs.x < rhs.x);
+    });
+
+    bool bListed = (iter != tunnels.end() && *iter == tile);
+    bool bTunnel = IsTunnelTile(tile);
+
+    if (bTunnel && !bListed)
+    {
+        tunnels.insert(iter, tile);
+    }
+    else if (!bTunnel && bListed)
+    {
+        tunnels.erase(iter);
+    }
+}
+
+bool Tiles::IsTunnelTile(ff::point_int tile) const
+{
+    return GetContent(tile) == CONTENT_NOTHING && GetBaseZone(tile) == ZONE_GHOST_SLOW;
+}
+
+ff::point_int Tiles::FindFirstContent(TileContent content) const
+{
+    for (int y = 0; y < _size.y; y++)
+    {
+        size_t nCount = 0;
+
+        for (int x = 0; x < _size.x; x += (int)nCount)
+        {
+            const TileContent* pContent = GetContentRun(ff::point_int(x, y), nCount);
+            size_t i = FindByte((const BYTE*)pContent, nCount, content);
+            if (i != ff::constants::invalid_unsigned<size_t>() && !IsEaten(y * _size.x + x + i))
+            {
+                return ff::point_int(x + (int)i, y);
+            }
+        }
+    }
+
+    return ff::point_int(0, 0);
+}
+
+// Gets a private copy of the tile data, with all eaten dots removed from it
+void Tiles::MakeWritable()
+{
+    if (!_planes)
+    {
+        _planes = std::make_shared<Planes>();
+    }
+    else if (!CanWritePlanes())
+    {
+        size_t nTiles = _size.x * _size.y;
+        size_t nWalls = _planes->_wallStride * _size.y;
+
+        // Views don't have to come with walls or exits, those get computed from the content after copying it
+        bool bRebuildWalls = !_planes->_walls || (!_planes->_chunked && !_planes->_exits);
+
+        std::shared_ptr<Planes> planes = std::make_shared<Planes>();
+        planes->_wallStride = _planes->_wallStride;
+
+        if (!bRebuildWalls)
+        {
+            planes->_wallData.assign(_planes->_walls, _planes->_walls + nWalls);
+        }
+
+        if (_planes->_chunked)
+        {
+            // Only copies pointers to the chunks, each chunk gets copied when it's written to
+            planes->_chunked = true;
+            planes->_contentChunks = _planes->_contentChunks;
+            planes->_zoneChunks = _planes->_zoneChunks;
+        }
+        else
+        {
+            planes->_zoneData.assign(_planes->_zone, _planes->_zone + nTiles);
+            planes->_contentData.assign(_planes->_content, _planes->_content + nTiles);
+
+            if (!bRebuildWalls)
+            {
+                planes->_exitData.assign(_planes->_exits, _planes->_exits + nTiles);
+            }
+        }
+
+        planes->UpdatePointers();
+
+        _planes = planes;
+
+        if (bRebuildWalls)
+        {
+            RebuildWalls();
+        }
+    }
+
+    if (!_eaten.empty())
+    {
+        for (size_t i = 0; i < _planes->_contentData.size(); i++)
+        {
+            if (IsEaten(i))
+            {
+                _planes->_contentData[i] = CONTENT_NOTHING;
+            }
+        }
+    }
+
+    _eaten.clear();
+}
+
+BYTE Tiles::ComputeExits(ff::point_int tile) const
+{
+    BYTE exits = EXIT_NONE;
+
+    if (!IsWall(ff::point_int(tile.x, tile.y - 1)))
+    {
+        exits |= EXIT_UP;
+    }
+
+    if (!IsWall(ff::point_int(tile.x - 1, tile.y)))
+    {
+        exits |= EXIT_LEFT;
+    }
+
+    if (!IsWall(ff::point_int(tile.x, tile.y + 1)))
+    {
+        exits |= EXIT_DOWN;
+    }
 
+    if (!IsWall(ff::point_int(tile.x + 1, tile.y)))
+    {
+        exits |= EXIT_RIGHT;
+    }
+
+    return exits;
+}
+
+void Tiles::UpdateExits(ff::point_int tile)
+{
+    if (tile.x >= 0 && tile.x < _size.x &&
+        tile.y >= 0 && tile.y < _size.y &&
+        !_planes->_chunked)
+    {
+        _planes->_exitData[tile.y * _size.x + tile.x] = ComputeExits(tile);
+    }
+}
+
+void Tiles::RebuildWalls()
+{
+    Planes& planes = *_planes;
+    planes._wallStride = GetWallStride(_size.x);
+    planes._wallData.assign(planes._wallStride * _size.y, 0);
+    planes._exitData.resize(planes._contentData.size());
+    planes.UpdatePointers();
+
+    for (ff::point_int tile(0, 0); tile.y < _size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < _size.x; tile.x++)
+        {
+            if (IsWallContent(GetBaseContent(tile)))
+            {
+                planes._wallData[tile.y * planes._wallStride + (tile.x >> 6)] |= (uint64_t)1 << (tile.x & 63);
+            }
+        }
+    }
+
+    for (ff::point_int tile(0, 0); !planes._chunked && tile.y < _size.y; tile.x = 0, tile.y++)
+    {
+        for (; tile.x < _size.x; tile.x++)
+        {
+            planes._exitData[tile.y * _size.x + tile.x] = ComputeExits(tile);
+        }
+    }
+}
+
+void Tiles::BeginChanges()
+{
+    _changeDepth++;
+}
+
+void Tiles::CommitChanges()
+{
+    assert_ret(_changeDepth);
+
+    if (!--_changeDepth)
+    {
+        if (_changedAll)
+        {
+            _changedAll = false;
+            _changedRects.clear();
+
+            for (size_t i = 0; i < _listeners.size(); i++)
+            {
+                _listeners[i]->OnAllTilesChanged();
+            }
+        }
+        else if (_changedRects.size())
+        {
+            MergeChangedRects();
+
+            std::vector<ff::rect_int> rects;
+            rects.swap(_changedRects);
+
+            for (size_t i = 0; i < _listeners.size(); i++)
+            {
+                _listeners[i]->OnTilesChanged(rects.data(), rects.size());
+            }
+        }
+    }
+}
+
+void Tiles::NotifyTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent)
+{
+    if (!_changeDepth)
+    {
+        for (size_t i = 0; i < _listeners.size(); i++)
+        {
+            _listeners[i]->OnTileChanged(tile, oldContent, newContent);
+        }
+    }
+    else if (!_changedAll && _listeners.size())
+    {
+        // Grow any rect that the tile touches, so rows and columns of edits turn into one rect
+
+        for (ff::rect_int& rect : _changedRects)
+        {
+            if (tile.x >= rect.left - 1 && tile.x <= rect.right &&
+                tile.y >= rect.top - 1 && tile.y <= rect.bottom)
+            {
+                rect.left = std::min(rect.left, tile.x);
+                rect.top = std::min(rect.top, tile.y);
+                rect.right = std::max(rect.right, tile.x + 1);
+                rect.bottom = std::max(rect.bottom, tile.y + 1);
+                return;
+            }
+        }
+
+        _changedRects.push_back(ff::rect_int(tile.x, tile.y, tile.x + 1, tile.y + 1));
+    }
+}
+
+void Tiles::NotifyAllTilesChanged()
+{
+    if (!_changeDepth)
+    {
         for (size_t i = 0; i < _listeners.size(); i++)
         {
-            _listeners[i]->OnTileChanged(tile, _content[nTile], _content[nTile]);
+            _listeners[i]->OnAllTilesChanged();
+        }
+    }
+    else
+    {
+        _changedAll = true;
+    }
+}
+
+void Tiles::MergeChangedRects()
+{
+    const size_t nMaxRects = 16;
+
+    for (bool bMerged = true; bMerged; )
+    {
+        bMerged = false;
+
+        for (size_t i = 0; i < _changedRects.size(); i++)
+        {
+            for (size_t h = i + 1; h < _changedRects.size(); h++)
+            {
+                ff::rect_int& a = _changedRects[i];
+                const ff::rect_int& b = _changedRects[h];
+
+                if (_changedRects.size() > nMaxRects ||
+                    (a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom))
+                {
+                    a.left = std::min(a.left, b.left);
+                    a.top = std::min(a.top, b.top);
+                    a.right = std::max(a.right, b.right);
+                    a.bottom = std::max(a.bottom, b.bottom);
+
+                    _changedRects.erase(_changedRects.begin() + h);
+                    bMerged = true;
+                    h--;
+                }
+            }
         }
     }
 }
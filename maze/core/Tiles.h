@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Core/TileChunks.h"
+
 class IMazeListener;
 
 enum TileContent : BYTE
@@ -22,6 +24,32 @@ enum TileZone : BYTE
     ZONE_OUT_OF_BOUNDS, // outside the maze
 };
 
+// Bit flags for the open neighbors of a tile, in ghost decision priority order
+enum TileExit : BYTE
+{
+    EXIT_NONE = 0x00,
+    EXIT_UP = 0x01,
+    EXIT_LEFT = 0x02,
+    EXIT_DOWN = 0x04,
+    EXIT_RIGHT = 0x08,
+    EXIT_ALL = 0x0F,
+};
+
+const size_t TILE_CONTENT_COUNT = CONTENT_FRUIT_START + 1;
+const size_t TILE_ZONE_COUNT = ZONE_OUT_OF_BOUNDS + 1;
+
+// Counts of each kind of tile, and where the one-of-a-kind tiles are. Kept up to date as tiles change.
+// Positions are the first one in reading order, and are only valid when the count for their content isn't zero.
+struct TileCensus
+{
+    size_t _contentCounts[TILE_CONTENT_COUNT];
+    size_t _zoneCounts[TILE_ZONE_COUNT];
+    ff::point_int _pacStart;
+    ff::point_int _ghostDoor;
+    ff::point_int _fruitStart;
+    std::vector<ff::point_int> _tunnelTiles; // open ghost-slow tiles on the edge of the maze, in reading order
+};
+
 class Tiles
 {
 public:
@@ -33,22 +61,130 @@ public:
     REFGUID GetID() const;
     ff::point_int GetSize() const;
     void SetSize(ff::point_int size);
-    void Shift(ff::point_int shift);
+    void Shift(ff::point_int shift, bool bWrap);
 
     TileContent GetContent(ff::point_int tile) const;
     void SetContent(ff::point_int tile, TileContent content);
     TileZone GetZone(ff::point_int tile) const;
     void SetZone(ff::point_int tile, TileZone zone);
 
+    // Changes made between these calls are reported to listeners once, when the outermost commit happens
+    void BeginChanges();
+    void CommitChanges();
+
+    // Walls, ghost walls, and ghost doors block movement. Anything outside the grid is open.
+    bool IsWall(ff::point_int tile) const
+    {
+        return (unsigned int)tile.x < (unsigned int)_size.x && (unsigned int)tile.y < (unsigned int)_size.y &&
+            ((_planes->_walls[tile.y * _planes->_wallStride + (tile.x >> 6)] >> (tile.x & 63)) & 1) != 0;
+    }
+
+    // Returns the TileExit flags for neighbors that aren't walls
+    BYTE GetExits(ff::point_int tile) const
+    {
+        if ((unsigned int)tile.x < (unsigned int)_size.x && (unsigned int)tile.y < (unsigned int)_size.y && _planes->_exits)
+        {
+            return _planes->_exits[tile.y * _size.x + tile.x];
+        }
+
+        return ComputeExits(tile);
+    }
+
+    static constexpr bool IsWallContent(TileContent content)
+    {
+        return
+            content == CONTENT_WALL ||
+            content == CONTENT_GHOST_WALL ||
+            content == CONTENT_GHOST_DOOR;
+    }
+
+    const TileCensus& GetCensus() const;
+
+    // Calls func for every dot and power dot in reading order, skipping over the rest of the maze quickly
+    void ForEachDot(const std::function<void(ff::point_int tile, TileContent content)>& func) const;
+
+    // Gets the 3x3 content and zones around a tile, row by row. Reads memory directly when it can.
+    void GetNeighbors(ff::point_int tile, TileContent content[9], TileZone zone[9]) const;
+
+    // Chunked storage only allocates memory for parts of the maze that aren't filler, for very large mazes.
+    // Exits aren't stored when chunked, they're computed from the walls.
+    bool IsChunked() const;
+    void SetChunked(bool bChunked);
+
+    // Bytes allocated for the planes and eaten dots, not counting views of memory owned by someone else
+    size_t GetMemorySize() const;
+
+    // Uses tile data owned by someone else without copying it, until something changes
+    void SetView(
+        ff::point_int size,
+        std::shared_ptr<const void> view,
+        const TileContent* pContent,
+        const TileZone* pZone,
+        const uint64_t* pWalls,
+        const BYTE* pExits);
+    static size_t GetWallStride(int nWidth);
+
     void AddListener(IMazeListener* pListener);
     void RemoveListener(IMazeListener* pListener);
 
 private:
-    GUID _id;
+    // Tile data that can be shared between clones until one of them changes something other than eating a dot.
+    // The pointers either point into the vectors or into read-only memory kept alive by _view,
+    // or they are null when the content and zones are chunked.
+    struct Planes
+    {
+        const TileZone* _zone{};
+        const TileContent* _content{};
+        const uint64_t* _walls{}; // one bit per tile for walls, packed by row
+        const BYTE* _exits{}; // TileExit flags for each tile
+        size_t _wallStride{};
+
+        std::shared_ptr<const void> _view;
+        std::vector<TileZone> _zoneData;
+        std::vector<TileContent> _contentData;
+        std::vector<uint64_t> _wallData;
+        std::vector<BYTE> _exitData;
+
+        bool _chunked{};
+        TileChunks<TileContent> _contentChunks{ CONTENT_NOTHING };
+        TileChunks<TileZone> _zoneChunks{ ZONE_NORMAL };
+
+        void UpdatePointers();
+    };
+
+    void NotifyTileChanged(ff::point_int tile, TileContent oldContent, TileContent newContent);
+    void NotifyAllTilesChanged();
+    void MergeChangedRects();
+    bool IsEaten(size_t nTile) const;
+    TileContent GetBaseContent(ff::point_int tile) const;
+    TileZone GetBaseZone(ff::point_int tile) const;
+    const TileContent* GetContentRun(ff::point_int tile, size_t& nCount) const;
+    const TileZone* GetZoneRun(ff::point_int tile, size_t& nCount) const;
+    void RebuildCensus();
+    void UpdateCensus(ff::point_int tile, TileContent oldContent, TileContent newContent, TileZone oldZone, TileZone newZone);
+    void UpdateTunnelTiles();
+    void UpdateTunnelTile(ff::point_int tile);
+    bool IsTunnelTile(ff::point_int tile) const;
+    ff::point_int FindFirstContent(TileContent content) const;
+    bool CanWritePlanes() const;
+    void MakeWritable();
+    BYTE ComputeExits(ff::point_int tile) const;
+    void UpdateExits(ff::point_int tile);
+    void RebuildWalls();
+
+    mutable GUID _id; // created on demand
+    mutable bool _hasID;
     ff::point_int _size;
-    std::vector<TileZone> _zone;
-    std::vector<TileContent> _content;
+    std::shared_ptr<Planes> _planes;
+    std::vector<uint64_t> _eaten; // one bit per dot or power tile that has been eaten since _planes was shared
     std::vector<IMazeListener*> _listeners;
+    TileCensus _census;
+
+    // Batched changes
+    size_t _changeDepth;
+    bool _changedAll;
+    std::vector<ff::rect_int> _changedRects;
 };
 
 std::shared_ptr<Tiles> CreateTilesFromResource(std::string_view name);
+std::shared_ptr<Tiles> CreateTilesFromValues(std::string_view name);
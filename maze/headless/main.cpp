@@ -0,0 +1,20 @@
+#include "pch.h"
+#include "Core/HeadlessRunner.h"
+
+#include <iostream>
+
+static void WriteToStdout(std::string_view text)
+{
+    std::cout << text;
+    std::cout.flush();
+}
+
+// Same as "maze.exe -headless <args>", but as a console app that never creates a window
+int main(int argc, char** argv)
+{
+    // The mazes and game values come from the same resources the game loads
+    ff::init_app initApp;
+    check_ret_val(initApp, 1);
+
+    return HeadlessRunner::RunArgs(std::vector<std::string>(argv + 1, argv + argc), WriteToStdout);
+}
@@ -18,10 +18,13 @@ public:
         return !::IsWindowEnabled(ff::app_window());
     }
 
-    virtual void Quit() override
+    virtual void Quit(int code) override
     {
+        this->exit_code = code;
         ff::app_window().close();
     }
+
+    int exit_code = 0;
 } pac_host;
 
 static void window_message(ff::window* window, ff::window_message& message)
@@ -50,5 +53,6 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE, _In_ LPWSTR, _I
     params.game_render_screen_func = [&](const ff::render_params& params) { pac_app->RenderScreen(params); };
     params.game_clears_back_buffer_func = [] { return ::pac_host.IsShowingPopup(); };
 
-    return ff::run_game(params);
+    int result = ff::run_game(params);
+    return ::pac_host.exit_code ? ::pac_host.exit_code : result;
 }
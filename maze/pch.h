@@ -3,6 +3,12 @@
 // Vendor
 #include <ff.all.h>
 
+// STL
+#include <charconv>
+#include <execution>
+#include <fstream>
+#include <sstream>
+
 // Windows
 #include <commctrl.h>
 
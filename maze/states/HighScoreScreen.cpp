@@ -5,6 +5,7 @@
 #include "Core/Mazes.h"
 #include "Core/RenderMaze.h"
 #include "Core/RenderText.h"
+#include "Core/Replay.h"
 #include "Core/Tiles.h"
 #include "States/PacApplication.h"
 #include "States/TitleScreen.h"
@@ -16,8 +17,9 @@ static const size_t s_nPeriodLetter = 27;
 static const size_t s_nBackLetter = 28;
 static const size_t s_nEndLetter = 29;
 
-HighScoreScreen::HighScoreScreen(std::string_view mazesId, std::shared_ptr<IPlayer> pPlayer)
+HighScoreScreen::HighScoreScreen(std::string_view mazesId, std::shared_ptr<IPlayer> pPlayer, std::shared_ptr<Replay> pReplay)
     : _inputRes(GetGlobalInputMapping())
+    , _replay(pReplay)
 {
     Stats& stats = Stats::Get(mazesId);
 
@@ -323,7 +325,12 @@ void HighScoreScreen::Advance()
             else if (_letter == s_nEndLetter)
             {
                 Stats& stats = Stats::Get(_mazesID);
-                stats.InsertHighScore(_player->GetScore(), _player->GetLevel(), _name.c_str());
+                size_t nSlot = stats.InsertHighScore(_player->GetScore(), _player->GetLevel(), _name.c_str());
+
+                if (nSlot != ff::constants::invalid_unsigned<size_t>())
+                {
+                    Replay::InsertHighScore(_mazesID, nSlot, _replay.get());
+                }
 
                 _done = true;
             }
@@ -470,6 +477,39 @@ void HighScoreScreen::PausedAdvance()
 {
 }
 
+bool HighScoreScreen::CanRewind() const
+{
+    return false;
+}
+
+void HighScoreScreen::Rewind(size_t nFrames)
+{
+}
+
+std::shared_ptr<Replay> HighScoreScreen::GetReplay()
+{
+    return nullptr;
+}
+
+bool HighScoreScreen::IsPlayingReplay() const
+{
+    return false;
+}
+
+size_t HighScoreScreen::GetReplayDivergedFrame() const
+{
+    return ff::constants::invalid_unsigned<size_t>();
+}
+
+size_t HighScoreScreen::GetSpeed() const
+{
+    return 1;
+}
+
+void HighScoreScreen::SetSpeed(size_t nSpeed)
+{
+}
+
 size_t HighScoreScreen::GetMazePlayer()
 {
     return ff::constants::invalid_unsigned<size_t>();
@@ -497,6 +537,26 @@ void HighScoreScreen::Reset()
 {
 }
 
+std::shared_ptr<IPlayingMaze> HighScoreScreen::Clone() const
+{
+    return nullptr;
+}
+
+size_t HighScoreScreen::GetSnapshotSize() const
+{
+    return 0;
+}
+
+bool HighScoreScreen::SaveSnapshot(BYTE* pData, size_t nSize) const
+{
+    return false;
+}
+
+bool HighScoreScreen::LoadSnapshot(const BYTE* pData, size_t nSize)
+{
+    return false;
+}
+
 GameState HighScoreScreen::GetGameState() const
 {
     return GS_PLAYING;
@@ -523,6 +583,11 @@ const Difficulty& HighScoreScreen::GetDifficulty() const
     return GetEmptyDifficulty();
 }
 
+Random& HighScoreScreen::GetRandom()
+{
+    return _random;
+}
+
 PacState HighScoreScreen::GetPacState() const
 {
     return PAC_NORMAL;
@@ -563,6 +628,11 @@ std::shared_ptr<IPlayingActor> HighScoreScreen::GetGhost(size_t nGhost)
     return nullptr;
 }
 
+const GhostPaths* HighScoreScreen::GetGhostPaths()
+{
+    return nullptr;
+}
+
 ff::point_int HighScoreScreen::GetGhostStartPixel() const
 {
     return ff::point_int(0, 0);
@@ -15,7 +15,7 @@ class HighScoreScreen
     , public IPlayingActor
 {
 public:
-    HighScoreScreen(std::string_view mazesId, std::shared_ptr<IPlayer> pPlayer);
+    HighScoreScreen(std::string_view mazesId, std::shared_ptr<IPlayer> pPlayer, std::shared_ptr<Replay> pReplay);
 
     std::string GetName() const;
 
@@ -36,6 +36,13 @@ public:
     virtual bool IsPaused() const override;
     virtual void TogglePaused() override;
     virtual void PausedAdvance() override;
+    virtual bool CanRewind() const override;
+    virtual void Rewind(size_t nFrames) override;
+    virtual std::shared_ptr<Replay> GetReplay() override;
+    virtual bool IsPlayingReplay() const override;
+    virtual size_t GetReplayDivergedFrame() const override;
+    virtual size_t GetSpeed() const override;
+    virtual void SetSpeed(size_t nSpeed) override;
 
     // IPlayingMazeHost
 
@@ -50,12 +57,17 @@ public:
     //virtual void Advance() override;
     //virtual void Render(ff::I2dRenderer *draw) override;
     virtual void Reset() override;
+    virtual std::shared_ptr<IPlayingMaze> Clone() const override;
+    virtual size_t GetSnapshotSize() const override;
+    virtual bool SaveSnapshot(BYTE* pData, size_t nSize) const override;
+    virtual bool LoadSnapshot(const BYTE* pData, size_t nSize) override;
 
     virtual GameState GetGameState() const override;
     virtual const Stats& GetStats() const override;
     virtual std::shared_ptr<IMaze> GetMaze() const override;
     virtual std::shared_ptr<IRenderMaze> GetRenderMaze() override;
     virtual const Difficulty& GetDifficulty() const override;
+    virtual Random& GetRandom() override;
 
     virtual PacState GetPacState() const override;
     virtual std::shared_ptr<IPlayingActor> GetPac() override;
@@ -66,6 +78,7 @@ public:
     virtual ff::point_int GetGhostEyeDir(size_t nGhost) const override;
     virtual GhostState GetGhostState(size_t nGhost) const override;
     virtual std::shared_ptr<IPlayingActor> GetGhost(size_t nGhost) override;
+    virtual const GhostPaths* GetGhostPaths() override;
 
     virtual ff::point_int GetGhostStartPixel() const override;
     virtual ff::point_int GetGhostStartTile() const override;
@@ -99,9 +112,11 @@ private:
     std::shared_ptr<IRenderMaze> _render;
     std::shared_ptr<IRenderText> _text;
     std::shared_ptr<IPlayer> _player;
+    std::shared_ptr<Replay> _replay; // saved with the score
     std::string _intro;
     std::string _name;
     size_t _counter{};
+    Random _random{ Random::NewSeed() };
     std::string _mazesID;
     bool _done{};
     bool _showNewLetter{ true };
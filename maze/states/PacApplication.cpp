@@ -1,7 +1,15 @@
 #include "pch.h"
+#include "Core/Audio.h"
 #include "Core/GlobalResources.h"
+#include "Core/HeadlessRunner.h"
 #include "Core/Helpers.h"
+#include "Core/MazeCache.h"
+#include "Core/MazePack.h"
 #include "Core/Mazes.h"
+#include "Core/PacController.h"
+#include "Core/PlayingMaze.h"
+#include "Core/Random.h"
+#include "Core/Replay.h"
 #include "Core/Stats.h"
 #include "States/HighScoreScreen.h"
 #include "States/PacApplication.h"
@@ -15,8 +23,55 @@ std::string_view PacApplication::OPTION_PAC_PLAYERS("OPTION_PAC_PLAYERS");
 std::string_view PacApplication::OPTION_SOUND_ON("OPTION_SOUND_ON");
 std::string_view PacApplication::OPTION_VIBRATE_ON("OPTION_VIBRATE_ON");
 std::string_view PacApplication::OPTION_FULL_SCREEN("OPTION_FULL_SCREEN");
+std::string_view PacApplication::OPTION_GHOST_TRAILS("OPTION_GHOST_TRAILS");
+std::string_view PacApplication::OPTION_AUTOPILOT("OPTION_AUTOPILOT");
+std::string_view PacApplication::OPTION_FAST_FORWARD_SPEED("OPTION_FAST_FORWARD_SPEED");
 
 static const double TOUCH_DEAD_ZONE = 20;
+static const size_t MAX_REWIND_SPEED = 4;
+static const size_t REWIND_SPEEDUP_FRAMES = 30;
+
+static std::vector<std::string> GetCommandLineArgs()
+{
+    std::vector<std::string> args;
+    int argc = 0;
+
+    LPWSTR* argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+    if (argv)
+    {
+        for (int i = 0; i < argc; i++)
+        {
+            args.push_back(ff::string::to_string(argv[i]));
+        }
+
+        ::LocalFree(argv);
+    }
+
+    return args;
+}
+
+// Windows apps don't get a console, so use the one that started the app, or open a new one.
+// Output that's already redirected to a file or pipe is used as is.
+static void WriteToStdout(std::string_view text)
+{
+    HANDLE handle = ::GetStdHandle(STD_OUTPUT_HANDLE);
+
+    if (!handle || handle == INVALID_HANDLE_VALUE)
+    {
+        if (!::AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            ::AllocConsole();
+        }
+
+        handle = ::CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+        check_ret(handle != INVALID_HANDLE_VALUE);
+        ::SetStdHandle(STD_OUTPUT_HANDLE, handle);
+    }
+
+    DWORD nWritten = 0;
+    ::WriteFile(handle, text.data(), (DWORD)text.size(), &nWritten, nullptr);
+    ::OutputDebugStringA(std::string(text).c_str());
+}
 
 PacApplication::PacApplication(IPacApplicationHost& host)
     : _host(host)
@@ -30,10 +85,14 @@ PacApplication::PacApplication(IPacApplicationHost& host)
     ff::input::pointer().touch_to_mouse(true);
 
     LoadState();
+
+    // Load all the mazes while the splash screen is still up, starting with the ones that will be played
+    MazeCache::Get().Prewarm(TitleScreen::GetMazesID());
 }
 
 PacApplication::~PacApplication()
 {
+    MazeCache::Get().StopPrewarm();
     SaveState();
 
     assert(s_pacApp == this);
@@ -69,10 +128,42 @@ void PacApplication::Update()
 {
     check_ret(!_host.IsShowingPopup());
 
+    ISoundEffects::SetEnabled(
+        _options.get<bool>(OPTION_SOUND_ON, DEFAULT_SOUND_ON),
+        _options.get<bool>(OPTION_VIBRATE_ON, DEFAULT_VIBRATE_ON));
+
     switch (_state)
     {
         case APP_LOADING:
-            SetState(APP_TITLE);
+#ifdef _DEBUG
+            if (std::wstring_view(::GetCommandLineW()).find(L"-compile-maze-pack") != std::wstring_view::npos)
+            {
+                verify(CompileMazePack(MazePack::GetDefaultPath()));
+            }
+#endif
+            if (IsHeadless())
+            {
+                // Already ran, waiting to quit
+                break;
+            }
+            else
+            {
+                std::vector<std::string> args = GetCommandLineArgs();
+                auto headlessArg = std::find(args.begin(), args.end(), "-headless");
+
+                if (headlessArg != args.end())
+                {
+                    // Simulate games without showing anything, then quit
+                    int nExitCode = HeadlessRunner::RunArgs(std::vector<std::string>(headlessArg + 1, args.end()), WriteToStdout);
+                    SetHeadless(true);
+                    _host.Quit(nExitCode);
+                    break;
+                }
+
+                ParseCommandLineArgs(args);
+            }
+
+            SetState(_playback ? APP_PLAYING_GAME : APP_TITLE);
             break;
 
         case APP_TITLE:
@@ -136,7 +227,38 @@ void PacApplication::Update()
 
     if (_game && !_game->IsPaused())
     {
-        _game->Advance();
+        // Holding rewind keeps the game stopped even after it can't go back any further
+        bool bRewind = _state == APP_PLAYING_GAME &&
+            _inputRes->digital_value(GetEventRewind()) &&
+            (_rewindFrames || _game->CanRewind());
+
+        if (bRewind)
+        {
+            if (!_rewindFrames)
+            {
+                ff::audio::pause_effects();
+            }
+
+            // Speeds up from 1x to 4x while held
+            _rewindFrames++;
+            _game->Rewind(std::min(MAX_REWIND_SPEED, 1 + _rewindFrames / REWIND_SPEEDUP_FRAMES));
+        }
+        else
+        {
+            if (_rewindFrames)
+            {
+                _rewindFrames = 0;
+                ff::audio::resume_effects();
+            }
+
+            // Holding fast forward runs more steps for each frame that gets shown
+            size_t nSpeed = _inputRes->digital_value(GetEventFastForward())
+                ? (size_t)std::max(2, _options.get<int>(OPTION_FAST_FORWARD_SPEED, DEFAULT_FAST_FORWARD_SPEED))
+                : _playSpeed;
+
+            _game->SetSpeed(nSpeed);
+            _game->Advance();
+        }
     }
 }
 
@@ -208,11 +330,16 @@ bool PacApplication::IsShowingStatusBar(IPlayingGame* pGame) const
     return true;
 }
 
+bool PacApplication::IsShowingGhostTrails(IPlayingGame* pGame) const
+{
+    return _options.get<bool>(OPTION_GHOST_TRAILS, DEFAULT_GHOST_TRAILS);
+}
+
 void PacApplication::OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlayer> pPlayer)
 {
     assert_ret(pPlayer);
 
-    if (_state == APP_PLAYING_GAME && pGame->GetMazes() && !pPlayer->DidCheat())
+    if (_state == APP_PLAYING_GAME && pGame->GetMazes() && !pPlayer->DidCheat() && !_pacController && !_playingReplay)
     {
         std::string_view mazesID = pGame->GetMazes()->GetID();
         Stats& stats = Stats::Get(mazesID);
@@ -221,7 +348,9 @@ void PacApplication::OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlay
 
         if (stats.GetHighScoreSlot(pPlayer->GetScore()) != ff::constants::invalid_unsigned<size_t>())
         {
-            std::shared_ptr<HighScoreScreen> pGame = std::make_shared<HighScoreScreen>(mazesID, pPlayer);
+            // Copied since the game keeps recording while the name is entered
+            std::shared_ptr<Replay> pReplay = pGame->GetReplay() ? std::make_shared<Replay>(*pGame->GetReplay()) : nullptr;
+            std::shared_ptr<HighScoreScreen> pGame = std::make_shared<HighScoreScreen>(mazesID, pPlayer, pReplay);
 
             _pushedGame = _game;
             _game = pGame;
@@ -232,6 +361,47 @@ void PacApplication::OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlay
     }
 }
 
+// What the user presses stays the same for every step of a frame, but the autopilot gets to change its mind
+void PacApplication::OnFastForwardStep(IPlayingGame* pGame)
+{
+    std::shared_ptr<IPlayingMaze> playMaze = (pGame == _game.get() && _pressDirFromController) ? GetCurrentPlayingMaze() : nullptr;
+    std::shared_ptr<IPlayingActor> pac = playMaze ? playMaze->GetPac() : nullptr;
+
+    if (pac)
+    {
+        pac->SetPressDir(_pacController->GetPressDir(playMaze.get()));
+    }
+}
+
+// -replay <path> plays a replay file instead of starting at the title.
+// -record <path> saves the replay of every game when it ends, replacing the one before.
+// -speed <steps> fast forwards all the time, up to IPlayingGame::MAX_SPEED steps for each frame.
+void PacApplication::ParseCommandLineArgs(const std::vector<std::string>& args)
+{
+    for (size_t i = 0; i + 1 < args.size(); i++)
+    {
+        if (args[i] == "-replay")
+        {
+            _playback = Replay::Load(std::filesystem::path(args[i + 1]));
+            assert(_playback);
+        }
+        else if (args[i] == "-record")
+        {
+            _recordPath = std::filesystem::path(args[i + 1]);
+        }
+        else if (args[i] == "-speed")
+        {
+            size_t nSpeed = 0;
+            std::string_view value = args[i + 1];
+
+            if (std::from_chars(value.data(), value.data() + value.size(), nSpeed).ec == std::errc() && nSpeed)
+            {
+                _playSpeed = nSpeed;
+            }
+        }
+    }
+}
+
 void PacApplication::HandleInputEvents()
 {
     bool unpause = false;
@@ -280,7 +450,7 @@ void PacApplication::HandleInputEvents()
             }
             else if (_state == APP_TITLE)
             {
-                _host.Quit();
+                _host.Quit(0);
             }
         }
         else if (ie.event_id == GetEventHome() && _state == APP_PLAYING_GAME)
@@ -328,8 +498,16 @@ void PacApplication::HandlePressing(ff::input_event_provider* inputMap)
     {
         // Tell the game about what directions the user is pressing
 
-        std::shared_ptr<IPlayingActor> pac = GetCurrentPac();
-        if (pac && !pressDir)
+        std::shared_ptr<IPlayingMaze> playMaze = GetCurrentPlayingMaze();
+        std::shared_ptr<IPlayingActor> pac = playMaze ? playMaze->GetPac() : nullptr;
+        _pressDirFromController = (pac && !pressDir && _pacController);
+
+        if (_pressDirFromController)
+        {
+            pac->SetPressDir(_pacController->GetPressDir(playMaze.get()));
+            _pressDirFromTouch = false;
+        }
+        else if (pac && !pressDir)
         {
             pressDir = HandleTouchPress(pac.get());
 
@@ -725,6 +903,11 @@ void PacApplication::SetState(EAppState state)
     {
         case APP_TITLE:
             {
+                if (_state == APP_PLAYING_GAME && _game && _game->GetReplay() && !_recordPath.empty())
+                {
+                    verify(_game->GetReplay()->Save(_recordPath));
+                }
+
                 std::shared_ptr<IPlayingGame> pTitle = std::make_shared<TitleScreen>();
                 std::swap(_game, pTitle);
                 _state = APP_TITLE;
@@ -734,10 +917,29 @@ void PacApplication::SetState(EAppState state)
         case APP_PLAYING_GAME:
             if (!_game)
             {
-                int players = _options.get<int>(OPTION_PAC_PLAYERS, DEFAULT_PAC_PLAYERS);
-                std::shared_ptr<IMazes> pMazes = CreateMazesFromId(TitleScreen::GetMazesID());
-                std::shared_ptr<IPlayingGame> pGame = IPlayingGame::Create(pMazes, players, this);
+                std::shared_ptr<IPlayingGame> pGame;
+
+                _playingReplay = false;
+
+                if (_playback)
+                {
+                    pGame = IPlayingGame::Create(_playback, this);
+                    _playingReplay = (pGame != nullptr);
+                    _playback = nullptr;
+                }
+
+                if (!pGame)
+                {
+                    int players = _options.get<int>(OPTION_PAC_PLAYERS, DEFAULT_PAC_PLAYERS);
+                    std::shared_ptr<IMazes> pMazes = CreateMazesFromId(TitleScreen::GetMazesID());
+                    pGame = IPlayingGame::Create(pMazes, players, this, Random::NewSeed());
+                }
+
                 std::swap(_game, pGame);
+
+                _pacController = _options.get<bool>(OPTION_AUTOPILOT, DEFAULT_AUTOPILOT)
+                    ? IPacController::CreateAutopilot()
+                    : nullptr;
             }
 
             _state = APP_PLAYING_GAME;
@@ -752,10 +954,17 @@ void PacApplication::SetState(EAppState state)
     assert(_state == state);
 }
 
-std::shared_ptr<IPlayingActor> PacApplication::GetCurrentPac() const
+std::shared_ptr<IPlayingMaze> PacApplication::GetCurrentPlayingMaze() const
 {
     std::shared_ptr<IPlayer> player = _game ? _game->GetPlayer(_game->GetCurrentPlayer()) : nullptr;
     std::shared_ptr<IPlayingMaze> playMaze = player ? player->GetPlayingMaze() : nullptr;
+
+    return playMaze;
+}
+
+std::shared_ptr<IPlayingActor> PacApplication::GetCurrentPac() const
+{
+    std::shared_ptr<IPlayingMaze> playMaze = GetCurrentPlayingMaze();
     std::shared_ptr<IPlayingActor> pac = playMaze ? playMaze->GetPac() : nullptr;
 
     return pac;
@@ -2,14 +2,17 @@
 
 #include "Core/PlayingGame.h"
 
+class IPacController;
 class IPlayingActor;
+class IPlayingMaze;
+class Replay;
 
 class IPacApplicationHost
 {
 public:
     virtual void ShowAboutDialog() = 0;
     virtual bool IsShowingPopup() const = 0;
-    virtual void Quit() = 0;
+    virtual void Quit(int nExitCode) = 0;
 };
 
 class PacApplication : public IPlayingGameHost
@@ -33,6 +36,9 @@ public:
     static std::string_view OPTION_SOUND_ON;
     static std::string_view OPTION_VIBRATE_ON;
     static std::string_view OPTION_FULL_SCREEN;
+    static std::string_view OPTION_GHOST_TRAILS;
+    static std::string_view OPTION_AUTOPILOT;
+    static std::string_view OPTION_FAST_FORWARD_SPEED;
 
     static const int DEFAULT_PAC_DIFF = 1;
     static const int DEFAULT_PAC_MAZES = 0;
@@ -40,6 +46,9 @@ public:
     static const bool DEFAULT_SOUND_ON = true;
     static const bool DEFAULT_VIBRATE_ON = true;
     static const bool DEFAULT_FULL_SCREEN = false;
+    static const bool DEFAULT_GHOST_TRAILS = false;
+    static const bool DEFAULT_AUTOPILOT = false;
+    static const int DEFAULT_FAST_FORWARD_SPEED = 8; // steps for each frame while fast forward is held
 
     // State
     void Update();
@@ -51,7 +60,9 @@ public:
     // IPlayingGameHost
     bool IsShowingScoreBar(IPlayingGame* pGame) const;
     bool IsShowingStatusBar(IPlayingGame* pGame) const;
+    bool IsShowingGhostTrails(IPlayingGame* pGame) const;
     void OnPlayerGameOver(IPlayingGame* pGame, std::shared_ptr<IPlayer> pPlayer);
+    void OnFastForwardStep(IPlayingGame* pGame);
 
 private:
     enum EAppState
@@ -69,6 +80,7 @@ private:
         PAUSE,
     };
 
+    void ParseCommandLineArgs(const std::vector<std::string>& args);
     void HandleInputEvents();
     void HandlePressing(ff::input_event_provider* inputMap);
     void HandleButtons(std::vector<ff::input_event>& events);
@@ -79,6 +91,7 @@ private:
     void RenderButtons(ff::dxgi::draw_base& draw);
     ff::rect_float GetButtonRect(EPlayButton button);
     void SetState(EAppState state);
+    std::shared_ptr<IPlayingMaze> GetCurrentPlayingMaze() const;
     std::shared_ptr<IPlayingActor> GetCurrentPac() const;
 
     IPacApplicationHost& _host;
@@ -87,6 +100,12 @@ private:
     std::shared_ptr<IPlayingGame> _game;
     std::shared_ptr<IPlayingGame> _pushedGame;
     std::shared_ptr<ff::input_event_provider> _inputRes;
+    std::shared_ptr<IPacController> _pacController; // drives Pac when nothing is pressed
+    size_t _rewindFrames{}; // how long rewind has been held
+    std::shared_ptr<Replay> _playback; // from the command line, played instead of the title
+    std::filesystem::path _recordPath;
+    bool _playingReplay{}; // replayed games can't get high scores
+    size_t _playSpeed{ 1 }; // steps for each frame when fast forward isn't held
 
     // Rendering
     ff::window_size _targetSize{};
@@ -98,6 +117,7 @@ private:
     // Touch controls
     bool _touching{};
     bool _pressDirFromTouch{};
+    bool _pressDirFromController{};
     double _touchLen{};
     ff::pointer_touch_info _touchInfo{};
     ff::point_double _touchStart{};
@@ -4,6 +4,7 @@
 #include "Core/Helpers.h"
 #include "Core/Maze.h"
 #include "Core/Mazes.h"
+#include "Core/PacController.h"
 #include "Core/PlayingGame.h"
 #include "Core/RenderMaze.h"
 #include "Core/RenderText.h"
@@ -144,6 +145,20 @@ void TitleScreen::CreateOptions()
                 : std::string("VIBRATE:OFF");
         };
 
+    auto ghostTrailsText = [options]()
+        {
+            return options->get<bool>(PacApplication::OPTION_GHOST_TRAILS, PacApplication::DEFAULT_GHOST_TRAILS)
+                ? std::string("GHOST TRAILS:ON")
+                : std::string("GHOST TRAILS:OFF");
+        };
+
+    auto autopilotText = [options]()
+        {
+            return options->get<bool>(PacApplication::OPTION_AUTOPILOT, PacApplication::DEFAULT_AUTOPILOT)
+                ? std::string("AUTOPILOT:ON")
+                : std::string("AUTOPILOT:OFF");
+        };
+
     auto fullScreenText = []
         {
             return ff::app_window().full_screen()
@@ -155,7 +170,7 @@ void TitleScreen::CreateOptions()
     optionPos.y += lineHeight;
 
     _options.push_back(Option(OPT_MSPAC, optionPos, msPacText, 1));
-    optionPos.y += lineHeight * 2;
+    optionPos.y += lineHeight + PixelsPerTile().y / 2; // a smaller gap leaves room above the high scores
 
     _options.push_back(Option(OPT_PLAYERS, optionPos, playersText));
     optionPos.y += lineHeight;
@@ -169,6 +184,12 @@ void TitleScreen::CreateOptions()
     _options.push_back(Option(OPT_VIBRATE, optionPos, vibrateText));
     optionPos.y += lineHeight;
 
+    _options.push_back(Option(OPT_GHOST_TRAILS, optionPos, ghostTrailsText));
+    optionPos.y += lineHeight;
+
+    _options.push_back(Option(OPT_AUTOPILOT, optionPos, autopilotText));
+    optionPos.y += lineHeight;
+
     _options.push_back(Option(OPT_FULL_SCREEN, optionPos, fullScreenText));
     optionPos.y += lineHeight;
 
@@ -193,7 +214,8 @@ bool TitleScreen::CreateBackMaze()
     std::shared_ptr<IMaze> pBackMaze = CreateMazeFromResource("title-maze-back");
     pBackMaze->SetCharType(CHAR_MS); // to get random ghost scattering
 
-    _backMaze = IPlayingMaze::Create(pBackMaze, GetEmptyDifficulty(), this);
+    _backMaze = IPlayingMaze::Create(pBackMaze, GetEmptyDifficulty(), this, Random::NewSeed());
+    _backPac = IPacController::CreateAutopilot();
     pBackMaze = _backMaze->GetMaze();
 
     // Remove all dots from the maze
@@ -262,6 +284,22 @@ void TitleScreen::Execute(EOption option, bool pressedLeft)
             }
             break;
 
+        case OPT_GHOST_TRAILS:
+            {
+                playEffect = true;
+                bool value = appOptions.get<bool>(PacApplication::OPTION_GHOST_TRAILS, PacApplication::DEFAULT_GHOST_TRAILS);
+                appOptions.set<bool>(PacApplication::OPTION_GHOST_TRAILS, !value);
+            }
+            break;
+
+        case OPT_AUTOPILOT:
+            {
+                playEffect = true;
+                bool value = appOptions.get<bool>(PacApplication::OPTION_AUTOPILOT, PacApplication::DEFAULT_AUTOPILOT);
+                appOptions.set<bool>(PacApplication::OPTION_AUTOPILOT, !value);
+            }
+            break;
+
         case OPT_FULL_SCREEN:
             {
                 playEffect = true;
@@ -353,6 +391,13 @@ void TitleScreen::Advance()
 
     if (_backMaze)
     {
+        // Attract mode, the autopilot keeps Pac away from the ghosts
+        std::shared_ptr<IPlayingActor> backPac = _backMaze->GetPac();
+        if (backPac && _backPac)
+        {
+            backPac->SetPressDir(_backPac->GetPressDir(_backMaze.get()));
+        }
+
         _backMaze->Advance();
     }
 
@@ -387,6 +432,8 @@ void TitleScreen::Advance()
                         case OPT_DIFF:
                         case OPT_SOUND:
                         case OPT_VIBRATE:
+                        case OPT_GHOST_TRAILS:
+                        case OPT_AUTOPILOT:
                         case OPT_FULL_SCREEN:
                             bExecute = true;
                             bLeft = (ie.event_id == GetEventLeft());
@@ -605,11 +652,45 @@ void TitleScreen::PausedAdvance()
 {
 }
 
-size_t TitleScreen::GetMazePlayer()
+bool TitleScreen::CanRewind() const
+{
+    return false;
+}
+
+void TitleScreen::Rewind(size_t nFrames)
+{
+}
+
+std::shared_ptr<Replay> TitleScreen::GetReplay()
+{
+    return nullptr;
+}
+
+bool TitleScreen::IsPlayingReplay() const
+{
+    return false;
+}
+
+size_t TitleScreen::GetReplayDivergedFrame() const
 {
     return ff::constants::invalid_unsigned<size_t>();
 }
 
+size_t TitleScreen::GetSpeed() const
+{
+    return 1;
+}
+
+void TitleScreen::SetSpeed(size_t nSpeed)
+{
+}
+
+// Being a player puts Pac in the back maze
+size_t TitleScreen::GetMazePlayer()
+{
+    return 0;
+}
+
 bool TitleScreen::IsPlayingLevel()
 {
     return false;
@@ -632,6 +713,26 @@ void TitleScreen::Reset()
 {
 }
 
+std::shared_ptr<IPlayingMaze> TitleScreen::Clone() const
+{
+    return nullptr;
+}
+
+size_t TitleScreen::GetSnapshotSize() const
+{
+    return 0;
+}
+
+bool TitleScreen::SaveSnapshot(BYTE* pData, size_t nSize) const
+{
+    return false;
+}
+
+bool TitleScreen::LoadSnapshot(const BYTE* pData, size_t nSize)
+{
+    return false;
+}
+
 GameState TitleScreen::GetGameState() const
 {
     return GS_PLAYING;
@@ -657,6 +758,11 @@ const Difficulty& TitleScreen::GetDifficulty() const
     return GetEmptyDifficulty();
 }
 
+Random& TitleScreen::GetRandom()
+{
+    return _random;
+}
+
 PacState TitleScreen::GetPacState() const
 {
     return PAC_NORMAL;
@@ -697,6 +803,11 @@ std::shared_ptr<IPlayingActor> TitleScreen::GetGhost(size_t nGhost)
     return nullptr;
 }
 
+const GhostPaths* TitleScreen::GetGhostPaths()
+{
+    return nullptr;
+}
+
 ff::point_int TitleScreen::GetGhostStartPixel() const
 {
     return ff::point_int(0, 0);
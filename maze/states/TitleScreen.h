@@ -5,6 +5,7 @@
 #include "Core/PlayingMaze.h"
 
 class PacApplication;
+class IPacController;
 class IRenderMaze;
 class IRenderText;
 class ISoundEffects;
@@ -39,6 +40,13 @@ public:
     virtual bool IsPaused() const override;
     virtual void TogglePaused() override;
     virtual void PausedAdvance() override;
+    virtual bool CanRewind() const override;
+    virtual void Rewind(size_t nFrames) override;
+    virtual std::shared_ptr<Replay> GetReplay() override;
+    virtual bool IsPlayingReplay() const override;
+    virtual size_t GetReplayDivergedFrame() const override;
+    virtual size_t GetSpeed() const override;
+    virtual void SetSpeed(size_t nSpeed) override;
 
     // IPlayingMazeHost
 
@@ -51,12 +59,17 @@ public:
     // IPlayingMaze
 
     virtual void Reset() override;
+    virtual std::shared_ptr<IPlayingMaze> Clone() const override;
+    virtual size_t GetSnapshotSize() const override;
+    virtual bool SaveSnapshot(BYTE* pData, size_t nSize) const override;
+    virtual bool LoadSnapshot(const BYTE* pData, size_t nSize) override;
 
     virtual GameState GetGameState() const override;
     virtual const Stats& GetStats() const override;
     virtual std::shared_ptr<IMaze> GetMaze() const override;
     virtual std::shared_ptr<IRenderMaze> GetRenderMaze() override;
     virtual const Difficulty& GetDifficulty() const override;
+    virtual Random& GetRandom() override;
 
     virtual PacState GetPacState() const override;
     virtual std::shared_ptr<IPlayingActor> GetPac() override;
@@ -67,6 +80,7 @@ public:
     virtual ff::point_int GetGhostEyeDir(size_t nGhost) const override;
     virtual GhostState GetGhostState(size_t nGhost) const override;
     virtual std::shared_ptr<IPlayingActor> GetGhost(size_t nGhost) override;
+    virtual const GhostPaths* GetGhostPaths() override;
 
     virtual ff::point_int GetGhostStartPixel() const override;
     virtual ff::point_int GetGhostStartTile() const override;
@@ -103,6 +117,8 @@ private:
         OPT_DIFF,
         OPT_SOUND,
         OPT_VIBRATE,
+        OPT_GHOST_TRAILS,
+        OPT_AUTOPILOT,
         OPT_FULL_SCREEN,
         OPT_ABOUT,
         OPT_NONE,
@@ -143,12 +159,14 @@ private:
     std::shared_ptr<IRenderMaze> _render;
     std::shared_ptr<IRenderText> _text;
     std::shared_ptr<IPlayingMaze> _backMaze;
+    std::shared_ptr<IPacController> _backPac; // plays the back maze while the title is up
     std::shared_ptr<ISoundEffects> _sounds;
     std::shared_ptr<ff::input_event_provider> _inputRes;
     std::vector<Option> _options;
     std::string _scores;
     size_t _curOption{};
     Stats _stats{};
+    Random _random{ Random::NewSeed() };
     float _fade{ 1 };
     bool _fading{ true };
     bool _done{};